@@ -0,0 +1,39 @@
+# Porównuje symbole eksportowane przez bibliotekę współdzieloną z listą symboli interfejsu.
+# Użycie: cmake -DNM=<nm> -DLIBRARY=<libpoly.so> -DSYMBOLS=<libpoly.sym> -P check_exports.cmake
+
+execute_process(COMMAND ${NM} -D --defined-only ${LIBRARY}
+                OUTPUT_VARIABLE NM_OUTPUT
+                RESULT_VARIABLE NM_RESULT)
+if (NOT NM_RESULT EQUAL 0)
+    message(FATAL_ERROR "${NM} -D --defined-only ${LIBRARY} failed")
+endif ()
+
+# Wiersze nm mają postać "adres typ nazwa"; interesują nas funkcje i dane.
+string(REGEX MATCHALL "[^\n]+" NM_LINES "${NM_OUTPUT}")
+set(EXPORTED)
+foreach (line ${NM_LINES})
+    if (line MATCHES " [TDBRVW] ([^ @]+)")
+        list(APPEND EXPORTED ${CMAKE_MATCH_1})
+    endif ()
+endforeach (line)
+list(SORT EXPORTED)
+
+# Lista ma jedną nazwę w wierszu; wiersze zaczynające się od # są komentarzami.
+file(READ ${SYMBOLS} SYMBOLS_TEXT)
+string(REGEX MATCHALL "(^|\n)[^#\n][^\n]*" EXPECTED "${SYMBOLS_TEXT}")
+string(REPLACE "\n" "" EXPECTED "${EXPECTED}")
+list(SORT EXPECTED)
+
+set(EXTRA ${EXPORTED})
+list(REMOVE_ITEM EXTRA ${EXPECTED})
+set(MISSING ${EXPECTED})
+if (EXPORTED)
+    list(REMOVE_ITEM MISSING ${EXPORTED})
+endif ()
+if (EXTRA OR MISSING)
+    string(REPLACE ";" " " EXTRA "${EXTRA}")
+    string(REPLACE ";" " " MISSING "${MISSING}")
+    message(FATAL_ERROR "${LIBRARY} does not match ${SYMBOLS}\n"
+                        "  unexpected symbols: ${EXTRA}\n"
+                        "  missing symbols: ${MISSING}")
+endif ()
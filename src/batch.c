@@ -0,0 +1,272 @@
+/** @file
+  Implementacja trybu wsadowego kalkulatora wielomianów
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+/** Udostępnia funkcje POSIX (wątki, katalogi) przy kompilacji z -std=c11. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "batch.h"
+#include "parallel.h"
+#include "parser.h"
+
+/** Rozmiar bufora strumienia wyjścia jednej sesji. */
+#define BATCH_OUTPUT_BUFFER 65536
+
+/** Struktura opisująca pojedynczą sesję w trybie wsadowym. */
+typedef struct BatchJob {
+    char *input; ///< ścieżka do pliku wejściowego
+    char *output; ///< ścieżka do pliku z wynikami
+    char *errors; ///< ścieżka do pliku z błędami
+    bool failed; ///< czy nie udało się otworzyć któregoś z plików
+} BatchJob;
+
+/** Struktura przechowująca listę sesji. */
+typedef struct BatchJobs {
+    BatchJob *arr; ///< tablica sesji
+    size_t size; ///< liczba sesji
+    size_t allocated_size; ///< rozmiar zaalokowanej pamięci w tablicy arr
+    atomic_size_t next; ///< indeks kolejnej sesji do wykonania
+    Stats stats; ///< łączne statystyki wszystkich sesji
+    pthread_mutex_t stats_lock; ///< blokada chroniąca łączne statystyki
+} BatchJobs;
+
+/**
+ * Skleja trzy napisy w nowo zaalokowany napis.
+ * @param[in] a : pierwszy napis
+ * @param[in] b : drugi napis
+ * @param[in] c : trzeci napis
+ * @return napis @p a @p b @p c
+ */
+static char *Concat(const char *a, const char *b, const char *c) {
+    size_t a_len = strlen(a), b_len = strlen(b), c_len = strlen(c);
+    char *res = (char*) MemoryAlloc(a_len + b_len + c_len + 1, MEMORY_WORK);
+    memcpy(res, a, a_len);
+    memcpy(res + a_len, b, b_len);
+    memcpy(res + a_len + b_len, c, c_len + 1);
+    return res;
+}
+
+/**
+ * Zwalnia napis zaalokowany funkcją Concat.
+ * @param[in] s : napis
+ */
+static void FreeString(char *s) {
+    MemoryFree(s, strlen(s) + 1, MEMORY_WORK);
+}
+
+/**
+ * Sprawdza, czy napis @p s kończy się napisem @p suffix.
+ * @param[in] s : napis
+ * @param[in] suffix : sufiks
+ * @return Czy @p s kończy się @p suffix?
+ */
+static bool EndsWith(const char *s, const char *suffix) {
+    size_t s_len = strlen(s), suffix_len = strlen(suffix);
+    return s_len >= suffix_len && strcmp(s + s_len - suffix_len, suffix) == 0;
+}
+
+/**
+ * Dodaje sesję dla pliku @p input. Przejmuje na własność napis @p input.
+ * @param[in,out] jobs : lista sesji
+ * @param[in] input : ścieżka do pliku wejściowego
+ * @param[in] out_dir : katalog na pliki wynikowe lub NULL
+ */
+static void AddJob(BatchJobs *jobs, char *input, const char *out_dir) {
+    if (jobs->size == jobs->allocated_size) {
+        size_t new_size = IncreaseSpace(jobs->allocated_size);
+        jobs->arr = (BatchJob*) MemoryRealloc(jobs->arr, jobs->allocated_size * sizeof(BatchJob),
+                                              new_size * sizeof(BatchJob), MEMORY_WORK);
+        jobs->allocated_size = new_size;
+    }
+
+    char *base = input;
+    if (out_dir != NULL) {
+        // pliki wynikowe umieszczamy w out_dir pod nazwą pliku wejściowego
+        char *slash = strrchr(input, '/');
+        base = Concat(out_dir, "/", (slash == NULL) ? input : slash + 1);
+    }
+
+    jobs->arr[jobs->size++] = (BatchJob) {
+        .input = input,
+        .output = Concat(base, BATCH_OUT_SUFFIX, ""),
+        .errors = Concat(base, BATCH_ERR_SUFFIX, ""),
+        .failed = false
+    };
+
+    if (base != input)
+        FreeString(base);
+}
+
+/**
+ * Porównuje dwa napisy, pomocnicza funkcja do sortowania nazw plików.
+ * @param[in] a : wskaźnik na pierwszy napis
+ * @param[in] b : wskaźnik na drugi napis
+ * @return wynik porównania napisów
+ */
+static int CompareNames(const void *a, const void *b) {
+    return strcmp(*(char* const*) a, *(char* const*) b);
+}
+
+/**
+ * Dodaje sesje dla wszystkich zwykłych plików z katalogu @p dir_path,
+ * w kolejności alfabetycznej, pomijając pliki wynikowe.
+ * @param[in,out] jobs : lista sesji
+ * @param[in] dir_path : ścieżka do katalogu
+ * @param[in] dir : otwarty katalog
+ * @param[in] out_dir : katalog na pliki wynikowe lub NULL
+ */
+static void AddDirectoryJobs(BatchJobs *jobs, const char *dir_path, DIR *dir, const char *out_dir) {
+    size_t size = 0, allocated_size = INIT_SIZE;
+    char **names = (char**) MemoryAlloc(allocated_size * sizeof(char*), MEMORY_WORK);
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.' || EndsWith(entry->d_name, BATCH_OUT_SUFFIX) ||
+            EndsWith(entry->d_name, BATCH_ERR_SUFFIX))
+            continue;
+
+        char *path = Concat(dir_path, "/", entry->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            FreeString(path);
+            continue;
+        }
+
+        if (size == allocated_size) {
+            size_t new_size = IncreaseSpace(allocated_size);
+            names = (char**) MemoryRealloc(names, allocated_size * sizeof(char*), new_size * sizeof(char*),
+                                           MEMORY_WORK);
+            allocated_size = new_size;
+        }
+        names[size++] = path;
+    }
+
+    // readdir nie gwarantuje kolejności, a chcemy deterministycznego wyniku
+    qsort(names, size, sizeof(char*), CompareNames);
+    for (size_t i = 0; i < size; ++i)
+        AddJob(jobs, names[i], out_dir);
+    MemoryFree(names, allocated_size * sizeof(char*), MEMORY_WORK);
+}
+
+/**
+ * Wykonuje jedną sesję: wczytuje polecenia z pliku wejściowego i zapisuje
+ * wyniki oraz błędy do plików wynikowych. Statystyki sesji dołącza do
+ * łącznych statystyk listy @p jobs.
+ * @param[in,out] jobs : lista sesji
+ * @param[in,out] job : sesja
+ */
+static void RunJob(BatchJobs *jobs, BatchJob *job) {
+    FILE *in = fopen(job->input, "r");
+    FILE *out = (in == NULL) ? NULL : fopen(job->output, "w");
+    FILE *err = (out == NULL) ? NULL : fopen(job->errors, "w");
+
+    if (err == NULL) {
+        job->failed = true;
+    }
+    else {
+        setvbuf(out, NULL, _IOFBF, BATCH_OUTPUT_BUFFER);
+        Reader reader = CreateReader(in);
+        Calculator c = InitCalculator(out, err);
+        ParseInput(&c, &reader);
+        pthread_mutex_lock(&jobs->stats_lock);
+        StatsMerge(&jobs->stats, &c.stats);
+        pthread_mutex_unlock(&jobs->stats_lock);
+        CalculatorClear(&c);
+        DestroyReader(&reader);
+    }
+
+    if (err != NULL)
+        fclose(err);
+    if (out != NULL)
+        fclose(out);
+    if (in != NULL)
+        fclose(in);
+}
+
+/**
+ * Funkcja wykonywana przez wątek roboczy, pobiera kolejne sesje z listy
+ * aż do jej wyczerpania.
+ * @param[in,out] arg : lista sesji
+ * @return NULL
+ */
+static void *BatchWorker(void *arg) {
+    BatchJobs *jobs = (BatchJobs*) arg;
+    size_t i;
+    while ((i = atomic_fetch_add(&jobs->next, 1)) < jobs->size)
+        RunJob(jobs, &jobs->arr[i]);
+    return NULL;
+}
+
+int RunBatch(size_t count, char *paths[], size_t threads, const char *out_dir, const char *stats_file) {
+    BatchJobs jobs;
+    jobs.size = 0;
+    jobs.allocated_size = INIT_SIZE;
+    jobs.arr = (BatchJob*) MemoryAlloc(jobs.allocated_size * sizeof(BatchJob), MEMORY_WORK);
+    atomic_init(&jobs.next, 0);
+    StatsReset(&jobs.stats);
+    pthread_mutex_init(&jobs.stats_lock, NULL);
+
+    for (size_t i = 0; i < count; ++i) {
+        DIR *dir = opendir(paths[i]);
+        if (dir != NULL) {
+            AddDirectoryJobs(&jobs, paths[i], dir, out_dir);
+            closedir(dir);
+        }
+        else {
+            AddJob(&jobs, Concat(paths[i], "", ""), out_dir);
+        }
+    }
+
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (size_t) cpus : 1;
+    }
+    if (threads > jobs.size)
+        threads = jobs.size;
+
+    pthread_t *workers = (pthread_t*) MemoryAlloc((threads + 1) * sizeof(pthread_t), MEMORY_WORK);
+    size_t started = 0;
+    // wątek główny też wykonuje sesje, więc uruchamiamy o jeden wątek mniej;
+    // zajęte procesory nie są już dostępne dla ParallelRun w sesjach
+    size_t reserved = ParallelReserve((threads > 0) ? threads - 1 : 0);
+    for (size_t i = 1; i < threads; ++i) {
+        if (pthread_create(&workers[started], NULL, BatchWorker, &jobs) == 0)
+            started++;
+    }
+    BatchWorker(&jobs);
+    for (size_t i = 0; i < started; ++i)
+        pthread_join(workers[i], NULL);
+    ParallelRelease(reserved);
+    MemoryFree(workers, (threads + 1) * sizeof(pthread_t), MEMORY_WORK);
+
+    pthread_mutex_destroy(&jobs.stats_lock);
+
+    int result = 0;
+    if (stats_file != NULL && !StatsDump(&jobs.stats, stats_file)) {
+        fprintf(stderr, "ERROR CANNOT OPEN %s\n", stats_file);
+        result = 1;
+    }
+
+    for (size_t i = 0; i < jobs.size; ++i) {
+        if (jobs.arr[i].failed) {
+            fprintf(stderr, "ERROR CANNOT OPEN %s\n", jobs.arr[i].input);
+            result = 1;
+        }
+        FreeString(jobs.arr[i].input);
+        FreeString(jobs.arr[i].output);
+        FreeString(jobs.arr[i].errors);
+    }
+    MemoryFree(jobs.arr, jobs.allocated_size * sizeof(BatchJob), MEMORY_WORK);
+
+    return result;
+}
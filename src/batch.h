@@ -0,0 +1,38 @@
+/** @file
+  Interfejs trybu wsadowego kalkulatora wielomianów
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef POLYNOMIALS_BATCH_H
+#define POLYNOMIALS_BATCH_H
+
+#include <stddef.h>
+
+/** Rozszerzenie pliku, do którego zapisywane są wyniki poleceń sesji. */
+#define BATCH_OUT_SUFFIX ".out"
+/** Rozszerzenie pliku, do którego zapisywane są błędy sesji. */
+#define BATCH_ERR_SUFFIX ".err"
+
+/**
+ * Uruchamia tryb wsadowy. Każdy plik z listy @p paths (a w przypadku katalogu
+ * każdy zwykły plik w nim, w kolejności alfabetycznej, z pominięciem plików
+ * wynikowych) jest wykonywany jako niezależna sesja kalkulatora z własnym
+ * stosem, parserem i buforem wyjścia. Sesje są rozdzielane między @p threads
+ * wątków. Wyniki sesji dla pliku `x` trafiają do plików `x.out` i `x.err`
+ * (w katalogu @p out_dir, jeżeli jest podany), więc nie zależą od kolejności
+ * wykonania. Pliki, których nie udało się otworzyć, są zgłaszane na
+ * standardowe wyjście błędów w kolejności z listy. Jeżeli podano @p stats_file,
+ * to na koniec zapisuje do niego łączne statystyki wszystkich sesji.
+ * @param[in] count : liczba ścieżek
+ * @param[in] paths : ścieżki do plików lub katalogów
+ * @param[in] threads : liczba wątków (0 oznacza liczbę dostępnych procesorów)
+ * @param[in] out_dir : katalog na pliki wynikowe lub NULL
+ * @param[in] stats_file : plik na statystyki lub NULL
+ * @return 0, jeżeli wszystkie sesje zostały wykonane, 1 w przeciwnym przypadku
+ */
+int RunBatch(size_t count, char *paths[], size_t threads, const char *out_dir, const char *stats_file);
+
+#endif //POLYNOMIALS_BATCH_H
@@ -0,0 +1,345 @@
+/** @file
+  Implementacja budowania wielomianu z nieuporządkowanego strumienia wyrazów
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include <string.h>
+#include "builder.h"
+
+/** Początkowa liczba miejsc na stosie serii; rozmiary serii maleją dwukrotnie, więc rzadko brakuje miejsca. */
+#define BUILDER_RUNS 8
+
+/**
+ * Alokuje serię na @p size wyrazów. Tablice mają jeden element zapasu,
+ * żeby nie alokować pustych bloków dla serii bez wyrazów lub bez zmiennych.
+ * @param[in] vars : liczba wykładników wyrazu
+ * @param[in] size : liczba wyrazów
+ * @return seria o rozmiarze @p size
+ */
+static BuilderRun RunAlloc(size_t vars, size_t size) {
+    BuilderRun run;
+    run.exps = (poly_exp_t*) MemoryAlloc((size * vars + 1) * sizeof(poly_exp_t), MEMORY_WORK);
+    run.coeffs = (poly_coeff_t*) MemoryAlloc((size + 1) * sizeof(poly_coeff_t), MEMORY_WORK);
+    run.size = size;
+    return run;
+}
+
+/**
+ * Zmniejsza tablice serii zaalokowanej na @p allocated wyrazów do jej rozmiaru.
+ * @param[in,out] run : seria
+ * @param[in] vars : liczba wykładników wyrazu
+ * @param[in] allocated : liczba wyrazów, na którą seria została zaalokowana
+ */
+static void RunShrink(BuilderRun *run, size_t vars, size_t allocated) {
+    if (run->size == allocated)
+        return;
+    run->exps = (poly_exp_t*) MemoryRealloc(run->exps, (allocated * vars + 1) * sizeof(poly_exp_t),
+                                            (run->size * vars + 1) * sizeof(poly_exp_t), MEMORY_WORK);
+    run->coeffs = (poly_coeff_t*) MemoryRealloc(run->coeffs, (allocated + 1) * sizeof(poly_coeff_t),
+                                                (run->size + 1) * sizeof(poly_coeff_t), MEMORY_WORK);
+}
+
+/**
+ * Zwalnia serię o @p size wyrazach.
+ * @param[in,out] run : seria
+ * @param[in] vars : liczba wykładników wyrazu
+ * @param[in] size : liczba wyrazów, na którą seria jest zaalokowana
+ */
+static void RunFree(BuilderRun *run, size_t vars, size_t size) {
+    MemoryFree(run->exps, (size * vars + 1) * sizeof(poly_exp_t), MEMORY_WORK);
+    MemoryFree(run->coeffs, (size + 1) * sizeof(poly_coeff_t), MEMORY_WORK);
+    run->exps = NULL;
+    run->coeffs = NULL;
+    run->size = 0;
+}
+
+/**
+ * Porównuje leksykograficznie wektory wykładników dwóch wyrazów.
+ * @param[in] a : wykładniki pierwszego wyrazu
+ * @param[in] b : wykładniki drugiego wyrazu
+ * @param[in] vars : liczba wykładników
+ * @return liczba ujemna, zero lub dodatnia, gdy @p a jest mniejszy, równy lub większy od @p b
+ */
+static int CompareTerms(const poly_exp_t *a, const poly_exp_t *b, size_t vars) {
+    for (size_t k = 0; k < vars; ++k) {
+        if (a[k] != b[k])
+            return (a[k] > b[k]) - (a[k] < b[k]);
+    }
+    return 0;
+}
+
+/**
+ * Dopisuje wyraz na koniec serii, łącząc go z ostatnim wyrazem, jeżeli mają
+ * równe wykładniki. Wyraz, którego współczynnik stał się zerem, jest usuwany
+ * przy dopisaniu następnego wyrazu lub w RunSeal.
+ * @param[in,out] run : seria z miejscem na wyraz
+ * @param[in] vars : liczba wykładników wyrazu
+ * @param[in] exps : wykładniki wyrazu
+ * @param[in] coeff : współczynnik wyrazu
+ */
+static void RunAppend(BuilderRun *run, size_t vars, const poly_exp_t *exps, poly_coeff_t coeff) {
+    if (run->size > 0) {
+        poly_exp_t *last = run->exps + (run->size - 1) * vars;
+        if (CompareTerms(last, exps, vars) == 0) {
+            run->coeffs[run->size - 1] += coeff;
+            return;
+        }
+        if (run->coeffs[run->size - 1] == 0)
+            run->size--;
+    }
+    memcpy(run->exps + run->size * vars, exps, vars * sizeof(poly_exp_t));
+    run->coeffs[run->size++] = coeff;
+}
+
+/**
+ * Usuwa z końca serii wyraz o zerowym współczynniku pozostawiony przez RunAppend.
+ * @param[in,out] run : seria
+ */
+static void RunSeal(BuilderRun *run) {
+    if (run->size > 0 && run->coeffs[run->size - 1] == 0)
+        run->size--;
+}
+
+/**
+ * Scala dwie serie w jedną, łącząc wyrazy podobne, i zwalnia je.
+ * @param[in,out] a : seria
+ * @param[in,out] b : seria
+ * @param[in] vars : liczba wykładników wyrazu
+ * @return scalona seria
+ */
+static BuilderRun RunMerge(BuilderRun *a, BuilderRun *b, size_t vars) {
+    size_t allocated = a->size + b->size;
+    BuilderRun merged = RunAlloc(vars, allocated);
+    merged.size = 0;
+
+    size_t i = 0, j = 0;
+    while (i < a->size || j < b->size) {
+        const poly_exp_t *a_exps = a->exps + i * vars, *b_exps = b->exps + j * vars;
+        if (j == b->size || (i < a->size && CompareTerms(a_exps, b_exps, vars) <= 0)) {
+            RunAppend(&merged, vars, a_exps, a->coeffs[i]);
+            i++;
+        }
+        else {
+            RunAppend(&merged, vars, b_exps, b->coeffs[j]);
+            j++;
+        }
+    }
+    RunSeal(&merged);
+    RunShrink(&merged, vars, allocated);
+
+    RunFree(a, vars, a->size);
+    RunFree(b, vars, b->size);
+    return merged;
+}
+
+/**
+ * Sortuje indeksy wyrazów bufora przez scalanie od dołu.
+ * @param[in] buffer : bufor wyrazów
+ * @param[in] vars : liczba wykładników wyrazu
+ * @param[in,out] idx : tablica na buffer->size indeksów
+ * @param[in,out] tmp : tablica pomocnicza tego samego rozmiaru
+ * @return tablica (@p idx lub @p tmp) z indeksami w kolejności wyrazów
+ */
+static size_t *SortTerms(const BuilderRun *buffer, size_t vars, size_t *idx, size_t *tmp) {
+    size_t n = buffer->size;
+    for (size_t i = 0; i < n; ++i)
+        idx[i] = i;
+
+    for (size_t width = 1; width < n; width *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * width) {
+            size_t mid = (lo + width < n) ? lo + width : n;
+            size_t hi = (lo + 2 * width < n) ? lo + 2 * width : n;
+            size_t i = lo, j = mid, k = lo;
+            while (i < mid && j < hi) {
+                const poly_exp_t *a = buffer->exps + idx[i] * vars, *b = buffer->exps + idx[j] * vars;
+                tmp[k++] = (CompareTerms(a, b, vars) <= 0) ? idx[i++] : idx[j++];
+            }
+            while (i < mid)
+                tmp[k++] = idx[i++];
+            while (j < hi)
+                tmp[k++] = idx[j++];
+        }
+        size_t *swap = idx;
+        idx = tmp;
+        tmp = swap;
+    }
+    return idx;
+}
+
+/**
+ * Kładzie serię na stos, scalając ją wcześniej z seriami, od których nie jest
+ * co najmniej dwa razy mniejsza.
+ * @param[in,out] b : budowniczy
+ * @param[in] run : seria
+ */
+static void PushRun(PolyBuilder *b, BuilderRun run) {
+    while (b->runs_count > 0 && 2 * run.size > b->runs[b->runs_count - 1].size)
+        run = RunMerge(&b->runs[--b->runs_count], &run, b->vars);
+
+    if (run.size == 0) {
+        RunFree(&run, b->vars, 0);
+        return;
+    }
+    if (b->runs_count == b->runs_capacity) {
+        size_t capacity = IncreaseSpace(b->runs_capacity);
+        b->runs = (BuilderRun*) MemoryRealloc(b->runs, b->runs_capacity * sizeof(BuilderRun),
+                                              capacity * sizeof(BuilderRun), MEMORY_WORK);
+        b->runs_capacity = capacity;
+    }
+    b->runs[b->runs_count++] = run;
+}
+
+/**
+ * Zamienia wyrazy z bufora w posortowaną serię i kładzie ją na stos.
+ * @param[in,out] b : budowniczy
+ */
+static void FlushBuffer(PolyBuilder *b) {
+    size_t n = b->buffer.size;
+    if (n == 0)
+        return;
+
+    size_t *idx = (size_t*) MemoryAlloc(2 * n * sizeof(size_t), MEMORY_WORK);
+    size_t *sorted = SortTerms(&b->buffer, b->vars, idx, idx + n);
+    BuilderRun run = RunAlloc(b->vars, n);
+    run.size = 0;
+    for (size_t i = 0; i < n; ++i)
+        RunAppend(&run, b->vars, b->buffer.exps + sorted[i] * b->vars, b->buffer.coeffs[sorted[i]]);
+    RunSeal(&run);
+    RunShrink(&run, b->vars, n);
+    MemoryFree(idx, 2 * n * sizeof(size_t), MEMORY_WORK);
+
+    b->buffer.size = 0;
+    PushRun(b, run);
+}
+
+void InitPolyBuilder(PolyBuilder *b, size_t vars) {
+    b->vars = vars;
+    b->buffer = RunAlloc(vars, POLY_BUILDER_RUN);
+    b->buffer.size = 0;
+    b->runs = (BuilderRun*) MemoryAlloc(BUILDER_RUNS * sizeof(BuilderRun), MEMORY_WORK);
+    b->runs_count = 0;
+    b->runs_capacity = BUILDER_RUNS;
+}
+
+void PolyBuilderAdd(PolyBuilder *b, const poly_exp_t exps[], poly_coeff_t coeff) {
+    if (coeff == 0)
+        return;
+    if (b->buffer.size == POLY_BUILDER_RUN)
+        FlushBuffer(b);
+
+    poly_exp_t *dst = b->buffer.exps + b->buffer.size * b->vars;
+    for (size_t k = 0; k < b->vars; ++k) {
+        assert(exps[k] >= 0);
+        dst[k] = exps[k];
+    }
+    b->buffer.coeffs[b->buffer.size++] = coeff;
+}
+
+/** Poziom budowy wielomianu: wyrazy o wspólnych wykładnikach poprzednich zmiennych. */
+typedef struct BuildFrame {
+    size_t i; ///< indeks kolejnego wyrazu do przetworzenia
+    size_t end; ///< indeks za ostatnim wyrazem poziomu
+    Mono *monos; ///< jednomiany budowanego wielomianu
+    size_t count; ///< liczba zapisanych jednomianów
+    Poly *dst; ///< miejsce na zbudowany wielomian
+} BuildFrame;
+
+/**
+ * Tworzy poziom budowy dla wyrazów z przedziału [@p begin, @p end), alokując
+ * tablicę na tyle jednomianów, ile jest różnych wykładników zmiennej @p level.
+ * @param[in] run : seria
+ * @param[in] vars : liczba wykładników wyrazu
+ * @param[in] level : indeks zmiennej
+ * @param[in] begin : indeks pierwszego wyrazu
+ * @param[in] end : indeks za ostatnim wyrazem
+ * @param[out] dst : miejsce na zbudowany wielomian
+ * @return poziom budowy
+ */
+static BuildFrame InitBuildFrame(const BuilderRun *run, size_t vars, size_t level,
+                                 size_t begin, size_t end, Poly *dst) {
+    size_t groups = 1;
+    for (size_t i = begin + 1; i < end; ++i) {
+        if (run->exps[i * vars + level] != run->exps[(i - 1) * vars + level])
+            groups++;
+    }
+    Mono *monos = (Mono*) MemoryPoolCalloc(groups * sizeof(Mono), MEMORY_MONOS);
+    return (BuildFrame) {.i = begin, .end = end, .monos = monos, .count = 0, .dst = dst};
+}
+
+/**
+ * Buduje wielomian z posortowanej serii. Wyrazy o wspólnych wykładnikach
+ * zmiennych @f$x_0, \ldots, x_{k-1}@f$ leżą w serii obok siebie, więc każdy
+ * poziom przechodzi po swoim przedziale raz, a jednomiany powstają od razu
+ * w kolejności rosnących wykładników.
+ * @param[in] run : seria
+ * @param[in] vars : liczba wykładników wyrazu
+ * @return wielomian będący sumą wyrazów serii
+ */
+static Poly BuildPoly(const BuilderRun *run, size_t vars) {
+    if (run->size == 0)
+        return PolyZero();
+    else if (vars == 0)
+        return PolyFromCoeff(run->coeffs[0]);
+
+    Poly result;
+    BuildFrame *frames = (BuildFrame*) MemoryAlloc(vars * sizeof(BuildFrame), MEMORY_WORK);
+    size_t depth = 0;
+    frames[depth++] = InitBuildFrame(run, vars, 0, 0, run->size, &result);
+
+    while (depth > 0) {
+        BuildFrame *top = &frames[depth - 1];
+        size_t level = depth - 1;
+        if (top->i == top->end) {
+            *top->dst = PolyOwnSortedMonos(top->count, top->monos);
+            depth--;
+            continue;
+        }
+
+        size_t begin = top->i;
+        poly_exp_t exp = run->exps[begin * vars + level];
+        while (top->i < top->end && run->exps[top->i * vars + level] == exp)
+            top->i++;
+
+        Mono *m = &top->monos[top->count++];
+        m->exp = exp;
+        if (level + 1 == vars) {
+            // w serii nie ma dwóch wyrazów o tych samych wykładnikach
+            assert(top->i == begin + 1);
+            m->p = PolyFromCoeff(run->coeffs[begin]);
+        }
+        else {
+            frames[depth++] = InitBuildFrame(run, vars, level + 1, begin, top->i, &m->p);
+        }
+    }
+
+    MemoryFree(frames, vars * sizeof(BuildFrame), MEMORY_WORK);
+    return result;
+}
+
+Poly PolyBuilderFinish(PolyBuilder *b) {
+    FlushBuffer(b);
+    if (b->runs_count == 0)
+        return PolyZero();
+
+    BuilderRun all = b->runs[--b->runs_count];
+    while (b->runs_count > 0)
+        all = RunMerge(&b->runs[--b->runs_count], &all, b->vars);
+
+    Poly result = BuildPoly(&all, b->vars);
+    RunFree(&all, b->vars, all.size);
+    return result;
+}
+
+void PolyBuilderDestroy(PolyBuilder *b) {
+    while (b->runs_count > 0) {
+        BuilderRun *run = &b->runs[--b->runs_count];
+        RunFree(run, b->vars, run->size);
+    }
+    MemoryFree(b->runs, b->runs_capacity * sizeof(BuilderRun), MEMORY_WORK);
+    RunFree(&b->buffer, b->vars, POLY_BUILDER_RUN);
+    b->runs = NULL;
+    b->runs_capacity = 0;
+}
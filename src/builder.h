@@ -0,0 +1,82 @@
+/** @file
+  Interfejs budowania wielomianu z nieuporządkowanego strumienia wyrazów
+
+  PolyAddMonos, PolyOwnMonos i PolyCloneMonos potrzebują od razu całej
+  tablicy jednomianów. Budowniczy PolyBuilder przyjmuje wyrazy (wektor
+  wykładników i współczynnik) pojedynczo, w dowolnej kolejności. Wyrazy
+  trafiają do bufora, który po zapełnieniu jest sortowany i zamieniany
+  w posortowaną serię z połączonymi wyrazami podobnymi. Serie leżą na stosie
+  o rozmiarach malejących co najmniej dwukrotnie: nowa seria jest scalana
+  z poprzednią, dopóki nie jest od niej dwa razy mniejsza. Serie zawierają
+  tylko różne wyrazy, więc zajmują łącznie co najwyżej około dwa razy tyle
+  pamięci co wynik, niezależnie od liczby dodanych wyrazów. PolyBuilderFinish
+  scala pozostałe serie i buduje z nich wielomian w jednym przejściu,
+  bez sortowania jednomianów.
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef POLYNOMIALS_BUILDER_H
+#define POLYNOMIALS_BUILDER_H
+
+#include "poly.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Liczba wyrazów w buforze, po której bufor jest zamieniany w serię. */
+#define POLY_BUILDER_RUN 4096
+
+/** Posortowana seria różnych wyrazów o niezerowych współczynnikach. */
+typedef struct BuilderRun {
+    poly_exp_t *exps; ///< wykładniki wyrazów, po `vars` na wyraz
+    poly_coeff_t *coeffs; ///< współczynniki wyrazów
+    size_t size; ///< liczba wyrazów
+} BuilderRun;
+
+/** Budowniczy wielomianu od ustalonej liczby zmiennych. */
+typedef struct PolyBuilder {
+    size_t vars; ///< liczba wykładników wyrazu
+    BuilderRun buffer; ///< nieposortowane wyrazy, mieści POLY_BUILDER_RUN wyrazów
+    BuilderRun *runs; ///< stos serii o malejących rozmiarach
+    size_t runs_count; ///< liczba serii na stosie
+    size_t runs_capacity; ///< liczba serii mieszczących się w tablicy runs
+} PolyBuilder;
+
+/**
+ * Tworzy pustego budowniczego wielomianu od zmiennych @f$x_0, \ldots, x_{vars-1}@f$.
+ * @param[out] b : budowniczy
+ * @param[in] vars : liczba zmiennych
+ */
+POLY_API void InitPolyBuilder(PolyBuilder *b, size_t vars);
+
+/**
+ * Dodaje wyraz @f$coeff \cdot x_0^{exps[0]} \cdots x_{vars-1}^{exps[vars-1]}@f$.
+ * @param[in,out] b : budowniczy
+ * @param[in] exps : @p vars nieujemnych wykładników
+ * @param[in] coeff : współczynnik
+ */
+POLY_API void PolyBuilderAdd(PolyBuilder *b, const poly_exp_t exps[], poly_coeff_t coeff);
+
+/**
+ * Daje sumę wszystkich dodanych wyrazów i opróżnia budowniczego, który może
+ * być dalej używany.
+ * @param[in,out] b : budowniczy
+ * @return wielomian będący sumą wyrazów
+ */
+POLY_API Poly PolyBuilderFinish(PolyBuilder *b);
+
+/**
+ * Zwalnia pamięć budowniczego wraz z dodanymi wyrazami.
+ * @param[in,out] b : budowniczy
+ */
+POLY_API void PolyBuilderDestroy(PolyBuilder *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //POLYNOMIALS_BUILDER_H
@@ -1,8 +1,116 @@
-#include "calculator.h"
-
-int main() {
-    Stack s = InitStack();
-    ParseInput(&s);
-    StackClear(&s);
-    return 0;
-}
\ No newline at end of file
+/** @file
+  Program kalkulatora wielomianów
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include <string.h>
+#include "batch.h"
+#include "dataflow.h"
+#include "modular.h"
+#include "parser.h"
+#include "pipeline.h"
+#include "reclaimer.h"
+
+/**
+ * Wypisuje sposób użycia programu.
+ * @param[in] name : nazwa programu
+ */
+static void Usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-s STATS_FILE] [-r NODES] [-m] [-p | -d THREADS] [-j THREADS] [-o OUT_DIR] [FILE|DIR]...\n", name);
+}
+
+/**
+ * Uruchamia kalkulator. Bez listy plików wykonuje jedną sesję na standardowym
+ * wejściu. Z listą plików lub katalogów uruchamia tryb wsadowy. Opcja `-s`
+ * zapisuje na koniec statystyki czasu wykonania poleceń do podanego pliku.
+ * Opcja `-r` uruchamia wątek zwalniający w tle wielomiany mające co najmniej
+ * podaną liczbę jednomianów (0 oznacza RECLAIM_DEFAULT_THRESHOLD).
+ * Opcja `-d` wykonuje sesję na standardowym wejściu w trybie przepływu danych
+ * (dataflow.h), w którym niezależne polecenia działają współbieżnie w podanej
+ * liczbie wątków (0 oznacza liczbę procesorów). Opcja `-p` wykonuje sesję
+ * na standardowym wejściu w trybie potokowym (pipeline.h), w którym wiersze
+ * są wczytywane w osobnym wątku. Opcja `-m` włącza tryb modularny mnożenia
+ * (modular.h), w którym duże iloczyny są liczone modulo kilka liczb pierwszych
+ * w osobnych wątkach.
+ */
+int main(int argc, char *argv[]) {
+    size_t threads = 0;
+    const char *out_dir = NULL;
+    const char *stats_file = NULL;
+    bool reclaim = false;
+    size_t reclaim_threshold = 0;
+    bool dataflow = false;
+    size_t dataflow_threads = 0;
+    bool pipeline = false;
+    int i = 1;
+
+    for (; i < argc && argv[i][0] == '-'; ++i) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            stats_file = argv[++i];
+        }
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            dataflow = true;
+            dataflow_threads = strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-p") == 0) {
+            pipeline = true;
+        }
+        else if (strcmp(argv[i], "-m") == 0) {
+            ModularSetEnabled(true);
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            reclaim = true;
+            reclaim_threshold = strtoul(argv[++i], NULL, 10);
+        }
+        else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if ((i == argc && (threads != 0 || out_dir != NULL)) || (i < argc && (dataflow || pipeline)) ||
+        (dataflow && pipeline)) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    if (reclaim)
+        ReclaimerStart(reclaim_threshold);
+
+    if (i < argc) {
+        int result = RunBatch((size_t) (argc - i), argv + i, threads, out_dir, stats_file);
+        ReclaimerStop();
+        MemoryPoolTrim();
+        return result;
+    }
+
+    Calculator c = InitCalculator(stdout, stderr);
+    Reader reader = CreateReader(stdin);
+    if (dataflow)
+        DataflowInput(&c, &reader, dataflow_threads);
+    else if (pipeline)
+        PipelineInput(&c, &reader);
+    else
+        ParseInput(&c, &reader);
+
+    int result = 0;
+    if (stats_file != NULL && !StatsDump(&c.stats, stats_file)) {
+        fprintf(stderr, "ERROR CANNOT OPEN %s\n", stats_file);
+        result = 1;
+    }
+
+    CalculatorClear(&c);
+    DestroyReader(&reader);
+    ReclaimerStop();
+    MemoryPoolTrim();
+    return result;
+}
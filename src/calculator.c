@@ -7,128 +7,247 @@
 */
 
 #include "calculator.h"
+#include "partial.h"
+#include "work_stack.h"
+
+Calculator InitCalculator(FILE *out, FILE *err) {
+    Calculator c = {.stack = InitStack(), .out = out, .err = err};
+    StatsReset(&c.stats);
+    return c;
+}
+
+void CalculatorClear(Calculator *c) {
+    StackClear(&c->stack);
+}
 
 /**
- * Funkcja pomocnicza do wypisywania wielomianu.
+ * Wypisuje wielomian, który nie ma tablicy jednomianów.
+ * @param[in] out : strumień wyjścia
+ * @param[in] p : wielomian stały lub zapisany bez tablicy jednomianów
+ */
+static void PrintLeaf(FILE *out, const Poly *p) {
+    if (PolyIsCoeff(p))
+        fprintf(out, "%ld", p->coeff);
+    else
+        fprintf(out, "(%ld,%d)", p->coeff, PolyInlineExp(p));
+}
+
+/**
+ * Wypisuje zakończenie @p i-tego jednomianu wielomianu @p p.
+ * @param[in] out : strumień wyjścia
  * @param[in] p : wielomian
+ * @param[in] i : indeks jednomianu
  */
-void PrintHelper(const Poly *p) {
-    if (PolyIsCoeff(p)) {
-        printf("%ld", p->coeff);
+static void PrintMonoEnd(FILE *out, const Poly *p, size_t i) {
+    fprintf(out, ",%d)", MonoGetExp(&PolyMonos(p)[i]));
+    if (i != PolyGetSize(p) - 1)
+        putc('+', out);
+}
+
+/**
+ * Ramka przejścia wypisującego wielomian. Wielomian jest widokiem
+ * z uwzględnionym znakiem.
+ */
+typedef struct PrintFrame {
+    Poly p; ///< wielomian z tablicą jednomianów
+    size_t i; ///< indeks kolejnego jednomianu do wypisania
+} PrintFrame;
+
+void PrintHelper(FILE *out, const Poly *p) {
+    if (PolyIsCoeff(p) || PolyIsInline(p)) {
+        PrintLeaf(out, p);
         return;
     }
 
-    for (size_t i = 0; i < p->size; ++i) {
-        printf("(");
-        PrintHelper(&p->arr[i].p);
-        printf(",%d)", p->arr[i].exp);
+    PrintFrame local[WORK_STACK_LOCAL_SIZE];
+    WorkStack ws = InitWorkStack(local, WORK_STACK_LOCAL_SIZE, sizeof(PrintFrame));
+    *(PrintFrame*) WorkStackPush(&ws) = (PrintFrame) {.p = *p, .i = 0};
+
+    while (!WorkStackIsEmpty(&ws)) {
+        PrintFrame *top = (PrintFrame*) WorkStackTop(&ws);
+        if (top->i == PolyGetSize(&top->p)) {
+            WorkStackPop(&ws);
+            // wielomian był współczynnikiem jednomianu, który trzeba teraz zamknąć
+            if (!WorkStackIsEmpty(&ws)) {
+                top = (PrintFrame*) WorkStackTop(&ws);
+                PrintMonoEnd(out, &top->p, top->i - 1);
+            }
+            continue;
+        }
 
-        if (i != p->size - 1)
-            printf("+");
+        Poly coeff = PolyGetMono(&top->p, top->i++).p;
+        putc('(', out);
+        if (PolyIsCoeff(&coeff) || PolyIsInline(&coeff)) {
+            PrintLeaf(out, &coeff);
+            PrintMonoEnd(out, &top->p, top->i - 1);
+        }
+        else {
+            *(PrintFrame*) WorkStackPush(&ws) = (PrintFrame) {.p = coeff, .i = 0};
+        }
     }
+
+    WorkStackClear(&ws);
 }
 
-void Print(const Stack *s, size_t row) {
-    if (!StackUnderflow(s, 1, row)) {
-        PrintHelper(&s->polys[s->size - 1]);
-        printf("\n");
+void Print(Calculator *c, size_t row) {
+    if (!StackUnderflow(&c->stack, 1, c->err, row)) {
+        StackTouch(&c->stack, 1);
+        PrintHelper(c->out, &c->stack.polys[c->stack.size - 1]);
+        putc('\n', c->out);
     }
 }
 
-void Zero(Stack *s) {
+void Zero(Calculator *c) {
     Poly p = PolyZero();
-    StackPush(s, &p);
+    StackPush(&c->stack, &p);
 }
 
-void IsCoeff(const Stack *s, size_t row) {
-    if (!StackUnderflow(s, 1, row))
-        printf("%d\n", PolyIsCoeff(&s->polys[s->size - 1]));
+void IsCoeff(const Calculator *c, size_t row) {
+    if (!StackUnderflow(&c->stack, 1, c->err, row))
+        fprintf(c->out, "%d\n", PolyIsCoeff(&c->stack.polys[c->stack.size - 1]));
 }
 
-void Clone(Stack *s, size_t row) {
-    if (!StackUnderflow(s, 1, row)) {
-        Poly p = PolyClone(&s->polys[s->size - 1]);
-        StackPush(s, &p);
+void Clone(Calculator *c, size_t row) {
+    if (!StackUnderflow(&c->stack, 1, c->err, row)) {
+        StackTouch(&c->stack, 1);
+        Poly p = PolyClone(&c->stack.polys[c->stack.size - 1]);
+        StackPush(&c->stack, &p);
     }
 }
 
-void IsZero(const Stack *s, size_t row) {
-    if (!StackUnderflow(s, 1, row))
-        printf("%d\n", PolyIsZero(&s->polys[s->size - 1]));
+void IsZero(const Calculator *c, size_t row) {
+    if (!StackUnderflow(&c->stack, 1, c->err, row))
+        fprintf(c->out, "%d\n", PolyIsZero(&c->stack.polys[c->stack.size - 1]));
 }
 
-void Add(Stack *s, size_t row) {
-    if (!StackUnderflow(s, 2, row)) {
-        Poly p = PolyAdd(&s->polys[s->size - 1], &s->polys[s->size - 2]);
-        StackPop(s);StackPop(s);
-        StackPush(s, &p);
+void Add(Calculator *c, size_t row) {
+    if (!StackUnderflow(&c->stack, 2, c->err, row)) {
+        Poly p = PolyAdd(&c->stack.polys[c->stack.size - 1], &c->stack.polys[c->stack.size - 2]);
+        StackPop(&c->stack);StackPop(&c->stack);
+        StackPush(&c->stack, &p);
     }
 }
 
-void Sub(Stack *s, size_t row) {
-    if (!StackUnderflow(s, 2, row)) {
-        Poly p = PolySub(&s->polys[s->size - 1], &s->polys[s->size - 2]);
-        StackPop(s);StackPop(s);
-        StackPush(s, &p);
+void Sub(Calculator *c, size_t row) {
+    if (!StackUnderflow(&c->stack, 2, c->err, row)) {
+        Poly p = PolySub(&c->stack.polys[c->stack.size - 1], &c->stack.polys[c->stack.size - 2]);
+        StackPop(&c->stack);StackPop(&c->stack);
+        StackPush(&c->stack, &p);
     }
 }
 
-void Mul(Stack *s, size_t row) {
-    if (!StackUnderflow(s, 2, row)) {
-        Poly p = PolyMul(&s->polys[StackGetSize(s) - 1], &s->polys[StackGetSize(s) - 2]);
-        StackPop(s);StackPop(s);
-        StackPush(s, &p);
+void Mul(Calculator *c, size_t row) {
+    if (!StackUnderflow(&c->stack, 2, c->err, row)) {
+        Poly p = PolyMul(&c->stack.polys[StackGetSize(&c->stack) - 1], &c->stack.polys[StackGetSize(&c->stack) - 2]);
+        StackPop(&c->stack);StackPop(&c->stack);
+        StackPush(&c->stack, &p);
     }
 }
 
-void Neg(Stack *s, size_t row) {
-    if (!StackUnderflow(s, 1, row)) {
-        Poly p = PolyNeg(&s->polys[StackGetSize(s) - 1]);
-        StackPop(s);
-        StackPush(s, &p);
+void Neg(Calculator *c, size_t row) {
+    if (!StackUnderflow(&c->stack, 1, c->err, row)) {
+        // wielomian przeciwny przejmuje tablice jednomianów wielomianu ze stosu
+        Poly *top = &c->stack.polys[StackGetSize(&c->stack) - 1];
+        *top = PolyNegShallow(top);
     }
 }
 
-void IsEq(const Stack *s, size_t row) {
-    if (!StackUnderflow(s, 2, row))
-        printf("%d\n", PolyIsEq(&s->polys[StackGetSize(s) - 1], &s->polys[StackGetSize(s) - 2]));
+void IsEq(Calculator *c, size_t row) {
+    if (!StackUnderflow(&c->stack, 2, c->err, row)) {
+        StackTouch(&c->stack, 2);
+        fprintf(c->out, "%d\n", PolyIsEq(&c->stack.polys[StackGetSize(&c->stack) - 1], &c->stack.polys[StackGetSize(&c->stack) - 2]));
+    }
 }
 
-void Deg(const Stack *s, size_t row) {
-    if (!StackUnderflow(s, 1, row))
-        printf("%d\n", PolyDeg(&s->polys[StackGetSize(s) - 1]));
+void Deg(Calculator *c, size_t row) {
+    if (!StackUnderflow(&c->stack, 1, c->err, row)) {
+        StackTouch(&c->stack, 1);
+        fprintf(c->out, "%d\n", PolyDeg(&c->stack.polys[StackGetSize(&c->stack) - 1]));
+    }
 }
 
-void Pop(Stack *s, size_t row) {
-    if (!StackUnderflow(s, 1, row))
-        StackPop(s);
+void Pop(Calculator *c, size_t row) {
+    if (!StackUnderflow(&c->stack, 1, c->err, row))
+        StackPop(&c->stack);
 }
 
-void DegBy(Stack *s, size_t row, unsigned long long idx) {
-    if (!StackUnderflow(s, 1, row))
-        printf("%d\n", PolyDegBy(&s->polys[StackGetSize(s) - 1], idx));
+void DegBy(Calculator *c, size_t row, unsigned long long idx) {
+    if (!StackUnderflow(&c->stack, 1, c->err, row)) {
+        StackTouch(&c->stack, 1);
+        fprintf(c->out, "%d\n", PolyDegBy(&c->stack.polys[StackGetSize(&c->stack) - 1], idx));
+    }
 }
 
-void At(Stack *s, size_t row, long int x) {
-    if (!StackUnderflow(s, 1, row)) {
-        Poly p = PolyAt(&s->polys[StackGetSize(s) - 1], x);
-        StackPop(s);
-        StackPush(s, &p);
+void At(Calculator *c, size_t row, long int x) {
+    if (!StackUnderflow(&c->stack, 1, c->err, row)) {
+        Poly p = PolyAt(&c->stack.polys[StackGetSize(&c->stack) - 1], x);
+        StackPop(&c->stack);
+        StackPush(&c->stack, &p);
     }
 }
 
-void Compose(Stack *s, size_t row, size_t k) {
-    if (!StackUnderflow(s, k + 1, row)) {
+void Compose(Calculator *c, size_t row, size_t k) {
+    if (!StackUnderflow(&c->stack, k + 1, c->err, row)) {
         /*Poly *q = (Poly*) calloc(k, sizeof(Poly));
-        size_t j = StackGetSize(s) - 2;
+        size_t j = StackGetSize(&c->stack) - 2;
         for (int i = (int) k - 1; i >= 0; --i) {
            q[i] = s->polys[j--];
         }*/
-        Poly res = PolyCompose(&s->polys[StackGetSize(s) - 1], k, s->polys + StackGetSize(s) - k - 1);
+        Poly res = PolyCompose(&c->stack.polys[StackGetSize(&c->stack) - 1], k, c->stack.polys + StackGetSize(&c->stack) - k - 1);
         for (size_t i = 0; i <= k; ++i) {
-            StackPop(s);
+            StackPop(&c->stack);
         }
-        StackPush(s, &res);
+        StackPush(&c->stack, &res);
         //free(q);
     }
 }
+
+void AddN(Calculator *c, size_t row, size_t k) {
+    if (!StackUnderflow(&c->stack, k, c->err, row)) {
+        Poly res = PolySumMany(k, c->stack.polys + StackGetSize(&c->stack) - k);
+        for (size_t i = 0; i < k; ++i)
+            StackPop(&c->stack);
+        StackPush(&c->stack, &res);
+    }
+}
+
+void MulN(Calculator *c, size_t row, size_t k) {
+    if (!StackUnderflow(&c->stack, k, c->err, row)) {
+        Poly res = PolyProductMany(k, c->stack.polys + StackGetSize(&c->stack) - k);
+        for (size_t i = 0; i < k; ++i)
+            StackPop(&c->stack);
+        StackPush(&c->stack, &res);
+    }
+}
+
+void AtVars(Calculator *c, size_t row, uint64_t var_mask) {
+    size_t k = PartialValueCount(var_mask);
+    if (!StackUnderflow(&c->stack, k + 1, c->err, row)) {
+        size_t size = StackGetSize(&c->stack);
+        Poly res = PolySubstituteVars(&c->stack.polys[size - 1], var_mask, c->stack.polys + size - k - 1);
+        for (size_t i = 0; i <= k; ++i)
+            StackPop(&c->stack);
+        StackPush(&c->stack, &res);
+    }
+}
+
+void Compact(Calculator *c, size_t row) {
+    if (!StackUnderflow(&c->stack, 1, c->err, row))
+        StackCompactTop(&c->stack);
+}
+
+void ShowStats(const Calculator *c) {
+#ifdef POLY_STATS
+    StatsPrint(&c->stats, c->out);
+#else
+    fprintf(c->out, "STATS DISABLED\n");
+#endif
+}
+
+void ShowMemoryStats(const Calculator *c) {
+#ifdef POLY_MEMORY_STATS
+    MemoryPrintStats(c->out);
+#else
+    fprintf(c->out, "MEM_STATS DISABLED\n");
+#endif
+}
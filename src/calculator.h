@@ -10,120 +10,205 @@
 #define POLYNOMIALS_CALCULATOR_H
 
 #include "errors.h"
-#include "parser.h"
+#include "stats.h"
 
-void PrintHelper(const Poly *p);
+/**
+ * Struktura przechowująca stan jednej sesji kalkulatora. Każda sesja ma własny
+ * stos oraz własne strumienie wyjścia i błędów, dzięki czemu wiele sesji może
+ * działać niezależnie od siebie.
+ */
+typedef struct Calculator {
+    Stack stack; ///< stos wielomianów
+    FILE *out; ///< strumień, na który wypisywane są wyniki poleceń
+    FILE *err; ///< strumień, na który wypisywane są błędy
+    Stats stats; ///< statystyki czasu wykonania poleceń sesji
+} Calculator;
+
+/**
+ * Tworzy nową sesję kalkulatora z pustym stosem.
+ * @param[in] out : strumień wyjścia
+ * @param[in] err : strumień błędów
+ * @return sesja kalkulatora
+ */
+Calculator InitCalculator(FILE *out, FILE *err);
+
+/**
+ * Usuwa wszystkie wielomiany ze stosu sesji i zwalnia jej pamięć.
+ * @param[in] c : sesja kalkulatora
+ */
+void CalculatorClear(Calculator *c);
+
+/**
+ * Wypisuje wielomian na strumień @p out.
+ * @param[in] out : strumień wyjścia
+ * @param[in] p : wielomian
+ */
+void PrintHelper(FILE *out, const Poly *p);
 
 /**
  * Wypisuje wielomian z wierzchołku stosu.
- * @param[in] s : stos
+ * @param[in] c : sesja kalkulatora
  * @param[in] row : aktualny numer wiersza, z którego zostało wczytane polecenie
  */
-void Print(const Stack *s, size_t row);
+void Print(Calculator *c, size_t row);
 
 /**
  * Wstawia na wierzchołek stosu wielomian tożsamościowo równy zeru.
- * @param[in] s : stos
+ * @param[in] c : sesja kalkulatora
  */
-void Zero(Stack *s);
+void Zero(Calculator *c);
 
 /**
- * Sprawdza, czy wielomian na wierzchołku stosu jest współczynnikiem – wypisuje na standardowe wyjście 0 lub 1.
- * @param[in] s : stos
+ * Sprawdza, czy wielomian na wierzchołku stosu jest współczynnikiem – wypisuje na wyjście sesji 0 lub 1.
+ * @param[in] c : sesja kalkulatora
  * @param[in] row : aktualny numer wiersza, z którego zostało wczytane polecenie
  */
-void IsCoeff(const Stack *s, size_t row);
+void IsCoeff(const Calculator *c, size_t row);
 
 /**
  * Wstawia na stos kopię wielomianu z wierzchołka.
- * @param[in] s : stos
+ * @param[in] c : sesja kalkulatora
  * @param[in] row : aktualny numer wiersza, z którego zostało wczytane polecenie
  */
-void Clone(Stack *s, size_t row);
+void Clone(Calculator *c, size_t row);
 
 /**
  * Sprawdza, czy wielomian na wierzchołku stosu jest tożsamościowo równy zeru -
- * wypisuje na standardowe wyjście 0 lub 1.
- * @param[in] s : stos
+ * wypisuje na wyjście sesji 0 lub 1.
+ * @param[in] c : sesja kalkulatora
  * @param[in] row : aktualny numer wiersza, z którego zostało wczytane polecenie
  */
-void IsZero(const Stack *s, size_t row);
+void IsZero(const Calculator *c, size_t row);
 
 /**
  * Dodaje dwa wielomiany z wierzchu stosu, usuwa je i wstawia na wierzchołek stosu ich sumę.
- * @param[in] s : stos
+ * @param[in] c : sesja kalkulatora
  * @param[in] row : aktualny numer wiersza, z którego zostało wczytane polecenie
  */
-void Add(Stack *s, size_t row);
+void Add(Calculator *c, size_t row);
 
 /**
  * Odejmuje od wielomianu z wierzchołka wielomian pod wierzchołkiem, usuwa je i wstawia na wierzchołek stosu różnicę.
- * @param[in] s : stos
+ * @param[in] c : sesja kalkulatora
  * @param[in] row : aktualny numer wiersza, z którego zostało wczytane polecenie
  */
-void Sub(Stack *s, size_t row);
+void Sub(Calculator *c, size_t row);
 
 /**
  * Mnoży dwa wielomiany z wierzchu stosu, usuwa je i wstawia na wierzchołek stosu ich iloczyn.
- * @param[in] s : stos
+ * @param[in] c : sesja kalkulatora
  * @param[in] row : aktualny numer wiersza, z którego zostało wczytane polecenie
  */
-void Mul(Stack *s, size_t row);
+void Mul(Calculator *c, size_t row);
 
 /**
  * Neguje wielomian na wierzchołku stosu.
- * @param[in] s : stos
+ * @param[in] c : sesja kalkulatora
  * @param[in] row : aktualny numer wiersza, z którego zostało wczytane polecenie
  */
-void Neg(Stack *s, size_t row);
+void Neg(Calculator *c, size_t row);
 
 /**
- * Sprawdza, czy dwa wielomiany na wierzchu stosu są równe – wypisuje na standardowe wyjście 0 lub 1.
- * @param[in] s : stos
+ * Sprawdza, czy dwa wielomiany na wierzchu stosu są równe – wypisuje na wyjście sesji 0 lub 1.
+ * @param[in] c : sesja kalkulatora
  * @param[in] row : aktualny numer wiersza, z którego zostało wczytane polecenie
  */
-void IsEq(const Stack *s, size_t row);
+void IsEq(Calculator *c, size_t row);
 
 /**
- * Wypisuje na standardowe wyjście stopień wielomianu (−1 dla wielomianu tożsamościowo równego zeru).
- * @param[in] s : stos
+ * Wypisuje na wyjście sesji stopień wielomianu (−1 dla wielomianu tożsamościowo równego zeru).
+ * @param[in] c : sesja kalkulatora
  * @param[in] row : aktualny numer wiersza, z którego zostało wczytane polecenie
  */
-void Deg(const Stack *s, size_t row);
+void Deg(Calculator *c, size_t row);
 
 /**
  * Usuwa wielomian z wierzchołka stosu.
- * @param[in] s : stos
+ * @param[in] c : sesja kalkulatora
  * @param[in] row : aktualny numer wiersza, z którego zostało wczytane polecenie
  */
-void Pop(Stack *s, size_t row);
+void Pop(Calculator *c, size_t row);
 
 /**
- * Wypisuje na standardowe wyjście stopień wielomianu ze względu na zmienną o numerze @p idx
+ * Wypisuje na wyjście sesji stopień wielomianu ze względu na zmienną o numerze @p idx
  * (−1 dla wielomianu tożsamościowo równego zeru).
- * @param[in] s : stos
+ * @param[in] c : sesja kalkulatora
  * @param[in] row : aktualny numer wiersza, z którego zostało wczytane polecenie
  * @param[in] idx : numer zmiennej
  */
-void DegBy(Stack *s, size_t row, unsigned long long idx);
+void DegBy(Calculator *c, size_t row, unsigned long long idx);
 
 /**
  * Wylicza wartość wielomianu w punkcie @p x, usuwa wielomian z wierzchołka i wstawia na stos wynik operacji.
- * @param[in] s : stos
+ * @param[in] c : sesja kalkulatora
  * @param[in] x : wartość argumentu
  * @param[in] row : aktualny numer wiersza, z którego zostało wczytane polecenie
  */
-void At(Stack *s, size_t row, long int x);
+void At(Calculator *c, size_t row, long int x);
 
 /**
  * Wykonuje operacje złożenia wielomianów. Zdejmuje ze stosu @f$k + 1@f$ wielomianów.
  * Do wielomianu z wierzchołka stosu podstawia pod @p k pierwszymch zmiennych kolejne wielomiany
  * ze stosu, w taki sposób, że kolejny wielomian ze stosu zostaje podstawiony pod zmienną k-1, następny
  * pod zmienną k-2 itd.
- * @param[in] s : stos
+ * @param[in] c : sesja kalkulatora
  * @param[in] row : aktualny numer wiersza, z którego zostało wczytane polecenie
  * @param[in] k : liczba wilomianów, które zostana podstawione pod zmienne wielomianu z wierzchu stosu
  */
-void Compose(Stack *s, size_t row, size_t k);
+void Compose(Calculator *c, size_t row, size_t k);
+
+/**
+ * Zdejmuje ze stosu @p k wielomianów i wstawia na stos ich sumę
+ * (patrz PolySumMany).
+ * @param[in] c : sesja kalkulatora
+ * @param[in] row : aktualny numer wiersza, z którego zostało wczytane polecenie
+ * @param[in] k : liczba dodawanych wielomianów
+ */
+void AddN(Calculator *c, size_t row, size_t k);
+
+/**
+ * Zdejmuje ze stosu @p k wielomianów i wstawia na stos ich iloczyn
+ * (patrz PolyProductMany).
+ * @param[in] c : sesja kalkulatora
+ * @param[in] row : aktualny numer wiersza, z którego zostało wczytane polecenie
+ * @param[in] k : liczba mnożonych wielomianów
+ */
+void MulN(Calculator *c, size_t row, size_t k);
+
+/**
+ * Podstawia pod zmienne wielomianu z wierzchołka stosu wskazane maską @p var_mask
+ * wielomiany leżące pod nim i numeruje kolejno pozostałe zmienne (patrz
+ * PolySubstituteVars). Zdejmuje ze stosu wielomian i tyle wielomianów, ile bitów
+ * maski jest zapalonych; wielomian tuż pod wierzchołkiem jest podstawiany pod
+ * zmienną o największym indeksie. Gdy podstawiane wielomiany są stałymi,
+ * wynik powstaje w jednym przejściu PolyEvalPartial.
+ * @param[in] c : sesja kalkulatora
+ * @param[in] row : aktualny numer wiersza, z którego zostało wczytane polecenie
+ * @param[in] var_mask : maska ustalonych zmiennych
+ */
+void AtVars(Calculator *c, size_t row, uint64_t var_mask);
+
+/**
+ * Zastępuje wielomian z wierzchołka stosu jego skompaktowaną kopią
+ * (patrz PolyCompact).
+ * @param[in] c : sesja kalkulatora
+ * @param[in] row : aktualny numer wiersza, z którego zostało wczytane polecenie
+ */
+void Compact(Calculator *c, size_t row);
+
+/**
+ * Wypisuje na wyjście sesji statystyki czasu wykonania poleceń (patrz StatsPrint).
+ * Jeżeli program został skompilowany bez POLY_STATS, wypisuje `STATS DISABLED`.
+ * @param[in] c : sesja kalkulatora
+ */
+void ShowStats(const Calculator *c);
+
+/**
+ * Wypisuje na wyjście sesji stan liczników alokacji pamięci (patrz MemoryPrintStats).
+ * Liczniki są wspólne dla wszystkich sesji działających w programie.
+ * Jeżeli program został skompilowany bez POLY_MEMORY_STATS, wypisuje `MEM_STATS DISABLED`.
+ * @param[in] c : sesja kalkulatora
+ */
+void ShowMemoryStats(const Calculator *c);
 
 #endif //POLYNOMIALS_CALCULATOR_H
@@ -0,0 +1,51 @@
+/** @file
+  Implementacja listy poleceń kalkulatora wielomianów
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include <string.h>
+#include "commands.h"
+
+/** Nazwy rodzajów wierszy, w kolejności z typu CommandType. */
+static const char *const command_names[COMMAND_COUNT] = {
+    [COMMAND_ZERO] = "ZERO",
+    [COMMAND_IS_COEFF] = "IS_COEFF",
+    [COMMAND_IS_ZERO] = "IS_ZERO",
+    [COMMAND_CLONE] = "CLONE",
+    [COMMAND_ADD] = "ADD",
+    [COMMAND_MUL] = "MUL",
+    [COMMAND_SUB] = "SUB",
+    [COMMAND_NEG] = "NEG",
+    [COMMAND_IS_EQ] = "IS_EQ",
+    [COMMAND_DEG] = "DEG",
+    [COMMAND_DEG_BY] = "DEG_BY",
+    [COMMAND_AT] = "AT",
+    [COMMAND_PRINT] = "PRINT",
+    [COMMAND_POP] = "POP",
+    [COMMAND_COMPOSE] = "COMPOSE",
+    [COMMAND_STATS] = "STATS",
+    [COMMAND_MEM_STATS] = "MEM_STATS",
+    [COMMAND_COMPACT] = "COMPACT",
+    [COMMAND_ADD_N] = "ADD_N",
+    [COMMAND_MUL_N] = "MUL_N",
+    [COMMAND_AT_VARS] = "AT_VARS",
+    [COMMAND_AT_NEXT] = "AT_NEXT",
+    [COMMAND_POLY] = "POLY",
+    [COMMAND_WRONG] = "WRONG_COMMAND"
+};
+
+const char *CommandName(CommandType type) {
+    return command_names[type];
+}
+
+CommandType CommandFromName(const char *name) {
+    // wiersze z wielomianem i niepoprawne polecenia nie są poleceniami
+    for (int i = 0; i < COMMAND_POLY; ++i) {
+        if (strcmp(name, command_names[i]) == 0)
+            return (CommandType) i;
+    }
+    return COMMAND_WRONG;
+}
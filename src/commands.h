@@ -0,0 +1,58 @@
+/** @file
+  Interfejs listy poleceń kalkulatora wielomianów
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef POLYNOMIALS_COMMANDS_H
+#define POLYNOMIALS_COMMANDS_H
+
+/**
+ * Rodzaje wierszy wykonywanych przez kalkulator. Oprócz poleceń wyróżniamy
+ * wiersz z wielomianem oraz niepoprawne polecenie.
+ */
+typedef enum CommandType {
+    COMMAND_ZERO, ///< polecenie ZERO
+    COMMAND_IS_COEFF, ///< polecenie IS_COEFF
+    COMMAND_IS_ZERO, ///< polecenie IS_ZERO
+    COMMAND_CLONE, ///< polecenie CLONE
+    COMMAND_ADD, ///< polecenie ADD
+    COMMAND_MUL, ///< polecenie MUL
+    COMMAND_SUB, ///< polecenie SUB
+    COMMAND_NEG, ///< polecenie NEG
+    COMMAND_IS_EQ, ///< polecenie IS_EQ
+    COMMAND_DEG, ///< polecenie DEG
+    COMMAND_DEG_BY, ///< polecenie DEG_BY
+    COMMAND_AT, ///< polecenie AT
+    COMMAND_PRINT, ///< polecenie PRINT
+    COMMAND_POP, ///< polecenie POP
+    COMMAND_COMPOSE, ///< polecenie COMPOSE
+    COMMAND_STATS, ///< polecenie STATS
+    COMMAND_MEM_STATS, ///< polecenie MEM_STATS
+    COMMAND_COMPACT, ///< polecenie COMPACT
+    COMMAND_ADD_N, ///< polecenie ADD_N
+    COMMAND_MUL_N, ///< polecenie MUL_N
+    COMMAND_AT_VARS, ///< polecenie AT_VARS
+    COMMAND_AT_NEXT, ///< polecenie AT_NEXT
+    COMMAND_POLY, ///< wiersz z wielomianem
+    COMMAND_WRONG, ///< niepoprawne polecenie
+    COMMAND_COUNT ///< liczba rodzajów wierszy
+} CommandType;
+
+/**
+ * Daje nazwę rodzaju wiersza.
+ * @param[in] type : rodzaj wiersza
+ * @return nazwa polecenia
+ */
+const char *CommandName(CommandType type);
+
+/**
+ * Rozpoznaje polecenie po nazwie.
+ * @param[in] name : nazwa polecenia zakończona znakiem '\0'
+ * @return rodzaj polecenia lub COMMAND_WRONG, jeżeli nie ma takiego polecenia
+ */
+CommandType CommandFromName(const char *name);
+
+#endif //POLYNOMIALS_COMMANDS_H
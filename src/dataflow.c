@@ -0,0 +1,736 @@
+/** @file
+  Implementacja współbieżnego wykonywania niezależnych poleceń kalkulatora
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+/** Udostępnia funkcje POSIX (wątki) przy kompilacji z -std=c11. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include "dataflow.h"
+#include "parallel.h"
+#include "partial.h"
+#include "reclaimer.h"
+
+/** Oznaczenie braku wiersza lub wielomianu. */
+#define DATAFLOW_NONE SIZE_MAX
+
+/** Wiersz skryptu jako wierzchołek grafu zależności. */
+typedef struct DataflowNode {
+    Command cmd; ///< wczytane polecenie
+    size_t inputs; ///< indeks pierwszego argumentu w tablicy argumentów grafu
+    size_t input_count; ///< liczba argumentów, w kolejności od najgłębszego na stosie
+    size_t output; ///< wielomian tworzony przez polecenie lub DATAFLOW_NONE
+    size_t successors; ///< indeks pierwszego następnika w tablicy następników grafu
+    size_t successor_count; ///< liczba następników
+    bool run; ///< czy polecenie trzeba wykonać (wielomian z wiersza jest gotowy od razu)
+    bool emit; ///< czy polecenie wypisuje wynik lub błąd, więc wykonuje je wątek główny
+    atomic_size_t waiting; ///< liczba niewykonanych poprzedników
+    uint64_t ns; ///< czas wczytania i wykonania polecenia w nanosekundach
+} DataflowNode;
+
+/** Wielomian zajmujący jedno miejsce na symbolicznym stosie. */
+typedef struct DataflowValue {
+    Poly p; ///< wielomian, poprawny po wykonaniu polecenia, które go tworzy
+    size_t producer; ///< polecenie tworzące wielomian lub DATAFLOW_NONE, jeżeli jest gotowy
+    size_t readers; ///< początek listy poleceń czytających wielomian lub DATAFLOW_NONE
+} DataflowValue;
+
+/** Element listy poleceń czytających wielomian. */
+typedef struct DataflowReader {
+    size_t node; ///< polecenie czytające wielomian
+    size_t next; ///< kolejny element listy lub DATAFLOW_NONE
+} DataflowReader;
+
+/** Krawędź grafu zależności. */
+typedef struct DataflowEdge {
+    size_t from; ///< polecenie, które musi zostać wykonane wcześniej
+    size_t to; ///< polecenie zależne
+} DataflowEdge;
+
+/**
+ * Kolejka zadań jednego wątku. Właściciel dodaje i pobiera zadania z końca,
+ * a pozostałe wątki podkradają zadania z początku.
+ */
+typedef struct DataflowDeque {
+    size_t *tasks; ///< tablica na DATAFLOW_BATCH zadań
+    size_t top; ///< indeks pierwszego zadania
+    size_t bottom; ///< indeks za ostatnim zadaniem
+    pthread_mutex_t lock; ///< blokada chroniąca kolejkę
+} DataflowDeque;
+
+struct Dataflow;
+
+/** Argument wątku roboczego. */
+typedef struct DataflowWorker {
+    struct Dataflow *df; ///< stan wykonania
+    size_t index; ///< numer kolejki wątku
+} DataflowWorker;
+
+/** Stan wykonania skryptu w trybie przepływu danych. */
+typedef struct Dataflow {
+    Calculator *c; ///< sesja kalkulatora
+    DataflowNode *nodes; ///< wiersze bieżącego grafu, co najwyżej DATAFLOW_BATCH
+    size_t nodes_size; ///< liczba wierszy grafu
+    DataflowValue *values; ///< wielomiany grafu
+    size_t values_size; ///< liczba wielomianów
+    size_t values_allocated; ///< rozmiar tablicy values
+    size_t *inputs; ///< argumenty poleceń jako indeksy wielomianów
+    size_t inputs_size; ///< liczba argumentów
+    size_t inputs_allocated; ///< rozmiar tablicy inputs
+    DataflowReader *readers; ///< elementy list poleceń czytających wielomiany
+    size_t readers_size; ///< liczba elementów list
+    size_t readers_allocated; ///< rozmiar tablicy readers
+    DataflowEdge *edges; ///< krawędzie grafu
+    size_t edges_size; ///< liczba krawędzi
+    size_t edges_allocated; ///< rozmiar tablicy edges
+    size_t *successors; ///< następniki wierszy, pogrupowane według poprzednika
+    size_t successors_allocated; ///< rozmiar tablicy successors
+    size_t *slots; ///< symboliczny stos: wielomiany nad częścią stosu sesji
+    size_t slots_size; ///< liczba miejsc symbolicznego stosu
+    size_t slots_allocated; ///< rozmiar tablicy slots
+    DataflowDeque *deques; ///< kolejki zadań, kolejka 0 należy do wątku głównego
+    DataflowWorker *args; ///< argumenty wątków roboczych
+    pthread_t *workers; ///< wątki robocze
+    size_t threads; ///< liczba kolejek (wątków roboczych i wątku głównego)
+    size_t started; ///< liczba uruchomionych wątków roboczych
+    size_t reserved; ///< liczba wątków roboczych zarezerwowanych przez ParallelReserve
+    atomic_size_t queued; ///< liczba zadań w kolejkach
+    atomic_size_t remaining; ///< liczba niewykonanych poleceń grafu
+    bool stopping; ///< czy wątki robocze mają się zakończyć
+    pthread_mutex_t lock; ///< blokada do usypiania i budzenia wątków
+    pthread_cond_t wake; ///< sygnalizuje nowe zadanie lub wykonanie oczekiwanego polecenia
+} Dataflow;
+
+/**
+ * Zapewnia, że tablica @p arr ma miejsce na co najmniej @p needed elementów.
+ * @param[in] arr : tablica lub NULL
+ * @param[in,out] allocated : rozmiar tablicy
+ * @param[in] needed : potrzebna liczba elementów
+ * @param[in] size : rozmiar elementu
+ * @return tablica z miejscem na @p needed elementów
+ */
+static void *DataflowReserve(void *arr, size_t *allocated, size_t needed, size_t size) {
+    if (needed <= *allocated)
+        return arr;
+
+    size_t old_allocated = *allocated;
+    size_t new_allocated = (old_allocated == 0) ? INIT_SIZE : old_allocated;
+    while (new_allocated < needed)
+        new_allocated = IncreaseSpace(new_allocated);
+    *allocated = new_allocated;
+    return MemoryRealloc(arr, old_allocated * size, new_allocated * size, MEMORY_WORK);
+}
+
+/**
+ * Dodaje wielomian do grafu.
+ * @param[in,out] df : stan wykonania
+ * @param[in] p : wielomian, przechodzi na własność grafu
+ * @param[in] producer : polecenie tworzące wielomian lub DATAFLOW_NONE
+ * @return indeks wielomianu
+ */
+static size_t DataflowNewValue(Dataflow *df, Poly p, size_t producer) {
+    df->values = (DataflowValue*) DataflowReserve(df->values, &df->values_allocated,
+                                                  df->values_size + 1, sizeof(DataflowValue));
+    df->values[df->values_size] = (DataflowValue) {.p = p, .producer = producer, .readers = DATAFLOW_NONE};
+    return df->values_size++;
+}
+
+/**
+ * Dodaje krawędź grafu, chyba że poprzednik nie wymaga wykonania.
+ * @param[in,out] df : stan wykonania
+ * @param[in] from : poprzednik lub DATAFLOW_NONE
+ * @param[in] to : następnik
+ */
+static void DataflowAddEdge(Dataflow *df, size_t from, size_t to) {
+    if (from == DATAFLOW_NONE)
+        return;
+    df->edges = (DataflowEdge*) DataflowReserve(df->edges, &df->edges_allocated,
+                                                df->edges_size + 1, sizeof(DataflowEdge));
+    df->edges[df->edges_size++] = (DataflowEdge) {.from = from, .to = to};
+}
+
+/**
+ * Odkłada wielomian na symboliczny stos.
+ * @param[in,out] df : stan wykonania
+ * @param[in] value : indeks wielomianu
+ */
+static void DataflowPushSlot(Dataflow *df, size_t value) {
+    df->slots = (size_t*) DataflowReserve(df->slots, &df->slots_allocated,
+                                          df->slots_size + 1, sizeof(size_t));
+    df->slots[df->slots_size++] = value;
+}
+
+/**
+ * Zapewnia, że symboliczny stos ma co najmniej @p count miejsc, przenosząc
+ * brakujące wielomiany z wierzchu stosu sesji.
+ * @param[in,out] df : stan wykonania
+ * @param[in] count : liczba miejsc, nie większa niż łączny rozmiar obu stosów
+ */
+static void DataflowPull(Dataflow *df, size_t count) {
+    if (df->slots_size >= count)
+        return;
+
+    Stack *stack = &df->c->stack;
+    size_t missing = count - df->slots_size;
+    df->slots = (size_t*) DataflowReserve(df->slots, &df->slots_allocated, count, sizeof(size_t));
+    memmove(df->slots + missing, df->slots, df->slots_size * sizeof(size_t));
+    for (size_t i = 0; i < missing; ++i)
+        df->slots[i] = DataflowNewValue(df, stack->polys[stack->size - missing + i], DATAFLOW_NONE);
+    stack->size -= missing;
+    df->slots_size = count;
+}
+
+/**
+ * Daje liczbę wielomianów ze stosu, których używa poprawne polecenie.
+ * @param[in] cmd : polecenie
+ * @return liczba argumentów polecenia
+ */
+static size_t DataflowOperandCount(const Command *cmd) {
+    switch (cmd->type) {
+        case COMMAND_ADD:
+        case COMMAND_SUB:
+        case COMMAND_MUL:
+        case COMMAND_IS_EQ:
+            return 2;
+        case COMMAND_COMPOSE:
+            return cmd->arg + 1;
+        case COMMAND_ADD_N:
+        case COMMAND_MUL_N:
+            return cmd->arg;
+        case COMMAND_AT_VARS:
+            return PartialValueCount(cmd->arg) + 1;
+        case COMMAND_ZERO:
+        case COMMAND_POLY:
+        case COMMAND_AT_NEXT:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+/**
+ * Sprawdza, czy polecenie tylko czyta swoje argumenty, nie zdejmując ich ze stosu.
+ * @param[in] type : rodzaj polecenia
+ * @return Czy polecenie zostawia argumenty na stosie?
+ */
+static bool DataflowReadsOnly(CommandType type) {
+    return type == COMMAND_IS_COEFF || type == COMMAND_IS_ZERO || type == COMMAND_IS_EQ ||
+           type == COMMAND_DEG || type == COMMAND_DEG_BY || type == COMMAND_PRINT ||
+           type == COMMAND_CLONE;
+}
+
+/**
+ * Dodaje wczytane polecenie do grafu, śledząc symbolicznie, które polecenie
+ * utworzyło każdy z jego argumentów. Polecenie zależy od poleceń tworzących
+ * jego argumenty, a jeżeli zdejmuje je ze stosu, to także od wcześniejszych
+ * poleceń, które je czytają.
+ * @param[in,out] df : stan wykonania
+ * @param[in,out] cmd : polecenie, wielomian z wiersza przechodzi na własność grafu
+ * @param[in] ns : czas wczytania polecenia w nanosekundach
+ */
+static void DataflowAddCommand(Dataflow *df, Command *cmd, uint64_t ns) {
+    size_t n = df->nodes_size++;
+    DataflowNode *node = &df->nodes[n];
+    *node = (DataflowNode) {.cmd = *cmd, .inputs = df->inputs_size, .output = DATAFLOW_NONE,
+                            .run = true, .emit = false, .ns = ns};
+
+    size_t count = DataflowOperandCount(cmd);
+    if (cmd->error == NULL && df->c->stack.size + df->slots_size < count)
+        node->cmd.error = ErrorStackUnderflow;
+
+    if (node->cmd.error != NULL) {
+        node->emit = true;
+        return;
+    }
+
+    if (cmd->type == COMMAND_AT_NEXT) {
+        // wartość została już podstawiona przez parser w kolejnym wierszu
+        node->run = false;
+        return;
+    }
+
+    if (cmd->type == COMMAND_POLY || cmd->type == COMMAND_ZERO) {
+        // wielomian jest gotowy od razu, więc polecenia go używające nie muszą czekać
+        node->run = false;
+        DataflowPushSlot(df, DataflowNewValue(df, (cmd->type == COMMAND_POLY) ? cmd->p : PolyZero(),
+                                              DATAFLOW_NONE));
+        return;
+    }
+
+    DataflowPull(df, count);
+    bool reads_only = DataflowReadsOnly(cmd->type);
+    node->emit = reads_only && cmd->type != COMMAND_CLONE;
+    node->input_count = count;
+    df->inputs = (size_t*) DataflowReserve(df->inputs, &df->inputs_allocated,
+                                           df->inputs_size + count, sizeof(size_t));
+    df->readers = (DataflowReader*) DataflowReserve(df->readers, &df->readers_allocated,
+                                                    df->readers_size + count, sizeof(DataflowReader));
+
+    for (size_t i = 0; i < count; ++i) {
+        size_t v = df->slots[df->slots_size - count + i];
+        DataflowValue *value = &df->values[v];
+        df->inputs[df->inputs_size++] = v;
+        DataflowAddEdge(df, value->producer, n);
+
+        if (reads_only) {
+            df->readers[df->readers_size] = (DataflowReader) {.node = n, .next = value->readers};
+            value->readers = df->readers_size++;
+        }
+        else {
+            // wielomian zostanie zwolniony, więc wszystkie odczyty muszą się wcześniej zakończyć
+            for (size_t r = value->readers; r != DATAFLOW_NONE; r = df->readers[r].next)
+                DataflowAddEdge(df, df->readers[r].node, n);
+        }
+    }
+
+    if (!reads_only)
+        df->slots_size -= count;
+    if (cmd->type != COMMAND_POP && !node->emit) {
+        node->output = DataflowNewValue(df, PolyZero(), n);
+        DataflowPushSlot(df, node->output);
+    }
+}
+
+/**
+ * Grupuje krawędzie grafu według poprzednika i ustala liczby niewykonanych
+ * poprzedników. Każde polecenie czeka dodatkowo na zwolnienie przez wątek
+ * główny, żeby nie zostało uruchomione dwa razy: przez DataflowRunBatch i przez
+ * wątek, który właśnie wykonał jego poprzednika.
+ * @param[in,out] df : stan wykonania
+ */
+static void DataflowLinkSuccessors(Dataflow *df) {
+    for (size_t i = 0; i < df->nodes_size; ++i) {
+        df->nodes[i].successor_count = 0;
+        atomic_init(&df->nodes[i].waiting, 1);
+    }
+    for (size_t e = 0; e < df->edges_size; ++e) {
+        df->nodes[df->edges[e].from].successor_count++;
+        atomic_fetch_add_explicit(&df->nodes[df->edges[e].to].waiting, 1, memory_order_relaxed);
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < df->nodes_size; ++i) {
+        df->nodes[i].successors = offset;
+        offset += df->nodes[i].successor_count;
+        df->nodes[i].successor_count = 0;
+    }
+
+    df->successors = (size_t*) DataflowReserve(df->successors, &df->successors_allocated,
+                                               df->edges_size, sizeof(size_t));
+    for (size_t e = 0; e < df->edges_size; ++e) {
+        DataflowNode *from = &df->nodes[df->edges[e].from];
+        df->successors[from->successors + from->successor_count++] = df->edges[e].to;
+    }
+}
+
+/**
+ * Budzi wątek główny oczekujący na wykonanie polecenia.
+ * @param[in,out] df : stan wykonania
+ */
+static void DataflowBroadcast(Dataflow *df) {
+    pthread_mutex_lock(&df->lock);
+    pthread_cond_broadcast(&df->wake);
+    pthread_mutex_unlock(&df->lock);
+}
+
+/**
+ * Dodaje zadanie na koniec kolejki wątku @p worker.
+ * @param[in,out] df : stan wykonania
+ * @param[in] worker : numer kolejki
+ * @param[in] node : polecenie gotowe do wykonania
+ */
+static void DataflowPush(Dataflow *df, size_t worker, size_t node) {
+    DataflowDeque *deque = &df->deques[worker];
+    pthread_mutex_lock(&deque->lock);
+    deque->tasks[deque->bottom++] = node;
+    pthread_mutex_unlock(&deque->lock);
+
+    // licznik zwiększamy pod blokadą, żeby usypiany wątek nie przeoczył zadania
+    pthread_mutex_lock(&df->lock);
+    atomic_fetch_add(&df->queued, 1);
+    pthread_cond_signal(&df->wake);
+    pthread_mutex_unlock(&df->lock);
+}
+
+/**
+ * Pobiera zadanie z kolejki. Właściciel pobiera ostatnio dodane zadanie,
+ * a inny wątek podkrada najdawniej dodane.
+ * @param[in,out] deque : kolejka
+ * @param[in] own : czy kolejka należy do pobierającego wątku
+ * @param[out] node : pobrane zadanie
+ * @return Czy kolejka zawierała zadanie?
+ */
+static bool DataflowDequeTake(DataflowDeque *deque, bool own, size_t *node) {
+    pthread_mutex_lock(&deque->lock);
+    bool found = deque->top < deque->bottom;
+    if (found)
+        *node = own ? deque->tasks[--deque->bottom] : deque->tasks[deque->top++];
+    if (deque->top == deque->bottom)
+        deque->top = deque->bottom = 0;
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+/**
+ * Pobiera zadanie z własnej kolejki, a jeżeli jest pusta, podkrada zadanie
+ * z kolejki innego wątku.
+ * @param[in,out] df : stan wykonania
+ * @param[in] worker : numer kolejki wątku
+ * @param[out] node : pobrane zadanie
+ * @return Czy udało się pobrać zadanie?
+ */
+static bool DataflowTake(Dataflow *df, size_t worker, size_t *node) {
+    if (atomic_load(&df->queued) == 0)
+        return false;
+    for (size_t i = 0; i < df->threads; ++i) {
+        size_t victim = (worker + i) % df->threads;
+        if (DataflowDequeTake(&df->deques[victim], i == 0, node)) {
+            atomic_fetch_sub(&df->queued, 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Zbiera argumenty polecenia, od najgłębszego na stosie, w jednej tablicy.
+ * @param[in] df : stan wykonania
+ * @param[in] node : polecenie
+ * @param[in] count : liczba zbieranych argumentów
+ * @return tablica wielomianów (zwalniana przez MemoryFree) lub NULL dla @p count = 0
+ */
+static Poly *DataflowGather(const Dataflow *df, const DataflowNode *node, size_t count) {
+    if (count == 0)
+        return NULL;
+    Poly *polys = (Poly*) MemoryAlloc(count * sizeof(Poly), MEMORY_WORK);
+    for (size_t i = 0; i < count; ++i)
+        polys[i] = df->values[df->inputs[node->inputs + i]].p;
+    return polys;
+}
+
+/**
+ * Wykonuje polecenie tworzące wielomian lub zdejmujące wielomiany ze stosu.
+ * Zdjęte argumenty są zwalniane, tak jak przez StackPop.
+ * @param[in,out] df : stan wykonania
+ * @param[in,out] node : polecenie
+ */
+static void DataflowCompute(Dataflow *df, DataflowNode *node) {
+    const size_t *in = df->inputs + node->inputs;
+    size_t count = node->input_count;
+    Poly *top = &df->values[in[count - 1]].p;
+    Poly *below = (count > 1) ? &df->values[in[count - 2]].p : NULL;
+    CommandType type = node->cmd.type;
+    Poly res = PolyZero();
+
+    if (type == COMMAND_CLONE) {
+        res = PolyClone(top);
+    }
+    else if (type == COMMAND_ADD) {
+        res = PolyAdd(top, below);
+    }
+    else if (type == COMMAND_SUB) {
+        res = PolySub(top, below);
+    }
+    else if (type == COMMAND_MUL) {
+        res = PolyMul(top, below);
+    }
+    else if (type == COMMAND_NEG) {
+        // wielomian przeciwny przejmuje tablice jednomianów argumentu
+        res = PolyNegShallow(top);
+        *top = PolyZero();
+    }
+    else if (type == COMMAND_AT) {
+        res = PolyAt(top, node->cmd.x);
+    }
+    else if (type == COMMAND_COMPACT) {
+        res = PolyCompact(top);
+    }
+    else if (type == COMMAND_COMPOSE || type == COMMAND_ADD_N || type == COMMAND_MUL_N ||
+             type == COMMAND_AT_VARS) {
+        size_t k = (type == COMMAND_COMPOSE || type == COMMAND_AT_VARS) ? count - 1 : count;
+        Poly *polys = DataflowGather(df, node, k);
+        if (type == COMMAND_COMPOSE)
+            res = PolyCompose(top, k, polys);
+        else if (type == COMMAND_AT_VARS)
+            res = PolySubstituteVars(top, node->cmd.arg, polys);
+        else if (type == COMMAND_ADD_N)
+            res = PolySumMany(k, polys);
+        else
+            res = PolyProductMany(k, polys);
+        MemoryFree(polys, k * sizeof(Poly), MEMORY_WORK);
+    }
+
+    if (type != COMMAND_CLONE) {
+        for (size_t i = 0; i < count; ++i)
+            PolyReclaim(&df->values[in[i]].p);
+    }
+    if (node->output != DATAFLOW_NONE)
+        df->values[node->output].p = res;
+}
+
+/**
+ * Wykonuje polecenie wypisujące wynik lub błąd na strumienie sesji.
+ * @param[in] df : stan wykonania
+ * @param[in] node : polecenie
+ */
+static void DataflowEmit(const Dataflow *df, const DataflowNode *node) {
+    Calculator *c = df->c;
+    const Command *cmd = &node->cmd;
+    if (cmd->error != NULL) {
+        cmd->error(c->err, cmd->row);
+        return;
+    }
+
+    const size_t *in = df->inputs + node->inputs;
+    const Poly *top = &df->values[in[node->input_count - 1]].p;
+    if (cmd->type == COMMAND_IS_COEFF) {
+        fprintf(c->out, "%d\n", PolyIsCoeff(top));
+    }
+    else if (cmd->type == COMMAND_IS_ZERO) {
+        fprintf(c->out, "%d\n", PolyIsZero(top));
+    }
+    else if (cmd->type == COMMAND_IS_EQ) {
+        fprintf(c->out, "%d\n", PolyIsEq(top, &df->values[in[0]].p));
+    }
+    else if (cmd->type == COMMAND_DEG) {
+        fprintf(c->out, "%d\n", PolyDeg(top));
+    }
+    else if (cmd->type == COMMAND_DEG_BY) {
+        fprintf(c->out, "%d\n", PolyDegBy(top, cmd->arg));
+    }
+    else if (cmd->type == COMMAND_PRINT) {
+        PrintHelper(c->out, top);
+        putc('\n', c->out);
+    }
+}
+
+/**
+ * Wykonuje polecenie i zwalnia jego następniki. Następniki gotowe do
+ * wykonania trafiają do kolejki wątku @p worker.
+ * @param[in,out] df : stan wykonania
+ * @param[in] i : indeks polecenia
+ * @param[in] worker : numer kolejki wątku wykonującego
+ */
+static void DataflowRun(Dataflow *df, size_t i, size_t worker) {
+    DataflowNode *node = &df->nodes[i];
+    uint64_t start = StatsNow();
+    if (node->emit)
+        DataflowEmit(df, node);
+    else
+        DataflowCompute(df, node);
+    node->ns += StatsNow() - start;
+
+    bool wake = false;
+    for (size_t s = 0; s < node->successor_count; ++s) {
+        size_t next = df->successors[node->successors + s];
+        if (atomic_fetch_sub(&df->nodes[next].waiting, 1) == 1) {
+            // polecenia wypisujące wykonuje wątek główny w kolejności wierszy
+            if (df->nodes[next].emit)
+                wake = true;
+            else
+                DataflowPush(df, worker, next);
+        }
+    }
+    if (atomic_fetch_sub(&df->remaining, 1) == 1)
+        wake = true;
+    if (wake && worker != 0)
+        DataflowBroadcast(df);
+}
+
+/**
+ * Sprawdza, czy wątek główny może przestać czekać.
+ * @param[in] df : stan wykonania
+ * @param[in] node : polecenie, na którego gotowość czeka wątek główny, lub
+ * DATAFLOW_NONE, jeżeli czeka na wykonanie całego grafu
+ * @return Czy oczekiwanie się zakończyło?
+ */
+static bool DataflowDone(Dataflow *df, size_t node) {
+    if (node == DATAFLOW_NONE)
+        return atomic_load(&df->remaining) == 0;
+    return atomic_load(&df->nodes[node].waiting) == 0;
+}
+
+/**
+ * Czeka w wątku głównym na gotowość polecenia @p node lub wykonanie całego
+ * grafu, w międzyczasie wykonując zadania z kolejek.
+ * @param[in,out] df : stan wykonania
+ * @param[in] node : polecenie lub DATAFLOW_NONE
+ */
+static void DataflowWait(Dataflow *df, size_t node) {
+    size_t task;
+    while (!DataflowDone(df, node)) {
+        if (DataflowTake(df, 0, &task)) {
+            DataflowRun(df, task, 0);
+            continue;
+        }
+        pthread_mutex_lock(&df->lock);
+        while (atomic_load(&df->queued) == 0 && !DataflowDone(df, node))
+            pthread_cond_wait(&df->wake, &df->lock);
+        pthread_mutex_unlock(&df->lock);
+    }
+}
+
+/**
+ * Pętla wątku roboczego: wykonuje zadania z własnej kolejki i podkrada
+ * zadania innym wątkom, a gdy nie ma zadań, czeka na nie.
+ * @param[in] arg : argument wątku (DataflowWorker)
+ * @return NULL
+ */
+static void *DataflowWorkerLoop(void *arg) {
+    DataflowWorker *worker = (DataflowWorker*) arg;
+    Dataflow *df = worker->df;
+    size_t task;
+    while (true) {
+        if (DataflowTake(df, worker->index, &task)) {
+            DataflowRun(df, task, worker->index);
+            continue;
+        }
+        pthread_mutex_lock(&df->lock);
+        while (atomic_load(&df->queued) == 0 && !df->stopping)
+            pthread_cond_wait(&df->wake, &df->lock);
+        bool stop = df->stopping;
+        pthread_mutex_unlock(&df->lock);
+        if (stop)
+            return NULL;
+    }
+}
+
+/**
+ * Wykonuje bieżący graf. Wątek główny wypisuje wyniki i błędy w kolejności
+ * wierszy, a po wykonaniu grafu wielomiany z symbolicznego stosu trafiają
+ * na stos sesji.
+ * @param[in,out] df : stan wykonania
+ */
+static void DataflowRunBatch(Dataflow *df) {
+    DataflowLinkSuccessors(df);
+
+    size_t runnable = 0;
+    for (size_t i = 0; i < df->nodes_size; ++i)
+        runnable += df->nodes[i].run;
+    atomic_store(&df->remaining, runnable);
+
+    size_t next_worker = 0;
+    for (size_t i = 0; i < df->nodes_size; ++i) {
+        DataflowNode *node = &df->nodes[i];
+        if (node->run && atomic_fetch_sub(&node->waiting, 1) == 1 && !node->emit) {
+            DataflowPush(df, next_worker, i);
+            next_worker = (next_worker + 1) % df->threads;
+        }
+    }
+
+    for (size_t i = 0; i < df->nodes_size; ++i) {
+        if (df->nodes[i].emit) {
+            DataflowWait(df, i);
+            DataflowRun(df, i, 0);
+        }
+    }
+    DataflowWait(df, DATAFLOW_NONE);
+
+    for (size_t i = 0; i < df->slots_size; ++i)
+        StackPush(&df->c->stack, &df->values[df->slots[i]].p);
+#ifdef POLY_STATS
+    for (size_t i = 0; i < df->nodes_size; ++i)
+        StatsRecord(&df->c->stats, df->nodes[i].cmd.type, df->nodes[i].ns);
+#endif
+
+    df->nodes_size = df->values_size = df->inputs_size = 0;
+    df->readers_size = df->edges_size = df->slots_size = 0;
+}
+
+/**
+ * Inicjalizuje stan wykonania i uruchamia wątki robocze.
+ * @param[out] df : stan wykonania
+ * @param[in,out] c : sesja kalkulatora
+ * @param[in] threads : liczba wątków, razem z wątkiem głównym
+ */
+static void DataflowInit(Dataflow *df, Calculator *c, size_t threads) {
+    *df = (Dataflow) {.c = c, .threads = threads, .stopping = false};
+    df->nodes = (DataflowNode*) MemoryAlloc(DATAFLOW_BATCH * sizeof(DataflowNode), MEMORY_WORK);
+    df->deques = (DataflowDeque*) MemoryAlloc(threads * sizeof(DataflowDeque), MEMORY_WORK);
+    for (size_t i = 0; i < threads; ++i) {
+        df->deques[i].tasks = (size_t*) MemoryAlloc(DATAFLOW_BATCH * sizeof(size_t), MEMORY_WORK);
+        df->deques[i].top = df->deques[i].bottom = 0;
+        pthread_mutex_init(&df->deques[i].lock, NULL);
+    }
+    atomic_init(&df->queued, 0);
+    atomic_init(&df->remaining, 0);
+    pthread_mutex_init(&df->lock, NULL);
+    pthread_cond_init(&df->wake, NULL);
+
+    df->args = (DataflowWorker*) MemoryAlloc(threads * sizeof(DataflowWorker), MEMORY_WORK);
+    df->workers = (pthread_t*) MemoryAlloc(threads * sizeof(pthread_t), MEMORY_WORK);
+    // wątek główny też wykonuje zadania, więc uruchamiamy o jeden wątek mniej;
+    // zajęte procesory nie są już dostępne dla ParallelRun w poleceniach
+    df->reserved = ParallelReserve(threads - 1);
+    for (size_t i = 1; i < threads; ++i) {
+        df->args[i] = (DataflowWorker) {.df = df, .index = i};
+        if (pthread_create(&df->workers[df->started], NULL, DataflowWorkerLoop, &df->args[i]) == 0)
+            df->started++;
+    }
+}
+
+/**
+ * Zatrzymuje wątki robocze i zwalnia pamięć stanu wykonania.
+ * @param[in,out] df : stan wykonania z wykonanym grafem
+ */
+static void DataflowDestroy(Dataflow *df) {
+    pthread_mutex_lock(&df->lock);
+    df->stopping = true;
+    pthread_cond_broadcast(&df->wake);
+    pthread_mutex_unlock(&df->lock);
+    for (size_t i = 0; i < df->started; ++i)
+        pthread_join(df->workers[i], NULL);
+    ParallelRelease(df->reserved);
+
+    for (size_t i = 0; i < df->threads; ++i) {
+        MemoryFree(df->deques[i].tasks, DATAFLOW_BATCH * sizeof(size_t), MEMORY_WORK);
+        pthread_mutex_destroy(&df->deques[i].lock);
+    }
+    pthread_mutex_destroy(&df->lock);
+    pthread_cond_destroy(&df->wake);
+    MemoryFree(df->deques, df->threads * sizeof(DataflowDeque), MEMORY_WORK);
+    MemoryFree(df->args, df->threads * sizeof(DataflowWorker), MEMORY_WORK);
+    MemoryFree(df->workers, df->threads * sizeof(pthread_t), MEMORY_WORK);
+    MemoryFree(df->nodes, DATAFLOW_BATCH * sizeof(DataflowNode), MEMORY_WORK);
+    MemoryFree(df->values, df->values_allocated * sizeof(DataflowValue), MEMORY_WORK);
+    MemoryFree(df->inputs, df->inputs_allocated * sizeof(size_t), MEMORY_WORK);
+    MemoryFree(df->readers, df->readers_allocated * sizeof(DataflowReader), MEMORY_WORK);
+    MemoryFree(df->edges, df->edges_allocated * sizeof(DataflowEdge), MEMORY_WORK);
+    MemoryFree(df->successors, df->successors_allocated * sizeof(size_t), MEMORY_WORK);
+    MemoryFree(df->slots, df->slots_allocated * sizeof(size_t), MEMORY_WORK);
+}
+
+void DataflowInput(Calculator *c, Reader *reader, size_t threads) {
+    Dataflow df;
+    DataflowInit(&df, c, (threads == 0) ? ParallelThreads() : threads);
+    CommandParser parser = CreateCommandParser(reader);
+    Command cmd;
+
+    while (true) {
+        uint64_t start = StatsNow();
+        if (!ParseNextCommand(&parser, &cmd))
+            break;
+
+        if (cmd.error == NULL && (cmd.type == COMMAND_STATS || cmd.type == COMMAND_MEM_STATS)) {
+            // statystyki opisują wszystkie wcześniejsze polecenia, więc czekamy na ich wykonanie
+            DataflowRunBatch(&df);
+            ExecuteCommand(c, &cmd);
+            STATS_STOP(&c->stats, cmd.type, start);
+            continue;
+        }
+
+        DataflowAddCommand(&df, &cmd, StatsNow() - start);
+        if (df.nodes_size == DATAFLOW_BATCH)
+            DataflowRunBatch(&df);
+    }
+
+    DataflowRunBatch(&df);
+    DestroyCommandParser(&parser);
+    DataflowDestroy(&df);
+}
@@ -0,0 +1,40 @@
+/** @file
+  Interfejs współbieżnego wykonywania niezależnych poleceń kalkulatora
+
+  Skrypt kalkulatora często buduje na stosie kilka niezależnych wyników
+  pośrednich, zanim je połączy. W trybie przepływu danych wczytane wiersze są
+  zamieniane na graf zależności: parser śledzi symbolicznie, który wiersz
+  utworzył wielomian w każdym miejscu stosu, więc polecenie zależy tylko od
+  poleceń, które utworzyły lub czytały jego argumenty. Polecenia bez
+  wzajemnych zależności wykonuje pula wątków z podkradaniem zadań, a wyniki
+  i błędy są wypisywane przez wątek główny w kolejności wierszy, więc są
+  identyczne jak przy wykonaniu sekwencyjnym (ParseInput).
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef POLYNOMIALS_DATAFLOW_H
+#define POLYNOMIALS_DATAFLOW_H
+
+#include "parser.h"
+
+/**
+ * Największa liczba wierszy w jednym grafie zależności. Po wczytaniu tylu
+ * wierszy graf jest wykonywany, a wyniki trafiają na stos sesji.
+ */
+#define DATAFLOW_BATCH 4096
+
+/**
+ * Wczytuje polecenia ze źródła @p reader i wykonuje je w sesji @p c jak
+ * ParseInput, ale niezależne polecenia wykonuje współbieżnie w @p threads
+ * wątkach. Polecenia STATS i MEM_STATS są wykonywane po zakończeniu
+ * wszystkich wcześniejszych poleceń.
+ * @param[in,out] c : sesja kalkulatora
+ * @param[in,out] reader : źródło znaków
+ * @param[in] threads : liczba wątków (0 oznacza liczbę dostępnych procesorów)
+ */
+void DataflowInput(Calculator *c, Reader *reader, size_t threads);
+
+#endif //POLYNOMIALS_DATAFLOW_H
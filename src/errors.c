@@ -8,32 +8,48 @@
 
 #include "errors.h"
 
-void ErrorWrongCommand(size_t row) {
-    fprintf(stderr, "ERROR %zu WRONG COMMAND\n", row);
+void ErrorWrongCommand(FILE *err, size_t row) {
+    fprintf(err, "ERROR %zu WRONG COMMAND\n", row);
 }
-void ErrorWrongPoly(size_t row) {
-    fprintf(stderr, "ERROR %zu WRONG POLY\n", row);
+void ErrorWrongPoly(FILE *err, size_t row) {
+    fprintf(err, "ERROR %zu WRONG POLY\n", row);
 }
 
-void ErrorDegBy(size_t row) {
-    fprintf(stderr, "ERROR %zu DEG BY WRONG VARIABLE\n", row);
+void ErrorDegBy(FILE *err, size_t row) {
+    fprintf(err, "ERROR %zu DEG BY WRONG VARIABLE\n", row);
 }
 
-void ErrorAt(size_t row) {
-    fprintf(stderr, "ERROR %zu AT WRONG VALUE\n", row);
+void ErrorAt(FILE *err, size_t row) {
+    fprintf(err, "ERROR %zu AT WRONG VALUE\n", row);
 }
 
-void ErrorCompose(size_t row) {
-    fprintf(stderr, "ERROR %zu COMPOSE WRONG PARAMETER\n", row);
+void ErrorCompose(FILE *err, size_t row) {
+    fprintf(err, "ERROR %zu COMPOSE WRONG PARAMETER\n", row);
 }
 
-void ErrorStackUnderflow(size_t row) {
-    fprintf(stderr, "ERROR %zu STACK UNDERFLOW\n", row);
+void ErrorAddN(FILE *err, size_t row) {
+    fprintf(err, "ERROR %zu ADD_N WRONG PARAMETER\n", row);
 }
 
-bool StackUnderflow(const Stack *s, size_t number_of_elements, size_t row) {
+void ErrorMulN(FILE *err, size_t row) {
+    fprintf(err, "ERROR %zu MUL_N WRONG PARAMETER\n", row);
+}
+
+void ErrorAtVars(FILE *err, size_t row) {
+    fprintf(err, "ERROR %zu AT_VARS WRONG PARAMETER\n", row);
+}
+
+void ErrorAtNext(FILE *err, size_t row) {
+    fprintf(err, "ERROR %zu AT_NEXT WRONG VALUE\n", row);
+}
+
+void ErrorStackUnderflow(FILE *err, size_t row) {
+    fprintf(err, "ERROR %zu STACK UNDERFLOW\n", row);
+}
+
+bool StackUnderflow(const Stack *s, size_t number_of_elements, FILE *err, size_t row) {
     if (StackGetSize(s) < number_of_elements) {
-        ErrorStackUnderflow(row);
+        ErrorStackUnderflow(err, row);
         return true;
     }
     return false;
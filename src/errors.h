@@ -12,49 +12,91 @@
 #include <stdio.h>
 #include "stack.h"
 
+/**
+ * Typ funkcji wypisującej błąd wiersza, np. ErrorWrongCommand.
+ * @param[in] err : strumień, na który wypisywany jest błąd
+ * @param[in] row : numer wiersza, w którym wystąpił błąd
+ */
+typedef void (*ErrorPrinter)(FILE *err, size_t row);
+
 /**
  * Wyświetla błąd o niepoprawnym poleceniu w wierszu.
+ * @param[in] err : strumień, na który wypisywany jest błąd
  * @param[in] row : numer wiersza, w którym wystąpił błąd
  */
-void ErrorWrongCommand(size_t row);
+void ErrorWrongCommand(FILE *err, size_t row);
 
 /**
  * Wyświetla błąd o wczytaniu niepoprawnego wielomianu w wierszu.
+ * @param[in] err : strumień, na który wypisywany jest błąd
  * @param[in] row : numer wiersza, w którym wystąpił błąd
  */
-void ErrorWrongPoly(size_t row);
+void ErrorWrongPoly(FILE *err, size_t row);
 
 /**
  * Wyświetla błąd o niepoprawnym argumencie polecenia DEG_BY.
+ * @param[in] err : strumień, na który wypisywany jest błąd
  * @param[in] row : numer wiersza, w którym wystąpił błąd
  */
-void ErrorDegBy(size_t row);
+void ErrorDegBy(FILE *err, size_t row);
 
 /**
  * Wyświetla błąd o niepoprawnym argumencie polecenia AT.
+ * @param[in] err : strumień, na który wypisywany jest błąd
  * @param[in] row : numer wiersza, w którym wystąpił błąd
  */
-void ErrorAt(size_t row);
+void ErrorAt(FILE *err, size_t row);
 
 /**
  * Wyświetla błąd o niepoprawnym argumencie polecenia COMPOSE.
+ * @param[in] err : strumień, na który wypisywany jest błąd
+ * @param[in] row : numer wiersza, w którym wystąpił błąd
+ */
+void ErrorCompose(FILE *err, size_t row);
+
+/**
+ * Wyświetla błąd o niepoprawnym argumencie polecenia ADD_N.
+ * @param[in] err : strumień, na który wypisywany jest błąd
+ * @param[in] row : numer wiersza, w którym wystąpił błąd
+ */
+void ErrorAddN(FILE *err, size_t row);
+
+/**
+ * Wyświetla błąd o niepoprawnym argumencie polecenia MUL_N.
+ * @param[in] err : strumień, na który wypisywany jest błąd
+ * @param[in] row : numer wiersza, w którym wystąpił błąd
+ */
+void ErrorMulN(FILE *err, size_t row);
+
+/**
+ * Wyświetla błąd o niepoprawnym argumencie polecenia AT_VARS.
+ * @param[in] err : strumień, na który wypisywany jest błąd
+ * @param[in] row : numer wiersza, w którym wystąpił błąd
+ */
+void ErrorAtVars(FILE *err, size_t row);
+
+/**
+ * Wyświetla błąd o niepoprawnym argumencie polecenia AT_NEXT.
+ * @param[in] err : strumień, na który wypisywany jest błąd
  * @param[in] row : numer wiersza, w którym wystąpił błąd
  */
-void ErrorCompose(size_t row);
+void ErrorAtNext(FILE *err, size_t row);
 
 /**
  * Wyświetla błąd dotyczący za małej liczby wielomianów na stosie do wykonania polecenia.
+ * @param[in] err : strumień, na który wypisywany jest błąd
  * @param[in] row : numer wiersza, w którym wystąpił błąd
  */
-void ErrorStackUnderflow(size_t row);
+void ErrorStackUnderflow(FILE *err, size_t row);
 
 /**
  * Sprawdza czy na stosie jest co najmniej @p number_of_elements elementów.
  * @param[in] s : stos
  * @param[in] number_of_elements : liczba elementów
+ * @param[in] err : strumień, na który wypisywany jest błąd
  * @param[in] row : numer wiersza, z którego zostało zczytane ostatnie polecenie
  * @return Czy na stosie jest co najmniej @p number_of_elements elementów?
  */
-bool StackUnderflow(const Stack *s, size_t number_of_elements, size_t row);
+bool StackUnderflow(const Stack *s, size_t number_of_elements, FILE *err, size_t row);
 
 #endif //POLYNOMIALS_ERRORS_H
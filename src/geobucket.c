@@ -0,0 +1,99 @@
+/** @file
+  Implementacja geokubełków – akumulatora sumy wielu wielomianów
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include <stdint.h>
+#include "geobucket.h"
+#include "reclaimer.h"
+
+/**
+ * Daje rozmiar wielomianu mierzony liczbą jednomianów na najwyższym poziomie,
+ * od której zależy koszt dodawania.
+ * @param[in] p : wielomian
+ * @return liczba jednomianów (1 dla niezerowego współczynnika)
+ */
+static size_t GeobucketSize(const Poly *p) {
+    if (PolyIsCoeff(p))
+        return PolyIsZero(p) ? 0 : 1;
+    return PolyGetSize(p);
+}
+
+/**
+ * Daje pojemność kubełka.
+ * @param[in] level : numer kubełka
+ * @return największa liczba jednomianów wielomianu w kubełku @p level
+ */
+static size_t GeobucketCapacity(size_t level) {
+    if (level == GEOBUCKET_LEVELS - 1)
+        return SIZE_MAX;
+    size_t capacity = GEOBUCKET_BASE;
+    for (size_t i = 0; i < level; ++i)
+        capacity *= GEOBUCKET_BASE;
+    return capacity;
+}
+
+Geobucket InitGeobucket(void) {
+    Geobucket g;
+    for (size_t i = 0; i < GEOBUCKET_LEVELS; ++i)
+        g.buckets[i] = PolyZero();
+    g.levels = 0;
+    return g;
+}
+
+void GeobucketAdd(Geobucket *g, Poly *p) {
+    Poly sum = *p;
+    *p = PolyZero();
+    if (PolyIsZero(&sum))
+        return;
+
+    size_t level = 0;
+    while (GeobucketSize(&sum) > GeobucketCapacity(level))
+        level++;
+
+    while (true) {
+        if (!PolyIsZero(&g->buckets[level])) {
+            Poly next = PolyAdd(&g->buckets[level], &sum);
+            PolyReclaim(&g->buckets[level]);
+            PolyReclaim(&sum);
+            g->buckets[level] = PolyZero();
+            sum = next;
+        }
+        // przepełniony kubełek przenosimy do następnego, większego
+        if (GeobucketSize(&sum) <= GeobucketCapacity(level))
+            break;
+        level++;
+    }
+
+    g->buckets[level] = sum;
+    if (level >= g->levels)
+        g->levels = level + 1;
+}
+
+Poly GeobucketSum(Geobucket *g) {
+    // kubełki mają rosnące rozmiary, więc dodawanie od najmniejszego
+    // kosztuje tyle, co kilka przejść po największym
+    Poly sum = PolyZero();
+    for (size_t i = 0; i < g->levels; ++i) {
+        if (PolyIsZero(&g->buckets[i]))
+            continue;
+        Poly next = PolyAdd(&sum, &g->buckets[i]);
+        PolyReclaim(&sum);
+        PolyReclaim(&g->buckets[i]);
+        g->buckets[i] = PolyZero();
+        sum = next;
+    }
+    g->levels = 0;
+    return sum;
+}
+
+void GeobucketDestroy(Geobucket *g) {
+    for (size_t i = 0; i < g->levels; ++i) {
+        PolyDestroy(&g->buckets[i]);
+        g->buckets[i] = PolyZero();
+    }
+    g->levels = 0;
+}
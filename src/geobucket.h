@@ -0,0 +1,62 @@
+/** @file
+  Interfejs geokubełków – akumulatora sumy wielu wielomianów
+
+  Sumowanie wielu wielomianów przez kolejne wywołania PolyAdd na rosnącej
+  sumie kosztuje przy każdym, nawet małym składniku, skopiowanie całej sumy,
+  czyli łącznie @f$O(n^2)@f$. Geokubełek trzyma sumę częściową rozbitą na
+  kubełki o pojemnościach rosnących geometrycznie (GEOBUCKET_BASE razy).
+  Składnik jest dodawany do kubełka odpowiadającego jego rozmiarowi,
+  a kubełek, który przekroczy pojemność, jest przenoszony do następnego.
+  Każdy jednomian jest więc kopiowany @f$O(\log n)@f$ razy, a cała suma
+  kosztuje @f$O(n \log n)@f$.
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef POLYNOMIALS_GEOBUCKET_H
+#define POLYNOMIALS_GEOBUCKET_H
+
+#include "poly.h"
+
+/** Stosunek pojemności kolejnych kubełków. */
+#define GEOBUCKET_BASE 4
+
+/** Liczba kubełków; pojemność ostatniego jest nieograniczona. */
+#define GEOBUCKET_LEVELS 32
+
+/** Struktura przechowująca sumę częściową rozbitą na kubełki. */
+typedef struct Geobucket {
+    Poly buckets[GEOBUCKET_LEVELS]; ///< kubełek i ma co najwyżej GEOBUCKET_BASE^(i+1) jednomianów
+    size_t levels; ///< liczba początkowych kubełków, które mogą być niezerowe
+} Geobucket;
+
+/**
+ * Tworzy pusty geokubełek (o sumie równej zeru).
+ * @return pusty geokubełek
+ */
+Geobucket InitGeobucket(void);
+
+/**
+ * Dodaje wielomian do sumy. Przejmuje na własność zawartość @p p,
+ * która po wywołaniu jest wielomianem zerowym.
+ * @param[in,out] g : geokubełek
+ * @param[in,out] p : dodawany wielomian
+ */
+void GeobucketAdd(Geobucket *g, Poly *p);
+
+/**
+ * Daje sumę wszystkich dodanych wielomianów i opróżnia geokubełek.
+ * @param[in,out] g : geokubełek
+ * @return suma dodanych wielomianów
+ */
+Poly GeobucketSum(Geobucket *g);
+
+/**
+ * Usuwa z pamięci wszystkie dodane wielomiany.
+ * @param[in,out] g : geokubełek
+ */
+void GeobucketDestroy(Geobucket *g);
+
+#endif //POLYNOMIALS_GEOBUCKET_H
@@ -0,0 +1,97 @@
+/** @file
+  Implementacja biblioteki libpoly
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include "libpoly.h"
+#include "parser.h"
+
+/**
+ * Stos za uchwytem PolyStack. Stos utworzony przez PolyStackCreate jest
+ * przechowywany w uchwycie, a uchwyt sesji wskazuje stos kalkulatora.
+ */
+struct PolyStack {
+    Stack *stack; ///< obsługiwany stos
+    Stack own; ///< stos należący do uchwytu utworzonego przez PolyStackCreate
+};
+
+/** Sesja kalkulatora za uchwytem PolyCalc. */
+struct PolyCalc {
+    Calculator calc; ///< sesja kalkulatora
+    PolyStack stack; ///< uchwyt stosu sesji zwracany przez PolyCalcStack
+};
+
+unsigned LibpolyVersion(void) {
+    return LIBPOLY_VERSION_MAJOR * 65536u + LIBPOLY_VERSION_MINOR;
+}
+
+PolyStack *PolyStackCreate(void) {
+    PolyStack *s = (PolyStack*) MemoryAlloc(sizeof(PolyStack), MEMORY_STACK);
+    s->own = InitStack();
+    s->stack = &s->own;
+    return s;
+}
+
+void PolyStackDestroy(PolyStack *s) {
+    if (s == NULL)
+        return;
+    StackClear(s->stack);
+    MemoryFree(s, sizeof(PolyStack), MEMORY_STACK);
+}
+
+size_t PolyStackSize(const PolyStack *s) {
+    return StackGetSize(s->stack);
+}
+
+void PolyStackPush(PolyStack *s, Poly *p) {
+    StackPush(s->stack, p);
+    *p = PolyZero();
+}
+
+bool PolyStackPop(PolyStack *s, Poly *p) {
+    if (IsEmpty(s->stack)) {
+        *p = PolyZero();
+        return false;
+    }
+    *p = StackTake(s->stack);
+    return true;
+}
+
+const Poly *PolyStackTop(const PolyStack *s) {
+    if (IsEmpty(s->stack))
+        return NULL;
+    return &s->stack->polys[StackGetSize(s->stack) - 1];
+}
+
+PolyCalc *PolyCalcCreate(FILE *out, FILE *err) {
+    PolyCalc *c = (PolyCalc*) MemoryAlloc(sizeof(PolyCalc), MEMORY_STACK);
+    c->calc = InitCalculator(out, err);
+    c->stack.stack = &c->calc.stack;
+    return c;
+}
+
+void PolyCalcDestroy(PolyCalc *c) {
+    if (c == NULL)
+        return;
+    CalculatorClear(&c->calc);
+    MemoryFree(c, sizeof(PolyCalc), MEMORY_STACK);
+}
+
+void PolyCalcExecute(PolyCalc *c, const char *buffer, size_t len) {
+    CalcExecute(&c->calc, buffer, len);
+}
+
+PolyStack *PolyCalcStack(PolyCalc *c) {
+    return &c->stack;
+}
+
+bool PolyCalcParse(const char *text, size_t len, Poly *p) {
+    return PolyParse(text, len, p);
+}
+
+void PolyCalcPrint(FILE *out, const Poly *p) {
+    PrintHelper(out, p);
+}
@@ -0,0 +1,150 @@
+/** @file
+  Interfejs biblioteki libpoly do użycia kalkulatora wielomianów w innym programie
+
+  Biblioteka udostępnia wielomiany z poly.h oraz stos wielomianów i sesję
+  kalkulatora ukryte za nieprzezroczystymi uchwytami PolyStack i PolyCalc,
+  więc ich budowa może się zmieniać bez zmiany interfejsu.
+
+  Zasady własności:
+  - uchwyt utworzony funkcją `...Create` należy do wywołującego i musi być
+    usunięty odpowiadającą jej funkcją `...Destroy`, która usuwa też wszystkie
+    wielomiany na stosie;
+  - wielomian przekazany do PolyStackPush przechodzi na własność stosu,
+    a wielomian zwrócony przez PolyStackPop i PolyCalcParse – na własność
+    wywołującego, który usuwa go funkcją PolyDestroy;
+  - wskaźniki zwracane przez PolyStackTop i PolyCalcStack są pożyczone: są
+    ważne do najbliższej zmiany stosu lub usunięcia właściciela i nie wolno
+    przez nie usuwać obiektów.
+
+  Różne uchwyty mogą być używane jednocześnie w różnych wątkach, jeden uchwyt
+  – tylko w jednym wątku naraz. Tak jak cały kalkulator, biblioteka kończy
+  program z kodem 1, gdy zabraknie pamięci.
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef POLYNOMIALS_LIBPOLY_H
+#define POLYNOMIALS_LIBPOLY_H
+
+#include <stdio.h>
+#include "poly.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Numer wersji interfejsu zmieniany przy zmianach niezgodnych wstecz. */
+#define LIBPOLY_VERSION_MAJOR 1
+
+/** Numer wersji interfejsu zmieniany przy dodaniu nowych funkcji. */
+#define LIBPOLY_VERSION_MINOR 0
+
+/** Nieprzezroczysty uchwyt stosu wielomianów. */
+typedef struct PolyStack PolyStack;
+
+/** Nieprzezroczysty uchwyt sesji kalkulatora. */
+typedef struct PolyCalc PolyCalc;
+
+/**
+ * Daje wersję biblioteki, z którą program został połączony.
+ * @return LIBPOLY_VERSION_MAJOR * 65536 + LIBPOLY_VERSION_MINOR
+ */
+POLY_API unsigned LibpolyVersion(void);
+
+/**
+ * Tworzy pusty stos wielomianów.
+ * @return uchwyt stosu
+ */
+POLY_API PolyStack *PolyStackCreate(void);
+
+/**
+ * Usuwa stos wraz ze wszystkimi wielomianami na nim.
+ * @param[in] s : uchwyt stosu lub NULL
+ */
+POLY_API void PolyStackDestroy(PolyStack *s);
+
+/**
+ * Daje liczbę wielomianów na stosie.
+ * @param[in] s : uchwyt stosu
+ * @return liczba wielomianów
+ */
+POLY_API size_t PolyStackSize(const PolyStack *s);
+
+/**
+ * Kładzie wielomian na stos. Stos przejmuje wielomian na własność,
+ * a @p p staje się wielomianem zerowym.
+ * @param[in,out] s : uchwyt stosu
+ * @param[in,out] p : wielomian
+ */
+POLY_API void PolyStackPush(PolyStack *s, Poly *p);
+
+/**
+ * Zdejmuje wielomian z góry stosu i przekazuje go na własność wywołującego.
+ * @param[in,out] s : uchwyt stosu
+ * @param[out] p : zdjęty wielomian lub wielomian zerowy, jeżeli stos jest pusty
+ * @return Czy stos był niepusty?
+ */
+POLY_API bool PolyStackPop(PolyStack *s, Poly *p);
+
+/**
+ * Daje pożyczony wskaźnik na wielomian z góry stosu.
+ * @param[in] s : uchwyt stosu
+ * @return wskaźnik na wielomian lub NULL, jeżeli stos jest pusty
+ */
+POLY_API const Poly *PolyStackTop(const PolyStack *s);
+
+/**
+ * Tworzy sesję kalkulatora z pustym stosem.
+ * @param[in] out : strumień, na który są wypisywane wyniki poleceń
+ * @param[in] err : strumień, na który są wypisywane błędy
+ * @return uchwyt sesji
+ */
+POLY_API PolyCalc *PolyCalcCreate(FILE *out, FILE *err);
+
+/**
+ * Usuwa sesję kalkulatora wraz z jej stosem.
+ * @param[in] c : uchwyt sesji lub NULL
+ */
+POLY_API void PolyCalcDestroy(PolyCalc *c);
+
+/**
+ * Wykonuje w sesji polecenia zapisane w buforze, czytając je bez kopiowania.
+ * Numery wierszy w komunikatach o błędach liczone są od początku bufora.
+ * @param[in,out] c : uchwyt sesji
+ * @param[in] buffer : polecenia, po jednym w wierszu
+ * @param[in] len : liczba znaków w buforze
+ */
+POLY_API void PolyCalcExecute(PolyCalc *c, const char *buffer, size_t len);
+
+/**
+ * Daje pożyczony uchwyt stosu sesji, na który można kłaść argumenty
+ * i z którego można zdejmować wyniki poleceń.
+ * @param[in] c : uchwyt sesji
+ * @return uchwyt stosu należący do sesji
+ */
+POLY_API PolyStack *PolyCalcStack(PolyCalc *c);
+
+/**
+ * Wczytuje wielomian zapisany tak jak w wierszu wejścia kalkulatora.
+ * @param[in] text : napis, nie musi być zakończony znakiem '\0'
+ * @param[in] len : liczba znaków napisu
+ * @param[out] p : wczytany wielomian na własność wywołującego lub wielomian
+ * zerowy w przypadku błędu
+ * @return Czy napis jest poprawnym wielomianem?
+ */
+POLY_API bool PolyCalcParse(const char *text, size_t len, Poly *p);
+
+/**
+ * Wypisuje wielomian w postaci używanej przez kalkulator, bez znaku nowej linii.
+ * @param[in] out : strumień
+ * @param[in] p : wielomian
+ */
+POLY_API void PolyCalcPrint(FILE *out, const Poly *p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //POLYNOMIALS_LIBPOLY_H
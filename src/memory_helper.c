@@ -6,8 +6,89 @@
   @date 2021
 */
 
+/** Udostępnia funkcje POSIX (wątki) przy kompilacji z -std=c11. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
 #include "memory_helper.h"
 
+/**
+ * Struktura przechowująca liczniki jednej kategorii alokacji. Liczniki są
+ * wspólne dla wszystkich wątków, a każda kategoria zajmuje osobną linię
+ * pamięci podręcznej, żeby wątki alokujące w różnych kategoriach sobie nie
+ * przeszkadzały.
+ */
+typedef struct MemoryCounters {
+    _Alignas(64) atomic_uint_fast64_t allocs; ///< liczba alokacji
+    atomic_uint_fast64_t frees; ///< liczba zwolnień
+    atomic_uint_fast64_t live_bytes; ///< liczba aktualnie zajętych bajtów
+    atomic_uint_fast64_t peak_bytes; ///< największa liczba jednocześnie zajętych bajtów
+    atomic_uint_fast64_t recycled; ///< liczba alokacji obsłużonych z puli
+} MemoryCounters;
+
+/** Liczniki wszystkich kategorii alokacji. */
+static MemoryCounters counters[MEMORY_CATEGORIES];
+
+/** Wolny blok w liście wolnych bloków puli. */
+typedef struct PoolBlock {
+    struct PoolBlock *next; ///< następny wolny blok tej samej klasy
+} PoolBlock;
+
+/**
+ * Struktura przechowująca wolne bloki puli jednego wątku. Każdy blok listy
+ * klasy @f$k@f$ ma co najmniej @f$(k + 1) \cdot@f$ POOL_GRANULARITY bajtów
+ * i został zaalokowany funkcją malloc, więc można go zwrócić funkcją free.
+ */
+typedef struct PoolCache {
+    PoolBlock *blocks[POOL_CLASSES]; ///< listy wolnych bloków poszczególnych klas
+    size_t count[POOL_CLASSES]; ///< długości list wolnych bloków
+    bool registered; ///< czy wątek zarejestrował zwolnienie puli przy zakończeniu
+    bool shares; ///< czy pełne listy są oddawane do puli wspólnej
+} PoolCache;
+
+/** Pula bieżącego wątku. */
+static _Thread_local PoolCache pool_cache;
+
+/** Lista wolnych bloków jednej klasy oddana w całości do puli wspólnej. */
+typedef struct PoolBatch {
+    PoolBlock *first; ///< pierwszy blok listy
+    size_t count; ///< długość listy
+} PoolBatch;
+
+/**
+ * Struktura przechowująca wolne bloki oddane przez wątki, które głównie
+ * zwalniają (jak wątek zwalniający), dla wątków, które je alokują. Bloki są
+ * przekazywane całymi listami, więc pod blokadą nie przechodzi się list.
+ * Liczby list są czytane bez blokady, żeby wątek z pustą listą nie musiał jej
+ * brać, gdy w puli wspólnej też nic nie ma.
+ */
+typedef struct SharedPool {
+    pthread_mutex_t lock; ///< blokada chroniąca listy
+    PoolBatch batches[POOL_CLASSES][POOL_SHARED_BATCHES]; ///< stosy list poszczególnych klas
+    atomic_size_t size[POOL_CLASSES]; ///< liczby list na stosach
+} SharedPool;
+
+/** Pula wspólna wszystkich wątków. */
+static SharedPool shared_pool = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+/** Klucz, którego destruktor zwalnia pulę kończącego się wątku. */
+static pthread_key_t pool_key;
+
+/** Zapewnia jednokrotne utworzenie klucza pool_key. */
+static pthread_once_t pool_key_once = PTHREAD_ONCE_INIT;
+
+/** Nazwy kategorii alokacji. */
+static const char *const category_names[MEMORY_CATEGORIES] = {
+    [MEMORY_MONOS] = "MONOS",
+    [MEMORY_STACK] = "STACK",
+    [MEMORY_PARSER] = "PARSER",
+    [MEMORY_WORK] = "WORK"
+};
+
 void CheckPtr(const void *ptr) {
     if (ptr == NULL)
         exit(1);
@@ -15,4 +96,345 @@ void CheckPtr(const void *ptr) {
 
 size_t IncreaseSpace(size_t space) {
     return 2 * space;
-}
\ No newline at end of file
+}
+
+/**
+ * Alokuje blok funkcją malloc i kończy program, jeżeli się nie udało.
+ * Wskaźnik nie trafia do CheckPtr: GCC uznaje, że funkcja z parametrem
+ * `const void *` czyta wskazywaną, jeszcze niezainicjalizowaną pamięć.
+ * @param[in] size : rozmiar bloku w bajtach
+ * @return wskaźnik na blok
+ */
+static inline void *CheckedMalloc(size_t size) {
+    void *ptr = malloc(size);
+    if (ptr == NULL)
+        exit(1);
+    return ptr;
+}
+
+/**
+ * Zwiększa liczbę zajętych bajtów kategorii i aktualizuje maksimum.
+ * @param[in,out] c : liczniki kategorii
+ * @param[in] size : liczba bajtów
+ */
+static inline void AddLiveBytes(MemoryCounters *c, size_t size) {
+    uint_fast64_t live = atomic_fetch_add_explicit(&c->live_bytes, size, memory_order_relaxed) + size;
+    uint_fast64_t peak = atomic_load_explicit(&c->peak_bytes, memory_order_relaxed);
+    while (live > peak &&
+           !atomic_compare_exchange_weak_explicit(&c->peak_bytes, &peak, live,
+                                                  memory_order_relaxed, memory_order_relaxed));
+}
+
+/**
+ * Zmienia liczbę zajętych bajtów kategorii przy zmianie rozmiaru bloku.
+ * @param[in] category : kategoria alokacji
+ * @param[in] old_size : dotychczasowy rozmiar w bajtach
+ * @param[in] new_size : nowy rozmiar w bajtach
+ */
+static inline void ResizeLiveBytes(MemoryCategory category, size_t old_size, size_t new_size) {
+#ifdef POLY_MEMORY_STATS
+    // zmiana rozmiaru nie jest ani nową alokacją, ani zwolnieniem
+    if (new_size > old_size)
+        AddLiveBytes(&counters[category], new_size - old_size);
+    else
+        atomic_fetch_sub_explicit(&counters[category].live_bytes, old_size - new_size, memory_order_relaxed);
+#else
+    (void) category;
+    (void) old_size;
+    (void) new_size;
+#endif
+}
+
+void MemoryTrackAlloc(size_t size, MemoryCategory category) {
+#ifdef POLY_MEMORY_STATS
+    atomic_fetch_add_explicit(&counters[category].allocs, 1, memory_order_relaxed);
+    AddLiveBytes(&counters[category], size);
+#else
+    (void) size;
+    (void) category;
+#endif
+}
+
+void MemoryTrackFree(size_t size, MemoryCategory category) {
+#ifdef POLY_MEMORY_STATS
+    atomic_fetch_add_explicit(&counters[category].frees, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&counters[category].live_bytes, size, memory_order_relaxed);
+#else
+    (void) size;
+    (void) category;
+#endif
+}
+
+void *MemoryAlloc(size_t size, MemoryCategory category) {
+    void *ptr = CheckedMalloc(size);
+    MemoryTrackAlloc(size, category);
+    return ptr;
+}
+
+void *MemoryCalloc(size_t count, size_t size, MemoryCategory category) {
+    void *ptr = calloc(count, size);
+    CheckPtr(ptr);
+    MemoryTrackAlloc(count * size, category);
+    return ptr;
+}
+
+void *MemoryRealloc(void *ptr, size_t old_size, size_t new_size, MemoryCategory category) {
+    if (ptr == NULL)
+        return MemoryAlloc(new_size, category);
+
+    ptr = realloc(ptr, new_size);
+    CheckPtr(ptr);
+    ResizeLiveBytes(category, old_size, new_size);
+    return ptr;
+}
+
+void MemoryFree(void *ptr, size_t size, MemoryCategory category) {
+    if (ptr == NULL)
+        return;
+    free(ptr);
+    MemoryTrackFree(size, category);
+}
+
+/**
+ * Wyznacza klasę rozmiaru puli dla bloku @p size bajtów.
+ * @param[in] size : rozmiar bloku, nie większy niż POOL_MAX_SIZE
+ * @return numer klasy rozmiaru
+ */
+static inline size_t PoolClass(size_t size) {
+    return (size == 0) ? 0 : (size - 1) / POOL_GRANULARITY;
+}
+
+/**
+ * Zwalnia listę wolnych bloków.
+ * @param[in] block : pierwszy blok listy lub NULL
+ */
+static void PoolFreeList(PoolBlock *block) {
+    while (block != NULL) {
+        PoolBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+}
+
+/**
+ * Zwalnia wszystkie wolne bloki z puli.
+ * @param[in,out] cache : pula
+ */
+static void PoolRelease(PoolCache *cache) {
+    for (size_t k = 0; k < POOL_CLASSES; ++k) {
+        PoolFreeList(cache->blocks[k]);
+        cache->blocks[k] = NULL;
+        cache->count[k] = 0;
+    }
+}
+
+/**
+ * Przenosi listę wolnych bloków klasy @p k bieżącego wątku do puli wspólnej
+ * lub, jeżeli pula wspólna jest pełna, zwalnia te bloki.
+ * @param[in] k : numer klasy rozmiaru
+ */
+static void PoolShareClass(size_t k) {
+    PoolBatch batch = {.first = pool_cache.blocks[k], .count = pool_cache.count[k]};
+    pool_cache.blocks[k] = NULL;
+    pool_cache.count[k] = 0;
+    if (batch.first == NULL)
+        return;
+
+    pthread_mutex_lock(&shared_pool.lock);
+    size_t size = atomic_load_explicit(&shared_pool.size[k], memory_order_relaxed);
+    if (size < POOL_SHARED_BATCHES) {
+        shared_pool.batches[k][size] = batch;
+        atomic_store_explicit(&shared_pool.size[k], size + 1, memory_order_relaxed);
+        batch.first = NULL;
+    }
+    pthread_mutex_unlock(&shared_pool.lock);
+    PoolFreeList(batch.first);
+}
+
+/**
+ * Uzupełnia pustą listę wolnych bloków klasy @p k bieżącego wątku listą
+ * z puli wspólnej.
+ * @param[in] k : numer klasy rozmiaru
+ */
+static void PoolRefill(size_t k) {
+    pthread_mutex_lock(&shared_pool.lock);
+    size_t size = atomic_load_explicit(&shared_pool.size[k], memory_order_relaxed);
+    if (size > 0) {
+        PoolBatch batch = shared_pool.batches[k][size - 1];
+        atomic_store_explicit(&shared_pool.size[k], size - 1, memory_order_relaxed);
+        pool_cache.blocks[k] = batch.first;
+        pool_cache.count[k] = batch.count;
+    }
+    pthread_mutex_unlock(&shared_pool.lock);
+}
+
+/**
+ * Destruktor klucza pool_key, zwalnia pulę kończącego się wątku.
+ * @param[in] cache : pula wątku
+ */
+static void PoolDestructor(void *cache) {
+    PoolRelease((PoolCache*) cache);
+}
+
+/** Tworzy klucz pool_key. */
+static void PoolCreateKey(void) {
+    pthread_key_create(&pool_key, PoolDestructor);
+}
+
+/**
+ * Pobiera blok o rozmiarze co najmniej @p size bajtów z puli bieżącego wątku,
+ * uzupełniając ją w razie potrzeby z puli wspólnej, lub, jeżeli obie są puste
+ * albo blok jest za duży, alokuje go funkcją malloc.
+ * Nie zmienia liczników alokacji poza licznikiem bloków z puli.
+ * @param[in] size : rozmiar bloku w bajtach
+ * @param[in] category : kategoria alokacji
+ * @return wskaźnik na blok
+ */
+static void *PoolTake(size_t size, MemoryCategory category) {
+    if (size > POOL_MAX_SIZE)
+        return CheckedMalloc(size);
+
+    size_t k = PoolClass(size);
+    if (pool_cache.blocks[k] == NULL && atomic_load_explicit(&shared_pool.size[k], memory_order_relaxed) > 0)
+        PoolRefill(k);
+    PoolBlock *block = pool_cache.blocks[k];
+    if (block != NULL) {
+        pool_cache.blocks[k] = block->next;
+        pool_cache.count[k]--;
+#ifdef POLY_MEMORY_STATS
+        atomic_fetch_add_explicit(&counters[category].recycled, 1, memory_order_relaxed);
+#else
+        (void) category;
+#endif
+        return block;
+    }
+
+    return CheckedMalloc((k + 1) * POOL_GRANULARITY);
+}
+
+/**
+ * Oddaje blok do puli bieżącego wątku lub, jeżeli jest za duży albo pula jest
+ * pełna, zwalnia go funkcją free. Wątek, który oddaje bloki do puli wspólnej,
+ * przenosi tam pełną listę i zaczyna nową. Nie zmienia liczników alokacji.
+ * @param[in] ptr : wskaźnik na blok
+ * @param[in] size : rozmiar bloku w bajtach
+ */
+static void PoolGive(void *ptr, size_t size) {
+    size_t k = PoolClass(size);
+    if (size > POOL_MAX_SIZE) {
+        free(ptr);
+        return;
+    }
+    if (pool_cache.count[k] == POOL_CACHE_LIMIT) {
+        if (!pool_cache.shares) {
+            free(ptr);
+            return;
+        }
+        PoolShareClass(k);
+    }
+
+    if (!pool_cache.registered) {
+        // przy zakończeniu wątku jego pula zostanie zwolniona
+        pthread_once(&pool_key_once, PoolCreateKey);
+        pthread_setspecific(pool_key, &pool_cache);
+        pool_cache.registered = true;
+    }
+
+    PoolBlock *block = (PoolBlock*) ptr;
+    block->next = pool_cache.blocks[k];
+    pool_cache.blocks[k] = block;
+    pool_cache.count[k]++;
+}
+
+void *MemoryPoolCalloc(size_t size, MemoryCategory category) {
+    void *ptr = PoolTake(size, category);
+    memset(ptr, 0, size);
+    MemoryTrackAlloc(size, category);
+    return ptr;
+}
+
+void *MemoryPoolRealloc(void *ptr, size_t old_size, size_t new_size, MemoryCategory category) {
+    if (old_size > POOL_MAX_SIZE && new_size > POOL_MAX_SIZE) {
+        ptr = realloc(ptr, new_size);
+        CheckPtr(ptr);
+    }
+    else if (old_size > POOL_MAX_SIZE || new_size > POOL_MAX_SIZE ||
+             PoolClass(new_size) > PoolClass(old_size)) {
+        // blok przechodzi do innej klasy, więc przenosimy jego zawartość
+        void *moved = PoolTake(new_size, category);
+        memcpy(moved, ptr, (old_size < new_size) ? old_size : new_size);
+        PoolGive(ptr, old_size);
+        ptr = moved;
+    }
+    // w pozostałym przypadku blok jest wystarczająco duży, żeby go nie przenosić
+
+    ResizeLiveBytes(category, old_size, new_size);
+    return ptr;
+}
+
+void MemoryPoolFree(void *ptr, size_t size, MemoryCategory category) {
+    if (ptr == NULL)
+        return;
+    PoolGive(ptr, size);
+    MemoryTrackFree(size, category);
+}
+
+void *MemoryPoolAdopt(void *ptr, size_t size, MemoryCategory category) {
+    MemoryTrackAlloc(size, category);
+    if (size > POOL_MAX_SIZE)
+        return ptr;
+
+    // blok zaalokowany przez użytkownika może być mniejszy niż blok swojej klasy,
+    // więc nie może trafić do puli
+    void *block = PoolTake(size, category);
+    memcpy(block, ptr, size);
+    free(ptr);
+    return block;
+}
+
+void MemoryPoolTrim(void) {
+    PoolRelease(&pool_cache);
+
+    pthread_mutex_lock(&shared_pool.lock);
+    for (size_t k = 0; k < POOL_CLASSES; ++k) {
+        size_t size = atomic_load_explicit(&shared_pool.size[k], memory_order_relaxed);
+        for (size_t j = 0; j < size; ++j)
+            PoolFreeList(shared_pool.batches[k][j].first);
+        atomic_store_explicit(&shared_pool.size[k], 0, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&shared_pool.lock);
+}
+
+void MemoryPoolShareFrees(bool share) {
+    pool_cache.shares = share;
+}
+
+void MemoryPoolFlush(void) {
+    for (size_t k = 0; k < POOL_CLASSES; ++k)
+        PoolShareClass(k);
+}
+
+MemoryStats MemoryGetStats(MemoryCategory category) {
+    MemoryCounters *c = &counters[category];
+    return (MemoryStats) {
+        .allocs = atomic_load_explicit(&c->allocs, memory_order_relaxed),
+        .frees = atomic_load_explicit(&c->frees, memory_order_relaxed),
+        .live_bytes = atomic_load_explicit(&c->live_bytes, memory_order_relaxed),
+        .peak_bytes = atomic_load_explicit(&c->peak_bytes, memory_order_relaxed),
+        .recycled = atomic_load_explicit(&c->recycled, memory_order_relaxed)
+    };
+}
+
+const char *MemoryCategoryName(MemoryCategory category) {
+    return category_names[category];
+}
+
+void MemoryPrintStats(FILE *out) {
+    fprintf(out, "CATEGORY ALLOCS FREES LIVE_BYTES PEAK_BYTES RECYCLED\n");
+    for (int i = 0; i < MEMORY_CATEGORIES; ++i) {
+        MemoryStats s = MemoryGetStats((MemoryCategory) i);
+        fprintf(out, "%s %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
+                MemoryCategoryName((MemoryCategory) i), s.allocs, s.frees, s.live_bytes, s.peak_bytes,
+                s.recycled);
+    }
+}
@@ -1,6 +1,18 @@
 /** @file
   Interfejs pomocnicznych funkcji do zarządzania pamięcią
 
+  Wszystkie alokacje wielomianów, stosu i parsera przechodzą przez funkcje
+  Memory*, które (jeżeli program został skompilowany z makrem
+  POLY_MEMORY_STATS) zliczają alokacje, zwolnienia oraz bieżący i maksymalny
+  rozmiar zajętej pamięci w podziale na kategorie.
+
+  Małe bloki (do POOL_MAX_SIZE bajtów) mogą być alokowane funkcjami
+  MemoryPool*, które zamiast zwracać zwolnione bloki do systemu trzymają je
+  w listach wolnych bloków osobnych dla każdego wątku i każdej klasy rozmiaru.
+  Wątek, który głównie zwalnia bloki zaalokowane przez inne wątki, może je
+  oddawać do puli wspólnej (MemoryPoolShareFrees), z której pozostałe wątki
+  uzupełniają swoje puste listy.
+
   @authors Jakub Pawlewicz <pan@mimuw.edu.pl>, Marcin Peczarski <marpe@mimuw.edu.pl>, Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
   @copyright Uniwersytet Warszawski
   @date 2021
@@ -12,8 +24,44 @@
 /** Początkowy rozmiar nowo alokowanej tablicy. */
 #define INIT_SIZE 10
 
+/** Co ile bajtów zaczyna się kolejna klasa rozmiaru puli. */
+#define POOL_GRANULARITY 16
+/** Liczba klas rozmiaru puli. */
+#define POOL_CLASSES 16
+/** Największy rozmiar bloku (w bajtach) obsługiwany przez pulę. */
+#define POOL_MAX_SIZE (POOL_GRANULARITY * POOL_CLASSES)
+/** Największa liczba wolnych bloków jednej klasy trzymanych przez wątek. */
+#define POOL_CACHE_LIMIT 1024
+/** Największa liczba list wolnych bloków jednej klasy w puli wspólnej. */
+#define POOL_SHARED_BATCHES 64
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include "stdlib.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Kategorie alokacji, dla których prowadzone są osobne liczniki. */
+typedef enum MemoryCategory {
+    MEMORY_MONOS, ///< tablice jednomianów
+    MEMORY_STACK, ///< tablica wielomianów na stosie
+    MEMORY_PARSER, ///< napisy, bufory i tablice parsera
+    MEMORY_WORK, ///< stosy robocze nierekurencyjnych przejść po wielomianach i inne tablice pomocnicze
+    MEMORY_CATEGORIES ///< liczba kategorii
+} MemoryCategory;
+
+/** Struktura przechowująca stan liczników jednej kategorii alokacji. */
+typedef struct MemoryStats {
+    uint64_t allocs; ///< liczba alokacji
+    uint64_t frees; ///< liczba zwolnień
+    uint64_t live_bytes; ///< liczba aktualnie zajętych bajtów
+    uint64_t peak_bytes; ///< największa liczba jednocześnie zajętych bajtów
+    uint64_t recycled; ///< liczba alokacji obsłużonych z puli, bez wywołania malloc
+} MemoryStats;
+
 /**
  * Funkcja do sprawdzania, czy udało się zaalokować pamięć.
  * @param[in] ptr : wskaźnik
@@ -27,4 +75,145 @@ void CheckPtr(const void *ptr);
  */
 size_t IncreaseSpace(size_t space);
 
+/**
+ * Alokuje @p size bajtów pamięci. Kończy program, jeżeli alokacja się nie powiodła.
+ * @param[in] size : liczba bajtów
+ * @param[in] category : kategoria alokacji
+ * @return wskaźnik na zaalokowaną pamięć
+ */
+void *MemoryAlloc(size_t size, MemoryCategory category);
+
+/**
+ * Alokuje wyzerowaną tablicę @p count elementów rozmiaru @p size.
+ * Kończy program, jeżeli alokacja się nie powiodła.
+ * @param[in] count : liczba elementów
+ * @param[in] size : rozmiar elementu
+ * @param[in] category : kategoria alokacji
+ * @return wskaźnik na zaalokowaną pamięć
+ */
+void *MemoryCalloc(size_t count, size_t size, MemoryCategory category);
+
+/**
+ * Zmienia rozmiar zaalokowanej pamięci z @p old_size na @p new_size bajtów.
+ * Kończy program, jeżeli alokacja się nie powiodła.
+ * @param[in] ptr : wskaźnik na pamięć (lub NULL)
+ * @param[in] old_size : dotychczasowy rozmiar w bajtach
+ * @param[in] new_size : nowy rozmiar w bajtach
+ * @param[in] category : kategoria alokacji
+ * @return wskaźnik na pamięć o nowym rozmiarze
+ */
+void *MemoryRealloc(void *ptr, size_t old_size, size_t new_size, MemoryCategory category);
+
+/**
+ * Zwalnia pamięć zaalokowaną funkcjami Memory*.
+ * @param[in] ptr : wskaźnik na pamięć (lub NULL)
+ * @param[in] size : rozmiar pamięci w bajtach
+ * @param[in] category : kategoria alokacji
+ */
+void MemoryFree(void *ptr, size_t size, MemoryCategory category);
+
+/**
+ * Alokuje wyzerowany blok @p size bajtów. Bloki nie większe niż POOL_MAX_SIZE
+ * są w miarę możliwości pobierane z listy wolnych bloków bieżącego wątku.
+ * Kończy program, jeżeli alokacja się nie powiodła.
+ * @param[in] size : liczba bajtów
+ * @param[in] category : kategoria alokacji
+ * @return wskaźnik na zaalokowaną pamięć
+ */
+void *MemoryPoolCalloc(size_t size, MemoryCategory category);
+
+/**
+ * Zmienia rozmiar bloku zaalokowanego funkcją MemoryPoolCalloc z @p old_size
+ * na @p new_size bajtów. Zawartość nowej części bloku nie jest zerowana.
+ * Kończy program, jeżeli alokacja się nie powiodła.
+ * @param[in] ptr : wskaźnik na blok
+ * @param[in] old_size : dotychczasowy rozmiar w bajtach
+ * @param[in] new_size : nowy rozmiar w bajtach (większy od zera)
+ * @param[in] category : kategoria alokacji
+ * @return wskaźnik na blok o nowym rozmiarze
+ */
+void *MemoryPoolRealloc(void *ptr, size_t old_size, size_t new_size, MemoryCategory category);
+
+/**
+ * Zwalnia blok zaalokowany funkcją MemoryPoolCalloc. Małe bloki trafiają do
+ * listy wolnych bloków bieżącego wątku (o ile nie jest pełna).
+ * @param[in] ptr : wskaźnik na blok (lub NULL)
+ * @param[in] size : rozmiar bloku w bajtach
+ * @param[in] category : kategoria alokacji
+ */
+void MemoryPoolFree(void *ptr, size_t size, MemoryCategory category);
+
+/**
+ * Przejmuje do puli blok @p ptr rozmiaru @p size zaalokowany funkcją malloc
+ * (na przykład przez użytkownika biblioteki). Jeżeli blok jest mały, to jego
+ * zawartość jest przenoszona do bloku z puli, a on sam zwalniany.
+ * @param[in] ptr : wskaźnik na blok
+ * @param[in] size : rozmiar bloku w bajtach
+ * @param[in] category : kategoria alokacji
+ * @return wskaźnik na blok, który można zwolnić funkcją MemoryPoolFree
+ */
+void *MemoryPoolAdopt(void *ptr, size_t size, MemoryCategory category);
+
+/**
+ * Zwraca do systemu wszystkie wolne bloki z puli bieżącego wątku i z puli
+ * wspólnej. Dla pozostałych wątków dzieje się to automatycznie przy ich
+ * zakończeniu.
+ */
+void MemoryPoolTrim(void);
+
+/**
+ * Ustala, czy bieżący wątek oddaje pełne listy wolnych bloków do puli
+ * wspólnej zamiast zwalniać kolejne bloki funkcją free. Służy wątkom, które
+ * zwalniają bloki zaalokowane przez inne wątki.
+ * @param[in] share : czy oddawać bloki do puli wspólnej
+ */
+void MemoryPoolShareFrees(bool share);
+
+/**
+ * Przenosi wszystkie wolne bloki bieżącego wątku do puli wspólnej (bloki,
+ * które się w niej nie mieszczą, są zwalniane).
+ */
+void MemoryPoolFlush(void);
+
+/**
+ * Zalicza do kategorii @p category pamięć, która została zaalokowana poza
+ * funkcjami Memory* (na przykład przez użytkownika biblioteki), a której
+ * właścicielem staje się teraz ta kategoria.
+ * @param[in] size : rozmiar pamięci w bajtach
+ * @param[in] category : kategoria alokacji
+ */
+void MemoryTrackAlloc(size_t size, MemoryCategory category);
+
+/**
+ * Wyłącza z kategorii @p category pamięć, która nie jest zwalniana, ale
+ * przestaje do niej należeć (na przykład jest przekazywana innej kategorii).
+ * @param[in] size : rozmiar pamięci w bajtach
+ * @param[in] category : kategoria alokacji
+ */
+void MemoryTrackFree(size_t size, MemoryCategory category);
+
+/**
+ * Daje stan liczników kategorii @p category (wspólnych dla wszystkich wątków).
+ * @param[in] category : kategoria alokacji
+ * @return stan liczników
+ */
+MemoryStats MemoryGetStats(MemoryCategory category);
+
+/**
+ * Daje nazwę kategorii alokacji.
+ * @param[in] category : kategoria alokacji
+ * @return nazwa kategorii
+ */
+const char *MemoryCategoryName(MemoryCategory category);
+
+/**
+ * Wypisuje stan liczników wszystkich kategorii alokacji.
+ * @param[in] out : strumień wyjścia
+ */
+void MemoryPrintStats(FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif //POLYNOMIALS_MEMORY_HELPER_H
@@ -0,0 +1,768 @@
+/** @file
+  Implementacja mnożenia wielomianów modulo kilka liczb pierwszych
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include "builder.h"
+#include "modular.h"
+#include "parallel.h"
+#include "terms.h"
+
+/** Liczba liczb pierwszych w tablicy modular_primes. */
+#define MODULAR_PRIMES 8
+
+/** Największe @f$k@f$, dla którego każda z liczb modular_primes ma pierwiastek z jedynki stopnia @f$2^k@f$. */
+#define NTT_MAX_LOG 23
+
+/** Długość transformaty, od której NTT dla różnych liczb pierwszych jest liczone w osobnych wątkach. */
+#define NTT_PARALLEL_LENGTH 4096
+
+/** Liczba współczynników odtwarzanych z reszt w jednym zadaniu. */
+#define MODULAR_GARNER_CHUNK 4096
+
+/** Znacznik pustego miejsca w tablicy mieszającej. */
+#define MODULAR_EMPTY UINT32_MAX
+
+/**
+ * Liczby pierwsze postaci @f$c \cdot 2^k + 1@f$, gdzie @f$k \geq@f$ NTT_MAX_LOG,
+ * z przedziału @f$(2^{30}, 2^{31})@f$. Iloczyn dwóch reszt mieści się
+ * w 62 bitach, a suma dwóch reszt w 32 bitach.
+ */
+static const uint32_t modular_primes[MODULAR_PRIMES] = {
+    2013265921u, 1811939329u, 2113929217u, 1711276033u,
+    1107296257u, 1224736769u, 2130706433u, 1300234241u
+};
+
+/** Pierwiastki pierwotne kolejnych liczb modular_primes. */
+static const uint32_t modular_generators[MODULAR_PRIMES] = {31, 13, 5, 29, 10, 3, 3, 3};
+
+/** Czy PolyMul korzysta z PolyMulModular. */
+static atomic_bool modular_enabled;
+
+void ModularSetEnabled(bool enabled) {
+    atomic_store(&modular_enabled, enabled);
+}
+
+bool ModularEnabled(void) {
+    return atomic_load_explicit(&modular_enabled, memory_order_relaxed);
+}
+
+/** Tablica mieszająca nadająca kolejne indeksy różnym kluczom wykładników. */
+typedef struct ModularTable {
+    uint64_t *keys; ///< klucze na kolejnych miejscach tablicy
+    uint32_t *slots; ///< indeksy kluczy na kolejnych miejscach albo MODULAR_EMPTY
+    size_t capacity; ///< liczba miejsc, potęga dwójki
+    uint64_t *distinct; ///< różne klucze w kolejności nadania indeksów
+    size_t count; ///< liczba różnych kluczy
+    size_t distinct_capacity; ///< liczba kluczy mieszczących się w tablicy distinct
+} ModularTable;
+
+/** Dane zadań liczących iloczyn modulo kolejne liczby pierwsze. */
+typedef struct ModularTask {
+    size_t primes; ///< liczba użytych liczb pierwszych
+    size_t p_count; ///< liczba wyrazów @f$p@f$
+    size_t q_count; ///< liczba wyrazów @f$q@f$
+    const poly_coeff_t *p_coeffs; ///< współczynniki wyrazów @f$p@f$
+    const poly_coeff_t *q_coeffs; ///< współczynniki wyrazów @f$q@f$
+    uint32_t *p_res; ///< reszty współczynników @f$p@f$, po p_count na liczbę pierwszą
+    uint32_t *p_shoup; ///< stałe ShoupConstant dla reszt p_res
+    uint32_t *q_res; ///< reszty współczynników @f$q@f$, po q_count na liczbę pierwszą
+    uint32_t *products; ///< bufory iloczynów reszt, po q_count na liczbę pierwszą
+    uint32_t **acc; ///< sumy iloczynów reszt pod indeksami kluczy, po jednej tablicy na liczbę pierwszą
+    const uint32_t *index; ///< indeksy kluczy par wyrazów bieżącego kroku, po q_count na wyraz @f$p@f$
+    size_t row_begin; ///< pierwszy wyraz @f$p@f$ bieżącego kroku
+    size_t row_end; ///< wyraz @f$p@f$ za ostatnim wyrazem bieżącego kroku
+    size_t distinct; ///< liczba różnych wyrazów iloczynu
+    size_t acc_capacity; ///< liczba sum mieszczących się w każdej z tablic acc
+    unsigned bound; ///< współczynniki iloczynu mają wartość bezwzględną mniejszą niż @f$2^{bound}@f$
+    uint32_t offset[MODULAR_PRIMES]; ///< @f$2^{bound}@f$ modulo kolejne liczby pierwsze
+    uint32_t inverse[MODULAR_PRIMES][MODULAR_PRIMES]; ///< odwrotność i-tej liczby pierwszej modulo j-ta w [j][i]
+    uint64_t prefix[MODULAR_PRIMES]; ///< iloczyny poprzednich liczb pierwszych modulo @f$2^{64}@f$
+    poly_coeff_t *coeffs; ///< odtworzone współczynniki wyrazów iloczynu
+} ModularTask;
+
+/**
+ * Daje liczbę bitów potrzebnych do zapisania liczby.
+ * @param[in] x : liczba
+ * @return liczba bitów (0 dla zera)
+ */
+static unsigned BitLength(uint64_t x) {
+    unsigned bits = 0;
+    while (x != 0) {
+        bits++;
+        x >>= 1;
+    }
+    return bits;
+}
+
+/**
+ * Daje wartość bezwzględną współczynnika bez przepełnienia.
+ * @param[in] c : współczynnik
+ * @return @f$|c|@f$
+ */
+static uint64_t CoeffAbs(poly_coeff_t c) {
+    return (c < 0) ? -(uint64_t) c : (uint64_t) c;
+}
+
+/**
+ * Daje resztę współczynnika modulo liczba pierwsza.
+ * @param[in] c : współczynnik
+ * @param[in] prime : liczba pierwsza
+ * @return @f$c \bmod prime@f$ z przedziału @f$[0, prime)@f$
+ */
+static uint32_t Residue(poly_coeff_t c, uint32_t prime) {
+    uint64_t r = CoeffAbs(c) % prime;
+    return (uint32_t) ((c < 0 && r != 0) ? prime - r : r);
+}
+
+/**
+ * Podnosi liczbę do potęgi modulo liczba pierwsza.
+ * @param[in] base : podstawa mniejsza niż @p prime
+ * @param[in] exp : wykładnik
+ * @param[in] prime : liczba pierwsza
+ * @return @f$base^{exp} \bmod prime@f$
+ */
+static uint64_t PowMod(uint64_t base, uint64_t exp, uint64_t prime) {
+    uint64_t result = 1;
+    while (exp > 0) {
+        if (exp & 1)
+            result = result * base % prime;
+        base = base * base % prime;
+        exp >>= 1;
+    }
+    return result;
+}
+
+/**
+ * Liczy stałe algorytmu Garnera i reszty przesunięcia @f$2^{bound}@f$.
+ * @param[in,out] task : dane zadań z ustawionymi polami primes i bound
+ */
+static void InitModularConstants(ModularTask *task) {
+    uint64_t prefix = 1;
+    for (size_t j = 0; j < task->primes; ++j) {
+        uint64_t prime = modular_primes[j];
+        task->offset[j] = (uint32_t) PowMod(2, task->bound, prime);
+        for (size_t i = 0; i < j; ++i)
+            task->inverse[j][i] = (uint32_t) PowMod(modular_primes[i] % prime, prime - 2, prime);
+        task->prefix[j] = prefix;
+        prefix *= prime;
+    }
+}
+
+/**
+ * Daje @f$\lfloor a \cdot 2^{32} / prime \rfloor@f$, czyli stałą mnożenia
+ * przez @p a metodą Shoupa.
+ * @param[in] a : reszta
+ * @param[in] prime : liczba pierwsza
+ * @return stała dla ShoupMul
+ */
+static uint32_t ShoupConstant(uint32_t a, uint32_t prime) {
+    return (uint32_t) (((uint64_t) a << 32) / prime);
+}
+
+/**
+ * Mnoży reszty modulo liczba pierwsza metodą Shoupa: iloraz jest przybliżany
+ * mnożeniem przez wcześniej policzoną stałą, więc nie ma dzielenia ani skoków
+ * warunkowych.
+ * @param[in] a : reszta
+ * @param[in] a_shoup : ShoupConstant(a, prime)
+ * @param[in] b : reszta
+ * @param[in] prime : liczba pierwsza
+ * @return @f$a \cdot b \bmod prime@f$
+ */
+static inline uint32_t ShoupMul(uint64_t a, uint64_t a_shoup, uint64_t b, uint32_t prime) {
+    uint64_t quotient = (a_shoup * b) >> 32;
+    uint64_t r = a * b - quotient * prime;
+    return (uint32_t) (r - ((r >= prime) ? prime : 0));
+}
+
+/**
+ * Liczy reszty współczynników obu czynników modulo jedna liczba pierwsza.
+ * @param[in,out] ctx : dane zadań (ModularTask)
+ * @param[in] i : indeks liczby pierwszej
+ */
+static void ModularResidues(void *ctx, size_t i) {
+    ModularTask *task = (ModularTask*) ctx;
+    uint32_t prime = modular_primes[i];
+    uint32_t *p_res = task->p_res + i * task->p_count, *p_shoup = task->p_shoup + i * task->p_count;
+    uint32_t *q_res = task->q_res + i * task->q_count;
+    for (size_t k = 0; k < task->p_count; ++k) {
+        p_res[k] = Residue(task->p_coeffs[k], prime);
+        p_shoup[k] = ShoupConstant(p_res[k], prime);
+    }
+    for (size_t k = 0; k < task->q_count; ++k)
+        q_res[k] = Residue(task->q_coeffs[k], prime);
+}
+
+/**
+ * Mnoży resztę przez wszystkie reszty tablicy modulo liczba pierwsza.
+ * @param[in] a : reszta
+ * @param[in] a_shoup : ShoupConstant(a, prime)
+ * @param[in] b : reszty
+ * @param[in] count : liczba reszt @p b
+ * @param[in] prime : liczba pierwsza
+ * @param[out] out : @f$a \cdot b[j] \bmod prime@f$ dla kolejnych @f$j@f$
+ */
+static void ModularProducts(uint64_t a, uint64_t a_shoup, const uint32_t b[], size_t count,
+                            uint32_t prime, uint32_t out[]) {
+    for (size_t j = 0; j < count; ++j)
+        out[j] = ShoupMul(a, a_shoup, b[j], prime);
+}
+
+/**
+ * Dodaje iloczyny reszt par wyrazów bieżącego kroku do sum pod indeksami ich
+ * kluczy modulo jedna liczba pierwsza.
+ * @param[in,out] ctx : dane zadań (ModularTask)
+ * @param[in] i : indeks liczby pierwszej
+ */
+static void ModularKernel(void *ctx, size_t i) {
+    ModularTask *task = (ModularTask*) ctx;
+    uint32_t prime = modular_primes[i];
+    const uint32_t *p_res = task->p_res + i * task->p_count, *p_shoup = task->p_shoup + i * task->p_count;
+    const uint32_t *q_res = task->q_res + i * task->q_count;
+    uint32_t *products = task->products + i * task->q_count;
+    uint32_t *acc = task->acc[i];
+
+    for (size_t row = task->row_begin; row < task->row_end; ++row) {
+        const uint32_t *index = task->index + (row - task->row_begin) * task->q_count;
+        ModularProducts(p_res[row], p_shoup[row], q_res, task->q_count, prime, products);
+        for (size_t j = 0; j < task->q_count; ++j) {
+            uint32_t sum = acc[index[j]] + products[j];
+            acc[index[j]] = sum - ((sum >= prime) ? prime : 0);
+        }
+    }
+}
+
+/**
+ * Odtwarza współczynniki z reszt algorytmem Garnera. Reszty przesuniętej
+ * wartości @f$c + 2^{bound}@f$ wyznaczają cyfry jej zapisu w systemie
+ * o podstawach będących kolejnymi liczbami pierwszymi, z których wartość jest
+ * składana modulo @f$2^{64}@f$.
+ * @param[in,out] ctx : dane zadań (ModularTask)
+ * @param[in] chunk : indeks kawałka MODULAR_GARNER_CHUNK współczynników
+ */
+static void ModularGarner(void *ctx, size_t chunk) {
+    ModularTask *task = (ModularTask*) ctx;
+    size_t begin = chunk * MODULAR_GARNER_CHUNK;
+    size_t end = (begin + MODULAR_GARNER_CHUNK < task->distinct) ? begin + MODULAR_GARNER_CHUNK : task->distinct;
+    uint64_t shift = (task->bound < 64) ? (uint64_t) 1 << task->bound : 0;
+
+    for (size_t c = begin; c < end; ++c) {
+        uint64_t digits[MODULAR_PRIMES];
+        uint64_t value = 0;
+        for (size_t j = 0; j < task->primes; ++j) {
+            uint64_t prime = modular_primes[j];
+            uint64_t x = ((uint64_t) task->acc[j][c] + task->offset[j]) % prime;
+            for (size_t i = 0; i < j; ++i)
+                x = (x + prime - digits[i] % prime) % prime * task->inverse[j][i] % prime;
+            digits[j] = x;
+            value += x * task->prefix[j];
+        }
+        task->coeffs[c] = (poly_coeff_t) (value - shift);
+    }
+}
+
+/**
+ * Odtwarza z reszt w tablicach acc współczynniki wszystkich distinct wyrazów
+ * iloczynu do nowej tablicy coeffs.
+ * @param[in,out] task : dane zadań
+ */
+static void ModularReconstruct(ModularTask *task) {
+    task->coeffs = (poly_coeff_t*) MemoryAlloc(task->distinct * sizeof(poly_coeff_t), MEMORY_WORK);
+    size_t chunks = (task->distinct + MODULAR_GARNER_CHUNK - 1) / MODULAR_GARNER_CHUNK;
+    ParallelRun(chunks, ParallelThreads(), ModularGarner, task);
+}
+
+/**
+ * Tworzy pustą tablicę mieszającą.
+ * @param[out] t : tablica
+ */
+static void InitModularTable(ModularTable *t) {
+    t->capacity = 1024;
+    t->keys = (uint64_t*) MemoryAlloc(t->capacity * sizeof(uint64_t), MEMORY_WORK);
+    t->slots = (uint32_t*) MemoryAlloc(t->capacity * sizeof(uint32_t), MEMORY_WORK);
+    memset(t->slots, 0xff, t->capacity * sizeof(uint32_t));
+    t->count = 0;
+    t->distinct_capacity = t->capacity / 2;
+    t->distinct = (uint64_t*) MemoryAlloc(t->distinct_capacity * sizeof(uint64_t), MEMORY_WORK);
+}
+
+/**
+ * Zwalnia pamięć tablicy mieszającej.
+ * @param[in,out] t : tablica
+ */
+static void ModularTableDestroy(ModularTable *t) {
+    MemoryFree(t->keys, t->capacity * sizeof(uint64_t), MEMORY_WORK);
+    MemoryFree(t->slots, t->capacity * sizeof(uint32_t), MEMORY_WORK);
+    MemoryFree(t->distinct, t->distinct_capacity * sizeof(uint64_t), MEMORY_WORK);
+}
+
+/**
+ * Daje pierwsze miejsce tablicy sprawdzane dla klucza.
+ * @param[in] t : tablica
+ * @param[in] key : klucz
+ * @return indeks miejsca
+ */
+static size_t ModularSlot(const ModularTable *t, uint64_t key) {
+    return (size_t) ((key * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & (t->capacity - 1);
+}
+
+/**
+ * Podwaja liczbę miejsc tablicy mieszającej i rozmieszcza klucze na nowo.
+ * @param[in,out] t : tablica
+ */
+static void ModularTableGrow(ModularTable *t) {
+    MemoryFree(t->keys, t->capacity * sizeof(uint64_t), MEMORY_WORK);
+    MemoryFree(t->slots, t->capacity * sizeof(uint32_t), MEMORY_WORK);
+    t->capacity = IncreaseSpace(t->capacity);
+    t->keys = (uint64_t*) MemoryAlloc(t->capacity * sizeof(uint64_t), MEMORY_WORK);
+    t->slots = (uint32_t*) MemoryAlloc(t->capacity * sizeof(uint32_t), MEMORY_WORK);
+    memset(t->slots, 0xff, t->capacity * sizeof(uint32_t));
+    for (size_t k = 0; k < t->count; ++k) {
+        size_t s = ModularSlot(t, t->distinct[k]);
+        while (t->slots[s] != MODULAR_EMPTY)
+            s = (s + 1) & (t->capacity - 1);
+        t->keys[s] = t->distinct[k];
+        t->slots[s] = (uint32_t) k;
+    }
+    size_t distinct_capacity = t->capacity / 2;
+    t->distinct = (uint64_t*) MemoryRealloc(t->distinct, t->distinct_capacity * sizeof(uint64_t),
+                                            distinct_capacity * sizeof(uint64_t), MEMORY_WORK);
+    t->distinct_capacity = distinct_capacity;
+}
+
+/**
+ * Daje indeks klucza, nadając nowemu kluczowi kolejny indeks.
+ * @param[in,out] t : tablica
+ * @param[in] key : klucz
+ * @return indeks klucza
+ */
+static uint32_t ModularTableIndex(ModularTable *t, uint64_t key) {
+    size_t s = ModularSlot(t, key);
+    while (t->slots[s] != MODULAR_EMPTY) {
+        if (t->keys[s] == key)
+            return t->slots[s];
+        s = (s + 1) & (t->capacity - 1);
+    }
+    if (t->count == t->distinct_capacity) {
+        // tablica jest zapełniona w połowie, po powiększeniu szukamy miejsca od nowa
+        ModularTableGrow(t);
+        s = ModularSlot(t, key);
+        while (t->slots[s] != MODULAR_EMPTY)
+            s = (s + 1) & (t->capacity - 1);
+    }
+    t->keys[s] = key;
+    t->slots[s] = (uint32_t) t->count;
+    t->distinct[t->count] = key;
+    return (uint32_t) t->count++;
+}
+
+/** Wyrazy czynnika wyeksportowane do tablic. */
+typedef struct ModularTerms {
+    size_t count; ///< liczba wyrazów
+    poly_exp_t *exps; ///< macierz wykładników, po vars na wyraz
+    poly_coeff_t *coeffs; ///< współczynniki wyrazów
+    uint64_t *keys; ///< spakowane wykładniki wyrazów
+} ModularTerms;
+
+/**
+ * Eksportuje wyrazy czynnika.
+ * @param[out] t : wyrazy
+ * @param[in] p : wielomian
+ * @param[in] vars : liczba kolumn macierzy wykładników
+ */
+static void InitModularTerms(ModularTerms *t, const Poly *p, size_t vars) {
+    t->count = PolyTermCount(p);
+    t->exps = (poly_exp_t*) MemoryAlloc(t->count * vars * sizeof(poly_exp_t), MEMORY_WORK);
+    t->coeffs = (poly_coeff_t*) MemoryAlloc(t->count * sizeof(poly_coeff_t), MEMORY_WORK);
+    t->keys = (uint64_t*) MemoryAlloc(t->count * sizeof(uint64_t), MEMORY_WORK);
+    PolyExportTerms(p, vars, t->exps, t->coeffs);
+}
+
+/**
+ * Zwalnia pamięć wyeksportowanych wyrazów.
+ * @param[in,out] t : wyrazy
+ * @param[in] vars : liczba kolumn macierzy wykładników
+ */
+static void ModularTermsDestroy(ModularTerms *t, size_t vars) {
+    MemoryFree(t->exps, t->count * vars * sizeof(poly_exp_t), MEMORY_WORK);
+    MemoryFree(t->coeffs, t->count * sizeof(poly_coeff_t), MEMORY_WORK);
+    MemoryFree(t->keys, t->count * sizeof(uint64_t), MEMORY_WORK);
+}
+
+/**
+ * Daje największy wykładnik zmiennej w wyrazach czynnika.
+ * @param[in] t : wyrazy
+ * @param[in] vars : liczba kolumn macierzy wykładników
+ * @param[in] var : indeks zmiennej
+ * @return największy wykładnik
+ */
+static uint64_t ModularMaxExp(const ModularTerms *t, size_t vars, size_t var) {
+    uint64_t max = 0;
+    for (size_t k = 0; k < t->count; ++k) {
+        if ((uint64_t) t->exps[k * vars + var] > max)
+            max = (uint64_t) t->exps[k * vars + var];
+    }
+    return max;
+}
+
+/**
+ * Pakuje wykładniki wyrazów czynnika do kluczy.
+ * @param[in,out] t : wyrazy
+ * @param[in] vars : liczba kolumn macierzy wykładników
+ * @param[in] shifts : przesunięcia kolejnych zmiennych w kluczu
+ */
+static void ModularPackKeys(ModularTerms *t, size_t vars, const unsigned shifts[]) {
+    for (size_t k = 0; k < t->count; ++k) {
+        uint64_t key = 0;
+        for (size_t v = 0; v < vars; ++v)
+            key |= (uint64_t) t->exps[k * vars + v] << shifts[v];
+        t->keys[k] = key;
+    }
+}
+
+/**
+ * Daje największą wartość bezwzględną współczynnika.
+ * @param[in] coeffs : współczynniki
+ * @param[in] count : liczba współczynników
+ * @return największe @f$|c|@f$
+ */
+static uint64_t MaxCoeffAbs(const poly_coeff_t coeffs[], size_t count) {
+    uint64_t max = 0;
+    for (size_t k = 0; k < count; ++k) {
+        if (CoeffAbs(coeffs[k]) > max)
+            max = CoeffAbs(coeffs[k]);
+    }
+    return max;
+}
+
+/**
+ * Ustawia wykładnik bound oszacowania @f$|c| < 2^{bound}@f$ współczynników
+ * iloczynu, liczbę potrzebnych liczb pierwszych i stałe algorytmu Garnera.
+ * @param[in,out] task : dane zadań z ustawionymi współczynnikami czynników
+ */
+static void InitModularBound(ModularTask *task) {
+    // współczynnik iloczynu jest sumą co najwyżej min(|p|, |q|) iloczynów współczynników
+    size_t terms = (task->p_count < task->q_count) ? task->p_count : task->q_count;
+    task->bound = BitLength(MaxCoeffAbs(task->p_coeffs, task->p_count)) +
+                  BitLength(MaxCoeffAbs(task->q_coeffs, task->q_count)) + BitLength(terms);
+    // wartość c + 2^bound leży w [0, 2^(bound + 1)), a iloczyn liczb pierwszych przekracza 2^(30 * primes)
+    task->primes = (task->bound + 30) / 30;
+    assert(task->primes <= MODULAR_PRIMES);
+    InitModularConstants(task);
+}
+
+/**
+ * Liczy sumy iloczynów reszt dla wszystkich par wyrazów. Pary są
+ * przetwarzane w krokach po co najmniej MODULAR_BLOCK par: wątek wywołujący
+ * nadaje kluczom par indeksy, a potem zadania dla kolejnych liczb pierwszych
+ * dodają iloczyny reszt pod tymi indeksami.
+ * @param[in,out] task : dane zadań
+ * @param[in] p : wyrazy @f$p@f$
+ * @param[in] q : wyrazy @f$q@f$
+ * @param[in,out] table : tablica mieszająca kluczy iloczynu
+ */
+static void ModularAccumulate(ModularTask *task, const ModularTerms *p, const ModularTerms *q, ModularTable *table) {
+    size_t rows = (MODULAR_BLOCK / q->count > 0) ? MODULAR_BLOCK / q->count : 1;
+    uint32_t *index = (uint32_t*) MemoryAlloc(rows * q->count * sizeof(uint32_t), MEMORY_WORK);
+    task->index = index;
+
+    for (size_t begin = 0; begin < p->count; begin += rows) {
+        size_t end = (begin + rows < p->count) ? begin + rows : p->count;
+        for (size_t row = begin; row < end; ++row) {
+            uint32_t *row_index = index + (row - begin) * q->count;
+            for (size_t j = 0; j < q->count; ++j)
+                row_index[j] = ModularTableIndex(table, p->keys[row] + q->keys[j]);
+        }
+
+        if (table->count > task->acc_capacity) {
+            size_t capacity = table->distinct_capacity;
+            for (size_t i = 0; i < task->primes; ++i) {
+                task->acc[i] = (uint32_t*) MemoryRealloc(task->acc[i], task->acc_capacity * sizeof(uint32_t),
+                                                         capacity * sizeof(uint32_t), MEMORY_WORK);
+                memset(task->acc[i] + task->acc_capacity, 0, (capacity - task->acc_capacity) * sizeof(uint32_t));
+            }
+            task->acc_capacity = capacity;
+        }
+
+        task->row_begin = begin;
+        task->row_end = end;
+        ParallelRun(task->primes, ParallelThreads(), ModularKernel, task);
+    }
+
+    task->distinct = table->count;
+    MemoryFree(index, rows * q->count * sizeof(uint32_t), MEMORY_WORK);
+}
+
+bool PolyMulModular(const Poly *p, const Poly *q, Poly *result) {
+    assert(p != NULL && q != NULL && result != NULL);
+    if (PolyIsCoeff(p) || PolyIsCoeff(q)) {
+        *result = PolyMul(p, q);
+        return true;
+    }
+
+    size_t p_vars = PolyVarCount(p), q_vars = PolyVarCount(q);
+    size_t vars = (p_vars > q_vars) ? p_vars : q_vars;
+    ModularTerms p_terms, q_terms;
+    InitModularTerms(&p_terms, p, vars);
+    InitModularTerms(&q_terms, q, vars);
+
+    // każda zmienna dostaje tyle bitów, ile ma suma jej największych wykładników w obu czynnikach
+    unsigned *shifts = (unsigned*) MemoryAlloc(vars * sizeof(unsigned), MEMORY_WORK);
+    unsigned *widths = (unsigned*) MemoryAlloc(vars * sizeof(unsigned), MEMORY_WORK);
+    unsigned total = 0;
+    for (size_t v = 0; v < vars && total <= 64; ++v) {
+        widths[v] = BitLength(ModularMaxExp(&p_terms, vars, v) + ModularMaxExp(&q_terms, vars, v));
+        shifts[v] = (widths[v] > 0) ? total : 0;
+        total += widths[v];
+    }
+
+    bool fits = total <= 64 && (uint64_t) p_terms.count * q_terms.count < MODULAR_EMPTY;
+    if (fits) {
+        ModularPackKeys(&p_terms, vars, shifts);
+        ModularPackKeys(&q_terms, vars, shifts);
+
+        ModularTask task = {.p_count = p_terms.count, .q_count = q_terms.count,
+                            .p_coeffs = p_terms.coeffs, .q_coeffs = q_terms.coeffs};
+        InitModularBound(&task);
+
+        uint32_t *acc[MODULAR_PRIMES] = {NULL};
+        task.acc = acc;
+        task.p_res = (uint32_t*) MemoryAlloc(task.primes * task.p_count * sizeof(uint32_t), MEMORY_WORK);
+        task.p_shoup = (uint32_t*) MemoryAlloc(task.primes * task.p_count * sizeof(uint32_t), MEMORY_WORK);
+        task.q_res = (uint32_t*) MemoryAlloc(task.primes * task.q_count * sizeof(uint32_t), MEMORY_WORK);
+        task.products = (uint32_t*) MemoryAlloc(task.primes * task.q_count * sizeof(uint32_t), MEMORY_WORK);
+        ParallelRun(task.primes, ParallelThreads(), ModularResidues, &task);
+
+        ModularTable table;
+        InitModularTable(&table);
+        ModularAccumulate(&task, &p_terms, &q_terms, &table);
+
+        ModularReconstruct(&task);
+
+        PolyBuilder b;
+        InitPolyBuilder(&b, vars);
+        poly_exp_t *exps = (poly_exp_t*) MemoryAlloc(vars * sizeof(poly_exp_t), MEMORY_WORK);
+        for (size_t c = 0; c < task.distinct; ++c) {
+            for (size_t v = 0; v < vars; ++v) {
+                uint64_t mask = ((uint64_t) 1 << widths[v]) - 1;
+                exps[v] = (poly_exp_t) ((table.distinct[c] >> shifts[v]) & mask);
+            }
+            PolyBuilderAdd(&b, exps, task.coeffs[c]);
+        }
+        *result = PolyBuilderFinish(&b);
+        PolyBuilderDestroy(&b);
+
+        MemoryFree(exps, vars * sizeof(poly_exp_t), MEMORY_WORK);
+        MemoryFree(task.coeffs, task.distinct * sizeof(poly_coeff_t), MEMORY_WORK);
+        for (size_t i = 0; i < task.primes; ++i)
+            MemoryFree(acc[i], task.acc_capacity * sizeof(uint32_t), MEMORY_WORK);
+        ModularTableDestroy(&table);
+        MemoryFree(task.p_res, task.primes * task.p_count * sizeof(uint32_t), MEMORY_WORK);
+        MemoryFree(task.p_shoup, task.primes * task.p_count * sizeof(uint32_t), MEMORY_WORK);
+        MemoryFree(task.q_res, task.primes * task.q_count * sizeof(uint32_t), MEMORY_WORK);
+        MemoryFree(task.products, task.primes * task.q_count * sizeof(uint32_t), MEMORY_WORK);
+    }
+
+    MemoryFree(shifts, vars * sizeof(unsigned), MEMORY_WORK);
+    MemoryFree(widths, vars * sizeof(unsigned), MEMORY_WORK);
+    ModularTermsDestroy(&p_terms, vars);
+    ModularTermsDestroy(&q_terms, vars);
+    return fits;
+}
+
+/** Dane zadań mnożących gęste wielomiany jednej zmiennej przez NTT. */
+typedef struct NttTask {
+    ModularTask crt; ///< współczynniki czynników (p_coeffs, q_coeffs), reszty iloczynu i dane algorytmu Garnera
+    unsigned log; ///< transformata ma długość @f$2^{log}@f$
+} NttTask;
+
+/**
+ * Liczy potęgi pierwiastka z jedynki stopnia @f$2^{log}@f$ i ich stałe Shoupa.
+ * @param[in] root : pierwiastek z jedynki
+ * @param[in] log : logarytm stopnia pierwiastka
+ * @param[in] prime : liczba pierwsza
+ * @param[out] roots : @f$root^j@f$ dla @f$j < 2^{log - 1}@f$
+ * @param[out] roots_shoup : stałe ShoupConstant kolejnych potęg
+ */
+static void NttRoots(uint32_t root, unsigned log, uint32_t prime, uint32_t roots[], uint32_t roots_shoup[]) {
+    size_t half = (size_t) 1 << (log - 1);
+    uint32_t root_shoup = ShoupConstant(root, prime);
+    roots[0] = 1;
+    roots_shoup[0] = ShoupConstant(1, prime);
+    for (size_t j = 1; j < half; ++j) {
+        roots[j] = ShoupMul(root, root_shoup, roots[j - 1], prime);
+        roots_shoup[j] = ShoupConstant(roots[j], prime);
+    }
+}
+
+/**
+ * Liczy w miejscu transformatę NTT tablicy długości @f$2^{log}@f$: po
+ * permutacji odwracającej bity indeksów łączy motylkami przedziały długości
+ * 2, 4, ..., @f$2^{log}@f$.
+ * @param[in,out] a : reszty
+ * @param[in] log : logarytm długości tablicy
+ * @param[in] prime : liczba pierwsza
+ * @param[in] roots : potęgi pierwiastka z jedynki stopnia @f$2^{log}@f$ (NttRoots)
+ * @param[in] roots_shoup : stałe Shoupa potęg pierwiastka
+ */
+static void NttTransform(uint32_t a[], unsigned log, uint32_t prime, const uint32_t roots[],
+                         const uint32_t roots_shoup[]) {
+    size_t n = (size_t) 1 << log;
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            uint32_t tmp = a[i];
+            a[i] = a[j];
+            a[j] = tmp;
+        }
+    }
+
+    for (size_t half = 1; half < n; half <<= 1) {
+        // przedział długości 2 * half korzysta z co (n / (2 * half))-tej potęgi pierwiastka
+        size_t step = n / (2 * half);
+        for (size_t start = 0; start < n; start += 2 * half) {
+            for (size_t j = 0; j < half; ++j) {
+                uint32_t u = a[start + j];
+                uint32_t v = ShoupMul(roots[j * step], roots_shoup[j * step], a[start + j + half], prime);
+                uint32_t sum = u + v;
+                a[start + j] = sum - ((sum >= prime) ? prime : 0);
+                a[start + j + half] = u - v + ((u < v) ? prime : 0);
+            }
+        }
+    }
+}
+
+/**
+ * Liczy współczynniki iloczynu modulo jedna liczba pierwsza: transformaty obu
+ * czynników, iloczyn punkt po punkcie i transformatę odwrotną.
+ * @param[in,out] ctx : dane zadań (NttTask)
+ * @param[in] i : indeks liczby pierwszej
+ */
+static void NttKernel(void *ctx, size_t i) {
+    NttTask *task = (NttTask*) ctx;
+    ModularTask *crt = &task->crt;
+    uint32_t prime = modular_primes[i];
+    size_t n = (size_t) 1 << task->log;
+    uint32_t *a = (uint32_t*) MemoryCalloc(n, sizeof(uint32_t), MEMORY_WORK);
+    uint32_t *b = (uint32_t*) MemoryCalloc(n, sizeof(uint32_t), MEMORY_WORK);
+    uint32_t *roots = (uint32_t*) MemoryAlloc(n / 2 * sizeof(uint32_t), MEMORY_WORK);
+    uint32_t *roots_shoup = (uint32_t*) MemoryAlloc(n / 2 * sizeof(uint32_t), MEMORY_WORK);
+    for (size_t k = 0; k < crt->p_count; ++k)
+        a[k] = Residue(crt->p_coeffs[k], prime);
+    for (size_t k = 0; k < crt->q_count; ++k)
+        b[k] = Residue(crt->q_coeffs[k], prime);
+
+    uint32_t root = (uint32_t) PowMod(modular_generators[i], (prime - 1) >> task->log, prime);
+    NttRoots(root, task->log, prime, roots, roots_shoup);
+    NttTransform(a, task->log, prime, roots, roots_shoup);
+    NttTransform(b, task->log, prime, roots, roots_shoup);
+    for (size_t k = 0; k < n; ++k)
+        a[k] = (uint32_t) ((uint64_t) a[k] * b[k] % prime);
+
+    // transformata odwrotna to transformata z odwrotnym pierwiastkiem podzielona przez n
+    NttRoots((uint32_t) PowMod(root, prime - 2, prime), task->log, prime, roots, roots_shoup);
+    NttTransform(a, task->log, prime, roots, roots_shoup);
+    uint32_t n_inverse = (uint32_t) PowMod(n % prime, prime - 2, prime), n_shoup = ShoupConstant(n_inverse, prime);
+    for (size_t k = 0; k < crt->distinct; ++k)
+        crt->acc[i][k] = ShoupMul(n_inverse, n_shoup, a[k], prime);
+
+    MemoryFree(a, n * sizeof(uint32_t), MEMORY_WORK);
+    MemoryFree(b, n * sizeof(uint32_t), MEMORY_WORK);
+    MemoryFree(roots, n / 2 * sizeof(uint32_t), MEMORY_WORK);
+    MemoryFree(roots_shoup, n / 2 * sizeof(uint32_t), MEMORY_WORK);
+}
+
+/**
+ * Zapisuje współczynniki wielomianu jednej zmiennej o stałych współczynnikach
+ * w gęstej tablicy, jeżeli co najmniej co NTT_DENSITY-ty współczynnik do
+ * stopnia włącznie jest niezerowy.
+ * @param[in] p : wielomian niebędący współczynnikiem
+ * @param[out] count : stopień wielomianu powiększony o 1, długość tablicy
+ * @return tablica współczynników albo NULL, jeżeli wielomian nie spełnia warunków
+ */
+static poly_coeff_t *NttDenseCoeffs(const Poly *p, size_t *count) {
+    size_t size = PolyGetSize(p);
+    for (size_t k = 0; k < size; ++k) {
+        Mono m = PolyGetMono(p, k);
+        if (!PolyIsCoeff(&m.p))
+            return NULL;
+    }
+    Mono last = PolyGetMono(p, size - 1);
+    *count = (size_t) MonoGetExp(&last) + 1;
+    if (*count > NTT_DENSITY * size)
+        return NULL;
+
+    poly_coeff_t *coeffs = (poly_coeff_t*) MemoryCalloc(*count, sizeof(poly_coeff_t), MEMORY_WORK);
+    for (size_t k = 0; k < size; ++k) {
+        // PolyGetMono uwzględnia znacznik POLY_NEG_TAG
+        Mono m = PolyGetMono(p, k);
+        coeffs[MonoGetExp(&m)] = m.p.coeff;
+    }
+    return coeffs;
+}
+
+bool PolyMulNtt(const Poly *p, const Poly *q, Poly *result) {
+    assert(p != NULL && q != NULL && result != NULL);
+    if (PolyIsCoeff(p) || PolyIsCoeff(q))
+        return false;
+
+    size_t p_count, q_count;
+    poly_coeff_t *p_coeffs = NttDenseCoeffs(p, &p_count);
+    if (p_coeffs == NULL)
+        return false;
+    poly_coeff_t *q_coeffs = NttDenseCoeffs(q, &q_count);
+    if (q_coeffs == NULL) {
+        MemoryFree(p_coeffs, p_count * sizeof(poly_coeff_t), MEMORY_WORK);
+        return false;
+    }
+
+    NttTask task = {.crt = {.p_count = p_count, .q_count = q_count, .p_coeffs = p_coeffs, .q_coeffs = q_coeffs,
+                            .distinct = p_count + q_count - 1}};
+    task.log = 1;
+    while (((size_t) 1 << task.log) < task.crt.distinct)
+        task.log++;
+    bool fits = task.log <= NTT_MAX_LOG;
+    if (fits) {
+        InitModularBound(&task.crt);
+        uint32_t *acc[MODULAR_PRIMES] = {NULL};
+        task.crt.acc = acc;
+        for (size_t i = 0; i < task.crt.primes; ++i)
+            acc[i] = (uint32_t*) MemoryAlloc(task.crt.distinct * sizeof(uint32_t), MEMORY_WORK);
+        // krótkie transformaty trwają krócej niż uruchomienie wątków
+        size_t threads = (((size_t) 1 << task.log) >= NTT_PARALLEL_LENGTH) ? ParallelThreads() : 1;
+        ParallelRun(task.crt.primes, threads, NttKernel, &task);
+        ModularReconstruct(&task.crt);
+
+        size_t count = 0;
+        for (size_t k = 0; k < task.crt.distinct; ++k)
+            count += task.crt.coeffs[k] != 0;
+        // wykładniki rosną, więc tablica jest od razu posortowana
+        Mono *monos = (count > 0) ? (Mono*) MemoryPoolCalloc(count * sizeof(Mono), MEMORY_MONOS) : NULL;
+        count = 0;
+        for (size_t k = 0; k < task.crt.distinct; ++k) {
+            if (task.crt.coeffs[k] != 0) {
+                Poly coeff = PolyFromCoeff(task.crt.coeffs[k]);
+                monos[count++] = MonoFromPoly(&coeff, (poly_exp_t) k);
+            }
+        }
+        *result = PolyOwnSortedMonos(count, monos);
+
+        MemoryFree(task.crt.coeffs, task.crt.distinct * sizeof(poly_coeff_t), MEMORY_WORK);
+        for (size_t i = 0; i < task.crt.primes; ++i)
+            MemoryFree(acc[i], task.crt.distinct * sizeof(uint32_t), MEMORY_WORK);
+    }
+
+    MemoryFree(p_coeffs, p_count * sizeof(poly_coeff_t), MEMORY_WORK);
+    MemoryFree(q_coeffs, q_count * sizeof(poly_coeff_t), MEMORY_WORK);
+    return fits;
+}
@@ -0,0 +1,96 @@
+/** @file
+  Interfejs mnożenia wielomianów modulo kilka liczb pierwszych
+
+  Iloczyn jest liczony osobno modulo kilka liczb pierwszych mniejszych niż
+  @f$2^{31}@f$, każda w osobnym zadaniu ParallelRun, a dokładne współczynniki
+  są odtwarzane z reszt z chińskiego twierdzenia o resztach (algorytmem
+  Garnera). Liczba liczb pierwszych wynika z oszacowania wartości
+  bezwzględnej współczynników iloczynu przez największe współczynniki
+  czynników i liczbę składników sumy. Współczynniki wielomianów są liczone
+  modulo @f$2^{64}@f$, więc odtworzona dokładna wartość jest na koniec
+  sprowadzana modulo @f$2^{64}@f$ i wynik jest identyczny z PolyMul.
+
+  Wykładniki wyrazu są pakowane do jednej liczby 64-bitowej, po tyle bitów
+  na zmienną, ile potrzeba na sumę największych wykładników tej zmiennej
+  w obu czynnikach, więc wykładnik iloczynu wyrazów to suma kluczy.
+  Tablica mieszająca nadaje każdemu różnemu kluczowi iloczynu indeks,
+  a zadania dla kolejnych liczb pierwszych sumują iloczyny reszt pod tymi
+  indeksami.
+
+  Gęste wielomiany jednej zmiennej o stałych współczynnikach PolyMulNtt mnoży
+  modulo te same liczby pierwsze szybką transformatą teoretycznoliczbową
+  (NTT) w czasie @f$O(n \log n)@f$, a współczynniki odtwarza tak samo.
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef POLYNOMIALS_MODULAR_H
+#define POLYNOMIALS_MODULAR_H
+
+#include "poly.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Iloczyn liczb jednomianów czynników, od którego PolyMul w trybie modularnym liczy iloczyn modulo liczby pierwsze. */
+#define MODULAR_MIN_PRODUCT 65536
+
+/**
+ * Liczba jednomianów obu czynników, od której PolyMul próbuje mnożenia przez
+ * NTT. Według BenchNtt w poly_bench.c NTT jest szybsze od zwykłego mnożenia
+ * już od około 16 wyrazów.
+ */
+#define NTT_MIN_TERMS 32
+
+/** PolyMulNtt wymaga, żeby co najmniej co NTT_DENSITY-ty współczynnik czynnika do stopnia był niezerowy. */
+#define NTT_DENSITY 2
+
+/** Liczba par wyrazów czynników przetwarzanych w jednym kroku przez zadania dla liczb pierwszych. */
+#define MODULAR_BLOCK (1u << 20)
+
+/**
+ * Włącza lub wyłącza tryb modularny: PolyMul (a więc też PolyPower) liczy
+ * duże iloczyny przez PolyMulModular w ParallelThreads() wątkach.
+ * @param[in] enabled : czy tryb ma być włączony
+ */
+POLY_API void ModularSetEnabled(bool enabled);
+
+/**
+ * Sprawdza, czy tryb modularny jest włączony.
+ * @return Czy PolyMul korzysta z PolyMulModular?
+ */
+POLY_API bool ModularEnabled(void);
+
+/**
+ * Mnoży dwa wielomiany modulo kilka liczb pierwszych i odtwarza współczynniki
+ * z chińskiego twierdzenia o resztach. Nie liczy iloczynu, jeżeli spakowane
+ * wykładniki iloczynu nie mieszczą się w 64 bitach albo liczba par wyrazów
+ * nie mieści się w indeksach 32-bitowych.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @param[out] result : @f$p * q@f$, jeżeli iloczyn został policzony
+ * @return Czy iloczyn został policzony?
+ */
+POLY_API bool PolyMulModular(const Poly *p, const Poly *q, Poly *result);
+
+/**
+ * Mnoży dwa wielomiany jednej zmiennej o stałych współczynnikach szybką
+ * transformatą teoretycznoliczbową modulo kilka liczb pierwszych i odtwarza
+ * współczynniki z chińskiego twierdzenia o resztach. Nie liczy iloczynu,
+ * jeżeli któryś czynnik ma współczynnik niebędący stałą, jest rzadki (patrz
+ * NTT_DENSITY) albo iloczyn ma stopień co najmniej @f$2^{23}@f$.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @param[out] result : @f$p * q@f$, jeżeli iloczyn został policzony
+ * @return Czy iloczyn został policzony?
+ */
+POLY_API bool PolyMulNtt(const Poly *p, const Poly *q, Poly *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //POLYNOMIALS_MODULAR_H
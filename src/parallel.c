@@ -0,0 +1,117 @@
+/** @file
+  Implementacja równoległego wykonywania niezależnych zadań
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+/** Udostępnia funkcje POSIX (wątki, sysconf) przy kompilacji z -std=c11. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "memory_helper.h"
+#include "parallel.h"
+
+/** Struktura opisująca zadania wykonywane przez wątki. */
+typedef struct ParallelJobs {
+    void (*task)(void *ctx, size_t i); ///< funkcja wykonująca zadanie
+    void *ctx; ///< dane przekazywane do funkcji task
+    size_t count; ///< liczba zadań
+    atomic_size_t next; ///< indeks kolejnego zadania do wykonania
+} ParallelJobs;
+
+/** Liczba wątków ustawiona przez ParallelSetThreads, 0 oznacza liczbę procesorów. */
+static atomic_size_t parallel_threads;
+
+/** Liczba dostępnych procesorów odczytana przy pierwszym użyciu, 0 oznacza brak odczytu. */
+static atomic_size_t parallel_cpus;
+
+/** Liczba dodatkowych wątków zarezerwowanych przez ParallelReserve. */
+static atomic_size_t parallel_reserved;
+
+/** Czy bieżący wątek wykonuje zadanie ParallelRun. */
+static _Thread_local bool parallel_inside;
+
+/**
+ * Wykonuje kolejne zadania, dopóki się nie skończą.
+ * @param[in,out] arg : zadania (ParallelJobs)
+ * @return NULL
+ */
+static void *ParallelWorker(void *arg) {
+    ParallelJobs *jobs = (ParallelJobs*) arg;
+    // zadania zagnieżdżone wykonujemy w bieżącym wątku
+    bool inside = parallel_inside;
+    parallel_inside = true;
+    size_t i;
+    while ((i = atomic_fetch_add(&jobs->next, 1)) < jobs->count)
+        jobs->task(jobs->ctx, i);
+    parallel_inside = inside;
+    return NULL;
+}
+
+void ParallelSetThreads(size_t threads) {
+    atomic_store(&parallel_threads, threads);
+}
+
+size_t ParallelThreads(void) {
+    size_t threads = atomic_load(&parallel_threads);
+    if (threads != 0)
+        return threads;
+    // sysconf czyta /sys przy każdym wywołaniu, a ParseLine pyta o liczbę wątków co wiersz;
+    // wątki, które odczytają ją jednocześnie, zapiszą tę samą wartość
+    size_t cpus = atomic_load_explicit(&parallel_cpus, memory_order_relaxed);
+    if (cpus == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        cpus = (online > 0) ? (size_t) online : 1;
+        atomic_store_explicit(&parallel_cpus, cpus, memory_order_relaxed);
+    }
+    return cpus;
+}
+
+size_t ParallelReserve(size_t threads) {
+    size_t limit = ParallelThreads() - 1;
+    size_t reserved = atomic_load(&parallel_reserved);
+    size_t granted;
+    do {
+        size_t free_threads = (reserved < limit) ? limit - reserved : 0;
+        granted = (threads < free_threads) ? threads : free_threads;
+    } while (granted > 0 && !atomic_compare_exchange_weak(&parallel_reserved, &reserved, reserved + granted));
+    return granted;
+}
+
+void ParallelRelease(size_t threads) {
+    atomic_fetch_sub(&parallel_reserved, threads);
+}
+
+void ParallelRun(size_t count, size_t threads, void (*task)(void *ctx, size_t i), void *ctx) {
+    if (threads == 0)
+        threads = ParallelThreads();
+    if (threads > count)
+        threads = count;
+
+    ParallelJobs jobs = {.task = task, .ctx = ctx, .count = count};
+    atomic_init(&jobs.next, 0);
+    // wątek wywołujący też wykonuje zadania, więc potrzebujemy o jeden wątek mniej
+    size_t extra = (threads <= 1 || parallel_inside) ? 0 : ParallelReserve(threads - 1);
+    if (extra == 0) {
+        ParallelWorker(&jobs);
+        return;
+    }
+
+    pthread_t *workers = (pthread_t*) MemoryAlloc(extra * sizeof(pthread_t), MEMORY_WORK);
+    size_t started = 0;
+    for (size_t i = 0; i < extra; ++i) {
+        if (pthread_create(&workers[started], NULL, ParallelWorker, &jobs) == 0)
+            started++;
+    }
+    ParallelWorker(&jobs);
+    for (size_t i = 0; i < started; ++i)
+        pthread_join(workers[i], NULL);
+    MemoryFree(workers, extra * sizeof(pthread_t), MEMORY_WORK);
+    ParallelRelease(extra);
+}
@@ -0,0 +1,59 @@
+/** @file
+  Interfejs równoległego wykonywania niezależnych zadań
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef POLYNOMIALS_PARALLEL_H
+#define POLYNOMIALS_PARALLEL_H
+
+#include <stddef.h>
+
+/**
+ * Ustawia liczbę wątków, między które są dzielone duże działania na wielu
+ * wielomianach.
+ * @param[in] threads : liczba wątków (0 oznacza liczbę dostępnych procesorów)
+ */
+void ParallelSetThreads(size_t threads);
+
+/**
+ * Daje liczbę wątków ustawioną przez ParallelSetThreads, a domyślnie liczbę
+ * dostępnych procesorów.
+ * @return liczba wątków, co najmniej 1
+ */
+size_t ParallelThreads(void);
+
+/**
+ * Rezerwuje co najwyżej @p threads dodatkowych wątków z limitu
+ * ParallelThreads() - 1 wspólnego dla całego programu. Wątki uruchamiane poza
+ * ParallelRun (sesje trybu wsadowego, wątki robocze przepływu danych)
+ * rezerwują się tak samo, żeby działania wewnątrz nich nie uruchamiały
+ * więcej wątków, niż jest procesorów.
+ * @param[in] threads : liczba potrzebnych wątków
+ * @return liczba zarezerwowanych wątków, być może 0
+ */
+size_t ParallelReserve(size_t threads);
+
+/**
+ * Zwalnia wątki zarezerwowane przez ParallelReserve.
+ * @param[in] threads : liczba zarezerwowanych wątków
+ */
+void ParallelRelease(size_t threads);
+
+/**
+ * Wykonuje zadania o indeksach od 0 do @p count - 1 w co najwyżej @p threads
+ * wątkach (wliczając wątek wywołujący). Wątki pobierają kolejne indeksy
+ * zadań, dopóki zadania się nie skończą. Wraca po wykonaniu wszystkich zadań.
+ * Dodatkowe wątki są rezerwowane przez ParallelReserve, więc gdy limit jest
+ * wyczerpany, zadania wykonuje sam wątek wywołujący; tak samo dzieje się
+ * przy wywołaniu z wnętrza zadania innego ParallelRun.
+ * @param[in] count : liczba zadań
+ * @param[in] threads : liczba wątków (0 oznacza liczbę dostępnych procesorów)
+ * @param[in] task : funkcja wykonująca zadanie o podanym indeksie
+ * @param[in] ctx : dane przekazywane do funkcji @p task
+ */
+void ParallelRun(size_t count, size_t threads, void (*task)(void *ctx, size_t i), void *ctx);
+
+#endif //POLYNOMIALS_PARALLEL_H
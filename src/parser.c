@@ -7,8 +7,13 @@
 */
 
 #include <limits.h>
+#include <stdint.h>
 #include "parser.h"
+#include "geobucket.h"
 #include "memory_helper.h"
+#include "parallel.h"
+#include "reclaimer.h"
+#include "work_stack.h"
 
 ///@{
  /**
@@ -32,39 +37,18 @@
 #define BIG_Z 'Z'
 #define WHITE_SPACE_START 9
 #define WHITE_SPACE_END 13
-///@}
-
- ///@{
-/** Komenda dostępna w kalkulatorze wielomianów. */
-#define ZERO "ZERO"
-#define IS_COEFF "IS_COEFF"
-#define IS_ZERO "IS_ZERO"
-#define CLONE "CLONE"
-#define ADD "ADD"
-#define MUL "MUL"
-#define SUB "SUB"
-#define NEG "NEG"
-#define IS_EQ "IS_EQ"
-#define DEG "DEG"
-#define DEG_BY "DEG_BY"
-#define AT "AT"
-#define PRINT "PRINT"
-#define POP "POP"
-#define COMPOSE "COMPOSE"
 ///@}
 
 /** Maksymalna wartość dla typu unsigned long long zapisana jako string. */
 const char *ullong_max_string = "18446744073709551615";
 
 String CreateString() {
-    char *arr = (char*) calloc(INIT_SIZE, sizeof(char));
-    CheckPtr(arr);
+    char *arr = (char*) MemoryCalloc(INIT_SIZE, sizeof(char), MEMORY_PARSER);
     return (String) {.arr = arr, .allocated_size = INIT_SIZE, .size = 0};
 }
 
 MonosArr CreateMonosArr() {
-    Mono *arr = (Mono*) calloc(INIT_SIZE, sizeof(Mono));
-    CheckPtr(arr);
+    Mono *arr = (Mono*) MemoryCalloc(INIT_SIZE, sizeof(Mono), MEMORY_PARSER);
     return (MonosArr) {.arr = arr, .allocated_size = INIT_SIZE, .size = 0};
 }
 
@@ -79,41 +63,44 @@ static void ResetParseProtector(ParserProtector *protector) {
 }
 
 void DestroyString(String *s) {
-    free(s->arr);
+    MemoryFree(s->arr, s->allocated_size * sizeof(char), MEMORY_PARSER);
     s->arr = NULL;
 }
 
 void DestroyMonosArr(MonosArr *monos) {
-    free(monos->arr);
+    MemoryFree(monos->arr, monos->allocated_size * sizeof(Mono), MEMORY_PARSER);
     monos->arr = NULL;
 }
 
 void CheckStringSpace(String *str) {
     if (str->size == str->allocated_size) {
+        size_t old_size = str->allocated_size;
         str->allocated_size = IncreaseSpace(str->allocated_size);
-        str->arr = (char*) realloc(str->arr, str->allocated_size * sizeof(char));
-        CheckPtr(str->arr);
+        str->arr = (char*) MemoryRealloc(str->arr, old_size * sizeof(char),
+                                         str->allocated_size * sizeof(char), MEMORY_PARSER);
     }
 }
 
 void CheckMonosArrSpace(MonosArr *monos) {
     if (monos->size == monos->allocated_size) {
+        size_t old_size = monos->allocated_size;
         monos->allocated_size = IncreaseSpace(monos->allocated_size);
-        monos->arr = (Mono*) realloc(monos->arr, monos->allocated_size * sizeof(Mono));
-        CheckPtr(monos->arr);
+        monos->arr = (Mono*) MemoryRealloc(monos->arr, old_size * sizeof(Mono),
+                                           monos->allocated_size * sizeof(Mono), MEMORY_PARSER);
     }
 }
 
 /**
  * Sprawdza czy kolejna liczba do wczytania jest ujemna.
+ * @param[in,out] reader : źródło znaków
  * @return Czy kolejnym znak do wczytania jest ujemny?
  */
-static bool CheckIfNumberIsNegative() {
-    int sign = getchar();
+static bool CheckIfNumberIsNegative(Reader *reader) {
+    int sign = ReaderGet(reader);
     if (sign == MINUS)
         return true;
     else {
-        ungetc(sign, stdin);
+        ReaderUnget(reader, sign);
         return false;
     }
 }
@@ -161,17 +148,17 @@ static void CheckIfLlongMax(String *s, ull number, bool *error) {
 
 }
 
-Number ParseNumber(bool *error) {
+Number ParseNumber(Reader *reader, bool *error) {
     String str = CreateString();
-    bool minus = CheckIfNumberIsNegative();
+    bool minus = CheckIfNumberIsNegative(reader);
 
     int digit;
-    while ((digit = getchar()) >= MIN_DIGIT && digit <= MAX_DIGIT) {
+    while ((digit = ReaderGet(reader)) >= MIN_DIGIT && digit <= MAX_DIGIT) {
         CheckStringSpace(&str);
         str.arr[str.size++] = (char) digit;
     }
 
-    ungetc(digit, stdin); // zwracamy na standardowe wejście ostatni wczytany znak
+    ReaderUnget(reader, digit); // zwracamy do źródła ostatni wczytany znak
 
     if (str.size == 0) {
         *error = true;
@@ -195,11 +182,12 @@ Number ParseNumber(bool *error) {
 /**
  * Parsuje współczynnik jednomianu lub wartość argumentu funkcji AT.
  * W przypadku wystąpienia błędu zwraca domyślnie 0.
+ * @param[in,out] reader : źródło znaków
  * @param[in,out] error : informacja o błędzie
  * @return wartość współczynnika lub argumentu funkcji AT lub 0 w przypadku błędu
  */
-poly_coeff_t ParseCoeff(bool *error) {
-    Number num = ParseNumber(error);
+poly_coeff_t ParseCoeff(Reader *reader, bool *error) {
+    Number num = ParseNumber(reader, error);
     if (!CheckCoeffCorrect(&num))
         *error = true;
     // w przypadku błędu zwracamy 0, aczkolwiek nie ma to żadnego znaczenia co byśmy zwrócili
@@ -210,11 +198,12 @@ poly_coeff_t ParseCoeff(bool *error) {
 
 /**
  * Parsuje wykładnik jednomianu.
+ * @param[in,out] reader : źródło znaków
  * @param[in,out] error : informacja o błędzie
  * @return wartość wykładnika jednomianu lub 0 w przypadku błędu
  */
-poly_exp_t ParseExp(bool *error) {
-    Number num = ParseNumber(error);
+poly_exp_t ParseExp(Reader *reader, bool *error) {
+    Number num = ParseNumber(reader, error);
     if (!CheckExpCorrect(&num))
         *error = true;
     return (*error) ? 0 : (int) ((num.minus) ? (-1) * num.value : num.value);
@@ -222,11 +211,12 @@ poly_exp_t ParseExp(bool *error) {
 
 /**
  * Parsuje argument polecenia DEG_BY/COMPOSE.
+ * @param[in,out] reader : źródło znaków
  * @param[in,out] error : informacja o błędzie
  * @return wartość argumentu polecenia DEG_BY/COMPOSE lub 0 w przypadku błędu
  */
-ull ParseArgDegByCompose(bool *error) {
-    Number num = ParseNumber(error);
+ull ParseArgDegByCompose(Reader *reader, bool *error) {
+    Number num = ParseNumber(reader, error);
     if (!CheckArgDegByCompose(&num))
         *error = true;
     return (*error) ? 0 : num.value;
@@ -251,14 +241,12 @@ static inline bool StopParsing(ParserProtector *protector) {
 }
 
 /**
- * Wczytuje znak ze standardowego wejścia zapisuje go i następnie oddaje ten
- * ponownie na standardowe wejście.
+ * Podgląda kolejny znak ze źródła, nie wczytując go.
+ * @param[in,out] reader : źródło znaków
  * @return kolejny do wczytania znak
  */
-static int NextChar() {
-    int next = getchar();
-    ungetc(next, stdin);
-    return next;
+static inline int NextChar(Reader *reader) {
+    return ReaderPeek(reader);
 }
 
 /**
@@ -268,13 +256,13 @@ static int NextChar() {
  */
 static void CheckIfEnd(ParserProtector *protector) {
     if (!LineIsOver(protector)) {
-        int next = getchar();
+        int next = ReaderGet(protector->reader);
         if (next == EOL)
             protector->end_of_line = true;
         else if (next == EOF)
             protector->end_of_file = true;
         else
-            ungetc(next, stdin);
+            ReaderUnget(protector->reader, next);
     }
 }
 
@@ -287,7 +275,7 @@ static void CheckIfEnd(ParserProtector *protector) {
 static void CheckNextChar(int value, ParserProtector *protector) {
     CheckIfEnd(protector);
     if (!StopParsing(protector)) {
-        int next = getchar();
+        int next = ReaderGet(protector->reader);
         if (next != value)
             protector->error = true;
     }
@@ -300,7 +288,7 @@ static void CheckNextChar(int value, ParserProtector *protector) {
 static void SkipLine(ParserProtector *protector) {
     int c;
     do {
-        c = getchar();
+        c = ReaderGet(protector->reader);
     } while (c != EOF && c != EOL);
     protector->end_of_file = (c == EOF) ? true : false;
     protector->end_of_line = (c == EOL) ? true : false;
@@ -308,28 +296,31 @@ static void SkipLine(ParserProtector *protector) {
 
 /**
  * Sprawdza czy kolejny wielomian do wczytania jest współczynnikiem.
+ * @param[in,out] reader : źródło znaków
  * @return Czy kolejny wielomian do wczytania jest współczynnikiem?
  */
-static bool NextPolyIsCoeff() {
-    int next = NextChar();
+static bool NextPolyIsCoeff(Reader *reader) {
+    int next = NextChar(reader);
     return next == MINUS || (MIN_DIGIT <= next && next <= MAX_DIGIT);
 }
 
 /**
  * Sprawdza czy wiersz jest komentarzem lub wierszem pustym.
+ * @param[in,out] reader : źródło znaków
  * @return Czy wiersz jest komentarzem lub wierszem pustym?
  */
-static bool CommentOrEmptyLine() {
-    int next = NextChar();
+static bool CommentOrEmptyLine(Reader *reader) {
+    int next = NextChar(reader);
     return next == EOL || next == HASH;
 }
 
 /**
  * Sprawdza czy wiersz jest poleceniem.
+ * @param[in,out] reader : źródło znaków
  * @return Czy następny wczytywany znak jest literą?
  */
-static bool CommandInLine() {
-    int next = NextChar();
+static bool CommandInLine(Reader *reader) {
+    int next = NextChar(reader);
     return (SMALL_A <= next && next <= SMALL_Z) || (BIG_A <= next && next <= BIG_Z);
 }
 
@@ -347,142 +338,376 @@ static bool IsLetter(int sign) {
  * Sprawdza czy doszliśmy do końca wielomianu. Jeżeli kolejny znak jest plusem to go pobiera, jeżeli
  * jest przecinkiem to znaczy, że doszliśmy do końca wielomianu, natomiast jeżeli jest to inny znak to
  * otrzymujemy błąd.
+ * @param[in,out] reader : źródło znaków
  * @param[in,out] error : informacja o błędzie
  * @param[in,out] end_of_poly : informacja o tym, czy doszliśmy do końca wielomianu
  */
-static void CheckIfEndOfPoly(bool *error, bool *end_of_poly) {
-    int next = NextChar();
+static void CheckIfEndOfPoly(Reader *reader, bool *error, bool *end_of_poly) {
+    int next = NextChar(reader);
     if (next == PLUS)
-        getchar();
+        ReaderGet(reader);
     else if (next == COMMA)
         *end_of_poly = true;
     else
         *error = true;
 }
 
-Mono ParseMono(ParserProtector *protector) {
-    CheckNextChar(LEFT_BRACKET, protector);
+/**
+ * Kończy parsowanie jednomianu, którego współczynnik został już wczytany:
+ * wczytuje przecinek, wykładnik i nawias zamykający.
+ * @param[in,out] protector : informacje o stanie wczytywanego wiersza
+ * @param[out] exp : wczytany wykładnik
+ * @return Czy koniec jednomianu jest poprawny?
+ */
+static bool ParseMonoExp(ParserProtector *protector, poly_exp_t *exp) {
+    CheckNextChar(COMMA, protector);
 
     if (StopParsing(protector)) {
         protector->error = true;
-        return (Mono) {.p = PolyZero(), .exp = 1};
+        return false;
     }
 
-    Poly p = ParsePoly(protector);
+    *exp = ParseExp(protector->reader, &protector->error);
 
-    CheckNextChar(COMMA, protector);
+    CheckNextChar(RIGHT_BRACKET, protector);
 
     if (StopParsing(protector)) {
-        PolyDestroy(&p);
         protector->error = true;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Kończy parsowanie jednomianu, którego współczynnik @p p został już wczytany:
+ * wczytuje przecinek, wykładnik i nawias zamykający. Przejmuje na własność
+ * wielomian @p p. W przypadku błędu usuwa go i zwraca jednomian zerowy.
+ * @param[in,out] protector : informacje o stanie wczytywanego wiersza
+ * @param[in] p : współczynnik jednomianu
+ * @return wczytany jednomian
+ */
+static Mono ParseMonoEnd(ParserProtector *protector, Poly *p) {
+    poly_exp_t exp;
+    if (!ParseMonoExp(protector, &exp)) {
+        PolyDestroy(p);
         return (Mono) {.p = PolyZero(), .exp = 1};
     }
 
-    poly_exp_t exp = ParseExp(&protector->error);
+    return MonoFromPoly(p, exp);
+}
 
-    CheckNextChar(RIGHT_BRACKET, protector);
+Mono ParseMono(ParserProtector *protector) {
+    CheckNextChar(LEFT_BRACKET, protector);
 
     if (StopParsing(protector)) {
-        PolyDestroy(&p);
         protector->error = true;
         return (Mono) {.p = PolyZero(), .exp = 1};
     }
 
-    return MonoFromPoly(&p, exp);
+    Poly p = ParsePoly(protector);
+    return ParseMonoEnd(protector, &p);
+}
+
+/** Ramka stosu roboczego parsera, odpowiada jednemu wczytywanemu wielomianowi. */
+typedef struct ParseFrame {
+    MonosArr monos; ///< wczytane dotąd jednomiany wielomianu
+    bool end_of_poly; ///< czy doszliśmy do przecinka kończącego wielomian
+} ParseFrame;
+
+/**
+ * Dodaje wczytany jednomian do wielomianu z ramki @p frame i sprawdza,
+ * czy po nim następuje kolejny jednomian.
+ * @param[in,out] protector : informacje o stanie wczytywanego wiersza
+ * @param[in,out] frame : ramka wczytywanego wielomianu
+ * @param[in] m : jednomian
+ */
+static void ParseFrameAddMono(ParserProtector *protector, ParseFrame *frame, Mono m) {
+    if (!PolyIsZero(&m.p)) {
+        frame->monos.arr[frame->monos.size++] = m;
+    }
+
+    CheckIfEnd(protector);
+
+    // jeżeli nie mamy powodu żeby zakończyć parsowanie
+    // to kolejny znak musi być plusem lub przecinkiem
+    // jeżeli jest plusem to kontunuujemy parsowanie
+    // jeżeli jest przecinkiem to kończymy
+    if (!StopParsing(protector))
+        CheckIfEndOfPoly(protector->reader, &protector->error, &frame->end_of_poly);
+}
+
+/**
+ * Tworzy wielomian z jednomianów wczytanych w ramce @p frame.
+ * @param[in,out] frame : ramka wczytywanego wielomianu
+ * @return wielomian będący sumą wczytanych jednomianów
+ */
+static Poly ParseFrameFinish(ParseFrame *frame) {
+    if (frame->monos.size == 0) {
+        DestroyMonosArr(&frame->monos);
+        return PolyZero();
+    }
+
+    // tablica jednomianów przechodzi na własność wielomianu
+    MemoryTrackFree(frame->monos.allocated_size * sizeof(Mono), MEMORY_PARSER);
+    return PolyOwnMonos(frame->monos.size, frame->monos.arr);
+}
+
+/**
+ * Rozpoczyna wczytywanie wielomianu, który nie jest współczynnikiem,
+ * odkładając jego ramkę na stos roboczy.
+ * @param[in,out] protector : informacje o stanie wczytywanego wiersza
+ * @param[in,out] ws : stos roboczy parsera
+ */
+static void ParseFramePush(ParserProtector *protector, WorkStack *ws) {
+    CheckIfEnd(protector);
+    *(ParseFrame*) WorkStackPush(ws) = (ParseFrame) {.monos = CreateMonosArr(), .end_of_poly = false};
 }
 
 Poly ParsePoly(ParserProtector *protector) {
-    if (NextPolyIsCoeff()) {
-        poly_coeff_t coeff = ParseCoeff(&protector->error);
+    if (NextPolyIsCoeff(protector->reader)) {
+        poly_coeff_t coeff = ParseCoeff(protector->reader, &protector->error);
         return PolyFromCoeff(coeff);
     }
 
-    CheckIfEnd(protector);
-    MonosArr monos = CreateMonosArr();
+    // zamiast rekurencji dla każdego poziomu zagnieżdżenia odkładamy ramkę na stos roboczy,
+    // więc głębokość wielomianu jest ograniczona tylko ilością pamięci
+    ParseFrame local[WORK_STACK_LOCAL_SIZE];
+    WorkStack ws = InitWorkStack(local, WORK_STACK_LOCAL_SIZE, sizeof(ParseFrame));
+    ParseFramePush(protector, &ws);
+    Poly result = PolyZero();
+
+    while (!WorkStackIsEmpty(&ws)) {
+        ParseFrame *frame = (ParseFrame*) WorkStackTop(&ws);
+
+        if (StopParsing(protector) || frame->end_of_poly) {
+            // wielomian z ramki jest wczytany, wracamy do jednomianu, w którym jest współczynnikiem
+            Poly p = ParseFrameFinish(frame);
+            WorkStackPop(&ws);
+            if (WorkStackIsEmpty(&ws)) {
+                result = p;
+            }
+            else {
+                Mono m = ParseMonoEnd(protector, &p);
+                ParseFrameAddMono(protector, (ParseFrame*) WorkStackTop(&ws), m);
+            }
+            continue;
+        }
 
-    // ta zmienna kontroluje, czy nie doszliśmy do końca wielomianu, wtedy gdy ten koniec jest przecinkiem
-    // oddzielającym wielomian od wykładnika w jednomianie
-    bool end_of_poly = false;
+        // wczytujemy kolejny jednomian
+        CheckMonosArrSpace(&frame->monos);
+        CheckNextChar(LEFT_BRACKET, protector);
 
-    while (!StopParsing(protector) && !end_of_poly) {
-        CheckMonosArrSpace(&monos);
-        Mono m = ParseMono(protector);
-        if (!PolyIsZero(&m.p)) {
-            monos.arr[monos.size++] = m;
+        if (StopParsing(protector)) {
+            protector->error = true;
+            ParseFrameAddMono(protector, frame, (Mono) {.p = PolyZero(), .exp = 1});
+        }
+        else if (NextPolyIsCoeff(protector->reader)) {
+            Poly p = PolyFromCoeff(ParseCoeff(protector->reader, &protector->error));
+            Mono m = ParseMonoEnd(protector, &p);
+            ParseFrameAddMono(protector, frame, m);
+        }
+        else {
+            ParseFramePush(protector, &ws);
         }
+    }
 
-        CheckIfEnd(protector);
+    WorkStackClear(&ws);
+    return result;
+}
 
-        // jeżeli nie mamy powodu żeby zakończyć parsowanie
-        // to kolejny znak musi być plusem lub przecinkiem
-        // jeżeli jest plusem to kontunuujemy parsowanie
-        // jeżeli jest przecinkiem to kończymy
-        if (!StopParsing(protector))
-            CheckIfEndOfPoly(&protector->error, &end_of_poly);
+/**
+ * Ramka stosu roboczego parsera obliczającego wartość, odpowiada jednemu
+ * wczytywanemu wielomianowi zmiennej, pod którą jest podstawiana wartość.
+ */
+typedef struct EvalFrame {
+    size_t var; ///< indeks zmiennej wielomianu
+    uint64_t value; ///< wartość zmiennej
+    uint64_t power; ///< wartość zmiennej podniesiona do wykładnika exp
+    poly_exp_t exp; ///< wykładnik ostatniego jednomianu
+    uint64_t sum; ///< suma jednomianów o stałych współczynnikach
+    Geobucket *rest; ///< suma pozostałych jednomianów lub NULL, jeżeli nie było takich jednomianów
+    bool end_of_poly; ///< czy doszliśmy do przecinka kończącego wielomian
+} EvalFrame;
+
+/**
+ * Rozpoczyna wczytywanie wielomianu zmiennej @f$x_{var}@f$, pod którą jest
+ * podstawiana wartość, odkładając jego ramkę na stos roboczy.
+ * @param[in,out] protector : informacje o stanie wczytywanego wiersza
+ * @param[in,out] ws : stos roboczy parsera
+ * @param[in] var : indeks zmiennej
+ * @param[in] value : wartość zmiennej
+ */
+static void EvalFramePush(ParserProtector *protector, WorkStack *ws, size_t var, poly_coeff_t value) {
+    CheckIfEnd(protector);
+    *(EvalFrame*) WorkStackPush(ws) = (EvalFrame) {.var = var, .value = (uint64_t) value, .power = 1, .exp = 0,
+                                                   .sum = 0, .rest = NULL, .end_of_poly = false};
+}
+
+/**
+ * Kończy wczytywanie jednomianu o współczynniku @p c i dodaje jego wartość do
+ * sumy w ramce @p frame. Potęga zmiennej jest liczona z potęgi dla poprzedniego
+ * jednomianu, jeżeli wykładnik nie zmalał. Przejmuje na własność wielomian @p c.
+ * @param[in,out] protector : informacje o stanie wczytywanego wiersza
+ * @param[in,out] frame : ramka wczytywanego wielomianu
+ * @param[in] c : współczynnik jednomianu
+ */
+static void EvalFrameAddMono(ParserProtector *protector, EvalFrame *frame, Poly *c) {
+    poly_exp_t exp;
+    if (ParseMonoExp(protector, &exp)) {
+        if (exp >= frame->exp)
+            frame->power *= PolyCoeffPow(frame->value, exp - frame->exp);
+        else
+            frame->power = PolyCoeffPow(frame->value, exp);
+        frame->exp = exp;
+
+        if (PolyIsCoeff(c)) {
+            frame->sum += frame->power * (uint64_t) c->coeff;
+        }
+        else {
+            Poly power = PolyFromCoeff((poly_coeff_t) frame->power);
+            Poly scaled = PolyMul(c, &power);
+            if (frame->rest == NULL) {
+                frame->rest = (Geobucket*) MemoryAlloc(sizeof(Geobucket), MEMORY_PARSER);
+                *frame->rest = InitGeobucket();
+            }
+            GeobucketAdd(frame->rest, &scaled);
+        }
     }
+    PolyDestroy(c);
 
-    Poly p = PolyOwnMonos(monos.size, monos.arr);
-    if (monos.size == 0)
-        DestroyMonosArr(&monos);
-    return p;
+    CheckIfEnd(protector);
+    if (!StopParsing(protector))
+        CheckIfEndOfPoly(protector->reader, &protector->error, &frame->end_of_poly);
 }
 
 /**
- * Sprawdza czy napis @p command jest równy tablicy znaków @p arr.
- * @param[in] command : napis
- * @param[in] arr : tablica znaków
- * @return Czy oba parametry przechowują ten sam napis?
+ * Daje wartość wielomianu wczytanego w ramce @p frame i zwalnia jej pamięć.
+ * @param[in,out] frame : ramka wczytywanego wielomianu
+ * @return wielomian od pozostałych zmiennych
  */
-static inline bool CommandsEqual(String *command, char *arr) {
-    return strcmp(command->arr, arr) == 0;
+static Poly EvalFrameFinish(EvalFrame *frame) {
+    if (frame->rest == NULL)
+        return PolyFromCoeff((poly_coeff_t) frame->sum);
+
+    Poly sum = PolyFromCoeff((poly_coeff_t) frame->sum);
+    GeobucketAdd(frame->rest, &sum);
+    Poly result = GeobucketSum(frame->rest);
+    MemoryFree(frame->rest, sizeof(Geobucket), MEMORY_PARSER);
+    return result;
 }
 
-void ParseCommand(String *command) {
-    int next = getchar();
+Poly ParsePolyAt(ParserProtector *protector, size_t count, const poly_coeff_t values[]) {
+    if (count == 0 || NextPolyIsCoeff(protector->reader))
+        return ParsePoly(protector);
+
+    // ramki są tylko dla zmiennych, pod które podstawiamy wartości, więc pamięć
+    // zależy od głębokości wielomianu, a nie od liczby jego jednomianów
+    EvalFrame local[WORK_STACK_LOCAL_SIZE];
+    WorkStack ws = InitWorkStack(local, WORK_STACK_LOCAL_SIZE, sizeof(EvalFrame));
+    EvalFramePush(protector, &ws, 0, values[0]);
+    Poly result = PolyZero();
+
+    while (!WorkStackIsEmpty(&ws)) {
+        EvalFrame *frame = (EvalFrame*) WorkStackTop(&ws);
+
+        if (StopParsing(protector) || frame->end_of_poly) {
+            Poly p = EvalFrameFinish(frame);
+            WorkStackPop(&ws);
+            if (WorkStackIsEmpty(&ws))
+                result = p;
+            else
+                EvalFrameAddMono(protector, (EvalFrame*) WorkStackTop(&ws), &p);
+            continue;
+        }
+
+        // wczytujemy kolejny jednomian
+        CheckNextChar(LEFT_BRACKET, protector);
+
+        if (StopParsing(protector)) {
+            protector->error = true;
+        }
+        else if (NextPolyIsCoeff(protector->reader)) {
+            Poly c = PolyFromCoeff(ParseCoeff(protector->reader, &protector->error));
+            EvalFrameAddMono(protector, frame, &c);
+        }
+        else if (frame->var + 1 < count) {
+            EvalFramePush(protector, &ws, frame->var + 1, values[frame->var + 1]);
+        }
+        else {
+            // współczynnik jest wielomianem pozostałych zmiennych, już o nowych indeksach
+            Poly c = ParsePoly(protector);
+            EvalFrameAddMono(protector, frame, &c);
+        }
+    }
+
+    WorkStackClear(&ws);
+    return result;
+}
+
+void ParseCommand(Reader *reader, String *command) {
+    int next = ReaderGet(reader);
     while ((IsLetter(next) || next == UNDERSCORE) && command->size < 10) {
         CheckStringSpace(command);
         command->arr[command->size++] = (char) next;
-        next = getchar();
+        next = ReaderGet(reader);
     }
-    ungetc(next, stdin);
+    ReaderUnget(reader, next);
     if (command->size > 0) {
         CheckStringSpace(command);
         command->arr[command->size++] = '\0';
     }
 }
 
+/**
+ * Daje funkcję wypisującą błąd argumentu polecenia rodzaju @p type.
+ * @param[in] type : polecenie DEG_BY, AT, COMPOSE, ADD_N, MUL_N, AT_VARS lub AT_NEXT
+ * @return funkcja wypisująca błąd argumentu
+ */
+static ErrorPrinter ArgumentError(CommandType type) {
+    if (type == COMMAND_DEG_BY)
+        return ErrorDegBy;
+    else if (type == COMMAND_AT)
+        return ErrorAt;
+    else if (type == COMMAND_COMPOSE)
+        return ErrorCompose;
+    else if (type == COMMAND_ADD_N)
+        return ErrorAddN;
+    else if (type == COMMAND_MUL_N)
+        return ErrorMulN;
+    else if (type == COMMAND_AT_VARS)
+        return ErrorAtVars;
+    else
+        return ErrorAtNext;
+}
+
 /**
  * Pierwsza z dwóch pomocniczych funkcji do sprawdzania poprawności argumentu.
- * Sprawdza podstawowe warunki na to, aby argument poleceń DEG_BY, AT, COMPOSE był poprawny.
+ * Sprawdza podstawowe warunki na to, aby argument poleceń DEG_BY, AT, COMPOSE, ADD_N, MUL_N, AT_VARS, AT_NEXT był poprawny.
+ * W przypadku błędu zapisuje w @p cmd funkcję, która go wypisze.
  * @param[in][out] protector : informacje o stanie wczytywanego wiersza
- * @param[in] row : numer aktualnie wczytywanego wiersza
- * @param[in] command : pomocnicze oznaczenie polecenia, 0 oznacza DEG_BY, 1 - AT, 2 - COMPOSE
+ * @param[in,out] cmd : wczytywane polecenie
  * @return Czy argument jest niepoprawny?
  */
-bool IncorrectArgument1(ParserProtector *protector, size_t row, int command) {
-    int next = NextChar();
+bool IncorrectArgument1(ParserProtector *protector, Command *cmd) {
+    int next = NextChar(protector->reader);
     // jeżeli po poleceniu mamy biały znak inny niż
     // spacja to traktujemy to jako błąd argumentu, natomiast jeżeli mamy jakiś inny znak
     // to wówczas jest to błąd polecenia
-    // dla komend AT i COMPOSE postępujemy tak samo
+    // dla pozostałych komend z argumentem postępujemy tak samo
     if (LineIsOver(protector) || (WHITE_SPACE_START <= next && next <= WHITE_SPACE_END)) {
         protector->error = true;
-        if (command == 0)
-            ErrorDegBy(row);
-        else if (command == 1)
-            ErrorAt(row);
-        else
-            ErrorCompose(row);
+        cmd->error = ArgumentError(cmd->type);
         return true;
     }
 
     if (next != SPACE) {
         protector->error = true;
-        ErrorWrongCommand(row);
+        cmd->error = ErrorWrongCommand;
         return true;
     }
     else {
-        getchar();
+        ReaderGet(protector->reader);
     }
 
     return false;
@@ -490,140 +715,495 @@ bool IncorrectArgument1(ParserProtector *protector, size_t row, int command) {
 
 /**
  * Druga z pomocniczych funkcji do sprawdzania poprawności argumentu.
- * Sprawdza podstawowe warunki na to, aby argument poleceń DEG_BY, AT, COMPOSE był poprawny.
+ * Sprawdza podstawowe warunki na to, aby argument poleceń DEG_BY, AT, COMPOSE, ADD_N, MUL_N, AT_VARS, AT_NEXT był poprawny.
+ * W przypadku błędu zapisuje w @p cmd funkcję, która go wypisze.
  * @param[in][out] protector : informacje o stanie wczytywanego wiersza
- * @param[in] row : numer aktualnie wczytywanego wiersza
- * @param[in] command : pomocnicze oznaczenie polecenia, 0 oznacza DEG_BY, 1 - AT, 2 - COMPOSE
+ * @param[in,out] cmd : wczytywane polecenie
  * @return Czy argument jest niepoprawny?
  */
-bool IncorrectArgument2(ParserProtector *protector, size_t row, int command) {
+bool IncorrectArgument2(ParserProtector *protector, Command *cmd) {
     CheckIfEnd(protector);
 
     if (!LineIsOver(protector) || protector->error) {
-        if (command == 0)
-            ErrorDegBy(row);
-        else if (command == 1)
-            ErrorAt(row);
-        else
-            ErrorCompose(row);
+        cmd->error = ArgumentError(cmd->type);
         return true;
     }
 
     return false;
 }
 
-void ExecuteCommand(Stack *s, String *command, ParserProtector *protector, size_t row) {
+/**
+ * Wczytuje argument polecenia rodzaju zapisanego w @p cmd i sprawdza,
+ * czy wiersz nie zawiera nic więcej.
+ * @param[in,out] protector : informacje o stanie wczytywanego wiersza
+ * @param[in,out] cmd : wczytywane polecenie
+ */
+static void ParseArguments(ParserProtector *protector, Command *cmd) {
     CheckIfEnd(protector);
 
-    if (CommandsEqual(command, DEG_BY)) {
-        if (IncorrectArgument1(protector, row, 0))
+    if (cmd->type == COMMAND_AT || cmd->type == COMMAND_AT_NEXT) {
+        if (IncorrectArgument1(protector, cmd))
+            return;
+
+        cmd->x = ParseCoeff(protector->reader, &protector->error);
+        IncorrectArgument2(protector, cmd);
+    }
+    else if (cmd->type == COMMAND_DEG_BY || cmd->type == COMMAND_COMPOSE ||
+             cmd->type == COMMAND_ADD_N || cmd->type == COMMAND_MUL_N || cmd->type == COMMAND_AT_VARS) {
+        if (IncorrectArgument1(protector, cmd))
             return;
 
-        ull arg = ParseArgDegByCompose(&protector->error);
+        cmd->arg = ParseArgDegByCompose(protector->reader, &protector->error);
 
-        if (IncorrectArgument2(protector, row, 0))
+        if (IncorrectArgument2(protector, cmd))
             return;
 
-        DegBy(s, row, arg);
+        // złożenie z ULLONG_MAX wielomianami wymagałoby ULLONG_MAX + 1 wielomianów na stosie
+        if (cmd->type == COMMAND_COMPOSE && cmd->arg == ULLONG_MAX)
+            cmd->error = ErrorStackUnderflow;
     }
-    else if (CommandsEqual(command, AT)) {
-        if (IncorrectArgument1(protector, row, 1))
-            return;
+    else if (cmd->type == COMMAND_WRONG || !LineIsOver(protector)) {
+        protector->error = true;
+        cmd->error = ErrorWrongCommand;
+    }
+}
+
+/**
+ * Sprawdza, czy bieżący wiersz kończy się w danych wczytanych już do bufora
+ * źródła. Tylko taki wiersz jest wczytywany bezpośrednio ze źródła.
+ * @param[in] reader : źródło znaków
+ * @return Czy bufor zawiera znak końca wiersza?
+ */
+static bool LineIsBuffered(Reader *reader) {
+    return memchr(reader->buffer + reader->pos, EOL, reader->len - reader->pos) != NULL;
+}
 
-        poly_coeff_t x = ParseCoeff(&protector->error);
+/**
+ * Przepisuje do napisu @p line pozostałą część wiersza, wczytując znak
+ * końca wiersza, ale nie zapisując go w napisie.
+ * @param[in,out] protector : informacje o stanie wczytywanego wiersza
+ * @param[in,out] line : napis, do którego dopisywany jest wiersz
+ */
+static void ReadLine(ParserProtector *protector, String *line) {
+    Reader *reader = protector->reader;
+    while (ReaderPeek(reader) != EOF) {
+        size_t avail = reader->len - reader->pos;
+        const char *start = reader->buffer + reader->pos;
+        const char *eol = memchr(start, EOL, avail);
+        size_t count = (eol != NULL) ? (size_t) (eol - start) : avail;
+
+        while (line->allocated_size - line->size < count) {
+            size_t old_size = line->allocated_size;
+            line->allocated_size = IncreaseSpace(line->allocated_size);
+            line->arr = (char*) MemoryRealloc(line->arr, old_size * sizeof(char),
+                                              line->allocated_size * sizeof(char), MEMORY_PARSER);
+        }
+        memcpy(line->arr + line->size, start, count);
+        line->size += count;
+        reader->pos += count;
 
-        if (IncorrectArgument2(protector, row, 1))
+        if (eol != NULL) {
+            ReaderGet(reader);
+            protector->end_of_line = true;
             return;
+        }
+    }
+    protector->end_of_file = true;
+}
 
-        At(s, row, x);
+/**
+ * Wczytuje wielomian zajmujący cały napis @p text (bez znaku końca wiersza),
+ * sprawdzając jego poprawność tak jak wiersz z wielomianem, i podstawia
+ * @p count wartości pod pierwsze zmienne (patrz ParsePolyAt). Znaki są czytane
+ * bezpośrednio z napisu, bez kopiowania.
+ * @param[in] text : znaki wielomianu
+ * @param[in] len : liczba znaków
+ * @param[in] count : liczba wartości
+ * @param[in] values : wartości zmiennych
+ * @param[out] error : informacja o błędzie, ustawiana tylko w razie błędu
+ * @return wczytany wielomian lub wielomian zerowy w przypadku błędu
+ */
+static Poly ParsePolyTextAt(const char *text, size_t len, size_t count, const poly_coeff_t values[],
+                            bool *error) {
+    Reader reader = CreateMemoryReader(text, len);
+    ParserProtector protector = {.reader = &reader};
+    ResetParseProtector(&protector);
+
+    Poly p = ParsePolyAt(&protector, count, values);
+    CheckIfEnd(&protector);
+    // napis nie może zawierać znaku końca wiersza, więc musi skończyć się razem z wielomianem
+    if (protector.error || !protector.end_of_file) {
+        // wartość wczytana przed błędem może być stałą, której PolyDestroy nie zeruje
+        PolyDestroy(&p);
+        p = PolyZero();
+        *error = true;
     }
-    else if (CommandsEqual(command, COMPOSE)) {
-        if (IncorrectArgument1(protector, row, 2))
-            return;
+    return p;
+}
+
+/**
+ * Wczytuje wielomian zajmujący cały napis @p text (bez znaku końca wiersza),
+ * sprawdzając jego poprawność tak jak wiersz z wielomianem.
+ * @param[in] text : znaki wielomianu
+ * @param[in] len : liczba znaków
+ * @param[out] error : informacja o błędzie, ustawiana tylko w razie błędu
+ * @return wczytany wielomian lub wielomian zerowy w przypadku błędu
+ */
+static Poly ParsePolyText(const char *text, size_t len, bool *error) {
+    return ParsePolyTextAt(text, len, 0, NULL, error);
+}
 
-        ull arg = ParseArgDegByCompose(&protector->error);
+/** Oznaczenie fragmentu wiersza, w którym nie ma miejsca podziału. */
+#define PARSE_NO_CUT SIZE_MAX
 
-        if (IncorrectArgument2(protector, row, 2))
-            return;
+/**
+ * Zadanie równoległego wczytywania długiego wiersza. Wiersz jest dzielony na
+ * fragmenty o równej długości, które są przeglądane dwa razy: najpierw każdy
+ * fragment liczy zmianę głębokości nawiasów, a potem, znając głębokość na
+ * swoim początku, szuka pierwszego plusa leżącego poza nawiasami. Wiersz jest
+ * następnie cięty w znalezionych plusach i każdy kawałek jest wczytywany jako
+ * osobny wielomian.
+ */
+typedef struct ParseLineTask {
+    const char *text; ///< znaki wiersza
+    size_t len; ///< liczba znaków wiersza
+    size_t parts; ///< liczba fragmentów
+    long *depth; ///< zmiana głębokości w fragmentach, a potem głębokość na ich początku
+    size_t *cuts; ///< pozycja plusa rozpoczynającego kawałek lub PARSE_NO_CUT
+    Poly *polys; ///< wczytane kawałki
+    bool *errors; ///< czy kawałek jest niepoprawny
+} ParseLineTask;
 
-        if (arg == ULLONG_MAX)
-            ErrorStackUnderflow(row);
-        else
-            Compose(s, row, arg);
-    }
-    else if (LineIsOver(protector)) {
-        if (CommandsEqual(command, ZERO))
-            Zero(s);
-        else if (CommandsEqual(command, IS_COEFF))
-            IsCoeff(s, row);
-        else if (CommandsEqual(command, IS_ZERO))
-            IsZero(s, row);
-        else if (CommandsEqual(command, CLONE))
-            Clone(s, row);
-        else if (CommandsEqual(command, ADD))
-            Add(s, row);
-        else if (CommandsEqual(command, MUL))
-            Mul(s, row);
-        else if (CommandsEqual(command, SUB))
-            Sub(s, row);
-        else if (CommandsEqual(command, NEG))
-            Neg(s, row);
-        else if (CommandsEqual(command, IS_EQ))
-            IsEq(s, row);
-        else if (CommandsEqual(command, DEG))
-            Deg(s, row);
-        else if (CommandsEqual(command, POP))
-            Pop(s, row);
-        else if (CommandsEqual(command, PRINT))
-            Print(s, row);
-        else {
-            protector->error = true;
-            ErrorWrongCommand(row);
+/**
+ * Liczy zmianę głębokości nawiasów w fragmencie @p i wiersza.
+ * @param[in,out] ctx : zadanie
+ * @param[in] i : numer fragmentu
+ */
+static void ParseLineDepth(void *ctx, size_t i) {
+    ParseLineTask *task = (ParseLineTask*) ctx;
+    size_t start = task->len * i / task->parts, end = task->len * (i + 1) / task->parts;
+    long depth = 0;
+    for (size_t j = start; j < end; ++j)
+        depth += (task->text[j] == LEFT_BRACKET) - (task->text[j] == RIGHT_BRACKET);
+    task->depth[i] = depth;
+}
+
+/**
+ * Szuka w fragmencie @p i wiersza pierwszego plusa poza nawiasami.
+ * @param[in,out] ctx : zadanie
+ * @param[in] i : numer fragmentu
+ */
+static void ParseLineCut(void *ctx, size_t i) {
+    ParseLineTask *task = (ParseLineTask*) ctx;
+    size_t start = task->len * i / task->parts, end = task->len * (i + 1) / task->parts;
+    long depth = task->depth[i];
+    task->cuts[i] = PARSE_NO_CUT;
+    for (size_t j = start; j < end; ++j) {
+        char c = task->text[j];
+        if (c == PLUS && depth == 0) {
+            task->cuts[i] = j;
+            return;
         }
+        depth += (c == LEFT_BRACKET) - (c == RIGHT_BRACKET);
+    }
+}
+
+/**
+ * Wczytuje kawałek @p i wiersza, leżący między kolejnymi miejscami podziału.
+ * @param[in,out] ctx : zadanie
+ * @param[in] i : numer kawałka
+ */
+static void ParseLinePiece(void *ctx, size_t i) {
+    ParseLineTask *task = (ParseLineTask*) ctx;
+    size_t start = (i == 0) ? 0 : task->cuts[i] + 1;
+    size_t end = (i + 1 == task->parts) ? task->len : task->cuts[i + 1];
+    task->errors[i] = false;
+    // kawałek musi być jednomianem lub sumą jednomianów, a nie współczynnikiem;
+    // pierwszy zaczyna się nawiasem, bo inaczej wiersz nie jest dzielony
+    if (start == end || task->text[start] != LEFT_BRACKET) {
+        task->errors[i] = true;
+        task->polys[i] = PolyZero();
     }
     else {
-        protector->error = true;
-        ErrorWrongCommand(row);
+        task->polys[i] = ParsePolyText(task->text + start, end - start, &task->errors[i]);
     }
 }
 
-void ParseInput(Stack *s) {
-    ParserProtector protector;
-    ResetParseProtector(&protector);
-    String command = CreateString();
-    size_t row_number = 1;
-
-    while (!protector.end_of_file) {
-        ResetParseProtector(&protector);
-        if (!CommentOrEmptyLine()) {
-            if (CommandInLine()) {
-                ParseCommand(&command);
-                ExecuteCommand(s, &command, &protector, row_number);
-                command.size = 0; // resetujemy długość napisu
-            }
-            else { // parsujemy wielomian
-                Poly p = ParsePoly(&protector);
-                CheckIfEnd(&protector);
-                if (protector.error || !LineIsOver(&protector)) {
-                    PolyDestroy(&p);
-                    ErrorWrongPoly(row_number);
-                }
-                else {
-                    StackPush(s, &p);
-                }
-            }
+/**
+ * Wczytuje wielomian z długiego wiersza w @p threads wątkach. Poprawny wiersz
+ * zaczynający się nawiasem jest sumą jednomianów rozdzielonych plusami poza
+ * nawiasami, więc jest poprawny wtedy i tylko wtedy, gdy każdy kawałek między
+ * takimi plusami jest poprawną sumą jednomianów. Posortowane kawałki są
+ * scalane przez PolySumMany. Pozostałe wiersze (współczynniki, także z zerami
+ * wiodącymi) są wczytywane w jednym wątku.
+ * @param[in] text : znaki wiersza
+ * @param[in] len : liczba znaków wiersza
+ * @param[in] threads : liczba wątków
+ * @param[out] error : informacja o błędzie, ustawiana tylko w razie błędu
+ * @return wczytany wielomian lub wielomian zerowy w przypadku błędu
+ */
+static Poly ParsePolyParallel(const char *text, size_t len, size_t threads, bool *error) {
+    // wiersz bez nawiasu na początku może być tylko współczynnikiem, którego nie dzielimy
+    if (text[0] != LEFT_BRACKET)
+        return ParsePolyText(text, len, error);
+
+    size_t parts = len / PARSE_PARALLEL_CHUNK;
+    if (parts > threads * 4)
+        parts = threads * 4;
+
+    ParseLineTask task = {.text = text, .len = len, .parts = parts};
+    task.depth = (long*) MemoryAlloc(parts * sizeof(long), MEMORY_WORK);
+    task.cuts = (size_t*) MemoryAlloc(parts * sizeof(size_t), MEMORY_WORK);
+    ParallelRun(parts, threads, ParseLineDepth, &task);
+
+    long depth = 0;
+    for (size_t i = 0; i < parts; ++i) {
+        long change = task.depth[i];
+        task.depth[i] = depth;
+        depth += change;
+    }
+    ParallelRun(parts, threads, ParseLineCut, &task);
+
+    // pierwszy kawałek zaczyna się na początku wiersza, pomijamy fragmenty bez podziału
+    size_t pieces = 1;
+    for (size_t i = 1; i < parts; ++i) {
+        if (task.cuts[i] != PARSE_NO_CUT)
+            task.cuts[pieces++] = task.cuts[i];
+    }
+    task.parts = pieces;
+    task.polys = (Poly*) MemoryAlloc(pieces * sizeof(Poly), MEMORY_WORK);
+    task.errors = (bool*) MemoryAlloc(pieces * sizeof(bool), MEMORY_WORK);
+    ParallelRun(pieces, threads, ParseLinePiece, &task);
+
+    bool correct = true;
+    for (size_t i = 0; i < pieces; ++i)
+        correct &= !task.errors[i];
+
+    Poly result = PolyZero();
+    if (correct)
+        result = PolySumMany(pieces, task.polys);
+    else
+        *error = true;
+
+    for (size_t i = 0; i < pieces; ++i)
+        PolyReclaim(&task.polys[i]);
+    MemoryFree(task.polys, pieces * sizeof(Poly), MEMORY_WORK);
+    MemoryFree(task.errors, pieces * sizeof(bool), MEMORY_WORK);
+    MemoryFree(task.cuts, parts * sizeof(size_t), MEMORY_WORK);
+    MemoryFree(task.depth, parts * sizeof(long), MEMORY_WORK);
+    return result;
+}
+
+/**
+ * Wczytuje wiersz z wielomianem, który nie mieści się w buforze źródła.
+ * Wiersz jest najpierw przepisywany w całości, a jeżeli ma co najmniej
+ * PARSE_PARALLEL_LINE znaków, jest wczytywany w @p threads wątkach.
+ * @param[in,out] protector : informacje o stanie wczytywanego wiersza
+ * @param[in,out] cmd : wczytywane polecenie
+ * @param[in] threads : liczba wątków
+ */
+static void ParseLongLine(ParserProtector *protector, Command *cmd, size_t threads) {
+    String line = CreateString();
+    ReadLine(protector, &line);
+
+    bool error = false;
+    if (line.size >= PARSE_PARALLEL_LINE)
+        cmd->p = ParsePolyParallel(line.arr, line.size, threads, &error);
+    else
+        cmd->p = ParsePolyText(line.arr, line.size, &error);
+
+    if (error)
+        cmd->error = ErrorWrongPoly;
+    DestroyString(&line);
+}
+
+/**
+ * Zapamiętuje wartość z poprawnego polecenia AT_NEXT, a po każdym innym
+ * wierszu zapomina zapamiętane wartości.
+ * @param[in,out] parser : parser poleceń
+ * @param[in] cmd : wczytane polecenie
+ */
+static void ParseAtNext(CommandParser *parser, const Command *cmd) {
+    if (cmd->type != COMMAND_AT_NEXT || cmd->error != NULL) {
+        parser->at_next_size = 0;
+        return;
+    }
+
+    if (parser->at_next_size == parser->at_next_allocated) {
+        size_t allocated = IncreaseSpace(parser->at_next_allocated);
+        parser->at_next = (poly_coeff_t*) MemoryRealloc(parser->at_next,
+                                                        parser->at_next_allocated * sizeof(poly_coeff_t),
+                                                        allocated * sizeof(poly_coeff_t), MEMORY_PARSER);
+        parser->at_next_allocated = allocated;
+    }
+    parser->at_next[parser->at_next_size++] = cmd->x;
+}
+
+/**
+ * Wczytuje wiersz, który nie jest komentarzem ani wierszem pustym. Wiersz
+ * z wielomianem poprzedzony poleceniami AT_NEXT jest obliczany w trakcie
+ * wczytywania (ParsePolyAt), zawsze bezpośrednio ze źródła.
+ * @param[in,out] parser : parser poleceń
+ * @param[out] cmd : wczytane polecenie
+ */
+static void ParseLine(CommandParser *parser, Command *cmd) {
+    ParserProtector *protector = &parser->protector;
+    *cmd = (Command) {.type = COMMAND_POLY, .row = parser->row, .p = PolyZero(), .error = NULL};
+
+    if (CommandInLine(protector->reader)) {
+        ParseCommand(protector->reader, &parser->name);
+        // pusty napis oznacza, że wiersz nie zaczyna się od wielkiej litery
+        cmd->type = (parser->name.size > 0) ? CommandFromName(parser->name.arr) : COMMAND_WRONG;
+        parser->name.size = 0; // resetujemy długość napisu
+        ParseArguments(protector, cmd);
+    }
+    else if (parser->at_next_size > 0) {
+        cmd->p = ParsePolyAt(protector, parser->at_next_size, parser->at_next);
+        CheckIfEnd(protector);
+        if (protector->error || !LineIsOver(protector)) {
+            PolyDestroy(&cmd->p);
+            cmd->error = ErrorWrongPoly;
         }
+    }
+    else if (!LineIsBuffered(protector->reader) && ParallelThreads() > 1) {
+        // w jednym wątku przepisywanie wiersza tylko by spowalniało wczytywanie
+        ParseLongLine(protector, cmd, ParallelThreads());
+    }
+    else { // parsujemy wielomian
+        cmd->p = ParsePoly(protector);
+        CheckIfEnd(protector);
+        if (protector->error || !LineIsOver(protector)) {
+            PolyDestroy(&cmd->p);
+            cmd->error = ErrorWrongPoly;
+        }
+    }
+    ParseAtNext(parser, cmd);
+}
+
+CommandParser CreateCommandParser(Reader *reader) {
+    CommandParser parser = {.protector = {.reader = reader}, .name = CreateString(), .row = 1,
+                            .at_next_size = 0, .at_next_allocated = INIT_SIZE};
+    parser.at_next = (poly_coeff_t*) MemoryCalloc(INIT_SIZE, sizeof(poly_coeff_t), MEMORY_PARSER);
+    ResetParseProtector(&parser.protector);
+    return parser;
+}
+
+void DestroyCommandParser(CommandParser *parser) {
+    DestroyString(&parser->name);
+    MemoryFree(parser->at_next, parser->at_next_allocated * sizeof(poly_coeff_t), MEMORY_PARSER);
+}
+
+bool ParseNextCommand(CommandParser *parser, Command *cmd) {
+    ParserProtector *protector = &parser->protector;
+
+    // wejście zakończone znakiem nowej linii nie zawiera już kolejnego wiersza
+    while (!protector->end_of_file && NextChar(protector->reader) != EOF) {
+        ResetParseProtector(protector);
+        bool found = !CommentOrEmptyLine(protector->reader);
+        if (found)
+            ParseLine(parser, cmd);
 
         // jeżeli nie doszliśmy do końca linii do wczytujemy pozostałe znaki
-        if (!LineIsOver(&protector))
-            SkipLine(&protector);
+        if (!LineIsOver(protector))
+            SkipLine(protector);
+
+        if (!protector->end_of_file)
+            CheckIfEnd(protector);
+
+        parser->row++;
+        if (found)
+            return true;
+    }
 
-        if (!protector.end_of_file)
-            CheckIfEnd(&protector);
+    return false;
+}
 
-        row_number++;
+bool PolyParse(const char *text, size_t len, Poly *p) {
+    return PolyParseAt(text, len, 0, NULL, p);
+}
+
+bool PolyParseAt(const char *text, size_t len, size_t count, const poly_coeff_t values[], Poly *p) {
+    bool error = false;
+    // jak w wierszu wejścia, wielomian może kończyć się znakiem nowej linii
+    if (len > 0 && text[len - 1] == EOL)
+        len--;
+    // pusty wiersz nie jest wielomianem
+    if (len == 0) {
+        *p = PolyZero();
+        return false;
     }
-    DestroyString(&command);
+    *p = ParsePolyTextAt(text, len, count, values, &error);
+    return !error;
 }
 
+void ExecuteCommand(Calculator *c, Command *cmd) {
+    CommandType type = cmd->type;
+    size_t row = cmd->row;
+
+    if (cmd->error != NULL)
+        cmd->error(c->err, row);
+    else if (type == COMMAND_POLY)
+        StackPush(&c->stack, &cmd->p);
+    else if (type == COMMAND_ZERO)
+        Zero(c);
+    else if (type == COMMAND_IS_COEFF)
+        IsCoeff(c, row);
+    else if (type == COMMAND_IS_ZERO)
+        IsZero(c, row);
+    else if (type == COMMAND_CLONE)
+        Clone(c, row);
+    else if (type == COMMAND_ADD)
+        Add(c, row);
+    else if (type == COMMAND_MUL)
+        Mul(c, row);
+    else if (type == COMMAND_SUB)
+        Sub(c, row);
+    else if (type == COMMAND_NEG)
+        Neg(c, row);
+    else if (type == COMMAND_IS_EQ)
+        IsEq(c, row);
+    else if (type == COMMAND_DEG)
+        Deg(c, row);
+    else if (type == COMMAND_DEG_BY)
+        DegBy(c, row, cmd->arg);
+    else if (type == COMMAND_AT)
+        At(c, row, cmd->x);
+    else if (type == COMMAND_POP)
+        Pop(c, row);
+    else if (type == COMMAND_PRINT)
+        Print(c, row);
+    else if (type == COMMAND_COMPOSE)
+        Compose(c, row, cmd->arg);
+    else if (type == COMMAND_ADD_N)
+        AddN(c, row, cmd->arg);
+    else if (type == COMMAND_MUL_N)
+        MulN(c, row, cmd->arg);
+    else if (type == COMMAND_AT_VARS)
+        AtVars(c, row, cmd->arg);
+    else if (type == COMMAND_STATS)
+        ShowStats(c);
+    else if (type == COMMAND_MEM_STATS)
+        ShowMemoryStats(c);
+    else if (type == COMMAND_COMPACT)
+        Compact(c, row);
+}
 
+void ParseInput(Calculator *c, Reader *reader) {
+    CommandParser parser = CreateCommandParser(reader);
+    Command cmd;
+
+    while (true) {
+        STATS_START(start);
+        if (!ParseNextCommand(&parser, &cmd))
+            break;
+        ExecuteCommand(c, &cmd);
+        STATS_STOP(&c->stats, cmd.type, start);
+    }
+
+    DestroyCommandParser(&parser);
+}
+
+void CalcExecute(Calculator *c, const char *buffer, size_t len) {
+    Reader reader = CreateMemoryReader(buffer, len);
+    ParseInput(c, &reader);
+}
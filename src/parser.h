@@ -11,8 +11,18 @@
 
 #include "stack.h"
 #include "calculator.h"
+#include "reader.h"
 #include <string.h>
 
+/**
+ * Najmniejsza długość wiersza z wielomianem (w znakach), od której wiersz jest
+ * dzielony na fragmenty wczytywane w kilku wątkach.
+ */
+#define PARSE_PARALLEL_LINE (1 << 20)
+
+/** Najmniejsza długość fragmentu wiersza wczytywanego przez jeden wątek. */
+#define PARSE_PARALLEL_CHUNK (1 << 18)
+
 /** Typ reprezentujący unsigned long long, dla skrócenia kodu. */
 typedef unsigned long long ull;
 
@@ -38,11 +48,35 @@ typedef struct MonosArr {
 
 /** Struktura pomocnicza do przechowywania niektórych informacji o stanie wczytywanego wiersza. */
 typedef struct ParserProtector {
+    Reader *reader; ///< źródło, z którego wczytywany jest wiersz
     bool error; ///< czy wystąpił błąd
     bool end_of_file; ///< czy został osiągnięty koniec pliku
     bool end_of_line; ///< czy został osiągnięty koniec wiersza
 } ParserProtector;
 
+/**
+ * Struktura przechowująca wczytany wiersz: polecenie wraz z argumentem,
+ * wielomian albo informację o błędzie.
+ */
+typedef struct Command {
+    CommandType type; ///< rodzaj wiersza
+    size_t row; ///< numer wiersza
+    ull arg; ///< argument poleceń DEG_BY, COMPOSE, ADD_N, MUL_N i AT_VARS
+    poly_coeff_t x; ///< argument poleceń AT i AT_NEXT
+    Poly p; ///< wielomian z wiersza COMMAND_POLY
+    ErrorPrinter error; ///< funkcja wypisująca błąd wiersza lub NULL, jeżeli wiersz jest poprawny
+} Command;
+
+/** Struktura przechowująca stan parsera kolejnych wierszy źródła. */
+typedef struct CommandParser {
+    ParserProtector protector; ///< informacje o stanie wczytywanego wiersza
+    String name; ///< bufor na nazwę polecenia
+    size_t row; ///< numer kolejnego wiersza
+    poly_coeff_t *at_next; ///< wartości z poleceń AT_NEXT dla kolejnego wiersza z wielomianem
+    size_t at_next_size; ///< liczba wartości w tablicy at_next
+    size_t at_next_allocated; ///< liczba wartości mieszczących się w tablicy at_next
+} CommandParser;
+
 /**
  * Tworzy pusty napis.
  * @return pusty napis
@@ -83,10 +117,11 @@ void DestroyMonosArr(MonosArr *monos);
 
 /**
  * Parsuje liczbę.
+ * @param[in,out] reader : źródło znaków
  * @param[in,out] error : informacja o tym czy wystąpił błąd
  * @return wczytana liczba
  */
-Number ParseNumber(bool *error);
+Number ParseNumber(Reader *reader, bool *error);
 
 /**
  * Parsuje jednomian.
@@ -102,27 +137,101 @@ Mono ParseMono(ParserProtector *protector);
  */
 Poly ParsePoly(ParserProtector *protector);
 
+/**
+ * Parsuje wielomian, od razu podstawiając @p count wartości pod zmienne
+ * @f$x_0, \ldots, x_{count-1}@f$, tak jak kolejne wywołania PolyAt, więc
+ * pozostałe zmienne dostają indeksy mniejsze o @p count. Jednomiany zmiennych,
+ * pod które są podstawiane wartości, nie są zapamiętywane: każdy wczytywany
+ * wielomian takiej zmiennej ma tylko sumę wartości jednomianów, więc pamięć
+ * zależy od głębokości zagnieżdżenia, a nie od liczby jednomianów.
+ * @param[in,out] protector : informacje o stanie wczytywanego wiersza
+ * @param[in] count : liczba wartości
+ * @param[in] values : wartości zmiennych @f$x_0, \ldots, x_{count-1}@f$
+ * @return wartość wczytanego wielomianu
+ */
+Poly ParsePolyAt(ParserProtector *protector, size_t count, const poly_coeff_t values[]);
+
 /**
  * Wczytuje polecenie, jego wartość jest zapisywana do zmiennej @p command.
+ * @param[in,out] reader : źródło znaków
  * @param[in] command : napis do którego będzie wczytane polecenie
  */
-void ParseCommand(String *command);
+void ParseCommand(Reader *reader, String *command);
 
 
 /**
- * Wykonuje polecenie kalkulatora. Jeżeli polecenie jest nieprawidłowe lub nieprawidłowy jest
- * argument polecenia DEG_BY lub AT to wówczas wypisuje odpowiedni błąd.
- * @param[in,out] s : stos
- * @param[in] command : polecenie
- * @param[in,out] protector : informacje o stanie wczytywanego wiersza
- * @param[in] row : numer wiersza, w którym zostało wczytane polecenie
+ * Wykonuje wczytane polecenie w sesji @p c. Jeżeli polecenie jest niepoprawne,
+ * wypisuje odpowiedni błąd. Wielomian z wiersza COMMAND_POLY przechodzi na
+ * własność stosu sesji.
+ * @param[in,out] c : sesja kalkulatora
+ * @param[in,out] cmd : polecenie
+ */
+void ExecuteCommand(Calculator *c, Command *cmd);
+
+/**
+ * Tworzy parser poleceń wczytujący wiersze ze źródła @p reader.
+ * @param[in,out] reader : źródło znaków
+ * @return parser poleceń
+ */
+CommandParser CreateCommandParser(Reader *reader);
+
+/**
+ * Zwalnia pamięć parsera poleceń.
+ * @param[in,out] parser : parser poleceń
+ */
+void DestroyCommandParser(CommandParser *parser);
+
+/**
+ * Wczytuje kolejny wiersz, który nie jest komentarzem ani wierszem pustym.
+ * Błędy wiersza nie są wypisywane, tylko zapisywane w @p cmd, żeby polecenie
+ * mogło zostać wykonane później (zobacz ExecuteCommand).
+ * @param[in,out] parser : parser poleceń
+ * @param[out] cmd : wczytane polecenie
+ * @return Czy udało się wczytać polecenie (false oznacza koniec źródła)?
+ */
+bool ParseNextCommand(CommandParser *parser, Command *cmd);
+
+/**
+ * Przeprowadza operacje wczytywania wielomianów oraz poleceń ze źródła @p reader
+ * i wykonuje je w sesji @p c.
+ * @param[in,out] c : sesja kalkulatora
+ * @param[in,out] reader : źródło znaków
+ */
+void ParseInput(Calculator *c, Reader *reader);
+
+/**
+ * Wczytuje wielomian zapisany w napisie @p text tak jak wiersz wejścia
+ * kalkulatora (zakończony co najwyżej jednym znakiem nowej linii). Znaki są
+ * czytane bezpośrednio z napisu, bez kopiowania. Funkcja może być wywoływana
+ * jednocześnie z wielu wątków.
+ * @param[in] text : napis, nie musi być zakończony znakiem '\0'
+ * @param[in] len : liczba znaków napisu
+ * @param[out] p : wczytany wielomian lub wielomian zerowy w przypadku błędu
+ * @return Czy napis jest poprawnym wielomianem?
+ */
+bool PolyParse(const char *text, size_t len, Poly *p);
+
+/**
+ * Wczytuje wielomian zapisany w napisie @p text tak jak PolyParse, podstawiając
+ * w trakcie wczytywania @p count wartości pod pierwsze zmienne (patrz ParsePolyAt).
+ * @param[in] text : napis, nie musi być zakończony znakiem '\0'
+ * @param[in] len : liczba znaków napisu
+ * @param[in] count : liczba wartości
+ * @param[in] values : wartości zmiennych @f$x_0, \ldots, x_{count-1}@f$
+ * @param[out] p : wartość wielomianu lub wielomian zerowy w przypadku błędu
+ * @return Czy napis jest poprawnym wielomianem?
  */
-void ExecuteCommand(Stack *s, String *command, ParserProtector *protector, size_t row);
+bool PolyParseAt(const char *text, size_t len, size_t count, const poly_coeff_t values[], Poly *p);
 
 /**
- * Przeprowadza operacje wczytywania wielomianów oraz poleceń.
- * @param[in] s : stos
+ * Wykonuje w sesji @p c polecenia zapisane w buforze @p buffer, czytając je
+ * bezpośrednio z bufora. Stos sesji jest zachowywany między wywołaniami,
+ * a numery wierszy w komunikatach o błędach liczone są od początku bufora.
+ * Wyniki i błędy trafiają do plików sesji (InitCalculator).
+ * @param[in,out] c : sesja kalkulatora
+ * @param[in] buffer : polecenia, po jednym w wierszu
+ * @param[in] len : liczba znaków w buforze
  */
-void ParseInput(Stack *s);
+void CalcExecute(Calculator *c, const char *buffer, size_t len);
 
 #endif //POLYNOMIALS_PARSER_H
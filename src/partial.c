@@ -0,0 +1,219 @@
+/** @file
+  Implementacja częściowego obliczania wartości wielomianu
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include "builder.h"
+#include "partial.h"
+#include "terms.h"
+#include "work_stack.h"
+
+/** Zmienna wielomianu po podstawieniu: ustalona albo przenumerowana. */
+typedef struct PartialVar {
+    bool fixed; ///< czy pod zmienną jest podstawiana stała
+    uint64_t value; ///< wartość ustalonej zmiennej
+    size_t index; ///< nowy indeks zmiennej nieustalonej
+} PartialVar;
+
+/** Ramka przejścia podstawiającego stałe; jednomiany są przechodzone od najniższego wykładnika. */
+typedef struct PartialFrame {
+    Poly p; ///< widok wielomianu z uwzględnionym znakiem
+    size_t var; ///< indeks zmiennej wielomianu
+    size_t i; ///< indeks kolejnego jednomianu
+    uint64_t mult; ///< iloczyn potęg wartości ustalonych zmiennych na drodze od korzenia
+    uint64_t power; ///< wartość zmiennej podniesiona do wykładnika exp, gdy zmienna jest ustalona
+    poly_exp_t exp; ///< wykładnik poprzedniego jednomianu
+} PartialFrame;
+
+/**
+ * Sprawdza, czy zmienna jest ustalona maską.
+ * @param[in] var_mask : maska ustalonych zmiennych
+ * @param[in] i : indeks zmiennej
+ * @return Czy pod zmienną @f$x_i@f$ jest podstawiana wartość?
+ */
+static inline bool PartialIsFixed(uint64_t var_mask, size_t i) {
+    return i < PARTIAL_MAX_VARS && ((var_mask >> i) & 1);
+}
+
+/**
+ * Liczy zmienne ustalone maską wśród zmiennych @f$x_0, \ldots, x_{count-1}@f$.
+ * @param[in] var_mask : maska ustalonych zmiennych
+ * @param[in] count : liczba zmiennych
+ * @return liczba ustalonych zmiennych
+ */
+static size_t PartialFixedCount(uint64_t var_mask, size_t count) {
+    size_t fixed = 0;
+    for (size_t i = 0; i < count && i < PARTIAL_MAX_VARS; ++i)
+        fixed += PartialIsFixed(var_mask, i);
+    return fixed;
+}
+
+size_t PartialValueCount(uint64_t var_mask) {
+    return PartialFixedCount(var_mask, PARTIAL_MAX_VARS);
+}
+
+/**
+ * Tworzy opis zmiennych wielomianu po podstawieniu.
+ * @param[in] count : liczba zmiennych wielomianu
+ * @param[in] var_mask : maska ustalonych zmiennych
+ * @param[in] values : wartości ustalonych zmiennych
+ * @return tablica @p count opisów zmiennych
+ */
+static PartialVar *CreatePartialVars(size_t count, uint64_t var_mask, const poly_coeff_t values[]) {
+    PartialVar *vars = (PartialVar*) MemoryAlloc(count * sizeof(PartialVar), MEMORY_WORK);
+    size_t fixed = 0;
+    for (size_t i = 0; i < count; ++i) {
+        vars[i].fixed = PartialIsFixed(var_mask, i);
+        vars[i].value = vars[i].fixed ? (uint64_t) values[fixed] : 0;
+        vars[i].index = i - fixed;
+        fixed += vars[i].fixed;
+    }
+    return vars;
+}
+
+/**
+ * Przechodzi bez rekurencji drzewo jednomianów wielomianu niebędącego
+ * współczynnikiem i dodaje do budowniczego jego wyrazy po podstawieniu.
+ * Wykładnik nieustalonej zmiennej jest zapisywany w @p exps na czas
+ * przechodzenia współczynnika jednomianu, a po zakończeniu ramki zerowany,
+ * więc wykładniki zmiennych głębszych niż bieżąca są zawsze zerami.
+ * Poddrzewa mnożone przez zero są pomijane.
+ * @param[in] p : wielomian
+ * @param[in] vars : opisy zmiennych wielomianu
+ * @param[in,out] exps : zerowe wykładniki pozostałych zmiennych
+ * @param[in,out] b : budowniczy wyniku
+ */
+static void PartialTraverse(const Poly *p, const PartialVar *vars, poly_exp_t *exps, PolyBuilder *b) {
+    PartialFrame local[WORK_STACK_LOCAL_SIZE];
+    WorkStack ws = InitWorkStack(local, WORK_STACK_LOCAL_SIZE, sizeof(PartialFrame));
+    *(PartialFrame*) WorkStackPush(&ws) = (PartialFrame) {.p = *p, .var = 0, .i = 0, .mult = 1,
+                                                          .power = 1, .exp = 0};
+
+    while (!WorkStackIsEmpty(&ws)) {
+        PartialFrame *top = (PartialFrame*) WorkStackTop(&ws);
+        const PartialVar *var = &vars[top->var];
+        if (top->i == PolyGetSize(&top->p)) {
+            if (!var->fixed)
+                exps[var->index] = 0;
+            WorkStackPop(&ws);
+            continue;
+        }
+
+        Mono m = PolyGetMono(&top->p, top->i++);
+        poly_exp_t exp = MonoGetExp(&m);
+        uint64_t mult = top->mult;
+        if (var->fixed) {
+            // potęga dla poprzedniego jednomianu razy wartość do różnicy wykładników
+            top->power *= PolyCoeffPow(var->value, exp - top->exp);
+            top->exp = exp;
+            mult *= top->power;
+        }
+        else {
+            exps[var->index] = exp;
+        }
+
+        if (mult == 0)
+            continue;
+        if (PolyIsCoeff(&m.p)) {
+            PolyBuilderAdd(b, exps, (poly_coeff_t) (mult * (uint64_t) m.p.coeff));
+        }
+        else {
+            size_t child = top->var + 1;
+            *(PartialFrame*) WorkStackPush(&ws) = (PartialFrame) {.p = m.p, .var = child, .i = 0, .mult = mult,
+                                                                  .power = 1, .exp = 0};
+        }
+    }
+    WorkStackClear(&ws);
+}
+
+Poly PolyEvalPartial(const Poly *p, uint64_t var_mask, const poly_coeff_t values[]) {
+    assert(p != NULL);
+    size_t count = PolyVarCount(p);
+    size_t fixed = PartialFixedCount(var_mask, count);
+    if (fixed == 0)
+        return PolyClone(p);
+
+    PartialVar *vars = CreatePartialVars(count, var_mask, values);
+    size_t remaining = count - fixed;
+    poly_exp_t *exps = (poly_exp_t*) MemoryCalloc(remaining + 1, sizeof(poly_exp_t), MEMORY_WORK);
+    PolyBuilder b;
+    InitPolyBuilder(&b, remaining);
+    PartialTraverse(p, vars, exps, &b);
+    Poly result = PolyBuilderFinish(&b);
+
+    PolyBuilderDestroy(&b);
+    MemoryFree(exps, (remaining + 1) * sizeof(poly_exp_t), MEMORY_WORK);
+    MemoryFree(vars, count * sizeof(PartialVar), MEMORY_WORK);
+    return result;
+}
+
+/**
+ * Tworzy wielomian @f$x_j@f$.
+ * @param[in] j : indeks zmiennej
+ * @return wielomian @f$x_j@f$
+ */
+static Poly PartialVarPoly(size_t j) {
+    poly_exp_t *exps = (poly_exp_t*) MemoryCalloc(j + 1, sizeof(poly_exp_t), MEMORY_WORK);
+    exps[j] = 1;
+    PolyBuilder b;
+    InitPolyBuilder(&b, j + 1);
+    PolyBuilderAdd(&b, exps, 1);
+    Poly result = PolyBuilderFinish(&b);
+    PolyBuilderDestroy(&b);
+    MemoryFree(exps, (j + 1) * sizeof(poly_exp_t), MEMORY_WORK);
+    return result;
+}
+
+/**
+ * Podstawia wielomiany pod zmienne wskazane maską przez PolyCompose. Pod
+ * pozostałe zmienne wielomianu są podstawiane wielomiany @f$x_j@f$ o nowych
+ * indeksach.
+ * @param[in] p : wielomian
+ * @param[in] var_mask : maska ustalonych zmiennych
+ * @param[in] values : wielomiany podstawiane pod ustalone zmienne
+ * @return wielomian od pozostałych zmiennych
+ */
+static Poly PartialCompose(const Poly *p, uint64_t var_mask, const Poly values[]) {
+    size_t count = PolyVarCount(p);
+    Poly *q = (Poly*) MemoryAlloc(count * sizeof(Poly), MEMORY_WORK);
+    size_t fixed = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (PartialIsFixed(var_mask, i))
+            q[i] = values[fixed++];
+        else
+            q[i] = PartialVarPoly(i - fixed);
+    }
+
+    Poly result = PolyCompose(p, count, q);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!PartialIsFixed(var_mask, i))
+            PolyDestroy(&q[i]);
+    }
+    MemoryFree(q, count * sizeof(Poly), MEMORY_WORK);
+    return result;
+}
+
+Poly PolySubstituteVars(const Poly *p, uint64_t var_mask, const Poly values[]) {
+    assert(p != NULL);
+    size_t count = PolyVarCount(p);
+    size_t fixed = PartialFixedCount(var_mask, count);
+    if (fixed == 0)
+        return PolyClone(p);
+
+    bool constants = true;
+    for (size_t j = 0; j < fixed; ++j)
+        constants = constants && PolyIsCoeff(&values[j]);
+    if (!constants)
+        return PartialCompose(p, var_mask, values);
+
+    poly_coeff_t *coeffs = (poly_coeff_t*) MemoryAlloc(fixed * sizeof(poly_coeff_t), MEMORY_WORK);
+    for (size_t j = 0; j < fixed; ++j)
+        coeffs[j] = values[j].coeff;
+    Poly result = PolyEvalPartial(p, var_mask, coeffs);
+    MemoryFree(coeffs, fixed * sizeof(poly_coeff_t), MEMORY_WORK);
+    return result;
+}
@@ -0,0 +1,71 @@
+/** @file
+  Interfejs częściowego obliczania wartości wielomianu
+
+  PolyAt podstawia wartość tylko pod zmienną główną, a ustalenie kilku innych
+  zmiennych wymaga złożenia PolyCompose z wielomianami tożsamościowymi.
+  PolyEvalPartial podstawia stałe pod dowolny podzbiór zmiennych
+  @f$x_0, \ldots, x_{63}@f$ w jednym przejściu drzewa jednomianów, bez
+  wielomianów pośrednich. Każda ramka przejścia pamięta iloczyn potęg wartości
+  ustalonych zmiennych na drodze od korzenia, a potęgę ustalonej zmiennej
+  liczy z potęgi dla poprzedniego jednomianu, mnożąc ją przez wartość
+  podniesioną do różnicy wykładników. Wyrazy z pozostałymi zmiennymi,
+  ponumerowanymi kolejno od zera, trafiają do budowniczego PolyBuilder,
+  który łączy wyrazy podobne. Obliczenia są wykonywane modulo @f$2^{64}@f$,
+  tak jak działania na współczynnikach wielomianów.
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef POLYNOMIALS_PARTIAL_H
+#define POLYNOMIALS_PARTIAL_H
+
+#include <stdint.h>
+#include "poly.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Liczba zmiennych, które można ustalić maską PolyEvalPartial. */
+#define PARTIAL_MAX_VARS 64
+
+/**
+ * Daje liczbę wartości podstawianych według maski, czyli liczbę zapalonych bitów.
+ * @param[in] var_mask : maska ustalonych zmiennych
+ * @return liczba wartości
+ */
+POLY_API size_t PartialValueCount(uint64_t var_mask);
+
+/**
+ * Podstawia stałe pod zmienne wielomianu wskazane maską. Zmienna @f$x_i@f$
+ * jest ustalona, jeżeli bit @f$i@f$ maski jest zapalony; pozostałe zmienne
+ * są numerowane kolejno od zera z zachowaniem kolejności, np. dla maski
+ * `0b101` zmienna @f$x_1@f$ staje się @f$x_0@f$, a @f$x_3@f$ staje się @f$x_1@f$.
+ * @param[in] p : wielomian
+ * @param[in] var_mask : maska ustalonych zmiennych
+ * @param[in] values : wartości ustalonych zmiennych w kolejności rosnących
+ * indeksów, po jednej na zapalony bit maski
+ * @return wielomian od pozostałych zmiennych
+ */
+POLY_API Poly PolyEvalPartial(const Poly *p, uint64_t var_mask, const poly_coeff_t values[]);
+
+/**
+ * Podstawia wielomiany pod zmienne wielomianu wskazane maską i numeruje
+ * pozostałe zmienne tak jak PolyEvalPartial. Jeżeli wszystkie podstawiane
+ * wielomiany są stałymi, wynik liczy PolyEvalPartial, a w przeciwnym razie
+ * PolyCompose z wielomianami @f$x_j@f$ podstawianymi pod pozostałe zmienne.
+ * @param[in] p : wielomian
+ * @param[in] var_mask : maska ustalonych zmiennych
+ * @param[in] values : wielomiany podstawiane pod ustalone zmienne w kolejności
+ * rosnących indeksów, po jednym na zapalony bit maski
+ * @return wielomian od pozostałych zmiennych
+ */
+POLY_API Poly PolySubstituteVars(const Poly *p, uint64_t var_mask, const Poly values[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //POLYNOMIALS_PARTIAL_H
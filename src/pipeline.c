@@ -0,0 +1,157 @@
+/** @file
+  Implementacja potokowego wykonywania poleceń kalkulatora
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+/** Udostępnia funkcje POSIX (wątki) przy kompilacji z -std=c11. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include "pipeline.h"
+
+/** Rozmiar linii pamięci podręcznej, na której leżą liczniki kolejki. */
+#define PIPELINE_CACHE_LINE 64
+
+/**
+ * Kolejka cykliczna wczytanych poleceń. Liczniki head i tail rosną bez
+ * ograniczeń, a miejscem polecenia jest licznik modulo PIPELINE_RING_SIZE.
+ * Każdy licznik zmienia tylko jeden wątek, więc do przekazania polecenia
+ * wystarczy zapis licznika; liczniki leżą w osobnych liniach pamięci, żeby
+ * wątki nie unieważniały sobie nawzajem pamięci podręcznej.
+ */
+typedef struct Pipeline {
+    Command *slots; ///< miejsca na polecenia
+    alignas(PIPELINE_CACHE_LINE) atomic_size_t head; ///< liczba poleceń wykonanych przez konsumenta
+    size_t tail_cache; ///< ostatnia wartość tail odczytana przez konsumenta
+    alignas(PIPELINE_CACHE_LINE) atomic_size_t tail; ///< liczba poleceń wczytanych przez producenta
+    size_t head_cache; ///< ostatnia wartość head odczytana przez producenta
+    alignas(PIPELINE_CACHE_LINE) atomic_bool done; ///< czy producent wczytał całe źródło
+    atomic_int sleepers; ///< liczba wątków uśpionych na zmiennej wake
+    CommandParser parser; ///< parser używany tylko przez wątek producenta
+    pthread_mutex_t lock; ///< blokada do usypiania wątków
+    pthread_cond_t wake; ///< sygnalizuje zmianę licznika lub koniec źródła
+} Pipeline;
+
+/**
+ * Czeka, aż licznik @p index będzie różny od @p seen albo producent
+ * zakończy wczytywanie. Najpierw sprawdza licznik PIPELINE_SPINS razy,
+ * a dopiero potem usypia wątek.
+ * @param[in,out] pl : potok
+ * @param[in] index : licznik drugiej strony kolejki
+ * @param[in] seen : ostatnia odczytana wartość licznika
+ */
+static void PipelineWait(Pipeline *pl, atomic_size_t *index, size_t seen) {
+    for (size_t i = 0; i < PIPELINE_SPINS; ++i) {
+        if (atomic_load_explicit(index, memory_order_acquire) != seen ||
+            atomic_load_explicit(&pl->done, memory_order_acquire))
+            return;
+    }
+
+    pthread_mutex_lock(&pl->lock);
+    // zwiększenie sleepers przed sprawdzeniem licznika gwarantuje, że druga
+    // strona po zmianie licznika zobaczy uśpiony wątek i go obudzi
+    atomic_fetch_add(&pl->sleepers, 1);
+    while (atomic_load(index) == seen && !atomic_load(&pl->done))
+        pthread_cond_wait(&pl->wake, &pl->lock);
+    atomic_fetch_sub(&pl->sleepers, 1);
+    pthread_mutex_unlock(&pl->lock);
+}
+
+/**
+ * Budzi wątek uśpiony w PipelineWait, jeżeli taki jest.
+ * @param[in,out] pl : potok
+ */
+static void PipelineWake(Pipeline *pl) {
+    if (atomic_load(&pl->sleepers) == 0)
+        return;
+    pthread_mutex_lock(&pl->lock);
+    pthread_cond_broadcast(&pl->wake);
+    pthread_mutex_unlock(&pl->lock);
+}
+
+/**
+ * Pętla wątku parsera: wczytuje polecenia do kolejnych miejsc kolejki,
+ * czekając, gdy kolejka jest pełna.
+ * @param[in,out] arg : potok
+ * @return NULL
+ */
+static void *PipelineProducer(void *arg) {
+    Pipeline *pl = (Pipeline*) arg;
+    size_t tail = 0;
+
+    while (true) {
+        if (tail - pl->head_cache == PIPELINE_RING_SIZE) {
+            pl->head_cache = atomic_load_explicit(&pl->head, memory_order_acquire);
+            if (tail - pl->head_cache == PIPELINE_RING_SIZE) {
+                PipelineWait(pl, &pl->head, pl->head_cache);
+                continue;
+            }
+        }
+
+        if (!ParseNextCommand(&pl->parser, &pl->slots[tail % PIPELINE_RING_SIZE]))
+            break;
+        atomic_store(&pl->tail, ++tail);
+        PipelineWake(pl);
+    }
+
+    atomic_store(&pl->done, true);
+    PipelineWake(pl);
+    return NULL;
+}
+
+void PipelineInput(Calculator *c, Reader *reader) {
+    Pipeline pl = {.tail_cache = 0, .head_cache = 0, .parser = CreateCommandParser(reader)};
+    atomic_init(&pl.head, 0);
+    atomic_init(&pl.tail, 0);
+    atomic_init(&pl.done, false);
+    atomic_init(&pl.sleepers, 0);
+    pthread_mutex_init(&pl.lock, NULL);
+    pthread_cond_init(&pl.wake, NULL);
+    pl.slots = (Command*) MemoryAlloc(PIPELINE_RING_SIZE * sizeof(Command), MEMORY_WORK);
+
+    pthread_t producer;
+    if (pthread_create(&producer, NULL, PipelineProducer, &pl) != 0) {
+        // bez drugiego wątku wczytujemy i wykonujemy wiersze na przemian
+        DestroyCommandParser(&pl.parser);
+        ParseInput(c, reader);
+    }
+    else {
+        size_t head = 0;
+        while (true) {
+            if (head == pl.tail_cache) {
+                pl.tail_cache = atomic_load_explicit(&pl.tail, memory_order_acquire);
+                if (head == pl.tail_cache) {
+                    // tail jest zapisywany przed done, więc po odczytaniu done
+                    // wystarczy jeszcze raz sprawdzić tail
+                    if (atomic_load_explicit(&pl.done, memory_order_acquire)) {
+                        pl.tail_cache = atomic_load_explicit(&pl.tail, memory_order_acquire);
+                        if (head == pl.tail_cache)
+                            break;
+                    }
+                    else {
+                        PipelineWait(&pl, &pl.tail, head);
+                    }
+                    continue;
+                }
+            }
+
+            Command *cmd = &pl.slots[head % PIPELINE_RING_SIZE];
+            STATS_START(start);
+            ExecuteCommand(c, cmd);
+            STATS_STOP(&c->stats, cmd->type, start);
+            atomic_store(&pl.head, ++head);
+            PipelineWake(&pl);
+        }
+        pthread_join(producer, NULL);
+        DestroyCommandParser(&pl.parser);
+    }
+
+    MemoryFree(pl.slots, PIPELINE_RING_SIZE * sizeof(Command), MEMORY_WORK);
+    pthread_cond_destroy(&pl.wake);
+    pthread_mutex_destroy(&pl.lock);
+}
@@ -0,0 +1,38 @@
+/** @file
+  Interfejs potokowego wykonywania poleceń kalkulatora
+
+  W ParseInput wczytywanie i wykonywanie wierszy przeplata się w jednym
+  wątku: podczas długiego mnożenia kolejne wiersze czekają niewczytane,
+  a podczas wczytywania dużego wielomianu nic nie jest liczone. W trybie
+  potokowym osobny wątek parsera zamienia wiersze na rekordy Command
+  i umieszcza je w ograniczonej kolejce cyklicznej z jednym producentem
+  i jednym konsumentem, a wątek wywołujący wykonuje je na stosie sesji
+  w kolejności wierszy. Kolejka nie używa blokad, dopóki żadna ze stron nie
+  musi czekać; wyniki i błędy są identyczne jak przy ParseInput.
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef POLYNOMIALS_PIPELINE_H
+#define POLYNOMIALS_PIPELINE_H
+
+#include "parser.h"
+
+/** Liczba miejsc w kolejce wczytanych poleceń (potęga dwójki). */
+#define PIPELINE_RING_SIZE 1024
+
+/** Liczba sprawdzeń kolejki przed uśpieniem czekającego wątku. */
+#define PIPELINE_SPINS 256
+
+/**
+ * Wczytuje polecenia ze źródła @p reader i wykonuje je w sesji @p c jak
+ * ParseInput, ale wczytuje je w osobnym wątku, współbieżnie z wykonywaniem
+ * wcześniejszych poleceń. Statystyki czasu obejmują tylko wykonanie poleceń.
+ * @param[in,out] c : sesja kalkulatora
+ * @param[in,out] reader : źródło znaków
+ */
+void PipelineInput(Calculator *c, Reader *reader);
+
+#endif //POLYNOMIALS_PIPELINE_H
@@ -6,9 +6,20 @@
   @date 2021
 */
 
+#include "geobucket.h"
+#include "modular.h"
+#include "parallel.h"
 #include "poly.h"
+#include "reclaimer.h"
+#include "work_stack.h"
+#include <stdlib.h>
 #include <string.h>
 
+// wykładnik wielomianu zapisanego bez tablicy jednomianów musi zmieścić się we wskaźniku
+_Static_assert(sizeof(uintptr_t) > sizeof(poly_exp_t), "exponent does not fit in a tagged pointer");
+// znaczniki POLY_COMPACT_TAG i POLY_NEG_TAG zajmują bity 1 i 2 wskaźnika na tablicę jednomianów
+_Static_assert(_Alignof(Mono) >= 8, "monos are not aligned enough for pointer tags");
+
 /**
  * Funkcja pomocnicza do obliczania większej z dwóch liczb
  * @param x : pierwsza liczba
@@ -19,6 +30,35 @@ static int max(int x, int y) {
     return (x > y) ? x : y;
 }
 
+/**
+ * Alokuje wyzerowaną tablicę jednomianów. Małe tablice pochodzą z puli.
+ * @param[in] count : długość tablicy
+ * @return wskaźnik na tablicę
+ */
+static inline Mono *MonosAlloc(size_t count) {
+    return (Mono*) MemoryPoolCalloc(count * sizeof(Mono), MEMORY_MONOS);
+}
+
+/**
+ * Zmienia długość tablicy jednomianów.
+ * @param[in] monos : tablica jednomianów
+ * @param[in] old_count : dotychczasowa długość tablicy
+ * @param[in] new_count : nowa długość tablicy
+ * @return wskaźnik na tablicę
+ */
+static inline Mono *MonosRealloc(Mono *monos, size_t old_count, size_t new_count) {
+    return (Mono*) MemoryPoolRealloc(monos, old_count * sizeof(Mono), new_count * sizeof(Mono), MEMORY_MONOS);
+}
+
+/**
+ * Zwalnia tablicę jednomianów, nie usuwając samych jednomianów.
+ * @param[in] monos : tablica jednomianów
+ * @param[in] count : długość tablicy
+ */
+static inline void MonosFree(Mono *monos, size_t count) {
+    MemoryPoolFree(monos, count * sizeof(Mono), MEMORY_MONOS);
+}
+
 /**
  * Dodaje dwa wielomiany stałe
  * @param[in] p_coeff : współczynnik w wielomianie stałym @f$p@f$
@@ -93,17 +133,17 @@ static Poly PolyPowerHelper(Poly *q, Poly *p, poly_exp_t n) {
     else {
         Poly square = PolyMul(p, p);
         if (n % 2 == 0) {
-            PolyDestroy(p);
+            PolyReclaim(p);
             Poly res = PolyPowerHelper(q, &square, n / 2);
-            PolyDestroy(&square);
+            PolyReclaim(&square);
             return res;
         }
         else {
             Poly mul = PolyMul(p, q);
-            PolyDestroy(p);
-            PolyDestroy(q);
+            PolyReclaim(p);
+            PolyReclaim(q);
             Poly res = PolyPowerHelper(&mul, &square, n / 2);
-            PolyDestroy(&square);
+            PolyReclaim(&square);
             return res;
         }
     }
@@ -114,7 +154,7 @@ Poly PolyPower(const Poly *p, poly_exp_t n) {
     Poly one = PolyFromCoeff(1);
     Poly copy = PolyClone(p);
     Poly res = PolyPowerHelper(&one, &copy, n);
-    PolyDestroy(&copy);
+    PolyReclaim(&copy);
     return res;
 }
 
@@ -123,8 +163,7 @@ Poly PolyPower(const Poly *p, poly_exp_t n) {
 Poly PolyAlloc(size_t size) {
     Poly p;
     p.size = size;
-    p.arr = (Mono*)calloc(size, sizeof(Mono));
-    CheckPtr(p.arr);
+    p.arr = MonosAlloc(size);
     return p;
 }
 
@@ -137,55 +176,409 @@ void PolyRealloc(Poly *p, size_t size) {
     if (size == 0)
         PolyDestroy(p);
     else {
+        p->arr = MonosRealloc(p->arr, PolyGetSize(p), size);
         p->size = size;
-        p->arr = (Mono* )realloc(p->arr, size * sizeof(Mono));
-        CheckPtr(p->arr);
     }
 }
 
+/**
+ * Jeżeli wielomian z tablicą jednomianów składa się z jednego jednomianu
+ * o stałym współczynniku, to zwalnia tablicę i zapisuje go bez niej, a jeżeli
+ * ten jednomian ma wykładnik 0, to zapisuje go jako wielomian stały.
+ * Przejmuje na własność wielomian @p p.
+ * @param[in] p : wielomian
+ * @return wielomian równy @p p
+ */
+static Poly PolyPack(Poly p) {
+    if (PolyIsCoeff(&p) || PolyIsInline(&p) || p.size != 1 || !PolyIsCoeff(&p.arr[0].p))
+        return p;
+
+    Poly packed;
+    if (MonoGetExp(&p.arr[0]) == 0)
+        packed = PolyFromCoeff(p.arr[0].p.coeff);
+    else
+        packed = PolyInline(p.arr[0].p.coeff, MonoGetExp(&p.arr[0]));
+    MonosFree(p.arr, 1);
+    return packed;
+}
+
+/**
+ * Sprawdza, czy wielomian ma tablicę jednomianów, czyli czy przejście po nim
+ * musi zejść do współczynników jego jednomianów.
+ * @param[in] p : wielomian
+ * @return Czy wielomian ma tablicę jednomianów?
+ */
+static inline bool PolyHasArr(const Poly *p) {
+    return !PolyIsCoeff(p) && !PolyIsInline(p);
+}
+
+/** Ramka przejścia po wielomianie z tablicą jednomianów. */
+typedef struct PolyFrame {
+    const Poly *p; ///< wielomian
+    size_t i; ///< indeks kolejnego jednomianu do odwiedzenia
+} PolyFrame;
+
+/**
+ * Daje początek zwartego bloku wielomianu skompaktowanego. Pierwszy jednomian
+ * bloku jest nagłówkiem, w którym pole `p.size` przechowuje liczbę
+ * jednomianów w bloku (bez nagłówka).
+ * @param[in] p : wielomian skompaktowany
+ * @return wskaźnik na nagłówek bloku
+ */
+static inline Mono *PolyCompactBlock(const Poly *p) {
+    return PolyMonos(p) - 1;
+}
+
+/**
+ * Zwalnia zwarty blok wielomianu skompaktowanego.
+ * @param[in] block : nagłówek bloku
+ */
+static void CompactBlockFree(Mono *block) {
+    MemoryFree(block, (block->p.size + 1) * sizeof(Mono), MEMORY_MONOS);
+}
+
 void PolyDestroy(Poly *p) {
     assert(p != NULL);
-    if (!PolyIsCoeff(p)) {
-        for (size_t i = 0; i < PolyGetSize(p); ++i)
-            MonoDestroy(&p->arr[i]);
-        free(p->arr);
-        p->arr = NULL;
-        p->coeff = 0;
+    if (PolyIsCoeff(p))
+        return;
+
+    if (PolyIsCompact(p)) {
+        // wszystkie tablice jednomianów leżą w jednym bloku
+        CompactBlockFree(PolyCompactBlock(p));
+    }
+    else if (!PolyIsInline(p)) {
+        PolyFrame local[WORK_STACK_LOCAL_SIZE];
+        WorkStack ws = InitWorkStack(local, WORK_STACK_LOCAL_SIZE, sizeof(PolyFrame));
+        *(PolyFrame*) WorkStackPush(&ws) = (PolyFrame) {.p = p, .i = 0};
+
+        while (!WorkStackIsEmpty(&ws)) {
+            PolyFrame *top = (PolyFrame*) WorkStackTop(&ws);
+            if (top->i < PolyGetSize(top->p)) {
+                const Poly *child = &PolyMonos(top->p)[top->i++].p;
+                if (PolyIsCompact(child))
+                    CompactBlockFree(PolyCompactBlock(child));
+                else if (PolyHasArr(child))
+                    *(PolyFrame*) WorkStackPush(&ws) = (PolyFrame) {.p = child, .i = 0};
+            }
+            else {
+                // wszystkie współczynniki są już usunięte
+                MonosFree(PolyMonos(top->p), PolyGetSize(top->p));
+                WorkStackPop(&ws);
+            }
+        }
+        WorkStackClear(&ws);
+    }
+
+    p->arr = NULL;
+    p->coeff = 0;
+}
+
+/**
+ * Ramka przejścia kopiującego wielomian. Kopiowany wielomian jest widokiem
+ * z uwzględnionym znakiem, więc kopia nie ma znaczników POLY_NEG_TAG.
+ */
+typedef struct CloneFrame {
+    Poly src; ///< kopiowany wielomian
+    Poly *dst; ///< kopia z zaalokowaną tablicą jednomianów
+    size_t i; ///< indeks kolejnego jednomianu do skopiowania
+} CloneFrame;
+
+/**
+ * Kopiuje wielomian skompaktowany jednym kopiowaniem bloku, przesuwając
+ * wskaźniki na tablice jednomianów do nowego bloku.
+ * @param[in] p : wielomian skompaktowany
+ * @return skompaktowana kopia wielomianu
+ */
+static Poly PolyCloneCompact(const Poly *p) {
+    Mono *block = PolyCompactBlock(p);
+    size_t total = block->p.size;
+    Mono *copy = (Mono*) MemoryAlloc((total + 1) * sizeof(Mono), MEMORY_MONOS);
+    memcpy(copy, block, (total + 1) * sizeof(Mono));
+
+    for (size_t i = 1; i <= total; ++i) {
+        Poly *coeff = &copy[i].p;
+        if (PolyHasArr(coeff))
+            coeff->arr = copy + (coeff->arr - block);
     }
+
+    uintptr_t tags = (uintptr_t) p->arr & (POLY_COMPACT_TAG | POLY_NEG_TAG);
+    return (Poly) {.size = p->size, .arr = (Mono*) ((uintptr_t) (copy + 1) | tags)};
 }
 
 Poly PolyClone(const Poly *p) {
     assert(p != NULL);
-    if (PolyIsCoeff(p))
+    if (!PolyHasArr(p))
         return *p;
+    if (PolyIsCompact(p))
+        return PolyCloneCompact(p);
 
     Poly copy = PolyAlloc(PolyGetSize(p));
-    for (size_t i = 0; i < PolyGetSize(&copy); ++i)
-        copy.arr[i] = MonoClone(&p->arr[i]);
+    CloneFrame local[WORK_STACK_LOCAL_SIZE];
+    WorkStack ws = InitWorkStack(local, WORK_STACK_LOCAL_SIZE, sizeof(CloneFrame));
+    *(CloneFrame*) WorkStackPush(&ws) = (CloneFrame) {.src = *p, .dst = &copy, .i = 0};
+
+    while (!WorkStackIsEmpty(&ws)) {
+        CloneFrame *top = (CloneFrame*) WorkStackTop(&ws);
+        if (top->i == PolyGetSize(&top->src)) {
+            WorkStackPop(&ws);
+            continue;
+        }
 
+        Mono m = PolyGetMono(&top->src, top->i);
+        Mono *copied = &top->dst->arr[top->i++];
+        copied->exp = m.exp;
+        if (PolyHasArr(&m.p)) {
+            copied->p = PolyAlloc(PolyGetSize(&m.p));
+            *(CloneFrame*) WorkStackPush(&ws) = (CloneFrame) {.src = m.p, .dst = &copied->p, .i = 0};
+        }
+        else {
+            copied->p = m.p;
+        }
+    }
+
+    WorkStackClear(&ws);
+    return copy;
+}
+
+/**
+ * Liczy jednomiany we wszystkich tablicach jednomianów wielomianu, przerywając
+ * liczenie po osiągnięciu @p limit.
+ * @param[in] p : wielomian z tablicą jednomianów
+ * @param[in] limit : liczba jednomianów, po której liczenie jest przerywane
+ * @return łączna długość tablic jednomianów, jeżeli jest mniejsza niż
+ * @p limit, wpp. liczba nie mniejsza niż @p limit
+ */
+static size_t PolyCountMonosHelper(const Poly *p, size_t limit) {
+    PolyFrame local[WORK_STACK_LOCAL_SIZE];
+    WorkStack ws = InitWorkStack(local, WORK_STACK_LOCAL_SIZE, sizeof(PolyFrame));
+    *(PolyFrame*) WorkStackPush(&ws) = (PolyFrame) {.p = p, .i = 0};
+    size_t total = PolyGetSize(p);
+
+    while (!WorkStackIsEmpty(&ws) && total < limit) {
+        PolyFrame *top = (PolyFrame*) WorkStackTop(&ws);
+        if (top->i == PolyGetSize(top->p)) {
+            WorkStackPop(&ws);
+            continue;
+        }
+
+        const Poly *coeff = &PolyMonos(top->p)[top->i++].p;
+        if (PolyHasArr(coeff)) {
+            total += PolyGetSize(coeff);
+            *(PolyFrame*) WorkStackPush(&ws) = (PolyFrame) {.p = coeff, .i = 0};
+        }
+    }
+
+    WorkStackClear(&ws);
+    return total;
+}
+
+size_t PolyCountMonos(const Poly *p, size_t limit) {
+    assert(p != NULL);
+    if (!PolyHasArr(p))
+        return PolyIsInline(p) ? 1 : 0;
+    if (PolyIsCompact(p))
+        return PolyCompactBlock(p)->p.size;
+    return PolyCountMonosHelper(p, limit);
+}
+
+bool PolyHasMonos(const Poly *p, size_t count) {
+    return PolyCountMonos(p, count) >= count;
+}
+
+Poly PolyCompact(const Poly *p) {
+    assert(p != NULL);
+    if (!PolyHasArr(p))
+        return *p;
+    if (PolyIsCompact(p))
+        return PolyCloneCompact(p);
+
+    size_t total = PolyCountMonosHelper(p, SIZE_MAX);
+    Mono *block = (Mono*) MemoryAlloc((total + 1) * sizeof(Mono), MEMORY_MONOS);
+    block[0] = (Mono) {.p = {.size = total, .arr = NULL}, .exp = 0};
+    // kolejne tablice jednomianów przydzielamy z bloku w kolejności przejścia w głąb
+    Mono *next = block + 1;
+
+    Poly copy = {.size = PolyGetSize(p), .arr = next};
+    next += PolyGetSize(p);
+    CloneFrame local[WORK_STACK_LOCAL_SIZE];
+    WorkStack ws = InitWorkStack(local, WORK_STACK_LOCAL_SIZE, sizeof(CloneFrame));
+    *(CloneFrame*) WorkStackPush(&ws) = (CloneFrame) {.src = *p, .dst = &copy, .i = 0};
+
+    while (!WorkStackIsEmpty(&ws)) {
+        CloneFrame *top = (CloneFrame*) WorkStackTop(&ws);
+        if (top->i == PolyGetSize(&top->src)) {
+            WorkStackPop(&ws);
+            continue;
+        }
+
+        Mono m = PolyGetMono(&top->src, top->i);
+        Mono *copied = &top->dst->arr[top->i++];
+        copied->exp = m.exp;
+        if (PolyHasArr(&m.p)) {
+            copied->p = (Poly) {.size = PolyGetSize(&m.p), .arr = next};
+            next += PolyGetSize(&m.p);
+            *(CloneFrame*) WorkStackPush(&ws) = (CloneFrame) {.src = m.p, .dst = &copied->p, .i = 0};
+        }
+        else {
+            copied->p = m.p;
+        }
+    }
+
+    WorkStackClear(&ws);
+    copy.arr = (Mono*) ((uintptr_t) copy.arr | POLY_COMPACT_TAG);
     return copy;
 }
 
 bool MonoIsCoeff(const Mono *m, poly_coeff_t *coeff) {
     assert(m != NULL);
-    if (m->exp == 0 && PolyIsCoeff(&m->p)) {
-        *coeff = m->p.coeff;
-        return true;
+    Mono cur = *m;
+    // schodzimy w głąb, dopóki jednomian ma zerowy wykładnik i jeden jednomian we współczynniku
+    while (true) {
+        if (cur.exp == 0 && PolyIsCoeff(&cur.p)) {
+            *coeff = cur.p.coeff;
+            return true;
+        }
+        else if (cur.exp != 0 || (!PolyIsCoeff(&cur.p) && PolyGetSize(&cur.p) > 1))
+            return false;
+        cur = PolyGetMono(&cur.p, 0);
     }
-    else if (m->exp != 0 || (!PolyIsCoeff(&m->p) && m->p.size > 1))
-        return false;
-    else
-        return MonoIsCoeff(&m->p.arr[0], coeff);
 }
 
 /**
  * Pomocnicza funkcja do sortowania jednomianow
  * @param a : wskaźnik do pierwszego jednomianu
  * @param b : wskaźnik do drugiego jednomianu
- * @return różnica wykładników jednomianów
+ * @return liczba ujemna, zero lub dodatnia, gdy wykładnik pierwszego
+ * jednomianu jest mniejszy, równy lub większy od wykładnika drugiego
  */
 static int CompareMonosByExp(const void *a, const void *b) {
-    return ((const Mono*)a)->exp - ((const Mono*)b)->exp;
+    // różnica wykładników mogłaby przekroczyć zakres int
+    poly_exp_t a_exp = ((const Mono*)a)->exp, b_exp = ((const Mono*)b)->exp;
+    return (a_exp > b_exp) - (a_exp < b_exp);
+}
+
+/** Średnia długość posortowanej serii, od której tablica jest sortowana scalaniem serii. */
+#define MONOS_SORT_RUN 16
+
+/** Długość tablicy, od której jest ona sortowana pozycyjnie zamiast funkcją qsort. */
+#define MONOS_RADIX_MIN 256
+
+/** Liczba bitów wykładnika sortowanych w jednym przebiegu sortowania pozycyjnego. */
+#define MONOS_RADIX_BITS 8
+
+/**
+ * Scala sąsiednie posortowane serie jednomianów, aż zostanie jedna.
+ * @param[in,out] monos : tablica jednomianów
+ * @param[in] count : długość tablicy
+ * @param[in,out] bounds : początki serii i na końcu @p count, razem @p runs + 1 liczb
+ * @param[in] runs : liczba serii
+ */
+static void MergeMonoRuns(Mono *monos, size_t count, size_t bounds[], size_t runs) {
+    Mono *tmp = (Mono*) MemoryAlloc(count * sizeof(Mono), MEMORY_WORK);
+    Mono *src = monos, *dst = tmp;
+
+    while (runs > 1) {
+        size_t merged = 0;
+        for (size_t r = 0; r < runs; r += 2) {
+            size_t lo = bounds[r], mid = bounds[(r + 1 < runs) ? r + 1 : runs], hi = bounds[(r + 2 < runs) ? r + 2 : runs];
+            size_t i = lo, j = mid, k = lo;
+            while (i < mid && j < hi)
+                dst[k++] = (src[j].exp < src[i].exp) ? src[j++] : src[i++];
+            memcpy(dst + k, src + i, (mid - i) * sizeof(Mono));
+            k += mid - i;
+            memcpy(dst + k, src + j, (hi - j) * sizeof(Mono));
+            bounds[merged++] = lo;
+        }
+        bounds[merged] = count;
+        runs = merged;
+        Mono *swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != monos)
+        memcpy(monos, src, count * sizeof(Mono));
+    MemoryFree(tmp, count * sizeof(Mono), MEMORY_WORK);
+}
+
+/**
+ * Sortuje jednomiany pozycyjnie (LSD) po kolejnych MONOS_RADIX_BITS bitach
+ * wykładnika, pomijając przebiegi, w których wszystkie jednomiany mają
+ * tę samą cyfrę (zwykle starsze bajty małych wykładników).
+ * @param[in,out] monos : tablica jednomianów
+ * @param[in] count : długość tablicy
+ */
+static void RadixSortMonos(Mono *monos, size_t count) {
+    Mono *tmp = (Mono*) MemoryAlloc(count * sizeof(Mono), MEMORY_WORK);
+    Mono *src = monos, *dst = tmp;
+    size_t buckets = (size_t) 1 << MONOS_RADIX_BITS;
+
+    for (unsigned shift = 0; shift < 32; shift += MONOS_RADIX_BITS) {
+        size_t counts[(size_t) 1 << MONOS_RADIX_BITS] = {0};
+        for (size_t i = 0; i < count; ++i) {
+            // odwrócenie bitu znaku porządkuje także ujemne wykładniki
+            uint32_t key = (uint32_t) src[i].exp ^ UINT32_C(0x80000000);
+            counts[(key >> shift) & (buckets - 1)]++;
+        }
+        uint32_t first = (uint32_t) src[0].exp ^ UINT32_C(0x80000000);
+        if (counts[(first >> shift) & (buckets - 1)] == count)
+            continue;
+
+        size_t offset = 0;
+        for (size_t b = 0; b < buckets; ++b) {
+            size_t c = counts[b];
+            counts[b] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t key = (uint32_t) src[i].exp ^ UINT32_C(0x80000000);
+            dst[counts[(key >> shift) & (buckets - 1)]++] = src[i];
+        }
+        Mono *swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != monos)
+        memcpy(monos, src, count * sizeof(Mono));
+    MemoryFree(tmp, count * sizeof(Mono), MEMORY_WORK);
+}
+
+/**
+ * Sortuje jednomiany niemalejąco według wykładników. Jedno przejście liczy
+ * posortowane serie: tablica posortowana zostaje bez zmian, tablica złożona
+ * z niewielu długich serii (na przykład iloczyny kolejnych jednomianów
+ * czynnika) jest sortowana scalaniem serii, duża tablica – pozycyjnie,
+ * a mała – funkcją qsort.
+ * @param[in,out] monos : tablica jednomianów
+ * @param[in] count : długość tablicy
+ */
+static void SortMonos(Mono *monos, size_t count) {
+    size_t runs = 1;
+    for (size_t i = 1; i < count; ++i)
+        runs += monos[i].exp < monos[i - 1].exp;
+
+    if (runs == 1)
+        return;
+
+    if (runs * MONOS_SORT_RUN <= count) {
+        size_t *bounds = (size_t*) MemoryAlloc((runs + 1) * sizeof(size_t), MEMORY_WORK);
+        size_t r = 0;
+        bounds[r++] = 0;
+        for (size_t i = 1; i < count; ++i) {
+            if (monos[i].exp < monos[i - 1].exp)
+                bounds[r++] = i;
+        }
+        bounds[r] = count;
+        MergeMonoRuns(monos, count, bounds, runs);
+        MemoryFree(bounds, (runs + 1) * sizeof(size_t), MEMORY_WORK);
+    }
+    else if (count >= MONOS_RADIX_MIN) {
+        RadixSortMonos(monos, count);
+    }
+    else {
+        qsort(monos, count, sizeof(Mono), CompareMonosByExp);
+    }
 }
 
 static Poly PolyAddPolyCoeff(const Poly *p, poly_coeff_t q_coeff) {
@@ -195,14 +588,18 @@ static Poly PolyAddPolyCoeff(const Poly *p, poly_coeff_t q_coeff) {
 
     if (PolyIsCoeff(p))
         return PolyCoeffAddPolyCoeff(p->coeff, q_coeff);
-    else if (MonoGetExp(&p->arr[0]) == 0) {
-        Poly added = PolyAddPolyCoeff(&p->arr[0].p, q_coeff);
+
+    Mono first = PolyGetMono(p, 0);
+    if (MonoGetExp(&first) == 0) {
+        Poly added = PolyAddPolyCoeff(&first.p, q_coeff);
         // jezeli po dodaniu otrzymujemy wielomian zerowy to zmniejszmay tablice jednomianow o 1 i przesuwamy pozostale jednomiany
         if (PolyIsZero(&added)) {
             Poly new_poly = PolyAlloc(PolyGetSize(p) - 1);
-            for (size_t i = 0; i < PolyGetSize(&new_poly); ++i)
-                new_poly.arr[i] = MonoClone(&p->arr[i + 1]);
-            return new_poly;
+            for (size_t i = 0; i < PolyGetSize(&new_poly); ++i) {
+                Mono m = PolyGetMono(p, i + 1);
+                new_poly.arr[i] = MonoClone(&m);
+            }
+            return PolyPack(new_poly);
         }
         // jezeli added jest wielomianem stalym i p sklada sie tylko z jednego jednomianu
         // to zwracamy added
@@ -212,9 +609,11 @@ static Poly PolyAddPolyCoeff(const Poly *p, poly_coeff_t q_coeff) {
         else {
             Poly new_poly = PolyAlloc(PolyGetSize(p));
             new_poly.arr[0].p = added;
-            for (size_t i = 1; i < PolyGetSize(&new_poly); ++i)
-                new_poly.arr[i] = MonoClone(&p->arr[i]);
-            return new_poly;
+            for (size_t i = 1; i < PolyGetSize(&new_poly); ++i) {
+                Mono m = PolyGetMono(p, i);
+                new_poly.arr[i] = MonoClone(&m);
+            }
+            return PolyPack(new_poly);
         }
     }
     // jezeli potega pierwszego jednomianu w p jest wieksza od 0
@@ -225,8 +624,10 @@ static Poly PolyAddPolyCoeff(const Poly *p, poly_coeff_t q_coeff) {
         Mono new_mono = MonoFromPoly(&q, 0);
         Poly new_poly = PolyAlloc(PolyGetSize(p) + 1);
         new_poly.arr[0] = new_mono;
-        for (size_t i = 0; i < PolyGetSize(p); ++i)
-            new_poly.arr[i + 1] = MonoClone(&p->arr[i]);
+        for (size_t i = 0; i < PolyGetSize(p); ++i) {
+            Mono m = PolyGetMono(p, i);
+            new_poly.arr[i + 1] = MonoClone(&m);
+        }
         return new_poly;
     }
 }
@@ -238,16 +639,21 @@ static Poly PolyAddPoly(const Poly *p, const Poly *q) {
     size_t real_size = 0;
 
     while (i < PolyGetSize(p) && j < PolyGetSize(q)) {
-        if (MonoGetExp(&p->arr[i]) < MonoGetExp(&q->arr[j]))
-            added.arr[real_size++] = MonoClone(&p->arr[i++]);
-        else if (MonoGetExp(&p->arr[i]) > MonoGetExp(&q->arr[j]))
-            added.arr[real_size++] = MonoClone(&q->arr[j++]);
+        Mono p_mono = PolyGetMono(p, i), q_mono = PolyGetMono(q, j);
+        if (MonoGetExp(&p_mono) < MonoGetExp(&q_mono)) {
+            added.arr[real_size++] = MonoClone(&p_mono);
+            i++;
+        }
+        else if (MonoGetExp(&p_mono) > MonoGetExp(&q_mono)) {
+            added.arr[real_size++] = MonoClone(&q_mono);
+            j++;
+        }
         // jezeli wykladniki sa rowne to musimy dodac wielomiany
         else {
-            Poly add_same_exp = PolyAdd(&p->arr[i].p, &q->arr[j].p);
+            Poly add_same_exp = PolyAdd(&p_mono.p, &q_mono.p);
             // jezeli wielomian po zsumowaniu jest niezerowy to go dodajemy
             if (!(PolyIsZero(&add_same_exp))) {
-                Mono m = MonoFromPoly(&add_same_exp, MonoGetExp(&p->arr[i]));
+                Mono m = MonoFromPoly(&add_same_exp, MonoGetExp(&p_mono));
                 added.arr[real_size++] = m;
             }
             i++; j++;
@@ -256,10 +662,12 @@ static Poly PolyAddPoly(const Poly *p, const Poly *q) {
     // po tym jak przejdziemy jeden caly wielomian to przepisujemy pozostale wartosci z drugiego wielomianu
     // co najmniej jedna z ponizszych petli się nie wykona
     while (i < PolyGetSize(p)) {
-        added.arr[real_size++] = MonoClone(&p->arr[i++]);
+        Mono m = PolyGetMono(p, i++);
+        added.arr[real_size++] = MonoClone(&m);
     }
     while (j < PolyGetSize(q)) {
-        added.arr[real_size++] = MonoClone(&q->arr[j++]);
+        Mono m = PolyGetMono(q, j++);
+        added.arr[real_size++] = MonoClone(&m);
     }
 
     // sprawdzamy czy utworzony wielomian nie jest tak naprawde jednomianem
@@ -270,7 +678,7 @@ static Poly PolyAddPoly(const Poly *p, const Poly *q) {
     }
 
     PolyRealloc(&added, real_size);
-    return added;
+    return PolyPack(added);
 }
 
 Poly PolyAdd(const Poly *p, const Poly *q) {
@@ -292,55 +700,55 @@ Poly PolyAdd(const Poly *p, const Poly *q) {
 Poly PolyAddMonosHelper(size_t count, Mono sorted_monos[]) {
     size_t real_size = 0;
 
-    for (size_t i = 0; i < count; ++i) {
-        // jezeli dlugosc dodanych jednomianow jest rowna 0
-        // lub obecny jednomian ma inny wykladnik (zawsze wiekszy) od ostatniego dodanego jednomianu
-        // to przestawiamy obecny jednomian w tablicy sorted_monos na indeks real_size
-        if (real_size == 0 || MonoGetExp(&sorted_monos[i]) != MonoGetExp(&sorted_monos[real_size - 1])) {
+    for (size_t i = 0; i < count;) {
+        poly_exp_t exp = MonoGetExp(&sorted_monos[i]);
+        size_t end = i + 1;
+        while (end < count && MonoGetExp(&sorted_monos[end]) == exp)
+            end++;
+
+        if (end == i + 1) {
+            // jednomian o jedynym takim wykładniku przestawiamy na indeks real_size
             sorted_monos[real_size++] = sorted_monos[i];
         }
         else {
-            // dodajemy 2 jednomiany o tym samym wykladniku
-            poly_exp_t exp = MonoGetExp(&sorted_monos[i]);
-            Poly sum = PolyAdd(&sorted_monos[real_size - 1].p, &sorted_monos[i].p);
-
-            MonoDestroy(&sorted_monos[i]);
-            MonoDestroy(&sorted_monos[real_size - 1]);
-
-            if (PolyIsZero(&sum)) {
-                real_size--;
+            // jednomiany o tym samym wykładniku sumujemy w geokubełku, żeby każdy
+            // kolejny składnik nie kopiował całej dotychczasowej sumy
+            Geobucket g = InitGeobucket();
+            for (size_t j = i; j < end; ++j)
+                GeobucketAdd(&g, &sorted_monos[j].p);
+            Poly sum = GeobucketSum(&g);
+
+            if (PolyIsZero(&sum))
                 PolyDestroy(&sum);
-            }
             else
-                sorted_monos[real_size - 1] = MonoFromPoly(&sum, exp);
+                sorted_monos[real_size++] = MonoFromPoly(&sum, exp);
         }
+        i = end;
     }
 
     poly_coeff_t coeff;
     if (real_size == 0) {
-        free(sorted_monos);
+        MonosFree(sorted_monos, count);
         sorted_monos = NULL;
         return PolyZero();
     }
     else if (real_size == 1 && MonoIsCoeff(&sorted_monos[0], &coeff)) {
-        free(sorted_monos);
+        MonosFree(sorted_monos, count);
         sorted_monos = NULL;
         return PolyFromCoeff(coeff);
     }
 
-    sorted_monos = (Mono*)realloc(sorted_monos, real_size * sizeof(Mono));
-    CheckPtr(sorted_monos);
-    return (Poly) {.arr = sorted_monos, .size = real_size};
+    sorted_monos = MonosRealloc(sorted_monos, count, real_size);
+    return PolyPack((Poly) {.arr = sorted_monos, .size = real_size});
 }
 
 Poly PolyAddMonos(size_t count, const Mono monos[]) {
     if (count == 0 || monos == NULL)
         return PolyZero();
 
-    Mono *sorted_monos = (Mono*) calloc(count, sizeof(Mono));
-    CheckPtr(sorted_monos);
+    Mono *sorted_monos = MonosAlloc(count);
     memcpy(sorted_monos, monos, count * sizeof(Mono));
-    qsort(sorted_monos, count, sizeof(Mono), CompareMonosByExp);
+    SortMonos(sorted_monos, count);
 
     return PolyAddMonosHelper(count, sorted_monos);
 }
@@ -349,7 +757,17 @@ Poly PolyOwnMonos(size_t count, Mono *monos) {
     if (count == 0 || monos == NULL)
         return PolyZero();
 
-    qsort(monos, count, sizeof(Mono), CompareMonosByExp);
+    // pamięć zaalokowana przez wywołującego od teraz należy do wielomianu
+    monos = (Mono*) MemoryPoolAdopt(monos, count * sizeof(Mono), MEMORY_MONOS);
+    SortMonos(monos, count);
+    return PolyAddMonosHelper(count, monos);
+}
+
+Poly PolyOwnSortedMonos(size_t count, Mono *monos) {
+    if (count == 0 || monos == NULL)
+        return PolyZero();
+    for (size_t i = 1; i < count; ++i)
+        assert(MonoGetExp(&monos[i - 1]) <= MonoGetExp(&monos[i]));
     return PolyAddMonosHelper(count, monos);
 }
 
@@ -357,46 +775,124 @@ Poly PolyCloneMonos(size_t count, const Mono monos[]) {
     if (count == 0 || monos == NULL)
         return PolyZero();
 
-    Mono *sorted_monos = (Mono*) calloc(count, sizeof(Mono));
+    Mono *sorted_monos = MonosAlloc(count);
     for (size_t i = 0; i < count; ++i) {
         sorted_monos[i] = MonoClone(&monos[i]);
     }
-    qsort(sorted_monos, count, sizeof(Mono), CompareMonosByExp);
+    SortMonos(sorted_monos, count);
     return PolyAddMonosHelper(count, sorted_monos);
 }
 
+/**
+ * Porównuje dwa wielomiany bez schodzenia do współczynników ich jednomianów.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return 1, jeżeli @f$p = q@f$, 0, jeżeli @f$p \neq q@f$, -1, jeżeli
+ * o równości decydują współczynniki jednomianów
+ */
+static int PolyIsEqShallow(const Poly *p, const Poly *q) {
+    if (PolyIsCoeff(p) && PolyIsCoeff(q)) return p->coeff == q->coeff;
+    if (PolyIsCoeff(q) || PolyIsCoeff(p)) return 0;
+    // jednomiany zapisane bez tablicy są równe, gdy mają równe współczynniki i wykładniki
+    if (PolyIsInline(p) && PolyIsInline(q)) return p->coeff == q->coeff && p->arr == q->arr;
+    if (PolyGetSize(p) != PolyGetSize(q)) return 0;
+    return -1;
+}
+
+/**
+ * Ramka przejścia porównującego dwa wielomiany. Wielomiany są widokami
+ * z uwzględnionym znakiem.
+ */
+typedef struct IsEqFrame {
+    Poly p; ///< wielomian @f$p@f$
+    Poly q; ///< wielomian @f$q@f$ tej samej długości co @f$p@f$
+    size_t i; ///< indeks kolejnej pary jednomianów do porównania
+} IsEqFrame;
+
 bool PolyIsEq(const Poly *p, const Poly *q) {
     assert(p != NULL && q != NULL);
-    if (PolyIsCoeff(p) && PolyIsCoeff(q)) return p->coeff == q->coeff;
-    if (PolyIsCoeff(q) || PolyIsCoeff(p)) return false;
-    if (p->size != q->size) return false;
+    int shallow = PolyIsEqShallow(p, q);
+    if (shallow >= 0)
+        return shallow;
 
+    IsEqFrame local[WORK_STACK_LOCAL_SIZE];
+    WorkStack ws = InitWorkStack(local, WORK_STACK_LOCAL_SIZE, sizeof(IsEqFrame));
+    *(IsEqFrame*) WorkStackPush(&ws) = (IsEqFrame) {.p = *p, .q = *q, .i = 0};
     bool eq = true;
-    for (size_t i = 0; i < PolyGetSize(p); ++i) {
-        if (MonoGetExp(&p->arr[i]) != MonoGetExp(&q->arr[i]))
-            return false;
-        eq &= PolyIsEq(&p->arr[i].p, &q->arr[i].p);
+
+    while (eq && !WorkStackIsEmpty(&ws)) {
+        IsEqFrame *top = (IsEqFrame*) WorkStackTop(&ws);
+        if (top->i == PolyGetSize(&top->p)) {
+            WorkStackPop(&ws);
+            continue;
+        }
+
+        size_t i = top->i++;
+        Mono p_mono = PolyGetMono(&top->p, i), q_mono = PolyGetMono(&top->q, i);
+        if (MonoGetExp(&p_mono) != MonoGetExp(&q_mono)) {
+            eq = false;
+            continue;
+        }
+
+        shallow = PolyIsEqShallow(&p_mono.p, &q_mono.p);
+        // współczynniki jednomianów wielomianu zapisanego bez tablicy są stałe,
+        // więc schodzimy niżej tylko w wielomianach z tablicami jednomianów
+        if (shallow < 0) {
+            IsEqFrame next = {.p = p_mono.p, .q = q_mono.p, .i = 0};
+            *(IsEqFrame*) WorkStackPush(&ws) = next;
+        }
+        else {
+            eq = shallow;
+        }
     }
 
+    WorkStackClear(&ws);
     return eq;
 }
 
+/** Ramka przejścia wyznaczającego stopień wielomianu. */
+typedef struct DegFrame {
+    const Poly *p; ///< wielomian z tablicą jednomianów
+    size_t i; ///< indeks kolejnego jednomianu do odwiedzenia
+    poly_exp_t deg_so_far; ///< suma wykładników na drodze do wielomianu @p p
+} DegFrame;
+
 /**
  * Funkcja pomocnicza do znajdowania stopnia wielomianu
- * przechodzi wielomian rekurencyjnie za każdym razem zwiekszając aktualny stopień
+ * przechodzi wielomian w głąb za każdym razem zwiekszając aktualny stopień
  * o wykładnik jednomianu
  * @param[in] p : wielomian
- * @param[in] deg_so_far : stopień wielomianu policzony do miejsca, w którym aktualnie jesteśmy
  * @return stopień wielomianu @p p
  */
-static poly_exp_t PolyDegHelper(const Poly *p, poly_exp_t deg_so_far) {
+static poly_exp_t PolyDegHelper(const Poly *p) {
     if (PolyIsCoeff(p))
-        return deg_so_far;
+        return 0;
+    if (PolyIsInline(p))
+        return PolyInlineExp(p);
 
+    DegFrame local[WORK_STACK_LOCAL_SIZE];
+    WorkStack ws = InitWorkStack(local, WORK_STACK_LOCAL_SIZE, sizeof(DegFrame));
+    *(DegFrame*) WorkStackPush(&ws) = (DegFrame) {.p = p, .i = 0, .deg_so_far = 0};
     poly_exp_t deg = 0;
-    for (size_t i = 0; i < PolyGetSize(p); ++i)
-        deg = max(deg, PolyDegHelper(&p->arr[i].p, deg_so_far + MonoGetExp(&p->arr[i])));
 
+    while (!WorkStackIsEmpty(&ws)) {
+        DegFrame *top = (DegFrame*) WorkStackTop(&ws);
+        if (top->i == PolyGetSize(top->p)) {
+            WorkStackPop(&ws);
+            continue;
+        }
+
+        const Mono *m = &PolyMonos(top->p)[top->i++];
+        poly_exp_t deg_so_far = top->deg_so_far + MonoGetExp(m);
+        if (PolyIsCoeff(&m->p))
+            deg = max(deg, deg_so_far);
+        else if (PolyIsInline(&m->p))
+            deg = max(deg, deg_so_far + PolyInlineExp(&m->p));
+        else
+            *(DegFrame*) WorkStackPush(&ws) = (DegFrame) {.p = &m->p, .i = 0, .deg_so_far = deg_so_far};
+    }
+
+    WorkStackClear(&ws);
     return deg;
 }
 
@@ -404,30 +900,51 @@ poly_exp_t PolyDeg(const Poly *p) {
     assert(p != NULL);
     if (PolyIsZero(p))
         return -1;
-    return PolyDegHelper(p, 0);
+    return PolyDegHelper(p);
 }
 
+/** Ramka przejścia wyznaczającego stopień wielomianu ze względu na zmienną. */
+typedef struct DegByFrame {
+    Poly p; ///< widok wielomianu niebędącego współczynnikiem
+    size_t i; ///< indeks kolejnego jednomianu do odwiedzenia
+    size_t index; ///< indeks zmiennej wielomianu @p p
+} DegByFrame;
+
 /**
- * Funkcja pomocnicza do znajdowania stopnia wielomianu ze względu na zadaną zmienną
+ * Funkcja pomocnicza do znajdowania stopnia wielomianu ze względu na zadaną zmienną,
+ * przechodzi bez rekurencji wielomiany zmiennych o indeksach nie większych niż @p var_idx
  * @param[in] p : wielomian
  * @param[in] var_idx : indeks zmiennej, dla której ma być obliczony stopień
- * @param[in] current_index : indeks zmiennej, w której aktualnie jesteśmy
  * @return stopień wielomianu @p p z względu na zmienną o indeksie @p var_idx
  */
-static poly_exp_t PolyDegByHelper(const Poly *p, size_t var_idx, size_t current_index) {
+static poly_exp_t PolyDegByHelper(const Poly *p, size_t var_idx) {
     assert(p != NULL);
     if (PolyIsCoeff(p))
         return 0;
 
+    DegByFrame local[WORK_STACK_LOCAL_SIZE];
+    WorkStack ws = InitWorkStack(local, WORK_STACK_LOCAL_SIZE, sizeof(DegByFrame));
+    *(DegByFrame*) WorkStackPush(&ws) = (DegByFrame) {.p = *p, .i = 0, .index = 0};
     poly_exp_t deg = 0;
 
-    for (size_t i = 0; i < PolyGetSize(p); ++i) {
-        if (current_index < var_idx)
-            deg = max(deg, PolyDegByHelper(&p->arr[i].p, var_idx, current_index + 1));
-        else if (current_index == var_idx)
-            deg = max(deg, MonoGetExp(&p->arr[i]));
+    while (!WorkStackIsEmpty(&ws)) {
+        DegByFrame *top = (DegByFrame*) WorkStackTop(&ws);
+        if (top->i == PolyGetSize(&top->p)) {
+            WorkStackPop(&ws);
+            continue;
+        }
+
+        Mono m = PolyGetMono(&top->p, top->i++);
+        if (top->index == var_idx)
+            deg = max(deg, MonoGetExp(&m));
+        else if (!PolyIsCoeff(&m.p)) {
+            // WorkStackPush może przenieść stos, więc indeks liczymy wcześniej
+            size_t child = top->index + 1;
+            *(DegByFrame*) WorkStackPush(&ws) = (DegByFrame) {.p = m.p, .i = 0, .index = child};
+        }
     }
 
+    WorkStackClear(&ws);
     return deg;
 }
 
@@ -435,39 +952,23 @@ poly_exp_t PolyDegBy(const Poly *p, size_t var_idx) {
     assert(p != NULL);
     if (PolyIsZero(p))
         return -1;
-    return PolyDegByHelper(p, var_idx, 0);
-}
-
-/**
- * Funkcja pomocnicza do obliczania wielomianu przeciwnego
- * przechodzi wielomian rekurencyjnie, jak dochodzi do wielomianu stałego to zmienia jego znak na przeciwny
- * @param[in, out] clone : wielomian
- */
-static void PolyNegHelper(Poly *clone) {
-    if (PolyIsCoeff(clone)) {
-        clone->coeff *= (-1);
-        return;
-    }
-
-    for (size_t i = 0; i < PolyGetSize(clone); ++i)
-        PolyNegHelper(&clone->arr[i].p);
+    return PolyDegByHelper(p, var_idx);
 }
 
 Poly PolyNeg(const Poly *p) {
     assert(p != NULL);
     if (PolyIsZero(p))
         return PolyZero();
-    Poly clone = PolyClone(p);
-    PolyNegHelper(&clone);
-    return clone;
+    // kopia widoku z odwróconym znakiem ma już zmienione znaki współczynników
+    Poly neg = PolyNegShallow(p);
+    return PolyClone(&neg);
 }
 
 Poly PolySub(const Poly *p, const Poly *q) {
     assert(p != NULL && q != NULL);
-    Poly neg_q = PolyNeg(q);
-    Poly result = PolyAdd(p, &neg_q);
-    PolyDestroy(&neg_q);
-    return result;
+    // znak jest uwzględniany przy odczycie jednomianów, więc wystarczy jedno dodawanie
+    Poly neg_q = PolyNegShallow(q);
+    return PolyAdd(p, &neg_q);
 }
 
 static Poly PolyMulPolyCoeff(const Poly *p, poly_coeff_t q_coeff) {
@@ -478,56 +979,419 @@ static Poly PolyMulPolyCoeff(const Poly *p, poly_coeff_t q_coeff) {
 
     if (PolyIsCoeff(p))
         return PolyFromCoeff(p->coeff * q_coeff);
+    if (PolyIsInline(p)) {
+        poly_coeff_t coeff = p->coeff * q_coeff;
+        return (coeff == 0) ? PolyZero() : PolyInline(coeff, PolyInlineExp(p));
+    }
 
     Poly new_poly = PolyAlloc(PolyGetSize(p));
     size_t real_size = 0;
 
+    // wielomian przeciwny mnożymy przez przeciwny współczynnik
+    if (PolyIsNeg(p))
+        q_coeff = -q_coeff;
+    const Mono *monos = PolyMonos(p);
     for (size_t i = 0; i < PolyGetSize(p); ++i) {
-        Poly multiplied = PolyMulPolyCoeff(&p->arr[i].p, q_coeff);
+        Poly multiplied = PolyMulPolyCoeff(&monos[i].p, q_coeff);
         // jezeli otrzymany wielomian jest zerem to pomijamy go
         if (!PolyIsZero(&multiplied))
-            new_poly.arr[real_size++] = MonoFromPoly(&multiplied, MonoGetExp(&p->arr[i]));
+            new_poly.arr[real_size++] = MonoFromPoly(&multiplied, MonoGetExp(&monos[i]));
     }
 
     PolyRealloc(&new_poly, real_size);
-    return new_poly;
+    return PolyPack(new_poly);
 }
 
-static Poly PolyMulPoly(const Poly *p, const Poly *q) {
-    Mono *monos = (Mono*)calloc(PolyGetSize(p) * PolyGetSize(q), sizeof(Mono));
+/**
+ * Zapisuje do tablicy niezerowe iloczyny par jednomianów dwóch wielomianów,
+ * które nie są wielomianami stałymi.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @param[out] monos : tablica na co najmniej |p| * |q| jednomianów
+ * @return liczba zapisanych jednomianów
+ */
+static size_t PolyMulMonos(const Poly *p, const Poly *q, Mono monos[]) {
     size_t real_size = 0;
 
     for (size_t i = 0; i < PolyGetSize(p); ++i) {
+        Mono p_mono = PolyGetMono(p, i);
         for (size_t j = 0; j < PolyGetSize(q); ++j) {
-            Poly multiplied = PolyMul(&p->arr[i].p, &q->arr[j].p);
+            Mono q_mono = PolyGetMono(q, j);
+            Poly multiplied = PolyMul(&p_mono.p, &q_mono.p);
             // jezeli otrzymany wielomian jest zerem to pomijamy go
             if (!PolyIsZero(&multiplied)) {
-                Mono m = MonoFromPoly(&multiplied, MonoGetExp(&p->arr[i]) + MonoGetExp(&q->arr[j]));
+                Mono m = MonoFromPoly(&multiplied, MonoGetExp(&p_mono) + MonoGetExp(&q_mono));
                 monos[real_size++] = m;
             }
         }
     }
+    return real_size;
+}
 
+/**
+ * Dodaje jednomiany z tablicy zaalokowanej na @p count jednomianów,
+ * z których zapisanych jest @p real_size, i zwalnia tablicę.
+ * @param[in] monos : tablica jednomianów przejmowanych na własność
+ * @param[in] count : rozmiar zaalokowanej tablicy
+ * @param[in] real_size : liczba jednomianów w tablicy
+ * @return suma jednomianów
+ */
+static Poly PolySumProductMonos(Mono *monos, size_t count, size_t real_size) {
     if (real_size == 0) {
-        free(monos);
+        MonosFree(monos, count);
         return PolyZero();
     }
 
-    monos = (Mono*)realloc(monos, real_size * sizeof(Mono));
-    CheckPtr(monos);
+    monos = MonosRealloc(monos, count, real_size);
     Poly result = PolyAddMonos(real_size, monos);
-    free(monos);
+    MonosFree(monos, real_size);
     return result;
 }
 
+static Poly PolyMulPoly(const Poly *p, const Poly *q) {
+    size_t count = PolyGetSize(p) * PolyGetSize(q);
+    Mono *monos = MonosAlloc(count);
+    size_t real_size = PolyMulMonos(p, q, monos);
+    return PolySumProductMonos(monos, count, real_size);
+}
+
 Poly PolyMul(const Poly *p, const Poly *q) {
     assert(p != NULL && q != NULL);
     if (PolyIsCoeff(p))
         return PolyMulPolyCoeff(q, p->coeff);
     else if (PolyIsCoeff(q))
         return PolyMulPolyCoeff(p, q->coeff);
+
+    Poly product;
+    if (PolyGetSize(p) >= NTT_MIN_TERMS && PolyGetSize(q) >= NTT_MIN_TERMS && PolyMulNtt(p, q, &product))
+        return product;
+    // PolyMulModular odmawia tylko, gdy wykładniki iloczynu nie mieszczą się w kluczu
+    if (ModularEnabled() &&
+        PolyCountMonos(p, MODULAR_MIN_PRODUCT) * PolyCountMonos(q, MODULAR_MIN_PRODUCT) >= MODULAR_MIN_PRODUCT &&
+        PolyMulModular(p, q, &product))
+        return product;
+    return PolyMulPoly(p, q);
+}
+
+Poly PolyMulAdd(const Poly *p, const Poly *q, const Poly *r) {
+    assert(p != NULL && q != NULL && r != NULL);
+    if (PolyIsCoeff(p) || PolyIsCoeff(q)) {
+        // iloczyn przez stałą nie sumuje jednomianów, więc nie ma czego łączyć z dodawaniem
+        Poly product = PolyMul(p, q);
+        Poly sum = PolyAdd(&product, r);
+        PolyDestroy(&product);
+        return sum;
+    }
+
+    size_t count = PolyGetSize(p) * PolyGetSize(q) + (PolyIsCoeff(r) ? 1 : PolyGetSize(r));
+    Mono *monos = MonosAlloc(count);
+    size_t real_size = PolyMulMonos(p, q, monos);
+    // jednomiany r są sumowane razem z iloczynami jednomianów p i q
+    if (PolyIsCoeff(r)) {
+        if (!PolyIsZero(r))
+            monos[real_size++] = MonoFromPoly(r, 0);
+    }
+    else {
+        for (size_t i = 0; i < PolyGetSize(r); ++i) {
+            Mono m = PolyGetMono(r, i);
+            Poly coeff = PolyClone(&m.p);
+            monos[real_size++] = MonoFromPoly(&coeff, MonoGetExp(&m));
+        }
+    }
+    return PolySumProductMonos(monos, count, real_size);
+}
+
+/** Liczba jednomianów składników, od której suma wielu wielomianów jest dzielona między wątki. */
+#define POLY_PARALLEL_MONOS 4096
+
+/** Iloczyn liczb jednomianów czynników, od którego mnożenie jest dzielone między wątki. */
+#define POLY_PARALLEL_PRODUCT 65536
+
+/** Kursor scalania: kolejny jednomian jednego z dodawanych wielomianów. */
+typedef struct MergeCursor {
+    poly_exp_t exp; ///< wykładnik jednomianu
+    size_t poly; ///< indeks wielomianu w tablicy dodawanych wielomianów
+    size_t i; ///< indeks jednomianu w wielomianie
+} MergeCursor;
+
+/**
+ * Przywraca własność kopca (najmniejszy wykładnik w korzeniu) dla poddrzewa
+ * o korzeniu w @p i.
+ * @param[in,out] heap : kopiec kursorów
+ * @param[in] size : liczba kursorów w kopcu
+ * @param[in] i : indeks korzenia poddrzewa
+ */
+static void MergeHeapDown(MergeCursor heap[], size_t size, size_t i) {
+    MergeCursor cur = heap[i];
+    while (2 * i + 1 < size) {
+        size_t child = 2 * i + 1;
+        if (child + 1 < size && heap[child + 1].exp < heap[child].exp)
+            child++;
+        if (cur.exp <= heap[child].exp)
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = cur;
+}
+
+/**
+ * Przesuwa kursor z korzenia kopca na kolejny jednomian jego wielomianu,
+ * a jeżeli wielomian się skończył, usuwa kursor z kopca.
+ * @param[in,out] heap : kopiec kursorów
+ * @param[in,out] size : liczba kursorów w kopcu
+ * @param[in] polys : dodawane wielomiany
+ */
+static void MergeHeapAdvance(MergeCursor heap[], size_t *size, const Poly polys[]) {
+    const Poly *p = &polys[heap[0].poly];
+    if (++heap[0].i < PolyGetSize(p))
+        heap[0].exp = MonoGetExp(&PolyMonos(p)[heap[0].i]);
     else
-        return PolyMulPoly(p, q);
+        heap[0] = heap[--(*size)];
+    MergeHeapDown(heap, *size, 0);
+}
+
+/**
+ * Dodaje wielomiany scalaniem wielu posortowanych tablic jednomianów.
+ * Wielomiany stałe są sumowane od razu, a ich suma jest traktowana jak
+ * jednomian o wykładniku 0. Współczynniki jednomianów o równych wykładnikach
+ * są sumowane rekurencyjnie tą samą funkcją.
+ * @param[in] count : liczba wielomianów
+ * @param[in] polys : tablica wielomianów
+ * @return suma wielomianów
+ */
+static Poly PolySumManyHelper(size_t count, const Poly polys[]) {
+    poly_coeff_t constant = 0;
+    size_t total = 0, arrays = 0;
+    for (size_t k = 0; k < count; ++k) {
+        if (PolyIsCoeff(&polys[k]))
+            constant += polys[k].coeff;
+        else {
+            total += PolyGetSize(&polys[k]);
+            arrays++;
+        }
+    }
+    if (arrays == 0)
+        return PolyFromCoeff(constant);
+
+    MergeCursor *heap = (MergeCursor*) MemoryAlloc(arrays * sizeof(MergeCursor), MEMORY_WORK);
+    Poly *group = (Poly*) MemoryAlloc((arrays + 1) * sizeof(Poly), MEMORY_WORK);
+    size_t heap_size = 0;
+    for (size_t k = 0; k < count; ++k) {
+        if (!PolyIsCoeff(&polys[k])) {
+            Mono first = PolyGetMono(&polys[k], 0);
+            heap[heap_size++] = (MergeCursor) {.exp = MonoGetExp(&first), .poly = k, .i = 0};
+        }
+    }
+    for (size_t k = heap_size / 2; k-- > 0;)
+        MergeHeapDown(heap, heap_size, k);
+
+    Mono *monos = MonosAlloc(total + 1);
+    size_t real_size = 0;
+    // suma wielomianów stałych jest jednomianem o wykładniku 0
+    if (constant != 0 && heap[0].exp > 0) {
+        monos[real_size++] = (Mono) {.p = PolyFromCoeff(constant), .exp = 0};
+        constant = 0;
+    }
+
+    while (heap_size > 0) {
+        poly_exp_t exp = heap[0].exp;
+        size_t group_size = 0;
+        if (constant != 0) {
+            group[group_size++] = PolyFromCoeff(constant);
+            constant = 0;
+        }
+        while (heap_size > 0 && heap[0].exp == exp) {
+            group[group_size++] = PolyGetMono(&polys[heap[0].poly], heap[0].i).p;
+            MergeHeapAdvance(heap, &heap_size, polys);
+        }
+
+        Poly sum = (group_size == 1) ? PolyClone(&group[0]) : PolySumManyHelper(group_size, group);
+        if (!PolyIsZero(&sum))
+            monos[real_size++] = MonoFromPoly(&sum, exp);
+    }
+
+    MemoryFree(heap, arrays * sizeof(MergeCursor), MEMORY_WORK);
+    MemoryFree(group, (arrays + 1) * sizeof(Poly), MEMORY_WORK);
+
+    poly_coeff_t coeff;
+    if (real_size == 0) {
+        MonosFree(monos, total + 1);
+        return PolyZero();
+    }
+    else if (real_size == 1 && MonoIsCoeff(&monos[0], &coeff)) {
+        MonoDestroy(&monos[0]);
+        MonosFree(monos, total + 1);
+        return PolyFromCoeff(coeff);
+    }
+
+    monos = MonosRealloc(monos, total + 1, real_size);
+    return PolyPack((Poly) {.size = real_size, .arr = monos});
+}
+
+/** Zadanie równoległego sumowania: suma jednego kawałka tablicy wielomianów. */
+typedef struct SumManyTask {
+    const Poly *polys; ///< dodawane wielomiany
+    size_t count; ///< liczba dodawanych wielomianów
+    size_t chunk; ///< liczba wielomianów w jednym kawałku
+    Poly *partial; ///< sumy kawałków
+} SumManyTask;
+
+/**
+ * Dodaje wielomiany z @p i-tego kawałka tablicy.
+ * @param[in,out] ctx : zadanie (SumManyTask)
+ * @param[in] i : indeks kawałka
+ */
+static void SumManyChunk(void *ctx, size_t i) {
+    SumManyTask *task = (SumManyTask*) ctx;
+    size_t begin = i * task->chunk;
+    size_t end = (begin + task->chunk < task->count) ? begin + task->chunk : task->count;
+    task->partial[i] = PolySumManyHelper(end - begin, task->polys + begin);
+}
+
+/**
+ * Sumuje liczby jednomianów wielomianów, przerywając po osiągnięciu @p limit.
+ * @param[in] count : liczba wielomianów
+ * @param[in] polys : tablica wielomianów
+ * @param[in] limit : liczba jednomianów, po której liczenie jest przerywane
+ * @return łączna liczba jednomianów lub liczba nie mniejsza niż @p limit
+ */
+static size_t PolysCountMonos(size_t count, const Poly polys[], size_t limit) {
+    size_t total = 0;
+    for (size_t k = 0; k < count && total < limit; ++k)
+        total += PolyCountMonos(&polys[k], limit - total);
+    return total;
+}
+
+Poly PolySumMany(size_t count, const Poly polys[]) {
+    assert(count == 0 || polys != NULL);
+    size_t threads = ParallelThreads();
+    if (threads > count / 2)
+        threads = count / 2;
+    if (threads <= 1 || PolysCountMonos(count, polys, POLY_PARALLEL_MONOS) < POLY_PARALLEL_MONOS)
+        return PolySumManyHelper(count, polys);
+
+    // każdy wątek scala swój kawałek tablicy, a na koniec scalamy sumy kawałków
+    size_t chunk = (count + threads - 1) / threads;
+    size_t chunks = (count + chunk - 1) / chunk;
+    Poly *partial = (Poly*) MemoryAlloc(chunks * sizeof(Poly), MEMORY_WORK);
+    SumManyTask task = {.polys = polys, .count = count, .chunk = chunk, .partial = partial};
+    ParallelRun(chunks, threads, SumManyChunk, &task);
+
+    Poly sum = PolySumManyHelper(chunks, partial);
+    for (size_t i = 0; i < chunks; ++i)
+        PolyReclaim(&partial[i]);
+    MemoryFree(partial, chunks * sizeof(Poly), MEMORY_WORK);
+    return sum;
+}
+
+/**
+ * Zadanie równoległego mnożenia: iloczyn kawałka tablicy jednomianów
+ * jednego czynnika przez drugi czynnik.
+ */
+typedef struct MulChunkTask {
+    const Poly *p; ///< czynnik dzielony na kawałki
+    const Poly *q; ///< drugi czynnik
+    size_t chunk; ///< liczba jednomianów w jednym kawałku
+    Poly *partial; ///< iloczyny kawałków
+} MulChunkTask;
+
+/**
+ * Mnoży @p i-ty kawałek tablicy jednomianów pierwszego czynnika przez drugi czynnik.
+ * @param[in,out] ctx : zadanie (MulChunkTask)
+ * @param[in] i : indeks kawałka
+ */
+static void MulChunk(void *ctx, size_t i) {
+    MulChunkTask *task = (MulChunkTask*) ctx;
+    size_t begin = i * task->chunk;
+    size_t size = PolyGetSize(task->p);
+    size_t end = (begin + task->chunk < size) ? begin + task->chunk : size;
+    // widok na kawałek tablicy jednomianów z zachowanym znakiem czynnika
+    uintptr_t neg = (uintptr_t) task->p->arr & POLY_NEG_TAG;
+    Poly part = {.size = end - begin, .arr = (Mono*) ((uintptr_t) (PolyMonos(task->p) + begin) | neg)};
+    task->partial[i] = PolyMul(&part, task->q);
+}
+
+/**
+ * Mnoży dwa wielomiany. Jeżeli mnożenie jest duże, dzieli tablicę jednomianów
+ * dłuższego czynnika na kawałki mnożone w osobnych wątkach, a iloczyny
+ * kawałków scala jak PolySumMany.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return @f$p * q@f$
+ */
+static Poly PolyMulParallel(const Poly *p, const Poly *q) {
+    size_t p_size = PolyHasArr(p) ? PolyGetSize(p) : 0, q_size = PolyHasArr(q) ? PolyGetSize(q) : 0;
+    if (p_size < q_size) {
+        const Poly *tmp = p;
+        p = q;
+        q = tmp;
+        p_size = q_size;
+    }
+
+    size_t threads = ParallelThreads();
+    if (threads > p_size)
+        threads = p_size;
+    // w trybie modularnym PolyMul sam dzieli duże mnożenie między wątki
+    if (threads <= 1 || PolyIsCoeff(q) || ModularEnabled() ||
+        PolyCountMonos(p, POLY_PARALLEL_PRODUCT) * PolyCountMonos(q, POLY_PARALLEL_PRODUCT) < POLY_PARALLEL_PRODUCT)
+        return PolyMul(p, q);
+
+    size_t chunk = (PolyGetSize(p) + threads - 1) / threads;
+    size_t chunks = (PolyGetSize(p) + chunk - 1) / chunk;
+    Poly *partial = (Poly*) MemoryAlloc(chunks * sizeof(Poly), MEMORY_WORK);
+    MulChunkTask task = {.p = p, .q = q, .chunk = chunk, .partial = partial};
+    ParallelRun(chunks, threads, MulChunk, &task);
+
+    Poly product = PolySumManyHelper(chunks, partial);
+    for (size_t i = 0; i < chunks; ++i)
+        PolyReclaim(&partial[i]);
+    MemoryFree(partial, chunks * sizeof(Poly), MEMORY_WORK);
+    return product;
+}
+
+/** Czynnik iloczynu wielu wielomianów. */
+typedef struct ProductFactor {
+    const Poly *p; ///< wielomian
+    size_t monos; ///< liczba jednomianów wielomianu
+} ProductFactor;
+
+/**
+ * Porównuje czynniki iloczynu według liczby jednomianów.
+ * @param[in] a : wskaźnik na pierwszy czynnik
+ * @param[in] b : wskaźnik na drugi czynnik
+ * @return wynik porównania liczb jednomianów czynników
+ */
+static int CompareFactorsByMonos(const void *a, const void *b) {
+    size_t x = ((const ProductFactor*) a)->monos, y = ((const ProductFactor*) b)->monos;
+    return (x > y) - (x < y);
+}
+
+Poly PolyProductMany(size_t count, const Poly polys[]) {
+    assert(count == 0 || polys != NULL);
+    if (count == 0)
+        return PolyFromCoeff(1);
+
+    ProductFactor *factors = (ProductFactor*) MemoryAlloc(count * sizeof(ProductFactor), MEMORY_WORK);
+    for (size_t k = 0; k < count; ++k) {
+        if (PolyIsZero(&polys[k])) {
+            MemoryFree(factors, count * sizeof(ProductFactor), MEMORY_WORK);
+            return PolyZero();
+        }
+        factors[k] = (ProductFactor) {.p = &polys[k], .monos = PolyCountMonos(&polys[k], SIZE_MAX)};
+    }
+    // iloczyn częściowy mnożymy przez coraz większe czynniki
+    qsort(factors, count, sizeof(ProductFactor), CompareFactorsByMonos);
+
+    Poly product = PolyClone(factors[0].p);
+    for (size_t k = 1; k < count; ++k) {
+        Poly next = PolyMulParallel(&product, factors[k].p);
+        PolyReclaim(&product);
+        product = next;
+    }
+
+    MemoryFree(factors, count * sizeof(ProductFactor), MEMORY_WORK);
+    return product;
 }
 
 
@@ -536,24 +1400,19 @@ Poly PolyAt(const Poly *p, poly_coeff_t x) {
     if (PolyIsCoeff(p))
         return PolyClone(p);
 
-    Poly result = PolyZero();
+    Geobucket result = InitGeobucket();
     for (size_t i = 0; i < PolyGetSize(p); ++i) {
+        Mono m = PolyGetMono(p, i);
         // obliczamy x_0 do potegi jaka przy nim stoi
-        poly_coeff_t value = Power(x, MonoGetExp(&p->arr[i]));
+        poly_coeff_t value = Power(x, MonoGetExp(&m));
 
         // mnozymy otrzymana wyzej wartosc przez wielomian z jednomianu, w ktorym jestesmy
-        Poly multiplied = PolyMulPolyCoeff(&p->arr[i].p, value);
+        Poly multiplied = PolyMulPolyCoeff(&m.p, value);
 
         // dodajemy otrzymana wartosc do dotychczasowego wyniku
-        Poly add = PolyAdd(&multiplied, &result);
-
-        PolyDestroy(&multiplied);
-        PolyDestroy(&result);
-
-        // aktualizujemy wynik
-        result = add;
+        GeobucketAdd(&result, &multiplied);
     }
-    return result;
+    return GeobucketSum(&result);
 }
 
 /**
@@ -569,31 +1428,26 @@ Poly PolyComposeHelper(const Poly *p, size_t next, size_t k, const Poly q[]) {
         return *p;
 
     Poly zero = PolyZero();
-    Poly res = PolyZero();
+    Geobucket res = InitGeobucket();
 
     for (size_t i = 0; i < PolyGetSize(p); ++i) {
+        Mono m = PolyGetMono(p, i);
         // jeżeli indeks next >= k to bierzemy wielomian zerowy
-        Poly pow = PolyPower((next < k) ? &q[next] : &zero, MonoGetExp(&p->arr[i]));
+        Poly pow = PolyPower((next < k) ? &q[next] : &zero, MonoGetExp(&m));
 
         // składamy wielomian "w środku"
-        Poly compose_inside = PolyComposeHelper(&p->arr[i].p, next + 1, k, q);
+        Poly compose_inside = PolyComposeHelper(&m.p, next + 1, k, q);
 
         // mnożymy złożenie wewnątrz z potęgą pow wielomianu, w którym aktulanie jesteśmy
         Poly cur_res = PolyMul(&pow, &compose_inside);
 
-        PolyDestroy(&compose_inside);
-        PolyDestroy(&pow);
+        PolyReclaim(&compose_inside);
+        PolyReclaim(&pow);
 
         // dodajemy do aktualnego wyniku
-        Poly add = PolyAdd(&cur_res, &res);
-
-        PolyDestroy(&res);
-        PolyDestroy(&cur_res);
-
-        // aktualizujemy wynik
-        res = add;
+        GeobucketAdd(&res, &cur_res);
     }
-    return res;
+    return GeobucketSum(&res);
 }
 
 Poly PolyCompose(const Poly *p, size_t k, const Poly q[]) {
@@ -12,8 +12,24 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include "memory_helper.h"
 
+/**
+ * Oznacza funkcję interfejsu biblioteki libpoly. Biblioteka jest kompilowana
+ * z ukrytą widocznością symboli, więc libpoly.so eksportuje tylko tak
+ * oznaczone funkcje, a nazwy wewnętrzne kalkulatora nie wchodzą do jej ABI.
+ */
+#if defined(__GNUC__)
+#define POLY_API __attribute__((visibility("default")))
+#else
+#define POLY_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /** To jest typ reprezentujący współczynniki. */
 typedef long poly_coeff_t;
 
@@ -22,10 +38,35 @@ typedef int poly_exp_t;
 
 struct Mono;
 
+/**
+ * Znacznik w najmłodszym bicie pola `arr` oznaczający wielomian będący jednym
+ * jednomianem o stałym współczynniku, zapisanym bez alokacji tablicy.
+ */
+#define POLY_INLINE_TAG ((uintptr_t) 1)
+
+/**
+ * Znacznik w bicie 1 pola `arr` oznaczający wielomian, którego wszystkie
+ * tablice jednomianów leżą w jednym ciągłym bloku (zobacz PolyCompact).
+ */
+#define POLY_COMPACT_TAG ((uintptr_t) 2)
+
+/**
+ * Znacznik w bicie 2 pola `arr` wielomianu z tablicą jednomianów oznaczający,
+ * że wartością wielomianu jest wartość przeciwna do zapisanej w tablicy.
+ */
+#define POLY_NEG_TAG ((uintptr_t) 4)
+
 /**
  * To jest struktura przechowująca wielomian.
  * Wielomian jest albo liczbą całkowitą, czyli wielomianem stałym
  * (wtedy `arr == NULL`), albo niepustą listą jednomianów (wtedy `arr != NULL`).
+ * Wielomian postaci @f$cx_i^n@f$, gdzie @f$c@f$ jest stałą, jest zapisywany
+ * bez tablicy jednomianów: `coeff` przechowuje @f$c@f$, a `arr` nie jest
+ * wskaźnikiem, tylko wykładnikiem @f$n@f$ przesuniętym o jeden bit
+ * ze znacznikiem POLY_INLINE_TAG. Wielomian po kompaktowaniu ma w `arr`
+ * znacznik POLY_COMPACT_TAG, a wielomian przeciwny do zapisanego w tablicy
+ * znacznik POLY_NEG_TAG. Do jednomianów wielomianu należy się więc
+ * odwoływać przez funkcje PolyGetMono i PolyMonos.
  */
 typedef struct Poly {
     /**
@@ -53,13 +94,117 @@ typedef struct Mono {
     poly_exp_t exp; ///< wykładnik
 } Mono;
 
+/**
+ * Sprawdza, czy wielomian jest jednomianem zapisanym bez tablicy jednomianów.
+ * @param[in] p : wielomian
+ * @return Czy wielomian jest zapisany bez tablicy jednomianów?
+ */
+static inline bool PolyIsInline(const Poly *p) {
+    return ((uintptr_t) p->arr & POLY_INLINE_TAG) != 0;
+}
+
+/**
+ * Tworzy wielomian @f$cx_i^n@f$ zapisany bez tablicy jednomianów.
+ * @param[in] c : współczynnik
+ * @param[in] n : wykładnik
+ * @return wielomian @f$cx_i^n@f$
+ */
+static inline Poly PolyInline(poly_coeff_t c, poly_exp_t n) {
+    Poly p;
+    p.coeff = c;
+    p.arr = (struct Mono*) (((uintptr_t) n << 1) | POLY_INLINE_TAG);
+    return p;
+}
+
+/**
+ * Daje wykładnik wielomianu zapisanego bez tablicy jednomianów.
+ * @param[in] p : wielomian
+ * @return wykładnik jedynego jednomianu wielomianu
+ */
+static inline poly_exp_t PolyInlineExp(const Poly *p) {
+    return (poly_exp_t) ((uintptr_t) p->arr >> 1);
+}
+
+/**
+ * Sprawdza, czy wielomian jest korzeniem zwartego bloku tablic jednomianów.
+ * @param[in] p : wielomian
+ * @return Czy wielomian został skompaktowany?
+ */
+static inline bool PolyIsCompact(const Poly *p) {
+    // w wielomianie zapisanym bez tablicy bit 1 jest częścią wykładnika
+    return ((uintptr_t) p->arr & (POLY_INLINE_TAG | POLY_COMPACT_TAG)) == POLY_COMPACT_TAG;
+}
+
+/**
+ * Sprawdza, czy wartością wielomianu jest wartość przeciwna do zapisanej
+ * w jego tablicy jednomianów.
+ * @param[in] p : wielomian
+ * @return Czy wielomian ma znacznik POLY_NEG_TAG?
+ */
+static inline bool PolyIsNeg(const Poly *p) {
+    // w wielomianie zapisanym bez tablicy bit 2 jest częścią wykładnika
+    return ((uintptr_t) p->arr & (POLY_INLINE_TAG | POLY_NEG_TAG)) == POLY_NEG_TAG;
+}
+
+/**
+ * Daje wielomian przeciwny do @p p w czasie stałym. Wielomian stały
+ * i zapisany bez tablicy mają zmieniony znak współczynnika, a wielomian
+ * z tablicą jednomianów dzieli ją z @p p i ma tylko odwrócony znacznik
+ * POLY_NEG_TAG. Wynik jest więc widokiem @p p, chyba że zastępuje @p p,
+ * przejmując jego tablicę.
+ * @param[in] p : wielomian
+ * @return wielomian @f$-p@f$
+ */
+static inline Poly PolyNegShallow(const Poly *p) {
+    Poly neg = *p;
+    if (p->arr == NULL || ((uintptr_t) p->arr & POLY_INLINE_TAG) != 0)
+        neg.coeff = -p->coeff;
+    else
+        neg.arr = (struct Mono*) ((uintptr_t) p->arr ^ POLY_NEG_TAG);
+    return neg;
+}
+
+/**
+ * Daje tablicę jednomianów wielomianu, który nie jest wielomianem stałym
+ * ani zapisanym bez tablicy jednomianów. Współczynniki w tablicy nie
+ * uwzględniają znacznika POLY_NEG_TAG wielomianu.
+ * @param[in] p : wielomian
+ * @return wskaźnik na tablicę jednomianów
+ */
+static inline struct Mono *PolyMonos(const Poly *p) {
+    return (struct Mono*) ((uintptr_t) p->arr & ~(POLY_COMPACT_TAG | POLY_NEG_TAG));
+}
+
 /**
  * Daje wartość liczby jednomianow w wielomianie.
  * @param[in] p : wielomian
  * @return wartość będąca liczbą jednomianów w wielomianie
  */
 static inline size_t PolyGetSize(const Poly *p) {
-    return p->size;
+    return PolyIsInline(p) ? 1 : p->size;
+}
+
+/**
+ * Daje @p i-ty jednomian wielomianu, który nie jest wielomianem stałym.
+ * Zwrócony jednomian jest widokiem: nie należy go usuwać ani modyfikować.
+ * Jego współczynnik uwzględnia znacznik POLY_NEG_TAG wielomianu.
+ * @param[in] p : wielomian
+ * @param[in] i : indeks jednomianu
+ * @return @p i-ty jednomian wielomianu
+ */
+static inline Mono PolyGetMono(const Poly *p, size_t i) {
+    assert(p->arr != NULL && i < PolyGetSize(p));
+    Mono m;
+    if (PolyIsInline(p)) {
+        m.p.coeff = p->coeff;
+        m.p.arr = NULL;
+        m.exp = PolyInlineExp(p);
+        return m;
+    }
+    m = PolyMonos(p)[i];
+    if (PolyIsNeg(p))
+        m.p = PolyNegShallow(&m.p);
+    return m;
 }
 
 /**
@@ -71,13 +216,35 @@ static inline poly_exp_t MonoGetExp(const Mono *m) {
   return m->exp;
 }
 
+/**
+ * Podnosi liczbę do potęgi modulo @f$2^{64}@f$ (szybkie potęgowanie).
+ * Arytmetyka bez znaku nie ma niezdefiniowanego przepełnienia, a wynik
+ * rzutowany na poly_coeff_t jest potęgą współczynnika w kodzie U2.
+ * @param[in] x : podstawa
+ * @param[in] exp : nieujemny wykładnik
+ * @return @f$x^{exp}@f$
+ */
+static inline uint64_t PolyCoeffPow(uint64_t x, poly_exp_t exp) {
+  uint64_t result = 1;
+  while (exp > 0) {
+    if (exp & 1)
+      result *= x;
+    x *= x;
+    exp >>= 1;
+  }
+  return result;
+}
+
 /**
  * Tworzy wielomian, który jest współczynnikiem (wielomian stały).
  * @param[in] c : wartość współczynnika
  * @return wielomian
  */
 static inline Poly PolyFromCoeff(poly_coeff_t c) {
-  return (Poly) {.coeff = c, .arr = NULL};
+  Poly p;
+  p.coeff = c;
+  p.arr = NULL;
+  return p;
 }
 
 /**
@@ -99,7 +266,10 @@ static inline bool PolyIsZero(const Poly *p);
  */
 static inline Mono MonoFromPoly(const Poly *p, poly_exp_t n) {
   //assert(n == 0 || !PolyIsZero(p));
-  return (Mono) {.p = *p, .exp = n};
+  Mono m;
+  m.p = *p;
+  m.exp = n;
+  return m;
 }
 
 /**
@@ -117,7 +287,7 @@ static inline bool PolyIsCoeff(const Poly *p) {
  * @param[in, out] coeff : współczynnik, do którego zapisywana jest wartość wielomianu jeżeli funkcja zwraca true
  * @return Czy jednomian jest współczynnikiem?
  */
-bool MonoIsCoeff(const Mono *m, poly_coeff_t *coeff);
+POLY_API bool MonoIsCoeff(const Mono *m, poly_coeff_t *coeff);
 
 /**
  * Sprawdza, czy wielomian jest tożsamościowo równy zeru.
@@ -133,13 +303,13 @@ static inline bool PolyIsZero(const Poly *p) {
  * @param[in] size : długość tablicy jednomianów
  * @return pusty wielomian z tablicą arr długości size
  */
-Poly PolyAlloc(size_t size);
+POLY_API Poly PolyAlloc(size_t size);
 
 /**
  * Usuwa wielomian z pamięci.
  * @param[in] p : wielomian
  */
-void PolyDestroy(Poly *p);
+POLY_API void PolyDestroy(Poly *p);
 
 /**
  * Usuwa jednomian z pamięci.
@@ -154,7 +324,39 @@ static inline void MonoDestroy(Mono *m) {
  * @param[in] p : wielomian
  * @return skopiowany wielomian
  */
-Poly PolyClone(const Poly *p);
+POLY_API Poly PolyClone(const Poly *p);
+
+/**
+ * Robi pełną kopię wielomianu, w której wszystkie tablice jednomianów leżą
+ * w jednym ciągłym bloku pamięci, w kolejności przejścia w głąb. Przejścia
+ * po takim wielomianie czytają pamięć po kolei, a usunięcie go zwalnia jeden
+ * blok. Kopia wielomianu skompaktowanego też jest skompaktowana.
+ * @param[in] p : wielomian
+ * @return skompaktowana kopia wielomianu
+ */
+POLY_API Poly PolyCompact(const Poly *p);
+
+/**
+ * Liczy jednomiany we wszystkich tablicach jednomianów wielomianu
+ * (wielomian zapisany bez tablicy ma jeden jednomian). Liczenie jest
+ * przerywane po osiągnięciu @p limit, więc jego koszt jest ograniczony
+ * przez @p limit.
+ * @param[in] p : wielomian
+ * @param[in] limit : liczba jednomianów, po której liczenie jest przerywane
+ * @return liczba jednomianów, jeżeli jest mniejsza niż @p limit, wpp. liczba
+ * nie mniejsza niż @p limit
+ */
+POLY_API size_t PolyCountMonos(const Poly *p, size_t limit);
+
+/**
+ * Sprawdza, czy tablice jednomianów wielomianu mają łącznie co najmniej
+ * @p count jednomianów. Przechodzi po wielomianie tylko do chwili, w której
+ * odpowiedź jest znana, więc koszt jest ograniczony przez @p count.
+ * @param[in] p : wielomian
+ * @param[in] count : szukana liczba jednomianów
+ * @return Czy wielomian ma co najmniej @p count jednomianów w tablicach?
+ */
+POLY_API bool PolyHasMonos(const Poly *p, size_t count);
 
 /**
  * Robi pełną, głęboką kopię jednomianu.
@@ -162,7 +364,10 @@ Poly PolyClone(const Poly *p);
  * @return skopiowany jednomian
  */
 static inline Mono MonoClone(const Mono *m) {
-  return (Mono) {.p = PolyClone(&m->p), .exp = m->exp};
+  Mono clone;
+  clone.p = PolyClone(&m->p);
+  clone.exp = m->exp;
+  return clone;
 }
 
 /**
@@ -171,7 +376,7 @@ static inline Mono MonoClone(const Mono *m) {
  * @param[in] q : wielomian @f$q@f$
  * @return @f$p + q@f$
  */
-Poly PolyAdd(const Poly *p, const Poly *q);
+POLY_API Poly PolyAdd(const Poly *p, const Poly *q);
 
 /**
  * Sumuje listę jednomianów i tworzy z nich wielomian.
@@ -180,7 +385,7 @@ Poly PolyAdd(const Poly *p, const Poly *q);
  * @param[in] monos : tablica jednomianów
  * @return wielomian będący sumą jednomianów
  */
-Poly PolyAddMonos(size_t count, const Mono monos[]);
+POLY_API Poly PolyAddMonos(size_t count, const Mono monos[]);
 
 /**
  * Sumuje listę jednomianów i tworzy z nich wielomian. Przejmuje na własność
@@ -192,7 +397,18 @@ Poly PolyAddMonos(size_t count, const Mono monos[]);
  * @param[in] monos : tablica jednomianów
  * @return wielomian będący sumą jednomianów
  */
-Poly PolyOwnMonos(size_t count, Mono *monos);
+POLY_API Poly PolyOwnMonos(size_t count, Mono *monos);
+
+/**
+ * Działa jak PolyOwnMonos dla tablicy już posortowanej niemalejąco według
+ * wykładników, więc nie sortuje jej ponownie. Tablica musi być zaalokowana
+ * funkcją MemoryPoolCalloc w kategorii MEMORY_MONOS i mieć dokładnie
+ * @p count jednomianów.
+ * @param[in] count : liczba jednomianów
+ * @param[in] monos : posortowana tablica jednomianów
+ * @return wielomian będący sumą jednomianów
+ */
+POLY_API Poly PolyOwnSortedMonos(size_t count, Mono *monos);
 
 /**
  * Sumuje listę jednomianów i tworzy z nich wielomian. Nie modyfikuje zawartości
@@ -203,7 +419,7 @@ Poly PolyOwnMonos(size_t count, Mono *monos);
  * @param[in] monos : tablica jednomianów
  * @return wielomian będący sumą jednomianów
  */
-Poly PolyCloneMonos(size_t count, const Mono monos[]);
+POLY_API Poly PolyCloneMonos(size_t count, const Mono monos[]);
 
 /**
  * Mnoży dwa wielomiany.
@@ -211,7 +427,41 @@ Poly PolyCloneMonos(size_t count, const Mono monos[]);
  * @param[in] q : wielomian @f$q@f$
  * @return @f$p * q@f$
  */
-Poly PolyMul(const Poly *p, const Poly *q);
+POLY_API Poly PolyMul(const Poly *p, const Poly *q);
+
+/**
+ * Oblicza @f$p * q + r@f$ jednym sumowaniem: jednomiany @p r są dodawane
+ * razem z iloczynami jednomianów @p p i @p q, bez tworzenia iloczynu
+ * @f$p * q@f$ jako osobnego wielomianu.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @param[in] r : wielomian @f$r@f$
+ * @return @f$p * q + r@f$
+ */
+POLY_API Poly PolyMulAdd(const Poly *p, const Poly *q, const Poly *r);
+
+/**
+ * Dodaje @p count wielomianów jednym scalaniem: jednomiany o najmniejszym
+ * wykładniku są wybierane z kopca, a współczynniki jednomianów o równych
+ * wykładnikach są sumowane w ten sam sposób. Każdy jednomian jest więc
+ * kopiowany raz, zamiast kopiowania rosnącej sumy przy każdym dodawaniu.
+ * Duże sumy są dzielone między wątki.
+ * @param[in] count : liczba wielomianów
+ * @param[in] polys : tablica wielomianów
+ * @return suma wielomianów z tablicy @p polys
+ */
+POLY_API Poly PolySumMany(size_t count, const Poly polys[]);
+
+/**
+ * Mnoży @p count wielomianów. Czynniki są ustawiane według liczby jednomianów
+ * i iloczyn częściowy jest mnożony przez coraz większe czynniki. Duże mnożenia
+ * są dzielone między wątki: każdy mnoży kawałek tablicy jednomianów jednego
+ * czynnika, a iloczyny kawałków są scalane jak w PolySumMany.
+ * @param[in] count : liczba wielomianów
+ * @param[in] polys : tablica wielomianów
+ * @return iloczyn wielomianów z tablicy @p polys (1 dla pustej tablicy)
+ */
+POLY_API Poly PolyProductMany(size_t count, const Poly polys[]);
 
 /**
  * Podnosi wielomian @p p do potęgi @p n.
@@ -219,7 +469,7 @@ Poly PolyMul(const Poly *p, const Poly *q);
  * @param[in] n - wykładnik
  * @return @f$p^n@f$
  */
-Poly PolyPower(const Poly *p, poly_exp_t n);
+POLY_API Poly PolyPower(const Poly *p, poly_exp_t n);
 
 /**
  * Wykonuje złożenie wielomianów, pod zmienne wielomianu @p p podstawia po kolei wielomiany
@@ -230,14 +480,14 @@ Poly PolyPower(const Poly *p, poly_exp_t n);
  * @param[in] q - tablica wielomianów, które zostaną podstawione do wielomianu @p p
  * @return Wielomian będący złożeniem wielomianu @p i wielomianów z tablicy @p q
  */
-Poly PolyCompose(const Poly *p, size_t k, const Poly q[]);
+POLY_API Poly PolyCompose(const Poly *p, size_t k, const Poly q[]);
 
 /**
  * Zwraca przeciwny wielomian.
  * @param[in] p : wielomian @f$p@f$
  * @return @f$-p@f$
  */
-Poly PolyNeg(const Poly *p);
+POLY_API Poly PolyNeg(const Poly *p);
 
 /**
  * Odejmuje wielomian od wielomianu.
@@ -245,7 +495,7 @@ Poly PolyNeg(const Poly *p);
  * @param[in] q : wielomian @f$q@f$
  * @return @f$p - q@f$
  */
-Poly PolySub(const Poly *p, const Poly *q);
+POLY_API Poly PolySub(const Poly *p, const Poly *q);
 
 /**
  * Zwraca stopień wielomianu ze względu na zadaną zmienną (-1 dla wielomianu
@@ -257,14 +507,14 @@ Poly PolySub(const Poly *p, const Poly *q);
  * @param[in] var_idx : indeks zmiennej
  * @return stopień wielomianu @p p z względu na zmienną o indeksie @p var_idx
  */
-poly_exp_t PolyDegBy(const Poly *p, size_t var_idx);
+POLY_API poly_exp_t PolyDegBy(const Poly *p, size_t var_idx);
 
 /**
  * Zwraca stopień wielomianu (-1 dla wielomianu tożsamościowo równego zeru).
  * @param[in] p : wielomian
  * @return stopień wielomianu @p p
  */
-poly_exp_t PolyDeg(const Poly *p);
+POLY_API poly_exp_t PolyDeg(const Poly *p);
 
 /**
  * Sprawdza równość dwóch wielomianów.
@@ -272,7 +522,7 @@ poly_exp_t PolyDeg(const Poly *p);
  * @param[in] q : wielomian @f$q@f$
  * @return @f$p = q@f$
  */
-bool PolyIsEq(const Poly *p, const Poly *q);
+POLY_API bool PolyIsEq(const Poly *p, const Poly *q);
 
 /**
  * Wylicza wartość wielomianu w punkcie @p x.
@@ -285,7 +535,11 @@ bool PolyIsEq(const Poly *p, const Poly *q);
  * @param[in] x : wartość argumentu @f$x@f$
  * @return @f$p(x, x_0, x_1, \ldots)@f$
  */
-Poly PolyAt(const Poly *p, poly_coeff_t x);
+POLY_API Poly PolyAt(const Poly *p, poly_coeff_t x);
 
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* __POLY_H__ */
@@ -0,0 +1,601 @@
+/** @file
+  Nakładka C++ na wielomiany z poly.h (tylko nagłówek)
+
+  Klasa poly::Polynomial jest właścicielem wielomianu Poly: destruktor usuwa
+  go funkcją PolyDestroy, kopiowanie robi PolyClone, a przenoszenie przekazuje
+  tablicę jednomianów bez kopiowania, zostawiając w źródle wielomian zerowy.
+
+  Operatory +, - i * nie liczą wyniku od razu, tylko budują drzewo wyrażenia
+  (szablony wyrażeń), które jest obliczane dopiero przy przypisaniu do
+  Polynomial. Składniki całej sumy są wtedy dodawane jednym wywołaniem
+  PolySumMany, czynniki iloczynu – jednym PolyProductMany, a iloczyn dwóch
+  czynników w sumie jest łączony z resztą składników przez PolyMulAdd, więc
+  `a + b + c` ani `a * b + c` nie tworzą wielomianów pośrednich. Odejmowanie
+  i zmiana znaku nie kopiują wielomianów (PolyNegShallow).
+
+  Wyrażenie przechowuje referencje do wielomianów, więc należy je obliczyć
+  w tej samej instrukcji, w której powstało: nie należy zapisywać go
+  w zmiennej typu `auto`.
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef POLYNOMIALS_POLY_HPP
+#define POLYNOMIALS_POLY_HPP
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "poly.h"
+
+namespace poly {
+
+class Polynomial;
+
+namespace detail {
+
+/** Wielomiany pośrednie powstałe przy obliczaniu wyrażenia, usuwane razem z nim. */
+class Temporaries {
+public:
+    Temporaries() = default;
+    Temporaries(const Temporaries &) = delete;
+    Temporaries &operator=(const Temporaries &) = delete;
+
+    ~Temporaries() {
+        for (Poly &p : polys_)
+            PolyDestroy(&p);
+    }
+
+    /**
+     * Przejmuje wielomian na własność.
+     * @param[in] p : wielomian
+     * @return widok przejętego wielomianu
+     */
+    Poly Keep(Poly p) {
+        polys_.push_back(p);
+        return p;
+    }
+
+private:
+    std::vector<Poly> polys_; ///< przejęte wielomiany
+};
+
+/**
+ * Składniki sumy zebrane z drzewa wyrażenia. Jeden iloczyn dwóch czynników
+ * jest zapamiętywany osobno, żeby dodać go do reszty przez PolyMulAdd.
+ */
+struct SumTerms {
+    std::vector<Poly> terms; ///< widoki składników z uwzględnionym znakiem
+    Temporaries temps; ///< składniki, które trzeba było obliczyć
+    bool fused = false; ///< czy zapamiętano iloczyn
+    Poly mul_p; ///< pierwszy czynnik zapamiętanego iloczynu, ze znakiem
+    Poly mul_q; ///< drugi czynnik zapamiętanego iloczynu
+};
+
+/**
+ * Mnoży zebrane czynniki.
+ * @param[in] factors : widoki czynników
+ * @param[in] neg : czy zmienić znak iloczynu
+ * @return iloczyn na własność wywołującego
+ */
+inline Poly Multiply(const std::vector<Poly> &factors, bool neg) {
+    Poly product;
+    if (factors.size() == 1)
+        product = PolyClone(&factors[0]);
+    else if (factors.size() == 2)
+        product = PolyMul(&factors[0], &factors[1]);
+    else
+        product = PolyProductMany(factors.size(), factors.data());
+    return neg ? PolyNegShallow(&product) : product;
+}
+
+/**
+ * Dodaje zebrane składniki sumy.
+ * @param[in] t : składniki
+ * @return suma na własność wywołującego
+ */
+inline Poly Sum(const SumTerms &t) {
+    if (t.fused) {
+        Poly rest = PolyZero();
+        bool own_rest = t.terms.size() > 1;
+        if (own_rest)
+            rest = PolySumMany(t.terms.size(), t.terms.data());
+        else if (t.terms.size() == 1)
+            rest = t.terms[0];
+        Poly result = PolyMulAdd(&t.mul_p, &t.mul_q, &rest);
+        if (own_rest)
+            PolyDestroy(&rest);
+        return result;
+    }
+    else if (t.terms.empty()) {
+        return PolyZero();
+    }
+    else if (t.terms.size() == 1) {
+        return PolyClone(&t.terms[0]);
+    }
+    else if (t.terms.size() == 2) {
+        return PolyAdd(&t.terms[0], &t.terms[1]);
+    }
+    else {
+        return PolySumMany(t.terms.size(), t.terms.data());
+    }
+}
+
+/** Czy typ jest wyrażeniem, z którego można obliczyć wielomian? */
+template <class E>
+struct IsExpression : std::false_type {};
+
+/** Sposób przechowywania argumentu w węźle wyrażenia: węzły przez wartość. */
+template <class E>
+struct Operand {
+    typedef const E type; ///< typ pola węzła
+};
+
+/** Wielomiany są przechowywane w węzłach przez referencję. */
+template <>
+struct Operand<Polynomial> {
+    typedef const Polynomial &type; ///< typ pola węzła
+};
+
+/**
+ * Węzeł sumy lub różnicy dwóch wyrażeń.
+ * @tparam L : typ lewego argumentu
+ * @tparam R : typ prawego argumentu
+ * @tparam Sub : czy węzeł jest różnicą
+ */
+template <class L, class R, bool Sub>
+class SumExpr {
+public:
+    /**
+     * Tworzy węzeł.
+     * @param[in] l : lewy argument
+     * @param[in] r : prawy argument
+     */
+    SumExpr(const L &l, const R &r) : l_(l), r_(r) {}
+
+    /**
+     * Dodaje składniki węzła do sumy.
+     * @param[in,out] t : składniki sumy
+     * @param[in] neg : czy składniki mają przeciwny znak
+     */
+    void CollectTerms(SumTerms &t, bool neg) const {
+        l_.CollectTerms(t, neg);
+        r_.CollectTerms(t, neg != Sub);
+    }
+
+    /**
+     * Dodaje węzeł jako jeden czynnik iloczynu.
+     * @param[in,out] factors : widoki czynników
+     * @param[in,out] temps : wielomiany pośrednie
+     * @param[in,out] neg : znak iloczynu
+     */
+    void CollectFactors(std::vector<Poly> &factors, Temporaries &temps, bool &neg) const {
+        (void) neg;
+        factors.push_back(temps.Keep(Eval()));
+    }
+
+    /**
+     * Oblicza wartość wyrażenia.
+     * @return wielomian na własność wywołującego
+     */
+    Poly Eval() const {
+        SumTerms t;
+        CollectTerms(t, false);
+        return Sum(t);
+    }
+
+private:
+    typename Operand<L>::type l_; ///< lewy argument
+    typename Operand<R>::type r_; ///< prawy argument
+};
+
+/**
+ * Węzeł iloczynu dwóch wyrażeń.
+ * @tparam L : typ lewego argumentu
+ * @tparam R : typ prawego argumentu
+ */
+template <class L, class R>
+class ProductExpr {
+public:
+    /**
+     * Tworzy węzeł.
+     * @param[in] l : lewy argument
+     * @param[in] r : prawy argument
+     */
+    ProductExpr(const L &l, const R &r) : l_(l), r_(r) {}
+
+    /**
+     * Dodaje iloczyn do sumy. Pierwszy iloczyn dwóch czynników jest
+     * zapamiętywany do PolyMulAdd, pozostałe są obliczane.
+     * @param[in,out] t : składniki sumy
+     * @param[in] neg : czy iloczyn ma przeciwny znak
+     */
+    void CollectTerms(SumTerms &t, bool neg) const {
+        std::vector<Poly> factors;
+        CollectFactors(factors, t.temps, neg);
+        if (factors.size() == 2 && !t.fused) {
+            t.fused = true;
+            t.mul_p = neg ? PolyNegShallow(&factors[0]) : factors[0];
+            t.mul_q = factors[1];
+        }
+        else {
+            t.terms.push_back(t.temps.Keep(Multiply(factors, neg)));
+        }
+    }
+
+    /**
+     * Dodaje czynniki obu argumentów do iloczynu.
+     * @param[in,out] factors : widoki czynników
+     * @param[in,out] temps : wielomiany pośrednie
+     * @param[in,out] neg : znak iloczynu
+     */
+    void CollectFactors(std::vector<Poly> &factors, Temporaries &temps, bool &neg) const {
+        l_.CollectFactors(factors, temps, neg);
+        r_.CollectFactors(factors, temps, neg);
+    }
+
+    /**
+     * Oblicza wartość wyrażenia.
+     * @return wielomian na własność wywołującego
+     */
+    Poly Eval() const {
+        std::vector<Poly> factors;
+        Temporaries temps;
+        bool neg = false;
+        CollectFactors(factors, temps, neg);
+        return Multiply(factors, neg);
+    }
+
+private:
+    typename Operand<L>::type l_; ///< lewy argument
+    typename Operand<R>::type r_; ///< prawy argument
+};
+
+/**
+ * Węzeł wyrażenia przeciwnego.
+ * @tparam E : typ argumentu
+ */
+template <class E>
+class NegExpr {
+public:
+    /**
+     * Tworzy węzeł.
+     * @param[in] e : argument
+     */
+    explicit NegExpr(const E &e) : e_(e) {}
+
+    /**
+     * Dodaje składniki argumentu ze zmienionym znakiem.
+     * @param[in,out] t : składniki sumy
+     * @param[in] neg : czy składniki mają przeciwny znak
+     */
+    void CollectTerms(SumTerms &t, bool neg) const {
+        e_.CollectTerms(t, !neg);
+    }
+
+    /**
+     * Dodaje czynniki argumentu, zmieniając znak iloczynu.
+     * @param[in,out] factors : widoki czynników
+     * @param[in,out] temps : wielomiany pośrednie
+     * @param[in,out] neg : znak iloczynu
+     */
+    void CollectFactors(std::vector<Poly> &factors, Temporaries &temps, bool &neg) const {
+        neg = !neg;
+        e_.CollectFactors(factors, temps, neg);
+    }
+
+    /**
+     * Oblicza wartość wyrażenia.
+     * @return wielomian na własność wywołującego
+     */
+    Poly Eval() const {
+        SumTerms t;
+        CollectTerms(t, false);
+        return Sum(t);
+    }
+
+private:
+    typename Operand<E>::type e_; ///< argument
+};
+
+template <class L, class R, bool Sub>
+struct IsExpression<SumExpr<L, R, Sub>> : std::true_type {};
+
+template <class L, class R>
+struct IsExpression<ProductExpr<L, R>> : std::true_type {};
+
+template <class E>
+struct IsExpression<NegExpr<E>> : std::true_type {};
+
+template <>
+struct IsExpression<Polynomial> : std::true_type {};
+
+/** Typ @p T, jeżeli oba typy @p L i @p R są wyrażeniami. */
+template <class L, class R, class T>
+using IfExpressions = typename std::enable_if<IsExpression<L>::value && IsExpression<R>::value, T>::type;
+
+} // namespace detail
+
+/** Wielomian będący właścicielem swojej tablicy jednomianów. */
+class Polynomial {
+public:
+    /** Tworzy wielomian zerowy. */
+    Polynomial() noexcept : p_(PolyZero()) {}
+
+    /**
+     * Tworzy wielomian stały.
+     * @param[in] c : współczynnik
+     */
+    explicit Polynomial(poly_coeff_t c) noexcept : p_(PolyFromCoeff(c)) {}
+
+    /**
+     * Przejmuje na własność wielomian z interfejsu C.
+     * @param[in] p : wielomian
+     * @return wielomian, który usunie @p p
+     */
+    static Polynomial Adopt(Poly p) noexcept {
+        Polynomial res;
+        res.p_ = p;
+        return res;
+    }
+
+    /**
+     * Tworzy kopię wielomianu.
+     * @param[in] other : wielomian
+     */
+    Polynomial(const Polynomial &other) : p_(PolyClone(&other.p_)) {}
+
+    /**
+     * Przejmuje tablicę jednomianów wielomianu @p other, który staje się zerem.
+     * @param[in,out] other : wielomian
+     */
+    Polynomial(Polynomial &&other) noexcept : p_(other.p_) {
+        other.p_ = PolyZero();
+    }
+
+    /**
+     * Oblicza wyrażenie.
+     * @param[in] e : wyrażenie
+     */
+    template <class E, class = typename std::enable_if<detail::IsExpression<E>::value>::type>
+    Polynomial(const E &e) : p_(e.Eval()) {}
+
+    /**
+     * Zastępuje wielomian kopią @p other.
+     * @param[in] other : wielomian
+     * @return ten wielomian
+     */
+    Polynomial &operator=(const Polynomial &other) {
+        if (this != &other)
+            Reset(PolyClone(&other.p_));
+        return *this;
+    }
+
+    /**
+     * Zastępuje wielomian wielomianem @p other, który staje się zerem.
+     * @param[in,out] other : wielomian
+     * @return ten wielomian
+     */
+    Polynomial &operator=(Polynomial &&other) noexcept {
+        if (this != &other) {
+            Reset(other.p_);
+            other.p_ = PolyZero();
+        }
+        return *this;
+    }
+
+    /**
+     * Zastępuje wielomian wartością wyrażenia, które może go zawierać.
+     * @param[in] e : wyrażenie
+     * @return ten wielomian
+     */
+    template <class E>
+    typename std::enable_if<detail::IsExpression<E>::value, Polynomial&>::type operator=(const E &e) {
+        Reset(e.Eval());
+        return *this;
+    }
+
+    /** Usuwa wielomian. */
+    ~Polynomial() {
+        PolyDestroy(&p_);
+    }
+
+    /**
+     * Daje wielomian do przekazania funkcjom z poly.h bez oddawania własności.
+     * @return wielomian
+     */
+    const Poly &Get() const noexcept {
+        return p_;
+    }
+
+    /**
+     * Oddaje wielomian na własność wywołującego i staje się zerem.
+     * @return wielomian do usunięcia funkcją PolyDestroy
+     */
+    Poly Release() noexcept {
+        Poly p = p_;
+        p_ = PolyZero();
+        return p;
+    }
+
+    /**
+     * Sprawdza, czy wielomian jest zerowy.
+     * @return Czy wielomian jest zerowy?
+     */
+    bool IsZero() const noexcept {
+        return PolyIsZero(&p_);
+    }
+
+    /**
+     * Sprawdza, czy wielomian jest stały.
+     * @return Czy wielomian jest stały?
+     */
+    bool IsCoeff() const noexcept {
+        return PolyIsCoeff(&p_);
+    }
+
+    /**
+     * Daje stopień wielomianu.
+     * @return stopień wielomianu (-1 dla wielomianu zerowego)
+     */
+    poly_exp_t Deg() const {
+        return PolyDeg(&p_);
+    }
+
+    /**
+     * Daje stopień wielomianu ze względu na zmienną @f$x_{idx}@f$.
+     * @param[in] var_idx : indeks zmiennej
+     * @return stopień wielomianu ze względu na zmienną
+     */
+    poly_exp_t DegBy(size_t var_idx) const {
+        return PolyDegBy(&p_, var_idx);
+    }
+
+    /**
+     * Wylicza wartość wielomianu w punkcie @p x.
+     * @param[in] x : wartość pierwszej zmiennej
+     * @return wielomian od pozostałych zmiennych
+     */
+    Polynomial At(poly_coeff_t x) const {
+        return Adopt(PolyAt(&p_, x));
+    }
+
+    /**
+     * Dodaje wyrażenie do wielomianu.
+     * @param[in] e : wyrażenie
+     * @return ten wielomian
+     */
+    template <class E>
+    typename std::enable_if<detail::IsExpression<E>::value, Polynomial&>::type operator+=(const E &e) {
+        return *this = detail::SumExpr<Polynomial, E, false>(*this, e);
+    }
+
+    /**
+     * Odejmuje wyrażenie od wielomianu.
+     * @param[in] e : wyrażenie
+     * @return ten wielomian
+     */
+    template <class E>
+    typename std::enable_if<detail::IsExpression<E>::value, Polynomial&>::type operator-=(const E &e) {
+        return *this = detail::SumExpr<Polynomial, E, true>(*this, e);
+    }
+
+    /**
+     * Mnoży wielomian przez wyrażenie.
+     * @param[in] e : wyrażenie
+     * @return ten wielomian
+     */
+    template <class E>
+    typename std::enable_if<detail::IsExpression<E>::value, Polynomial&>::type operator*=(const E &e) {
+        return *this = detail::ProductExpr<Polynomial, E>(*this, e);
+    }
+
+    /**
+     * Sprawdza równość dwóch wielomianów.
+     * @param[in] other : wielomian
+     * @return Czy wielomiany są równe?
+     */
+    bool operator==(const Polynomial &other) const {
+        return PolyIsEq(&p_, &other.p_);
+    }
+
+    /**
+     * Sprawdza, czy wielomiany są różne.
+     * @param[in] other : wielomian
+     * @return Czy wielomiany są różne?
+     */
+    bool operator!=(const Polynomial &other) const {
+        return !PolyIsEq(&p_, &other.p_);
+    }
+
+    /**
+     * Dodaje wielomian do sumy jako widok.
+     * @param[in,out] t : składniki sumy
+     * @param[in] neg : czy zmienić znak
+     */
+    void CollectTerms(detail::SumTerms &t, bool neg) const {
+        t.terms.push_back(neg ? PolyNegShallow(&p_) : p_);
+    }
+
+    /**
+     * Dodaje wielomian do iloczynu jako widok.
+     * @param[in,out] factors : widoki czynników
+     * @param[in,out] temps : wielomiany pośrednie
+     * @param[in,out] neg : znak iloczynu
+     */
+    void CollectFactors(std::vector<Poly> &factors, detail::Temporaries &temps, bool &neg) const {
+        (void) temps;
+        (void) neg;
+        factors.push_back(p_);
+    }
+
+    /**
+     * Daje kopię wielomianu.
+     * @return kopia na własność wywołującego
+     */
+    Poly Eval() const {
+        return PolyClone(&p_);
+    }
+
+private:
+    /**
+     * Usuwa wielomian i zastępuje go wielomianem @p p.
+     * @param[in] p : wielomian przejmowany na własność
+     */
+    void Reset(Poly p) noexcept {
+        PolyDestroy(&p_);
+        p_ = p;
+    }
+
+    Poly p_; ///< wielomian
+};
+
+/**
+ * Buduje wyrażenie @f$l + r@f$.
+ * @param[in] l : wyrażenie
+ * @param[in] r : wyrażenie
+ * @return węzeł sumy
+ */
+template <class L, class R>
+detail::IfExpressions<L, R, detail::SumExpr<L, R, false>> operator+(const L &l, const R &r) {
+    return detail::SumExpr<L, R, false>(l, r);
+}
+
+/**
+ * Buduje wyrażenie @f$l - r@f$.
+ * @param[in] l : wyrażenie
+ * @param[in] r : wyrażenie
+ * @return węzeł różnicy
+ */
+template <class L, class R>
+detail::IfExpressions<L, R, detail::SumExpr<L, R, true>> operator-(const L &l, const R &r) {
+    return detail::SumExpr<L, R, true>(l, r);
+}
+
+/**
+ * Buduje wyrażenie @f$l * r@f$.
+ * @param[in] l : wyrażenie
+ * @param[in] r : wyrażenie
+ * @return węzeł iloczynu
+ */
+template <class L, class R>
+detail::IfExpressions<L, R, detail::ProductExpr<L, R>> operator*(const L &l, const R &r) {
+    return detail::ProductExpr<L, R>(l, r);
+}
+
+/**
+ * Buduje wyrażenie @f$-e@f$.
+ * @param[in] e : wyrażenie
+ * @return węzeł wyrażenia przeciwnego
+ */
+template <class E>
+detail::IfExpressions<E, E, detail::NegExpr<E>> operator-(const E &e) {
+    return detail::NegExpr<E>(e);
+}
+
+} // namespace poly
+
+#endif //POLYNOMIALS_POLY_HPP
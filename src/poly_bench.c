@@ -0,0 +1,823 @@
+/** @file
+  Pomiary czasu wybranych operacji na wielomianach
+
+  Program wypisuje dla każdego pomiaru wiersz `NAZWA NS`, gdzie NS to czas
+  wykonania operacji w nanosekundach. Opcjonalny argument określa głębokość
+  zagnieżdżenia wielomianów w pomiarach przejść w głąb.
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+/** Udostępnia funkcje POSIX (fileno) przy kompilacji z -std=c11. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <string.h>
+#include "builder.h"
+#include "dataflow.h"
+#include "modular.h"
+#include "parallel.h"
+#include "partial.h"
+#include "pipeline.h"
+#include "program.h"
+#include "reclaimer.h"
+
+/** Domyślna głębokość zagnieżdżenia wielomianu w pomiarach. */
+#define BENCH_DEFAULT_DEPTH 100000
+
+/**
+ * Wypisuje wynik pomiaru.
+ * @param[in] name : nazwa pomiaru
+ * @param[in] start : czas rozpoczęcia pomiaru
+ */
+static void Report(const char *name, uint64_t start) {
+    printf("%s %" PRIu64 "\n", name, StatsNow() - start);
+}
+
+/**
+ * Zapisuje do pliku tymczasowego wiersz z wielomianem @f$x_0x_1 \cdots x_{depth-1}@f$
+ * w postaci `((...((1,1),1)...),1)`.
+ * @param[in] depth : głębokość zagnieżdżenia
+ * @return plik ustawiony na początek wiersza
+ */
+static FILE *WriteDeepChain(size_t depth) {
+    FILE *file = tmpfile();
+    CheckPtr(file);
+    for (size_t i = 0; i < depth; ++i)
+        putc('(', file);
+    putc('1', file);
+    for (size_t i = 0; i < depth; ++i)
+        fputs(",1)", file);
+    putc('\n', file);
+    fflush(file);
+    rewind(file);
+    return file;
+}
+
+/**
+ * Mierzy wczytywanie, wypisywanie, kopiowanie, porównywanie, stopień
+ * i usuwanie głęboko zagnieżdżonego wielomianu.
+ * @param[in] depth : głębokość zagnieżdżenia
+ */
+static void BenchDeepChain(size_t depth) {
+    FILE *in = WriteDeepChain(depth);
+    FILE *out = fopen("/dev/null", "w");
+    CheckPtr(out);
+    Calculator c = InitCalculator(out, stderr);
+    Reader reader = CreateReader(in);
+
+    uint64_t start = StatsNow();
+    ParseInput(&c, &reader);
+    Report("DEEP_PARSE", start);
+    Poly p = c.stack.polys[0];
+
+    start = StatsNow();
+    PrintHelper(out, &p);
+    Report("DEEP_PRINT", start);
+
+    start = StatsNow();
+    Poly q = PolyClone(&p);
+    Report("DEEP_CLONE", start);
+
+    start = StatsNow();
+    bool eq = PolyIsEq(&p, &q);
+    Report("DEEP_IS_EQ", start);
+
+    start = StatsNow();
+    poly_exp_t deg = PolyDeg(&p);
+    Report("DEEP_DEG", start);
+
+    start = StatsNow();
+    PolyDestroy(&q);
+    Report("DEEP_DESTROY", start);
+
+    if (!eq || deg != (poly_exp_t) depth)
+        fprintf(stderr, "DEEP_CHAIN WRONG RESULT\n");
+
+    CalculatorClear(&c);
+    DestroyReader(&reader);
+    fclose(out);
+    fclose(in);
+}
+
+/**
+ * Tworzy wielomian @f$(x_0 + x_1 + \cdots + x_{vars-1} + 1)^{n}@f$, którego
+ * tablice jednomianów są rozrzucone po stercie przez kolejne mnożenia.
+ * @param[in] vars : liczba zmiennych
+ * @param[in] n : wykładnik
+ * @return wielomian
+ */
+static Poly MakeScattered(size_t vars, poly_exp_t n) {
+    Poly base = PolyFromCoeff(1);
+    for (size_t i = 0; i < vars; ++i) {
+        // dodajemy zmienną x_{vars-1-i}, zagnieżdżając dotychczasową sumę
+        Poly one = PolyFromCoeff(1);
+        Mono monos[2] = {MonoFromPoly(&base, 0), MonoFromPoly(&one, 1)};
+        base = PolyAddMonos(2, monos);
+    }
+    Poly res = PolyPower(&base, n);
+    PolyDestroy(&base);
+    return res;
+}
+
+/**
+ * Mierzy porównywanie i wypisywanie wielomianu przed i po kompaktowaniu.
+ */
+static void BenchCompact(void) {
+    FILE *out = fopen("/dev/null", "w");
+    CheckPtr(out);
+    Poly p = MakeScattered(6, 8);
+    Poly q = PolyClone(&p);
+
+    uint64_t start = StatsNow();
+    bool eq = PolyIsEq(&p, &q);
+    PrintHelper(out, &p);
+    Report("SCATTERED_IS_EQ_PRINT", start);
+
+    start = StatsNow();
+    Poly compact_p = PolyCompact(&p);
+    Poly compact_q = PolyCompact(&q);
+    Report("COMPACT", start);
+
+    start = StatsNow();
+    eq &= PolyIsEq(&compact_p, &compact_q);
+    PrintHelper(out, &compact_p);
+    Report("COMPACT_IS_EQ_PRINT", start);
+
+    if (!eq)
+        fprintf(stderr, "COMPACT WRONG RESULT\n");
+
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+    PolyDestroy(&compact_p);
+    PolyDestroy(&compact_q);
+    fclose(out);
+}
+
+/**
+ * Mierzy odejmowanie wielomianów i wyznaczanie wielomianu przeciwnego.
+ */
+static void BenchSub(void) {
+    Poly p = MakeScattered(6, 8);
+    Poly q = MakeScattered(5, 9);
+
+    uint64_t start = StatsNow();
+    Poly diff = PolySub(&p, &q);
+    Report("SUB", start);
+
+    start = StatsNow();
+    Poly neg = PolyNeg(&p);
+    Report("NEG", start);
+
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+    PolyDestroy(&diff);
+    PolyDestroy(&neg);
+}
+
+/**
+ * Porównuje sumę i iloczyn wielu wielomianów liczone kolejnymi działaniami
+ * na dwóch wielomianach z PolySumMany i PolyProductMany.
+ * @param[in] count : liczba wielomianów
+ */
+static void BenchMany(size_t count) {
+    Poly *polys = (Poly*) MemoryAlloc(count * sizeof(Poly), MEMORY_WORK);
+    for (size_t i = 0; i < count; ++i) {
+        // (x_0^i + x_0^{i+1} x_1 + 1), różne wykładniki dla kolejnych wielomianów
+        Poly x1 = PolyInline(1, 1), one = PolyFromCoeff(1), c = PolyFromCoeff(1);
+        Mono monos[3] = {MonoFromPoly(&one, (poly_exp_t) i + 1), MonoFromPoly(&x1, (poly_exp_t) i + 2),
+                         MonoFromPoly(&c, 0)};
+        polys[i] = PolyAddMonos(3, monos);
+    }
+
+    uint64_t start = StatsNow();
+    Poly sum = PolyZero();
+    for (size_t i = 0; i < count; ++i) {
+        Poly next = PolyAdd(&sum, &polys[i]);
+        PolyDestroy(&sum);
+        sum = next;
+    }
+    Report("ADD_LOOP", start);
+
+    start = StatsNow();
+    Poly sum_many = PolySumMany(count, polys);
+    Report("ADD_N", start);
+
+    size_t factors = (count < 48) ? count : 48;
+    start = StatsNow();
+    Poly product = PolyFromCoeff(1);
+    for (size_t i = 0; i < factors; ++i) {
+        Poly next = PolyMul(&product, &polys[i]);
+        PolyDestroy(&product);
+        product = next;
+    }
+    Report("MUL_LOOP", start);
+
+    start = StatsNow();
+    Poly product_many = PolyProductMany(factors, polys);
+    Report("MUL_N", start);
+
+    if (!PolyIsEq(&sum, &sum_many) || !PolyIsEq(&product, &product_many))
+        fprintf(stderr, "MANY WRONG RESULT\n");
+
+    PolyDestroy(&sum);
+    PolyDestroy(&sum_many);
+    PolyDestroy(&product);
+    PolyDestroy(&product_many);
+    for (size_t i = 0; i < count; ++i)
+        PolyDestroy(&polys[i]);
+    MemoryFree(polys, count * sizeof(Poly), MEMORY_WORK);
+}
+
+/**
+ * Mierzy PolyAt wielomianu, którego współczynniki przy kolejnych potęgach
+ * @f$x_0@f$ są małe, a ich suma jest duża, więc wynik powstaje z wielu
+ * dodawań małego składnika do dużej sumy częściowej.
+ * @param[in] count : liczba jednomianów
+ */
+static void BenchAt(size_t count) {
+    Mono *monos = (Mono*) MemoryAlloc(count * sizeof(Mono), MEMORY_WORK);
+    for (size_t i = 0; i < count; ++i) {
+        // x_1^i x_0^i
+        Poly coeff = PolyInline(1, (poly_exp_t) i + 1);
+        monos[i] = MonoFromPoly(&coeff, (poly_exp_t) i);
+    }
+    Poly p = PolyAddMonos(count, monos);
+    MemoryFree(monos, count * sizeof(Mono), MEMORY_WORK);
+
+    uint64_t start = StatsNow();
+    Poly at = PolyAt(&p, 1);
+    Report("AT_MANY", start);
+
+    if (PolyIsCoeff(&at) || PolyGetSize(&at) != count)
+        fprintf(stderr, "AT WRONG RESULT\n");
+
+    PolyDestroy(&p);
+    PolyDestroy(&at);
+}
+
+/**
+ * Porównuje jednomiany według wykładników tak jak PolyAddMonos przed
+ * wprowadzeniem sortowania seriami i pozycyjnego.
+ * @param[in] a : wskaźnik na pierwszy jednomian
+ * @param[in] b : wskaźnik na drugi jednomian
+ * @return wynik porównania wykładników
+ */
+static int CompareExps(const void *a, const void *b) {
+    poly_exp_t a_exp = ((const Mono*) a)->exp, b_exp = ((const Mono*) b)->exp;
+    return (a_exp > b_exp) - (a_exp < b_exp);
+}
+
+/**
+ * Mierzy PolyAddMonos na tablicy @p monos i to samo dodawanie poprzedzone
+ * sortowaniem funkcją qsort.
+ * @param[in] name : nazwa pomiaru
+ * @param[in] qsort_name : nazwa pomiaru z funkcją qsort
+ * @param[in] monos : jednomiany o stałych współczynnikach
+ * @param[in] count : liczba jednomianów
+ */
+static void BenchSortLayout(const char *name, const char *qsort_name, const Mono *monos, size_t count) {
+    uint64_t start = StatsNow();
+    Mono *sorted = (Mono*) MemoryPoolCalloc(count * sizeof(Mono), MEMORY_MONOS);
+    memcpy(sorted, monos, count * sizeof(Mono));
+    qsort(sorted, count, sizeof(Mono), CompareExps);
+    Poly old = PolyOwnSortedMonos(count, sorted);
+    Report(qsort_name, start);
+
+    start = StatsNow();
+    Poly p = PolyAddMonos(count, monos);
+    Report(name, start);
+
+    if (!PolyIsEq(&old, &p))
+        fprintf(stderr, "SORT WRONG RESULT\n");
+    PolyDestroy(&old);
+    PolyDestroy(&p);
+}
+
+/**
+ * Mierzy dodawanie @p count jednomianów posortowanych, złożonych z 64
+ * posortowanych serii i w losowej kolejności.
+ * @param[in] count : liczba jednomianów
+ */
+static void BenchSortMonos(size_t count) {
+    Mono *monos = (Mono*) MemoryAlloc(count * sizeof(Mono), MEMORY_WORK);
+    for (size_t i = 0; i < count; ++i)
+        monos[i] = (Mono) {.p = PolyFromCoeff(1), .exp = (poly_exp_t) i};
+    BenchSortLayout("SORT_SORTED", "SORT_SORTED_QSORT", monos, count);
+
+    size_t runs = 64;
+    for (size_t i = 0; i < count; ++i)
+        monos[i].exp = (poly_exp_t) ((i % (count / runs)) * runs + i / (count / runs));
+    BenchSortLayout("SORT_RUNS", "SORT_RUNS_QSORT", monos, count);
+
+    unsigned seed = 1;
+    for (size_t i = count - 1; i > 0; --i) {
+        seed = seed * 1103515245u + 12345u;
+        size_t j = (seed >> 8) % (i + 1);
+        Mono tmp = monos[i];
+        monos[i] = monos[j];
+        monos[j] = tmp;
+    }
+    BenchSortLayout("SORT_RANDOM", "SORT_RANDOM_QSORT", monos, count);
+    MemoryFree(monos, count * sizeof(Mono), MEMORY_WORK);
+}
+
+/**
+ * Mierzy budowanie wielomianu z @p count losowych wyrazów trzech zmiennych
+ * budowniczym oraz przez PolyAddMonos z tablicy jednomianów wyrazów.
+ * @param[in] count : liczba wyrazów
+ */
+static void BenchBuilder(size_t count) {
+    poly_exp_t *exps = (poly_exp_t*) MemoryAlloc(3 * count * sizeof(poly_exp_t), MEMORY_WORK);
+    unsigned seed = 1;
+    for (size_t i = 0; i < 3 * count; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        exps[i] = (poly_exp_t) ((seed >> 16) % 64);
+    }
+
+    uint64_t start = StatsNow();
+    PolyBuilder b;
+    InitPolyBuilder(&b, 3);
+    for (size_t i = 0; i < count; ++i)
+        PolyBuilderAdd(&b, exps + 3 * i, 1);
+    Poly built = PolyBuilderFinish(&b);
+    PolyBuilderDestroy(&b);
+    Report("BUILD_TERMS", start);
+
+    start = StatsNow();
+    Mono *monos = (Mono*) MemoryAlloc(count * sizeof(Mono), MEMORY_WORK);
+    for (size_t i = 0; i < count; ++i) {
+        Poly coeff = PolyInline(1, exps[3 * i + 2]);
+        Mono inner = MonoFromPoly(&coeff, exps[3 * i + 1]);
+        coeff = PolyAddMonos(1, &inner);
+        monos[i] = MonoFromPoly(&coeff, exps[3 * i]);
+    }
+    Poly added = PolyAddMonos(count, monos);
+    MemoryFree(monos, count * sizeof(Mono), MEMORY_WORK);
+    Report("ADD_MONOS_TERMS", start);
+
+    if (!PolyIsEq(&built, &added))
+        fprintf(stderr, "BUILD WRONG RESULT\n");
+
+    PolyDestroy(&built);
+    PolyDestroy(&added);
+    MemoryFree(exps, 3 * count * sizeof(poly_exp_t), MEMORY_WORK);
+}
+
+/**
+ * Mierzy wykonanie skryptu z kilkoma niezależnymi mnożeniami sekwencyjnie
+ * i w trybie przepływu danych.
+ * @param[in] products : liczba niezależnych mnożeń
+ */
+static void BenchDataflow(size_t products) {
+    FILE *script = tmpfile();
+    CheckPtr(script);
+    for (size_t i = 0; i < products; ++i) {
+        // wielomian o 30 * 30 jednomianach, różny dla każdego mnożenia
+        for (size_t j = 0; j < 30; ++j) {
+            putc('(', script);
+            for (size_t k = 0; k < 30; ++k)
+                fprintf(script, "(%zu,%zu)%s", i + j + k + 1, k, (k < 29) ? "+" : "");
+            fprintf(script, ",%zu)%s", j, (j < 29) ? "+" : "\n");
+        }
+        fputs("CLONE\nMUL\n", script);
+    }
+    fprintf(script, "ADD_N %zu\nDEG\n", products);
+    fflush(script);
+
+    FILE *out = fopen("/dev/null", "w");
+    CheckPtr(out);
+    for (int dataflow = 0; dataflow < 2; ++dataflow) {
+        rewind(script);
+        Calculator c = InitCalculator(out, stderr);
+        Reader reader = CreateReader(script);
+        uint64_t start = StatsNow();
+        if (dataflow)
+            DataflowInput(&c, &reader, ParallelThreads());
+        else
+            ParseInput(&c, &reader);
+        Report(dataflow ? "DATAFLOW_PAR" : "DATAFLOW_SEQ", start);
+        CalculatorClear(&c);
+        DestroyReader(&reader);
+    }
+    fclose(out);
+    fclose(script);
+}
+
+/**
+ * Mierzy wykonanie skryptu, w którym wczytywanie dużych wielomianów
+ * przeplata się z mnożeniami, bez potoku i w trybie potokowym.
+ * @param[in] rounds : liczba par wczytanie – mnożenie
+ */
+static void BenchPipeline(size_t rounds) {
+    FILE *script = tmpfile();
+    CheckPtr(script);
+    for (size_t i = 0; i < rounds; ++i) {
+        // wielomian o 20000 jednomianach do wczytania i mały wielomian do pomnożenia
+        for (size_t j = 0; j < 200; ++j) {
+            putc('(', script);
+            for (size_t k = 0; k < 100; ++k)
+                fprintf(script, "(%zu,%zu)%s", i + j + k + 1, k, (k < 99) ? "+" : "");
+            fprintf(script, ",%zu)%s", j, (j < 199) ? "+" : "\n");
+        }
+        fputs("DEG\nPOP\n", script);
+        for (size_t j = 0; j < 40; ++j)
+            fprintf(script, "(%zu,%zu)+((1,1)+(%zu,%zu),%zu)%s", j + i, j, i + 1, j, j + 1, (j < 39) ? "+" : "\n");
+        fputs("CLONE\nMUL\nCLONE\nMUL\nDEG\nPOP\n", script);
+    }
+    fflush(script);
+
+    FILE *out = fopen("/dev/null", "w");
+    CheckPtr(out);
+    for (int pipeline = 0; pipeline < 2; ++pipeline) {
+        rewind(script);
+        Calculator c = InitCalculator(out, stderr);
+        Reader reader = CreateReader(script);
+        uint64_t start = StatsNow();
+        if (pipeline)
+            PipelineInput(&c, &reader);
+        else
+            ParseInput(&c, &reader);
+        Report(pipeline ? "PIPELINE_PAR" : "PIPELINE_SEQ", start);
+        CalculatorClear(&c);
+        DestroyReader(&reader);
+    }
+    fclose(out);
+    fclose(script);
+}
+
+/**
+ * Mierzy wczytanie jednego długiego wiersza z wielomianem w jednym wątku
+ * i w kilku wątkach.
+ * @param[in] monos : liczba jednomianów w wierszu
+ */
+static void BenchLongLine(size_t monos) {
+    FILE *script = tmpfile();
+    CheckPtr(script);
+    for (size_t i = 0; i < monos; ++i)
+        fprintf(script, "((1,%zu)+(%zu,0),%zu)%s", i % 7 + 1, i, i, (i + 1 < monos) ? "+" : "\nDEG\n");
+    fflush(script);
+
+    FILE *out = fopen("/dev/null", "w");
+    CheckPtr(out);
+    size_t threads = ParallelThreads();
+    for (int parallel = 0; parallel < 2; ++parallel) {
+        ParallelSetThreads(parallel ? threads : 1);
+        rewind(script);
+        Calculator c = InitCalculator(out, stderr);
+        Reader reader = CreateReader(script);
+        uint64_t start = StatsNow();
+        ParseInput(&c, &reader);
+        Report(parallel ? "PARSE_LONG_PAR" : "PARSE_LONG_SEQ", start);
+        CalculatorClear(&c);
+        DestroyReader(&reader);
+    }
+    ParallelSetThreads(threads);
+    fclose(out);
+    fclose(script);
+}
+
+/**
+ * Mierzy obliczenie wartości długiego wiersza z wielomianem dwóch zmiennych:
+ * wczytanie całego wielomianu i dwa polecenia AT oraz obliczanie w trakcie
+ * wczytywania po dwóch poleceniach AT_NEXT. Wypisuje też liczbę alokacji
+ * tablic jednomianów w obu przypadkach.
+ * @param[in] monos : liczba jednomianów w wierszu
+ */
+static void BenchAtParse(size_t monos) {
+    FILE *line = tmpfile();
+    CheckPtr(line);
+    for (size_t i = 0; i < monos; ++i)
+        fprintf(line, "((1,%zu)+(%zu,0),%zu)%s", i % 7 + 1, i, i, (i + 1 < monos) ? "+" : "\n");
+    fflush(line);
+
+    FILE *out = fopen("/dev/null", "w");
+    CheckPtr(out);
+    for (int streaming = 0; streaming < 2; ++streaming) {
+        FILE *script = tmpfile();
+        CheckPtr(script);
+        if (streaming)
+            fprintf(script, "AT_NEXT 3\nAT_NEXT -2\n");
+        rewind(line);
+        int ch;
+        while ((ch = getc(line)) != EOF)
+            putc(ch, script);
+        fprintf(script, streaming ? "PRINT\n" : "AT 3\nAT -2\nPRINT\n");
+        rewind(script);
+
+        Calculator c = InitCalculator(out, stderr);
+        Reader reader = CreateReader(script);
+        uint64_t allocs = MemoryGetStats(MEMORY_MONOS).allocs;
+        uint64_t start = StatsNow();
+        ParseInput(&c, &reader);
+        Report(streaming ? "PARSE_AT_NEXT" : "PARSE_THEN_AT", start);
+        printf("%s %" PRIu64 "\n", streaming ? "PARSE_AT_NEXT_MONO_ALLOCS" : "PARSE_THEN_AT_MONO_ALLOCS",
+               MemoryGetStats(MEMORY_MONOS).allocs - allocs);
+        CalculatorClear(&c);
+        DestroyReader(&reader);
+        fclose(script);
+    }
+    fclose(out);
+    fclose(line);
+}
+
+/**
+ * Mierzy czas zdjęcia dużego wielomianu ze stosu przy zwalnianiu go od razu
+ * i w wątku zwalniającym.
+ */
+static void BenchReclaim(void) {
+    Poly p = MakeScattered(6, 12);
+    Stack s = InitStack();
+
+    Poly q = PolyClone(&p);
+    StackPush(&s, &q);
+    uint64_t start = StatsNow();
+    StackPop(&s);
+    Report("POP_SYNC", start);
+
+    ReclaimerStart(4096);
+    q = PolyClone(&p);
+    StackPush(&s, &q);
+    start = StatsNow();
+    StackPop(&s);
+    Report("POP_RECLAIM", start);
+    ReclaimerStop();
+
+    PolyDestroy(&p);
+    StackClear(&s);
+}
+
+/**
+ * Mierzy kopiowanie dużego wielomianu, gdy poprzednie kopie są zwalniane
+ * w wątku zwalniającym, i wypisuje, ile tablic jednomianów kopii zostało
+ * zaalokowanych, a ile z nich pobrano z puli.
+ * @param[in] rounds : liczba kopii
+ */
+static void BenchReclaimReuse(size_t rounds) {
+    Poly p = MakeScattered(6, 12);
+    ReclaimerStart(4096);
+    MemoryStats before = MemoryGetStats(MEMORY_MONOS);
+    uint64_t start = StatsNow();
+    for (size_t i = 0; i < rounds; ++i) {
+        Poly q = PolyClone(&p);
+        PolyReclaim(&q);
+    }
+    Report("CLONE_RECLAIM", start);
+    ReclaimerStop();
+    MemoryStats after = MemoryGetStats(MEMORY_MONOS);
+    printf("CLONE_RECLAIM_MONO_ALLOCS %" PRIu64 "\n", after.allocs - before.allocs);
+    printf("CLONE_RECLAIM_RECYCLED %" PRIu64 "\n", after.recycled - before.recycled);
+    PolyDestroy(&p);
+}
+
+/**
+ * Mierzy mnożenie dwóch wielomianów od trzech zmiennych o dużych
+ * współczynnikach zwykłym PolyMul i w trybie modularnym, w jednym wątku
+ * i w ParallelThreads() wątkach.
+ * @param[in] terms : liczba losowanych wyrazów każdego czynnika
+ */
+static void BenchModular(size_t terms) {
+    Poly factors[2];
+    unsigned seed = 1;
+    for (size_t k = 0; k < 2; ++k) {
+        PolyBuilder b;
+        InitPolyBuilder(&b, 3);
+        for (size_t i = 0; i < terms; ++i) {
+            poly_exp_t term[3];
+            for (size_t v = 0; v < 3; ++v) {
+                seed = seed * 1103515245u + 12345u;
+                term[v] = (poly_exp_t) ((seed >> 16) % 32);
+            }
+            seed = seed * 1103515245u + 12345u;
+            PolyBuilderAdd(&b, term, ((poly_coeff_t) (seed >> 8) - (1L << 23)) << 16);
+        }
+        factors[k] = PolyBuilderFinish(&b);
+        PolyBuilderDestroy(&b);
+    }
+
+    uint64_t start = StatsNow();
+    Poly expected = PolyMul(&factors[0], &factors[1]);
+    Report("MUL_CLASSIC", start);
+
+    size_t threads = ParallelThreads();
+    ModularSetEnabled(true);
+    for (int parallel = 0; parallel <= 1; ++parallel) {
+        ParallelSetThreads(parallel ? threads : 1);
+        start = StatsNow();
+        Poly product = PolyMul(&factors[0], &factors[1]);
+        Report(parallel ? "MUL_MODULAR_PAR" : "MUL_MODULAR_SEQ", start);
+        if (!PolyIsEq(&product, &expected))
+            fprintf(stderr, "MODULAR WRONG RESULT\n");
+        PolyDestroy(&product);
+    }
+    ModularSetEnabled(false);
+    ParallelSetThreads(threads);
+
+    PolyDestroy(&expected);
+    for (size_t k = 0; k < 2; ++k)
+        PolyDestroy(&factors[k]);
+}
+
+/**
+ * Mierzy mnożenie gęstych wielomianów jednej zmiennej o rosnącej liczbie
+ * wyrazów zwykłym algorytmem (PolyMulAdd z zerem) i przez NTT, żeby wyznaczyć
+ * próg NTT_MIN_TERMS.
+ * @param[in] max_terms : największa liczba wyrazów czynnika
+ */
+static void BenchNtt(size_t max_terms) {
+    Poly zero = PolyZero();
+    unsigned seed = 1;
+    for (size_t terms = 4; terms <= max_terms; terms *= 2) {
+        Poly factors[2];
+        for (size_t k = 0; k < 2; ++k) {
+            Mono *monos = (Mono*) MemoryAlloc(terms * sizeof(Mono), MEMORY_WORK);
+            for (size_t i = 0; i < terms; ++i) {
+                seed = seed * 1103515245u + 12345u;
+                Poly coeff = PolyFromCoeff(((poly_coeff_t) (seed >> 8) - (1L << 23)) << 16 | 1);
+                monos[i] = MonoFromPoly(&coeff, (poly_exp_t) i);
+            }
+            factors[k] = PolyAddMonos(terms, monos);
+            MemoryFree(monos, terms * sizeof(Mono), MEMORY_WORK);
+        }
+
+        // mniejsze mnożenia powtarzamy, żeby czas był mierzalny
+        size_t rounds = max_terms / terms;
+        char name[32];
+        uint64_t start = StatsNow();
+        for (size_t r = 0; r < rounds; ++r) {
+            Poly product = PolyMulAdd(&factors[0], &factors[1], &zero);
+            PolyDestroy(&product);
+        }
+        snprintf(name, sizeof(name), "MUL_DENSE_%zu", terms);
+        Report(name, start);
+
+        start = StatsNow();
+        for (size_t r = 0; r < rounds; ++r) {
+            Poly product;
+            if (!PolyMulNtt(&factors[0], &factors[1], &product))
+                fprintf(stderr, "NTT REFUSED\n");
+            PolyDestroy(&product);
+        }
+        snprintf(name, sizeof(name), "MUL_NTT_%zu", terms);
+        Report(name, start);
+
+        for (size_t k = 0; k < 2; ++k)
+            PolyDestroy(&factors[k]);
+    }
+}
+
+/**
+ * Mierzy obliczanie wartości wielomianu trzech zmiennych w wielu punktach:
+ * kolejnymi PolyAt, programem z PolyCompile po jednym punkcie
+ * i blokami punktów.
+ * @param[in] points : liczba punktów
+ */
+static void BenchProgram(size_t points) {
+    PolyBuilder b;
+    InitPolyBuilder(&b, 3);
+    unsigned seed = 1;
+    for (size_t i = 0; i < 2000; ++i) {
+        poly_exp_t term[3];
+        for (size_t v = 0; v < 3; ++v) {
+            seed = seed * 1103515245u + 12345u;
+            term[v] = (poly_exp_t) ((seed >> 16) % 20);
+        }
+        seed = seed * 1103515245u + 12345u;
+        PolyBuilderAdd(&b, term, (poly_coeff_t) (seed >> 16) - 32768);
+    }
+    Poly p = PolyBuilderFinish(&b);
+    PolyBuilderDestroy(&b);
+
+    poly_coeff_t *xs = (poly_coeff_t*) MemoryAlloc(3 * points * sizeof(poly_coeff_t), MEMORY_WORK);
+    poly_coeff_t *values = (poly_coeff_t*) MemoryAlloc(points * sizeof(poly_coeff_t), MEMORY_WORK);
+    for (size_t i = 0; i < 3 * points; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        xs[i] = (poly_coeff_t) (seed >> 16) % 100;
+    }
+
+    // PolyAt tworzy wielomiany pośrednie, więc mierzymy je na setnej części punktów
+    uint64_t start = StatsNow();
+    poly_coeff_t at_sum = 0;
+    for (size_t i = 0; i < points / 100; ++i) {
+        Poly cur = PolyClone(&p);
+        for (size_t v = 0; v < 3; ++v) {
+            Poly next = PolyAt(&cur, xs[3 * i + v]);
+            PolyDestroy(&cur);
+            cur = next;
+        }
+        at_sum += cur.coeff;
+    }
+    Report("EVAL_AT_1_100", start);
+
+    start = StatsNow();
+    PolyProgram prog = PolyCompile(&p);
+    Report("COMPILE", start);
+
+    start = StatsNow();
+    for (size_t i = 0; i < points; ++i)
+        values[i] = PolyProgramEval(&prog, xs + 3 * i);
+    Report("EVAL_PROGRAM", start);
+
+    start = StatsNow();
+    PolyProgramEvalBlock(&prog, points, xs, values);
+    Report("EVAL_PROGRAM_BLOCK", start);
+
+    poly_coeff_t program_sum = 0;
+    for (size_t i = 0; i < points / 100; ++i)
+        program_sum += values[i];
+    if (program_sum != at_sum)
+        fprintf(stderr, "PROGRAM WRONG RESULT\n");
+
+    PolyProgramDestroy(&prog);
+    MemoryFree(xs, 3 * points * sizeof(poly_coeff_t), MEMORY_WORK);
+    MemoryFree(values, points * sizeof(poly_coeff_t), MEMORY_WORK);
+    PolyDestroy(&p);
+}
+
+/**
+ * Mierzy ustalenie zmiennych @f$x_1@f$ i @f$x_4@f$ wielomianu sześciu
+ * zmiennych: złożeniem PolyCompose ze stałymi i wielomianami @f$x_j@f$ pod
+ * pozostałymi zmiennymi oraz jednym przejściem PolyEvalPartial.
+ * @param[in] terms : liczba wyrazów wielomianu
+ */
+static void BenchPartial(size_t terms) {
+    PolyBuilder b;
+    InitPolyBuilder(&b, 6);
+    unsigned seed = 1;
+    for (size_t i = 0; i < terms; ++i) {
+        poly_exp_t term[6];
+        for (size_t v = 0; v < 6; ++v) {
+            seed = seed * 1103515245u + 12345u;
+            term[v] = (poly_exp_t) ((seed >> 16) % 10);
+        }
+        seed = seed * 1103515245u + 12345u;
+        PolyBuilderAdd(&b, term, (poly_coeff_t) (seed >> 16) - 32768);
+    }
+    Poly p = PolyBuilderFinish(&b);
+    PolyBuilderDestroy(&b);
+
+    const uint64_t mask = (1u << 1) | (1u << 4);
+    const poly_coeff_t values[2] = {3, -5};
+    Poly q[6];
+    size_t fixed = 0;
+    for (size_t v = 0; v < 6; ++v) {
+        if ((mask >> v) & 1) {
+            q[v] = PolyFromCoeff(values[fixed++]);
+            continue;
+        }
+        poly_exp_t exps[6] = {0};
+        exps[v - fixed] = 1;
+        InitPolyBuilder(&b, v - fixed + 1);
+        PolyBuilderAdd(&b, exps, 1);
+        q[v] = PolyBuilderFinish(&b);
+        PolyBuilderDestroy(&b);
+    }
+
+    uint64_t start = StatsNow();
+    Poly composed = PolyCompose(&p, 6, q);
+    Report("PARTIAL_COMPOSE", start);
+
+    start = StatsNow();
+    Poly partial = PolyEvalPartial(&p, mask, values);
+    Report("PARTIAL_EVAL", start);
+
+    if (!PolyIsEq(&composed, &partial))
+        fprintf(stderr, "PARTIAL WRONG RESULT\n");
+
+    for (size_t v = 0; v < 6; ++v)
+        PolyDestroy(&q[v]);
+    PolyDestroy(&composed);
+    PolyDestroy(&partial);
+    PolyDestroy(&p);
+}
+
+/**
+ * Uruchamia pomiary.
+ * @param[in] argc : liczba argumentów
+ * @param[in] argv : argumenty, opcjonalnie głębokość zagnieżdżenia
+ * @return 0
+ */
+int main(int argc, char *argv[]) {
+    size_t depth = (argc > 1) ? strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_DEPTH;
+    BenchDeepChain(depth);
+    BenchCompact();
+    BenchSub();
+    BenchMany(5000);
+    BenchAt(20000);
+    BenchSortMonos(1 << 20);
+    BenchBuilder(1000000);
+    BenchModular(4000);
+    BenchNtt(4096);
+    BenchProgram(100000);
+    BenchPartial(200000);
+    BenchDataflow(8);
+    BenchPipeline(8);
+    BenchLongLine(1000000);
+    BenchAtParse(1000000);
+    BenchReclaim();
+    BenchReclaimReuse(200);
+    MemoryPoolTrim();
+    return 0;
+}
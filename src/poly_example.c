@@ -2,11 +2,30 @@
 #undef NDEBUG
 #endif
 
+/** Udostępnia funkcje POSIX (katalogi tymczasowe) przy kompilacji z -std=c11. */
+#define _POSIX_C_SOURCE 200809L
+
 #include "poly.h"
+#include "batch.h"
+#include "builder.h"
+#include "dataflow.h"
+#include "geobucket.h"
+#include "libpoly.h"
+#include "modular.h"
+#include "parallel.h"
+#include "partial.h"
+#include "pipeline.h"
+#include "program.h"
+#include "reclaimer.h"
+#include "terms.h"
 #include <assert.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define CHECK_PTR(p)  \
   do {                \
@@ -238,6 +257,93 @@ static bool SimpleMulTest(void) {
     return res;
 }
 
+static bool TestMulAdd(Poly a, Poly b, Poly c) {
+    Poly product = PolyMul(&a, &b);
+    Poly expected = PolyAdd(&product, &c);
+    Poly fused = PolyMulAdd(&a, &b, &c);
+    bool is_eq = PolyIsEq(&fused, &expected);
+    // składnik przeciwny jest widokiem ze znacznikiem POLY_NEG_TAG
+    Poly neg_c = PolyNegShallow(&c);
+    Poly diff = PolyMulAdd(&a, &b, &neg_c);
+    Poly expected_diff = PolySub(&product, &c);
+    is_eq &= PolyIsEq(&diff, &expected_diff);
+    PolyDestroy(&a);
+    PolyDestroy(&b);
+    PolyDestroy(&c);
+    PolyDestroy(&product);
+    PolyDestroy(&expected);
+    PolyDestroy(&fused);
+    PolyDestroy(&diff);
+    PolyDestroy(&expected_diff);
+    return is_eq;
+}
+
+static bool MulAddTest(void) {
+    bool res = true;
+    res &= TestMulAdd(C(2), C(3), C(4));
+    res &= TestMulAdd(C(2), P(C(1), 1), P(C(1), 2));
+    res &= TestMulAdd(P(C(1), 1), P(C(1), 1), C(0));
+    res &= TestMulAdd(P(C(1), 1), P(C(1), 1), C(5));
+    // iloczyn skraca się z dodawanym wielomianem
+    res &= TestMulAdd(P(C(-1), 0, C(1), 1), P(C(1), 0, C(1), 1), P(C(1), 0, C(-1), 2));
+    res &= TestMulAdd(POLY_P, POLY_P, POLY_P);
+    res &= TestMulAdd(P(P(C(1), 2), 0, P(C(1), 1), 1), P(C(3), 1), P(P(C(-3), 1), 2, C(7), 5));
+    return res;
+}
+
+static bool TestSortedMonos(Mono *monos, size_t count, size_t distinct) {
+    Poly p = PolyAddMonos(count, monos);
+    bool res = !PolyIsCoeff(&p) && PolyGetSize(&p) == distinct;
+    for (size_t i = 0; res && i < distinct; ++i) {
+        Mono m = PolyGetMono(&p, i);
+        // każdy wykładnik występuje w tablicy dwa razy, z jednomianami 1 i 2
+        res &= MonoGetExp(&m) == (poly_exp_t) (i * 1000) && PolyIsCoeff(&m.p) && m.p.coeff == 3;
+    }
+    PolyDestroy(&p);
+    return res;
+}
+
+static bool SortMonosTest(void) {
+    bool res = true;
+    size_t sizes[] = {10, 100, 5000};
+    for (size_t s = 0; s < 3; ++s) {
+        size_t distinct = sizes[s], count = 2 * distinct;
+        Mono *monos = (Mono*) malloc(count * sizeof(Mono));
+        CHECK_PTR(monos);
+
+        // tablica posortowana
+        for (size_t i = 0; i < count; ++i)
+            monos[i] = M(C(1 + (poly_coeff_t) (i % 2)), (poly_exp_t) (i / 2 * 1000));
+        res &= TestSortedMonos(monos, count, distinct);
+
+        // dwie posortowane serie, jak w iloczynie wielomianów
+        for (size_t i = 0; i < count; ++i)
+            monos[i] = M(C(1 + (poly_coeff_t) (i / distinct)), (poly_exp_t) (i % distinct * 1000));
+        res &= TestSortedMonos(monos, count, distinct);
+
+        // kolejność losowa
+        for (size_t i = 0; i < count; ++i)
+            monos[i] = M(C(1 + (poly_coeff_t) (i % 2)), (poly_exp_t) (i / 2 * 1000));
+        unsigned seed = 7;
+        for (size_t i = count - 1; i > 0; --i) {
+            seed = seed * 1103515245u + 12345u;
+            size_t j = (seed >> 8) % (i + 1);
+            Mono tmp = monos[i];
+            monos[i] = monos[j];
+            monos[j] = tmp;
+        }
+        res &= TestSortedMonos(monos, count, distinct);
+        free(monos);
+    }
+
+    // porównanie nie może liczyć różnicy wykładników
+    Mono big[] = {M(C(1), INT32_MAX), M(C(2), 0), M(C(3), INT32_MAX - 1)};
+    Poly p = PolyAddMonos(3, big);
+    res &= PolyGetSize(&p) == 3 && MonoGetExp(&p.arr[0]) == 0 && MonoGetExp(&p.arr[2]) == INT32_MAX;
+    PolyDestroy(&p);
+    return res;
+}
+
 static bool SimpleNegTest(void) {
     Poly a = P(P(C(1), 0, C(2), 2), 0, P(C(1), 1), 1, C(1), 2);
     Poly b = PolyNeg(&a);
@@ -312,9 +418,1126 @@ static bool OverflowTest(void) {
     res &= TestAt(P(C(1), 64), 2, C(0));
     res &= TestAt(P(C(1), 0, C(1), 64), 2, C(1));
     res &= TestAt(P(P(C(1), 1), 64), 2, C(0));
+    // jedyny pozostały jednomian ma wykładnik 0, więc wynik jest stały
+    res &= TestMul(P(C(3), 0, C(1L << 32), 1), C(1L << 32), C(3L << 32));
+    return res;
+}
+
+static bool InlineMonoTest(void) {
+    bool res = true;
+    Poly p = P(C(5), 3);
+    Poly q = P(P(C(2), 1), 3);
+    res &= PolyIsInline(&p) && !PolyIsInline(&q) && PolyGetSize(&p) == 1;
+    res &= PolyDeg(&p) == 3 && PolyDeg(&q) == 4;
+    // suma dwóch jednomianów o tym samym wykładniku pozostaje zapisana w miejscu
+    res &= TestAdd(P(C(5), 3), P(C(-2), 3), P(C(3), 3));
+    res &= TestAdd(P(C(5), 3), P(C(-5), 3), C(0));
+    res &= TestAdd(P(C(5), 3), P(C(1), 4), P(C(5), 3, C(1), 4));
+    res &= TestMul(P(C(5), 3), P(C(2), 1), P(C(10), 4));
+    res &= TestEq(PolyNeg(&p), P(C(-5), 3), true);
+    res &= TestEq(PolyAt(&q, 2), P(C(16), 1), true);
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+    return res;
+}
+
+static bool CompactTest(void) {
+    bool res = true;
+    Poly p = P(POLY_P, 1, P(C(2), 0, P(C(3), 1), 2), 4);
+    Poly compact = PolyCompact(&p);
+    Poly clone = PolyClone(&compact);
+    res &= PolyIsCompact(&compact) && PolyIsCompact(&clone);
+    res &= PolyIsEq(&p, &compact) && PolyIsEq(&compact, &clone);
+    res &= PolyDeg(&compact) == PolyDeg(&p);
+    Poly two = C(2);
+    res &= TestEq(PolyAdd(&compact, &clone), PolyMul(&p, &two), true);
+    res &= TestEq(PolyNeg(&clone), PolyNeg(&p), true);
+    PolyDestroy(&p);
+    PolyDestroy(&compact);
+    PolyDestroy(&clone);
+    return res;
+}
+
+static bool NegTagTest(void) {
+    bool res = true;
+    Poly p = P(POLY_P, 1, P(C(2), 0, P(C(3), 1), 2), 4);
+    Poly neg = PolyNeg(&p);
+    Poly view = PolyNegShallow(&p);
+    res &= PolyIsNeg(&view) && !PolyIsNeg(&neg);
+    res &= PolyIsEq(&view, &neg) && !PolyIsEq(&view, &p);
+    Poly view_view = PolyNegShallow(&view);
+    res &= PolyIsEq(&view_view, &p);
+    res &= TestEq(PolyAdd(&view, &p), C(0), true);
+    res &= TestEq(PolySub(&p, &view), PolyAdd(&p, &p), true);
+    res &= TestEq(PolyClone(&view), PolyClone(&neg), true);
+    res &= TestEq(PolyMul(&view, &view), PolyMul(&p, &p), true);
+    res &= TestEq(PolyAt(&view, 2), PolyAt(&neg, 2), true);
+    res &= PolyDeg(&view) == PolyDeg(&p) && PolyDegBy(&view, 1) == PolyDegBy(&p, 1);
+
+    Poly compact = PolyCompact(&view);
+    Poly compact_neg = PolyNegShallow(&compact);
+    res &= PolyIsEq(&compact, &neg) && PolyIsEq(&compact_neg, &p);
+    Poly clone = PolyClone(&compact_neg);
+    res &= PolyIsCompact(&clone) && PolyIsEq(&clone, &p);
+    PolyDestroy(&clone);
+    // wielomian przeciwny przejmuje tablice skompaktowanego wielomianu
+    PolyDestroy(&compact_neg);
+    PolyDestroy(&neg);
+    PolyDestroy(&p);
+    return res;
+}
+
+static bool ManyTest(void) {
+    bool res = true;
+    Poly polys[1000];
+    for (size_t i = 0; i < 1000; ++i) {
+        // ((1,i)+(-1,1),i%7)+((2,i+1),i+1)+(3,0), różne wykładniki i znaki
+        Mono inner[2] = {M(C(1), (poly_exp_t) i), M(C(-1), 1)};
+        Mono monos[3] = {M(PolyAddMonos(2, inner), (poly_exp_t) i % 7),
+                         M(PolyInline(2, (poly_exp_t) i + 1), (poly_exp_t) i + 1), M(C(3), 0)};
+        polys[i] = PolyAddMonos(3, monos);
+        if (i % 5 == 0)
+            polys[i] = PolyNegShallow(&polys[i]);
+    }
+
+    res &= TestEq(PolySumMany(0, polys), C(0), true);
+    res &= TestEq(PolyProductMany(0, polys), C(1), true);
+    res &= TestEq(PolyProductMany(1, polys), PolyClone(&polys[0]), true);
+
+    // sprawdzamy też podział między wątki, niezależnie od liczby procesorów
+    for (size_t threads = 1; threads <= 4; threads += 3) {
+        ParallelSetThreads(threads);
+        Poly sum = PolyZero(), product = PolyFromCoeff(1);
+        for (size_t i = 0; i < 1000; ++i) {
+            Poly next = PolyAdd(&sum, &polys[i]);
+            PolyDestroy(&sum);
+            sum = next;
+        }
+        // czynniki mają po kilkaset jednomianów, więc mnożenie jest dzielone między wątki
+        Poly factors[2];
+        for (size_t i = 0; i < 2; ++i)
+            factors[i] = PolySumMany(200, polys + 200 * i);
+        for (size_t i = 0; i < 2; ++i) {
+            Poly next = PolyMul(&product, &factors[i]);
+            PolyDestroy(&product);
+            product = next;
+        }
+        res &= TestEq(PolySumMany(1000, polys), sum, true);
+        res &= TestEq(PolyProductMany(2, factors), product, true);
+        for (size_t i = 0; i < 2; ++i)
+            PolyDestroy(&factors[i]);
+    }
+    ParallelSetThreads(0);
+
+    Poly zero = C(0);
+    Poly with_zero[3] = {polys[0], zero, polys[1]};
+    res &= TestEq(PolyProductMany(3, with_zero), C(0), true);
+    Poly opposite[2] = {polys[3], PolyNegShallow(&polys[3])};
+    res &= TestEq(PolySumMany(2, opposite), C(0), true);
+
+    for (size_t i = 0; i < 1000; ++i)
+        PolyDestroy(&polys[i]);
+    return res;
+}
+
+static bool GeobucketTest(void) {
+    bool res = true;
+    Geobucket g = InitGeobucket();
+    Poly sum = PolyZero();
+    for (size_t i = 0; i < 500; ++i) {
+        // (x_1^i + x_1^{i/2} - 1) x_0^{i%3}, składniki o różnych rozmiarach się znoszą
+        Mono inner[3] = {M(C(1), (poly_exp_t) i), M(C(1), (poly_exp_t) i / 2), M(C(-1), 0)};
+        Mono outer = M(PolyAddMonos(3, inner), (poly_exp_t) i % 3);
+        Poly p = PolyAddMonos(1, &outer);
+        Poly next = PolyAdd(&sum, &p);
+        PolyDestroy(&sum);
+        sum = next;
+        GeobucketAdd(&g, &p);
+        res &= PolyIsZero(&p);
+    }
+    res &= TestEq(GeobucketSum(&g), sum, true);
+    res &= TestEq(GeobucketSum(&g), C(0), true);
+
+    Poly x = P(C(1), 1);
+    GeobucketAdd(&g, &x);
+    GeobucketDestroy(&g);
+    res &= TestEq(GeobucketSum(&g), C(0), true);
+
+    // wiele jednomianów o tym samym wykładniku w PolyAddMonos
+    Mono monos[300];
+    for (size_t i = 0; i < 300; ++i)
+        monos[i] = M(P(C(i % 2 ? -1 : 1), (poly_exp_t) i / 2), 4);
+    res &= TestEq(PolyAddMonos(300, monos), C(0), true);
+    return res;
+}
+
+static bool ReclaimTest(void) {
+    bool res = true;
+    Poly p = P(POLY_P, 1, P(C(2), 0, P(C(3), 1), 2), 4);
+    Poly compact = PolyCompact(&p);
+    res &= PolyHasMonos(&p, 7) && !PolyHasMonos(&p, 8);
+    res &= PolyHasMonos(&compact, 7) && !PolyHasMonos(&compact, 8);
+    PolyDestroy(&compact);
+
+    MemoryStats before = MemoryGetStats(MEMORY_MONOS);
+    ReclaimerStart(2);
+    // więcej wielomianów niż mieści kolejka, dodający muszą czekać na miejsce
+    for (size_t i = 0; i < 4 * RECLAIM_QUEUE_SIZE; ++i) {
+        Poly q = PolyMul(&p, &p);
+        PolyReclaim(&q);
+        res &= PolyIsZero(&q);
+    }
+    ReclaimerStop();
+    MemoryStats after = MemoryGetStats(MEMORY_MONOS);
+    res &= after.live_bytes == before.live_bytes;
+
+#ifdef POLY_MEMORY_STATS
+    // tablice zwolnione w tle wracają przez pulę wspólną do wątku, który je alokuje
+    MemoryPoolTrim();
+    ReclaimerStart(2);
+    Poly q = PolyClone(&p);
+    PolyReclaim(&q);
+    ReclaimerStop();
+    before = MemoryGetStats(MEMORY_MONOS);
+    q = PolyClone(&p);
+    after = MemoryGetStats(MEMORY_MONOS);
+    res &= after.allocs > before.allocs && after.recycled - before.recycled == after.allocs - before.allocs;
+    PolyDestroy(&q);
+#endif
+    PolyDestroy(&p);
+    return res;
+}
+
+typedef struct NestedTasks {
+    atomic_size_t done;
+    atomic_size_t threads;
+} NestedTasks;
+
+static void InnerTask(void *ctx, size_t i) {
+    (void) i;
+    atomic_fetch_add(&((NestedTasks*) ctx)->done, 1);
+}
+
+static void OuterTask(void *ctx, size_t i) {
+    (void) i;
+    // zagnieżdżone zadania wykonuje wątek zadania zewnętrznego
+    NestedTasks *tasks = (NestedTasks*) ctx;
+    ParallelRun(4, 4, InnerTask, ctx);
+    atomic_fetch_add(&tasks->threads, ParallelReserve(4));
+}
+
+static bool ParallelTest(void) {
+    ParallelSetThreads(4);
+    bool res = ParallelReserve(2) == 2 && ParallelReserve(5) == 1 && ParallelReserve(1) == 0;
+    ParallelRelease(3);
+
+    NestedTasks tasks;
+    atomic_init(&tasks.done, 0);
+    atomic_init(&tasks.threads, 0);
+    ParallelRun(8, 4, OuterTask, &tasks);
+    // zadania zewnętrzne zajmują cały limit, więc nie mogą już nic zarezerwować
+    res &= atomic_load(&tasks.done) == 32 && atomic_load(&tasks.threads) == 0;
+
+    // przy wyczerpanym limicie ParallelRun wykonuje wszystko w wątku wywołującym
+    res &= ParallelReserve(3) == 3;
+    atomic_store(&tasks.done, 0);
+    ParallelRun(8, 4, InnerTask, &tasks);
+    res &= atomic_load(&tasks.done) == 8;
+    ParallelRelease(3);
+    res &= ParallelReserve(3) == 3;
+    ParallelRelease(3);
+    ParallelSetThreads(0);
+    return res;
+}
+
+static bool SameContents(FILE *a, FILE *b) {
+    rewind(a);
+    rewind(b);
+    int x, y;
+    do {
+        x = getc(a);
+        y = getc(b);
+    } while (x == y && x != EOF);
+    return x == y;
+}
+
+static bool FileEquals(FILE *file, const char *expected) {
+    rewind(file);
+    int c;
+    while ((c = getc(file)) != EOF && c == (unsigned char) *expected)
+        expected++;
+    return c == EOF && *expected == '\0';
+}
+
+static bool RunScript(FILE *script, size_t threads, bool pipeline, FILE *out, FILE *err) {
+    rewind(script);
+    Calculator c = InitCalculator(out, err);
+    Reader reader = CreateReader(script);
+    if (pipeline)
+        PipelineInput(&c, &reader);
+    else if (threads == 0)
+        ParseInput(&c, &reader);
+    else
+        DataflowInput(&c, &reader, threads);
+    fprintf(out, "%zu\n", StackGetSize(&c.stack));
+    CalculatorClear(&c);
+    DestroyReader(&reader);
+    return true;
+}
+
+static FILE *WriteMixedScript(void) {
+    FILE *script = tmpfile();
+    CHECK_PTR(script);
+    // niezależne wyniki pośrednie, odczyty przed zdjęciem ze stosu, błędy
+    // i więcej wierszy niż mieści jeden graf
+    for (size_t i = 0; i < DATAFLOW_BATCH / 4; ++i) {
+        fprintf(script, "((1,1)+(%zu,0),2)+(1,%zu)\nCLONE\nMUL\n", i, i % 5);
+        fprintf(script, (i % 3 == 0) ? "PRINT\nNEG\nADD\n" : "IS_EQ\nADD_N 0\n");
+        fprintf(script, (i % 7 == 0) ? "COMPOSE 1\nDEG_BY 1\nAT 2\nPOP\nWRONG\n" : "DEG\n");
+        if (i % 5 == 1)
+            fprintf(script, "%zu\nAT_VARS 3\nPRINT\n", i);
+        if (i % 6 == 2)
+            fprintf(script, "AT_NEXT %zu\nAT_NEXT -1\n((1,1)+(%zu,0),2)+(1,3)\nPRINT\n", i, i);
+    }
+    fprintf(script, "ADD_N 600\nPRINT\nSTATS X\nMUL_N 3\nPOP\n");
+    return script;
+}
+
+static bool SameRun(FILE *script, size_t threads, bool pipeline) {
+    FILE *out[2] = {tmpfile(), tmpfile()}, *err[2] = {tmpfile(), tmpfile()};
+    CHECK_PTR(out[0]); CHECK_PTR(out[1]); CHECK_PTR(err[0]); CHECK_PTR(err[1]);
+    bool res = RunScript(script, 0, false, out[0], err[0]) &&
+               RunScript(script, threads, pipeline, out[1], err[1]);
+    res &= SameContents(out[0], out[1]) && SameContents(err[0], err[1]);
+    for (int i = 0; i < 2; ++i) {
+        fclose(out[i]);
+        fclose(err[i]);
+    }
+    return res;
+}
+
+static bool DataflowTest(void) {
+    FILE *script = WriteMixedScript();
+    bool res = true;
+    for (size_t threads = 1; threads <= 4; threads += 3)
+        res &= SameRun(script, threads, false);
+    fclose(script);
+    return res;
+}
+
+static bool PipelineTest(void) {
+    // skrypt ma kilka razy więcej wierszy, niż mieści kolejka
+    FILE *script = WriteMixedScript();
+    bool res = SameRun(script, 0, true);
+    fclose(script);
+
+    // puste wejście i wejście bez znaku nowej linii na końcu
+    script = tmpfile();
+    CHECK_PTR(script);
+    res &= SameRun(script, 0, true);
+    fputs("(1,2)\nCLONE\nMUL\nPRINT", script);
+    res &= SameRun(script, 0, true);
+    fclose(script);
     return res;
 }
 
+static void WriteLongPoly(FILE *script, size_t count, const char *sep) {
+    // jednomiany o powtarzających się wykładnikach i plusach wewnątrz nawiasów
+    for (size_t i = 0; i < count; ++i)
+        fprintf(script, "((1,%zu)+(%zu,0),%zu)%s", i % 3 + 1, i, i % 50, (i + 1 < count) ? sep : "");
+}
+
+static size_t CountLines(FILE *file) {
+    rewind(file);
+    size_t lines = 0;
+    int c;
+    while ((c = getc(file)) != EOF)
+        lines += (c == '\n');
+    return lines;
+}
+
+static bool LongLineTest(void) {
+    // ponad PARSE_PARALLEL_LINE znaków w jednym wierszu
+    size_t count = PARSE_PARALLEL_LINE / 16;
+    FILE *line = tmpfile(), *split = tmpfile(), *wrong = tmpfile();
+    CHECK_PTR(line); CHECK_PTR(split); CHECK_PTR(wrong);
+    WriteLongPoly(line, count, "+");
+    fputs("\nPRINT\n", line);
+    WriteLongPoly(split, count, "\n");
+    fprintf(split, "\nADD_N %zu\nPRINT\n", count);
+
+    const char *suffixes[] = {"+5\n", "+\n", " \n", ",1)\n", "+(1,2)\n"};
+    for (size_t i = 0; i < 5; ++i) {
+        WriteLongPoly(wrong, count, "+");
+        fputs(suffixes[i], wrong);
+    }
+    WriteLongPoly(wrong, count / 2, "+");
+    fputs("+((1,2),3", wrong);
+    WriteLongPoly(wrong, count / 2, "+");
+    fputs("\n", wrong);
+    WriteLongPoly(wrong, count, "+");
+
+    // współczynniki z zerami wiodącymi dłuższe niż PARSE_PARALLEL_LINE
+    FILE *coeffs = tmpfile();
+    CHECK_PTR(coeffs);
+    for (size_t i = 0; i < 3; ++i) {
+        fputs((i == 1) ? "-" : "", coeffs);
+        for (size_t j = 0; j < PARSE_PARALLEL_LINE; ++j)
+            putc('0', coeffs);
+        fputs((i == 2) ? "+5\nPRINT\n" : "5\nPRINT\n", coeffs);
+    }
+
+    bool res = true;
+    for (size_t threads = 1; threads <= 4; threads += 3) {
+        ParallelSetThreads(threads);
+        FILE *out[2] = {tmpfile(), tmpfile()}, *err[2] = {tmpfile(), tmpfile()};
+        CHECK_PTR(out[0]); CHECK_PTR(out[1]); CHECK_PTR(err[0]); CHECK_PTR(err[1]);
+        res &= RunScript(line, 0, false, out[0], err[0]) && RunScript(split, 0, false, out[1], err[1]);
+        res &= SameContents(out[0], out[1]) && CountLines(err[0]) == 0 && CountLines(err[1]) == 0;
+        res &= RunScript(wrong, 0, false, out[0], err[0]);
+        // błędne są wiersze z dopisanym "+5", "+", spacją, ",1)" i bez nawiasu zamykającego
+        res &= CountLines(err[0]) == 5;
+        for (int i = 0; i < 2; ++i) {
+            fclose(out[i]);
+            fclose(err[i]);
+        }
+        // w wielu wątkach taki sam wynik jak w jednym
+        FILE *coeffs_out = tmpfile(), *coeffs_err = tmpfile();
+        CHECK_PTR(coeffs_out); CHECK_PTR(coeffs_err);
+        res &= RunScript(coeffs, 0, false, coeffs_out, coeffs_err);
+        res &= FileEquals(coeffs_out, "5\n-5\n-5\n2\n") && FileEquals(coeffs_err, "ERROR 5 WRONG POLY\n");
+        fclose(coeffs_out);
+        fclose(coeffs_err);
+    }
+    ParallelSetThreads(0);
+
+    fclose(line);
+    fclose(split);
+    fclose(wrong);
+    fclose(coeffs);
+    return res;
+}
+
+static char *DeepChainText(size_t depth, char innermost) {
+    char *text = malloc(4 * depth + 2);
+    CHECK_PTR(text);
+    memset(text, '(', depth);
+    text[depth] = innermost;
+    for (size_t d = 0; d < depth; ++d)
+        memcpy(text + depth + 1 + 3 * d, ",1)", 3);
+    text[4 * depth + 1] = '\0';
+    return text;
+}
+
+static bool DeepChainTest(void) {
+    // rekurencja po zagnieżdżeniu przepełniłaby stos wywołań
+    size_t depth = 100000;
+    char *chain = DeepChainText(depth, '1'), *other = DeepChainText(depth, '2');
+    FILE *script = tmpfile(), *out = tmpfile(), *err = tmpfile();
+    CHECK_PTR(script); CHECK_PTR(out); CHECK_PTR(err);
+    fprintf(script, "%s\nCLONE\nIS_EQ\nDEG\nDEG_BY %zu\nPRINT\nPOP\n%s\nIS_EQ\n", chain, depth - 1, other);
+
+    size_t size = 4 * depth + 64;
+    char *expected = malloc(size);
+    CHECK_PTR(expected);
+    snprintf(expected, size, "1\n%zu\n1\n%s\n0\n2\n", depth, chain);
+    bool res = RunScript(script, 0, false, out, err) && FileEquals(out, expected) && CountLines(err) == 0;
+
+    fclose(script);
+    fclose(out);
+    fclose(err);
+    free(expected);
+    free(other);
+    free(chain);
+    return res;
+}
+
+static char *PathIn(const char *dir, const char *name) {
+    char *path = malloc(strlen(dir) + strlen(name) + 2);
+    CHECK_PTR(path);
+    sprintf(path, "%s/%s", dir, name);
+    return path;
+}
+
+static void WriteTextFile(const char *dir, const char *name, const char *text) {
+    char *path = PathIn(dir, name);
+    FILE *file = fopen(path, "w");
+    CHECK_PTR(file);
+    fputs(text, file);
+    fclose(file);
+    free(path);
+}
+
+static bool TextFileEquals(const char *dir, const char *name, const char *expected) {
+    char *path = PathIn(dir, name);
+    FILE *file = fopen(path, "r");
+    free(path);
+    if (file == NULL)
+        return expected == NULL;
+    bool res = expected != NULL && FileEquals(file, expected);
+    fclose(file);
+    return res;
+}
+
+static void RemoveFiles(const char *dir, const char *names[], size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        char *path = PathIn(dir, names[i]);
+        remove(path);
+        free(path);
+    }
+    remove(dir);
+}
+
+static bool BatchOutputs(const char *dir) {
+    return TextFileEquals(dir, "a.out", "3\n") &&
+           TextFileEquals(dir, "a.err", "ERROR 4 STACK UNDERFLOW\n") &&
+           TextFileEquals(dir, "b.out", "(1,4)\n") &&
+           TextFileEquals(dir, "b.err", "ERROR 5 WRONG COMMAND\n");
+}
+
+static bool BatchTest(void) {
+    char dir[] = "/tmp/poly_batch_XXXXXX", out_dir[] = "/tmp/poly_batch_out_XXXXXX";
+    CHECK_PTR(mkdtemp(dir));
+    CHECK_PTR(mkdtemp(out_dir));
+    WriteTextFile(dir, "b", "(1,2)\nCLONE\nMUL\nPRINT\nWRONG\n");
+    WriteTextFile(dir, "a", "3\nPRINT\nPOP\nPOP\n");
+
+    bool res = true;
+    char *paths[] = {dir, NULL};
+    res &= RunBatch(1, paths, 2, NULL, NULL) == 0 && BatchOutputs(dir);
+    // pliki wynikowe z poprzedniego uruchomienia nie są nowymi sesjami,
+    // a wyniki nie zależą od liczby wątków
+    res &= RunBatch(1, paths, 1, NULL, NULL) == 0 && BatchOutputs(dir);
+    res &= TextFileEquals(dir, "a.out.out", NULL) && TextFileEquals(dir, "a.err.out", NULL);
+
+    res &= RunBatch(1, paths, 4, out_dir, NULL) == 0 && BatchOutputs(out_dir);
+    // sesja, której pliku nie da się otworzyć, nie przerywa pozostałych
+    char *missing = PathIn(dir, "missing");
+    char *b_path = PathIn(dir, "b");
+    char *list[] = {missing, b_path};
+    remove(b_path);
+    WriteTextFile(dir, "b", "(1,3)\nCLONE\nMUL\nPRINT\nWRONG\n");
+    res &= RunBatch(2, list, 2, out_dir, NULL) == 1 && TextFileEquals(out_dir, "b.out", "(1,6)\n");
+    res &= TextFileEquals(out_dir, "missing.out", NULL);
+    free(missing);
+    free(b_path);
+
+    const char *names[] = {"a", "b", "a.out", "a.err", "b.out", "b.err"};
+    RemoveFiles(dir, names, 6);
+    RemoveFiles(out_dir, names + 2, 4);
+    return res;
+}
+
+#ifdef POLY_STATS
+static uint64_t StatsCount(FILE *table, const char *name) {
+    // liczba wykonań polecenia w ostatniej wypisanej tabeli
+    rewind(table);
+    char line[256], command[64];
+    uint64_t count, result = 0;
+    while (fgets(line, sizeof(line), table) != NULL) {
+        if (strncmp(line, "COMMAND ", 8) == 0)
+            result = 0;
+        else if (sscanf(line, "%63s %" SCNu64, command, &count) == 2 && strcmp(command, name) == 0)
+            result = count;
+    }
+    return result;
+}
+#endif
+
+static bool StatsTest(void) {
+    bool res = true;
+    FILE *script = tmpfile(), *out = tmpfile(), *err = tmpfile();
+    CHECK_PTR(script); CHECK_PTR(out); CHECK_PTR(err);
+    fputs("(1,2)\nCLONE\nMUL\nPRINT\nCLONE\nADD\nWRONG\nPOP\nPOP\n3\nSTATS\nSTATS\n", script);
+    res &= RunScript(script, 0, false, out, err);
+#ifdef POLY_STATS
+    // drugie STATS widzi już pierwsze, a polecenia bez wykonań są pomijane
+    res &= StatsCount(out, "CLONE") == 2 && StatsCount(out, "POP") == 2 && StatsCount(out, "ADD") == 1;
+    res &= StatsCount(out, "POLY") == 2 && StatsCount(out, "WRONG_COMMAND") == 1;
+    res &= StatsCount(out, "STATS") == 1 && StatsCount(out, "NEG") == 0;
+#else
+    res &= FileEquals(out, "(1,4)\nSTATS DISABLED\nSTATS DISABLED\n1\n");
+#endif
+    fclose(script);
+    fclose(out);
+    fclose(err);
+
+    // percentyle są górnymi końcami przedziałów, ograniczonymi przez maksimum
+    Stats stats, merged;
+    StatsReset(&stats);
+    StatsReset(&merged);
+    StatsRecord(&stats, COMMAND_ADD, 1);
+    StatsRecord(&stats, COMMAND_ADD, 2);
+    StatsRecord(&stats, COMMAND_ADD, 3);
+    StatsRecord(&stats, COMMAND_ADD, 100);
+    StatsRecord(&stats, COMMAND_PRINT, 0);
+    StatsMerge(&merged, &stats);
+    StatsMerge(&merged, &stats);
+
+    char dir[] = "/tmp/poly_stats_XXXXXX";
+    CHECK_PTR(mkdtemp(dir));
+    char *path = PathIn(dir, "stats");
+    res &= StatsDump(&merged, path);
+    res &= TextFileEquals(dir, "stats", "COMMAND COUNT TOTAL_NS P50_NS P99_NS MAX_NS\n"
+                                        "ADD 8 212 3 100 100\n"
+                                        "PRINT 2 0 0 0 0\n");
+    char *missing = PathIn(path, "stats");
+    res &= !StatsDump(&merged, missing);
+    free(missing);
+    free(path);
+    const char *names[] = {"stats"};
+    RemoveFiles(dir, names, 1);
+    return res;
+}
+
+typedef struct SlowSource {
+    const char *text;
+    size_t pos;
+} SlowSource;
+
+static size_t SlowRead(void *ctx, char *buffer, size_t size) {
+    // oddajemy po kilka znaków, żeby wiersze były dzielone między porcje
+    SlowSource *source = (SlowSource*) ctx;
+    size_t count = 0;
+    while (count < 3 && count < size && source->text[source->pos] != '\0')
+        buffer[count++] = source->text[source->pos++];
+    return count;
+}
+
+static bool ParseApiTest(void) {
+    bool res = true;
+    Poly p;
+    res &= PolyParse("(1,2)+((3,1),0)", 15, &p) && TestEq(p, P(P(C(3), 1), 0, C(1), 2), true);
+    res &= PolyParse("-5\n", 3, &p) && TestEq(p, C(-5), true);
+    // napis nie musi kończyć się znakiem '\0'
+    res &= PolyParse("(1,2)+(3,4)", 5, &p) && TestEq(p, P(C(1), 2), true);
+    res &= !PolyParse("(1,2)\n\n", 7, &p) && PolyIsZero(&p);
+    res &= !PolyParse("(1,2) ", 6, &p) && PolyIsZero(&p);
+    res &= !PolyParse("(1,2)+", 6, &p) && PolyIsZero(&p);
+    res &= !PolyParse("", 0, &p) && PolyIsZero(&p);
+
+    const char *script = "(1,2)\nCLONE\nADD\nPRINT\nWRONG\n";
+    FILE *out = tmpfile(), *err = tmpfile();
+    CHECK_PTR(out); CHECK_PTR(err);
+    Calculator c = InitCalculator(out, err);
+    CalcExecute(&c, script, strlen(script));
+    // stos sesji jest zachowany, a wiersze są liczone od nowa
+    CalcExecute(&c, "PRINT\nPOP\nPOP", 13);
+    res &= FileEquals(out, "(2,2)\n(2,2)\n");
+    res &= FileEquals(err, "ERROR 5 WRONG COMMAND\nERROR 3 STACK UNDERFLOW\n");
+    CalculatorClear(&c);
+    fclose(out);
+    fclose(err);
+
+    out = tmpfile();
+    err = tmpfile();
+    CHECK_PTR(out); CHECK_PTR(err);
+    c = InitCalculator(out, err);
+    SlowSource source = {.text = script, .pos = 0};
+    Reader reader = CreateCallbackReader(SlowRead, &source);
+    ParseInput(&c, &reader);
+    DestroyReader(&reader);
+    res &= FileEquals(out, "(2,2)\n");
+    res &= FileEquals(err, "ERROR 5 WRONG COMMAND\n");
+    CalculatorClear(&c);
+    fclose(out);
+    fclose(err);
+    return res;
+}
+
+static Poly AtMany(Poly p, size_t count, const poly_coeff_t values[]) {
+    for (size_t v = 0; v < count; ++v) {
+        Poly next = PolyAt(&p, values[v]);
+        PolyDestroy(&p);
+        p = next;
+    }
+    return p;
+}
+
+static bool AtParseTest(void) {
+    bool res = true;
+    const char *lines[] = {"(1,2)+((3,1),0)", "-5", "((1,2)+(2,1),1)+((3,0)+(1,3),2)", "(1,0)+(-1,0)",
+                           "(((1,2),1)+((2,1),1),1)+((3,0)+(1,3),2)+((-1,0),0)",
+                           "((1,3),2147483647)+(9223372036854775807,63)+((2,1),2)",
+                           "(1,2)+(2", "(1,2) ", "((1,2),1)+", "((1,2)+(1,-1),1)", "((1,2),1),1)"};
+    // 2^32 podniesione do kwadratu daje zero modulo 2^64
+    const poly_coeff_t values[] = {2, -3, 1L << 32};
+    for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); ++i) {
+        for (size_t count = 0; count <= 3; ++count) {
+            Poly p, q;
+            bool correct = PolyParse(lines[i], strlen(lines[i]), &p);
+            res &= PolyParseAt(lines[i], strlen(lines[i]), count, values, &q) == correct;
+            res &= TestEq(q, AtMany(p, count, values), true);
+        }
+    }
+
+    // x_0 * x_1 * ... * x_299 * 2 z wartością 3 dla pierwszych 250 zmiennych
+    size_t depth = 300;
+    char *line = (char*) malloc(4 * depth + 2);
+    CHECK_PTR(line);
+    memset(line, '(', depth);
+    line[depth] = '2';
+    for (size_t d = 0; d < depth; ++d)
+        memcpy(line + depth + 1 + 3 * d, ",1)", 3);
+    poly_coeff_t threes[250];
+    for (size_t v = 0; v < 250; ++v)
+        threes[v] = 3;
+    Poly p, q;
+    res &= PolyParse(line, 4 * depth + 1, &p) && PolyParseAt(line, 4 * depth + 1, 250, threes, &q);
+    res &= TestEq(q, AtMany(p, 250, threes), true);
+    free(line);
+
+    // wartości dotyczą tylko najbliższego wiersza z wielomianem, błędne AT_NEXT je usuwa
+    const char *script = "AT_NEXT 2\nAT_NEXT x\n(1,1)\nPRINT\nAT_NEXT 2\nDEG\nAT_NEXT 3\n# c\n\n(1,2)\nPRINT\n";
+    FILE *out = tmpfile(), *err = tmpfile();
+    CHECK_PTR(out); CHECK_PTR(err);
+    Calculator c = InitCalculator(out, err);
+    CalcExecute(&c, script, strlen(script));
+    res &= FileEquals(out, "(1,1)\n1\n9\n");
+    res &= FileEquals(err, "ERROR 2 AT_NEXT WRONG VALUE\n");
+    CalculatorClear(&c);
+    fclose(out);
+    fclose(err);
+    return res;
+}
+
+static bool LibraryTest(void) {
+    bool res = LibpolyVersion() >> 16 == LIBPOLY_VERSION_MAJOR;
+
+    PolyStack *s = PolyStackCreate();
+    Poly p = P(C(1), 2);
+    PolyStackPush(s, &p);
+    // stos przejął wielomian, a p jest zerowy
+    res &= PolyIsZero(&p) && PolyStackSize(s) == 1;
+    Poly q = P(C(1), 2);
+    res &= PolyIsEq(PolyStackTop(s), &q);
+    PolyDestroy(&q);
+    res &= PolyStackPop(s, &p) && TestEq(p, P(C(1), 2), true);
+    res &= !PolyStackPop(s, &p) && PolyIsZero(&p) && PolyStackTop(s) == NULL;
+    p = C(7);
+    PolyStackPush(s, &p);
+    PolyStackDestroy(s);
+    PolyStackDestroy(NULL);
+
+    FILE *out = tmpfile(), *err = tmpfile();
+    CHECK_PTR(out); CHECK_PTR(err);
+    PolyCalc *c = PolyCalcCreate(out, err);
+    res &= PolyCalcParse("(1,2)+(3,0)", 11, &p);
+    PolyStackPush(PolyCalcStack(c), &p);
+    PolyCalcExecute(c, "CLONE\nMUL\nPRINT\nADD\n", 20);
+    res &= PolyStackSize(PolyCalcStack(c)) == 1;
+    res &= PolyStackPop(PolyCalcStack(c), &p);
+    PolyCalcPrint(out, &p);
+    PolyDestroy(&p);
+    // wielomiany pozostawione na stosie sesji usuwa PolyCalcDestroy
+    PolyCalcExecute(c, "0\n1", 3);
+    PolyCalcDestroy(c);
+    PolyCalcDestroy(NULL);
+    res &= FileEquals(out, "(9,0)+(6,2)+(1,4)\n(9,0)+(6,2)+(1,4)");
+    res &= FileEquals(err, "ERROR 4 STACK UNDERFLOW\n");
+    fclose(out);
+    fclose(err);
+    return res;
+}
+
+static bool TermsTest(void) {
+    bool res = true;
+    // 3 + x0*(2 - x1^2) - 5*x0^2*x2 + 7*x0^4, z dwoma jednomianami zapisanymi bez tablicy
+    Poly p = P(C(3), 0, P(C(2), 0, C(-1), 2), 1, P(P(C(-5), 1), 0), 2, C(7), 4);
+    const poly_exp_t expected_exps[] = {0, 0, 0,  1, 0, 0,  1, 2, 0,  2, 0, 1,  4, 0, 0};
+    const poly_coeff_t expected_coeffs[] = {3, 2, -1, -5, 7};
+    res &= PolyTermCount(&p) == 5 && PolyVarCount(&p) == 3;
+
+    poly_exp_t exps[15];
+    poly_coeff_t coeffs[5];
+    res &= PolyExportTerms(&p, 3, exps, coeffs) == 5;
+    res &= memcmp(exps, expected_exps, sizeof(exps)) == 0;
+    res &= memcmp(coeffs, expected_coeffs, sizeof(coeffs)) == 0;
+
+    // przeciwny wielomian jest widokiem, a iterator uwzględnia jego znak
+    Poly neg = PolyNegShallow(&p);
+    PolyTerms t;
+    InitPolyTerms(&t, &neg);
+    size_t count = 0;
+    while (PolyTermsNext(&t)) {
+        res &= t.coeff == -expected_coeffs[count] && t.vars <= 3;
+        for (size_t i = 0; i < 3; ++i)
+            res &= (i < t.vars ? t.exps[i] : 0) == expected_exps[3 * count + i];
+        count++;
+    }
+    PolyTermsDestroy(&t);
+    res &= count == 5;
+    PolyDestroy(&p);
+
+    Poly zero = C(0), constant = C(-4);
+    res &= PolyTermCount(&zero) == 0 && PolyVarCount(&zero) == 0;
+    res &= PolyExportTerms(&constant, 0, NULL, coeffs) == 1 && coeffs[0] == -4;
+
+    // głęboki wielomian wymaga powiększenia stosu iteratora
+    Poly deep = C(9);
+    for (int i = 0; i < 3 * POLY_TERMS_DEPTH; ++i)
+        deep = P(deep, 1);
+    InitPolyTerms(&t, &deep);
+    res &= PolyTermsNext(&t) && t.vars == 3 * POLY_TERMS_DEPTH && t.coeff == 9 &&
+           t.exps[0] == 1 && t.exps[t.vars - 1] == 1 && !PolyTermsNext(&t);
+    PolyTermsDestroy(&t);
+    PolyDestroy(&deep);
+    return res;
+}
+
+static Poly TermPoly(const poly_exp_t exps[], size_t vars, poly_coeff_t coeff) {
+    Poly p = C(coeff);
+    for (size_t k = vars; k-- > 0;) {
+        Mono m = M(p, exps[k]);
+        p = PolyAddMonos(1, &m);
+    }
+    return p;
+}
+
+static bool BuilderTest(void) {
+    bool res = true;
+    PolyBuilder b;
+    InitPolyBuilder(&b, 3);
+    res &= TestEq(PolyBuilderFinish(&b), C(0), true);
+
+    // wyrazy podane w dowolnej kolejności, z powtórzeniami i skracaniem
+    const poly_exp_t exps[][3] = {{1, 0, 0}, {0, 0, 0}, {1, 0, 0}, {0, 2, 1}, {1, 0, 0}, {0, 2, 1}};
+    const poly_coeff_t coeffs[] = {4, 3, -1, 5, -3, -5};
+    for (size_t i = 0; i < 6; ++i)
+        PolyBuilderAdd(&b, exps[i], coeffs[i]);
+    res &= TestEq(PolyBuilderFinish(&b), C(3), true);
+
+    // wiele serii: wyrazy są losowe, a sumą kontrolną jest geokubełek
+    Geobucket g = InitGeobucket();
+    unsigned seed = 1;
+    for (size_t i = 0; i < 10 * POLY_BUILDER_RUN; ++i) {
+        poly_exp_t term[3];
+        for (size_t k = 0; k < 3; ++k) {
+            seed = seed * 1103515245u + 12345u;
+            term[k] = (poly_exp_t) ((seed >> 16) % 9);
+        }
+        seed = seed * 1103515245u + 12345u;
+        poly_coeff_t coeff = (poly_coeff_t) ((seed >> 16) % 7) - 3;
+        PolyBuilderAdd(&b, term, coeff);
+        Poly p = TermPoly(term, 3, coeff);
+        GeobucketAdd(&g, &p);
+    }
+    res &= TestEq(PolyBuilderFinish(&b), GeobucketSum(&g), true);
+    GeobucketDestroy(&g);
+
+    // po PolyBuilderFinish budowniczy jest pusty i może być dalej używany
+    poly_exp_t x1[3] = {0, 1, 0};
+    PolyBuilderAdd(&b, x1, 2);
+    res &= TestEq(PolyBuilderFinish(&b), P(P(C(2), 1), 0), true);
+    PolyBuilderAdd(&b, x1, 2);
+    PolyBuilderDestroy(&b);
+
+    InitPolyBuilder(&b, 0);
+    PolyBuilderAdd(&b, NULL, 2);
+    PolyBuilderAdd(&b, NULL, 5);
+    res &= TestEq(PolyBuilderFinish(&b), C(7), true);
+    PolyBuilderDestroy(&b);
+    return res;
+}
+
+static Poly RandomTermsPoly(size_t terms, unsigned coeff_bits, unsigned *seed) {
+    PolyBuilder b;
+    InitPolyBuilder(&b, 3);
+    for (size_t i = 0; i < terms; ++i) {
+        poly_exp_t term[3];
+        for (size_t k = 0; k < 3; ++k) {
+            *seed = *seed * 1103515245u + 12345u;
+            term[k] = (poly_exp_t) ((*seed >> 16) % 12);
+        }
+        *seed = *seed * 1103515245u + 12345u;
+        poly_coeff_t coeff = (poly_coeff_t) (*seed >> 8) - (1L << 23);
+        PolyBuilderAdd(&b, term, coeff_bits >= 24 ? coeff * (1L << (coeff_bits - 24)) : coeff % (1L << coeff_bits));
+    }
+    Poly p = PolyBuilderFinish(&b);
+    PolyBuilderDestroy(&b);
+    return p;
+}
+
+static bool ModularTest(void) {
+    bool res = true;
+    unsigned seed = 7;
+    // współczynniki iloczynu od kilku bitów do przepełnienia 64 bitów, czyli od 1 do 7 liczb pierwszych
+    const unsigned coeff_bits[] = {3, 20, 40, 63};
+    for (size_t threads = 1; threads <= 4; threads += 3) {
+        ParallelSetThreads(threads);
+        for (size_t k = 0; k < 4; ++k) {
+            Poly p = RandomTermsPoly(300, coeff_bits[k], &seed), q = RandomTermsPoly(200, coeff_bits[k], &seed);
+            Poly product;
+            res &= PolyMulModular(&p, &q, &product);
+            res &= TestEq(product, PolyMul(&p, &q), true);
+            Poly neg = PolyNegShallow(&q);
+            res &= PolyMulModular(&p, &neg, &product);
+            res &= TestEq(product, PolyMul(&p, &neg), true);
+            PolyDestroy(&p);
+            PolyDestroy(&q);
+        }
+    }
+
+    // LONG_MIN ma wartość bezwzględną 2^63
+    Poly p = P(C(-1), 0, C(LONG_MIN), 1), q = P(C(3), 0, C(LONG_MIN), 1), product;
+    res &= PolyMulModular(&p, &q, &product);
+    res &= TestEq(product, PolyMul(&p, &q), true);
+    res &= PolyMulModular(&p, &p, &product);
+    res &= TestEq(product, PolyMul(&p, &p), true);
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+
+    // wykładniki trzech zmiennych potrzebują po 32 bity, więc nie mieszczą się w kluczu
+    poly_exp_t big[3] = {INT_MAX, INT_MAX, INT_MAX};
+    p = TermPoly(big, 3, 1);
+    res &= !PolyMulModular(&p, &p, &product);
+    PolyDestroy(&p);
+
+    // w trybie modularnym PolyMul i PolyPower dają te same wyniki
+    p = RandomTermsPoly(400, 30, &seed);
+    q = RandomTermsPoly(400, 30, &seed);
+    Poly r = RandomTermsPoly(60, 30, &seed);
+    Poly expected = PolyMul(&p, &q), power = PolyPower(&r, 2);
+    ModularSetEnabled(true);
+    res &= TestEq(PolyMul(&p, &q), expected, true);
+    res &= TestEq(PolyPower(&r, 2), power, true);
+    ModularSetEnabled(false);
+    ParallelSetThreads(0);
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+    PolyDestroy(&r);
+    return res;
+}
+
+static Poly DensePoly(size_t deg, unsigned coeff_bits, unsigned *seed) {
+    Mono *monos = (Mono*) malloc((deg + 1) * sizeof(Mono));
+    CHECK_PTR(monos);
+    size_t count = 0;
+    for (size_t i = 0; i <= deg; ++i) {
+        *seed = *seed * 1103515245u + 12345u;
+        // co czwarty współczynnik jest zerem, a najwyższy nigdy
+        if ((*seed >> 16) % 4 == 0 && i < deg)
+            continue;
+        *seed = *seed * 1103515245u + 12345u;
+        poly_coeff_t coeff = (poly_coeff_t) (*seed >> 8) - (1L << 23);
+        coeff = coeff_bits >= 24 ? coeff * (1L << (coeff_bits - 24)) : coeff % (1L << coeff_bits);
+        monos[count++] = M(C(coeff == 0 ? 1 : coeff), (poly_exp_t) i);
+    }
+    Poly p = PolyAddMonos(count, monos);
+    free(monos);
+    return p;
+}
+
+static bool NttTest(void) {
+    bool res = true;
+    unsigned seed = 11;
+    Poly zero = C(0), product;
+    // współczynniki iloczynu od kilku bitów do przepełnienia 64 bitów
+    const unsigned coeff_bits[] = {3, 20, 40, 63};
+    for (size_t threads = 1; threads <= 4; threads += 3) {
+        ParallelSetThreads(threads);
+        for (size_t k = 0; k < 4; ++k) {
+            Poly p = DensePoly(300, coeff_bits[k], &seed), q = DensePoly(200, coeff_bits[k], &seed);
+            // PolyMulAdd mnoży zwykłym algorytmem
+            res &= PolyMulNtt(&p, &q, &product);
+            res &= TestEq(product, PolyMulAdd(&p, &q, &zero), true);
+            Poly neg = PolyNegShallow(&q);
+            res &= TestEq(PolyMul(&p, &neg), PolyMulAdd(&p, &neg, &zero), true);
+            PolyDestroy(&p);
+            PolyDestroy(&q);
+        }
+    }
+
+    // długie transformaty są liczone w kilku wątkach, wynik porównujemy z mnożeniem modularnym
+    Poly p = DensePoly(3000, 40, &seed), q = DensePoly(2000, 40, &seed), expected;
+    res &= PolyMulNtt(&p, &q, &product);
+    res &= PolyMulModular(&p, &q, &expected);
+    res &= TestEq(product, expected, true);
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+    ParallelSetThreads(0);
+
+    p = P(C(-1), 0, C(LONG_MIN), 1);
+    q = P(C(3), 0, C(LONG_MAX), 1);
+    res &= PolyMulNtt(&p, &q, &product);
+    res &= TestEq(product, PolyMulAdd(&p, &q, &zero), true);
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+
+    // (2^32 + 2^32 x)^2 ma współczynniki podzielne przez 2^64
+    p = P(C(1L << 32), 0, C(1L << 32), 1);
+    res &= PolyMulNtt(&p, &p, &product);
+    res &= TestEq(product, C(0), true);
+    PolyDestroy(&p);
+
+    // rzadkiego wielomianu ani wielomianu o niestałych współczynnikach PolyMulNtt nie mnoży
+    p = P(C(1), 0, C(1), 1000);
+    q = P(C(1), 0, P(C(1), 1), 1);
+    res &= !PolyMulNtt(&p, &p, &product);
+    res &= !PolyMulNtt(&q, &q, &product);
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+    return res;
+}
+
+static poly_coeff_t EvalAt(const Poly *p, size_t vars, const poly_coeff_t x[]) {
+    Poly cur = PolyClone(p);
+    for (size_t v = 0; v < vars; ++v) {
+        Poly next = PolyAt(&cur, x[v]);
+        PolyDestroy(&cur);
+        cur = next;
+    }
+    assert(PolyIsCoeff(&cur));
+    return cur.coeff;
+}
+
+typedef struct ProgramTask {
+    const PolyProgram *prog;
+    const poly_coeff_t *xs;
+    poly_coeff_t *out;
+    size_t chunk;
+} ProgramTask;
+
+static void ProgramChunk(void *ctx, size_t i) {
+    ProgramTask *task = (ProgramTask*) ctx;
+    PolyProgramEvalBlock(task->prog, task->chunk, task->xs + i * task->chunk * task->prog->vars,
+                         task->out + i * task->chunk);
+}
+
+static bool ProgramTest(void) {
+    bool res = true;
+    Poly c = C(5);
+    PolyProgram prog = PolyCompile(&c);
+    poly_coeff_t out[3];
+    res &= prog.vars == 0 && PolyProgramEval(&prog, NULL) == 5;
+    PolyProgramEvalBlock(&prog, 3, NULL, out);
+    res &= out[0] == 5 && out[2] == 5;
+    PolyProgramDestroy(&prog);
+
+    // x0 * x1 * ... * x199 przy wszystkich zmiennych równych 3, modulo 2^64
+    Poly chain = C(1);
+    for (size_t d = 0; d < 200; ++d)
+        chain = P(chain, 1);
+    prog = PolyCompile(&chain);
+    poly_coeff_t threes[200];
+    uint64_t expected = 1;
+    for (size_t d = 0; d < 200; ++d) {
+        threes[d] = 3;
+        expected *= 3;
+    }
+    res &= prog.vars == 200 && PolyProgramEval(&prog, threes) == (poly_coeff_t) expected;
+    PolyProgramDestroy(&prog);
+    PolyDestroy(&chain);
+
+    // losowy wielomian trzech zmiennych i jego widok przeciwny w 100 punktach (ponad jeden blok)
+    unsigned seed = 3;
+    Poly p = RandomTermsPoly(300, 63, &seed);
+    Poly views[2] = {p, PolyNegShallow(&p)};
+    poly_coeff_t xs[100 * 3], values[100], parallel[100];
+    for (size_t k = 0; k < 2; ++k) {
+        prog = PolyCompile(&views[k]);
+        res &= prog.vars == 3;
+        for (size_t i = 0; i < 100 * 3; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            xs[i] = (i % 2 == 0) ? (poly_coeff_t) (seed >> 16) % 7 - 3 : (poly_coeff_t) seed * 1000003L;
+        }
+        PolyProgramEvalBlock(&prog, 100, xs, values);
+        for (size_t i = 0; i < 100; ++i) {
+            poly_coeff_t value = EvalAt(&views[k], 3, xs + 3 * i);
+            res &= PolyProgramEval(&prog, xs + 3 * i) == value && values[i] == value;
+        }
+
+        // jeden program wykonywany równocześnie w kilku wątkach
+        ProgramTask task = {.prog = &prog, .xs = xs, .out = parallel, .chunk = 25};
+        ParallelRun(4, 4, ProgramChunk, &task);
+        res &= memcmp(values, parallel, sizeof(values)) == 0;
+        PolyProgramDestroy(&prog);
+    }
+    PolyDestroy(&p);
+    return res;
+}
+
+static bool PartialTest(void) {
+    bool res = true;
+    unsigned seed = 5;
+    Poly p = RandomTermsPoly(300, 63, &seed);
+    Poly views[2] = {p, PolyNegShallow(&p)};
+    // 2^32 podniesione do kwadratu daje zero modulo 2^64
+    const poly_coeff_t values[][3] = {{0, 1, -1}, {3, -7, 1L << 32}, {LONG_MIN, 123456789, 2}};
+    for (size_t k = 0; k < 2; ++k) {
+        for (size_t v = 0; v < 3; ++v) {
+            for (uint64_t mask = 0; mask < 8; ++mask) {
+                // wynik musi być równy złożeniu ze stałymi i wielomianami x_j pod pozostałymi zmiennymi
+                Poly q[3], fixed[3];
+                poly_coeff_t compact[3];
+                size_t count = 0;
+                for (size_t i = 0; i < 3; ++i) {
+                    if ((mask >> i) & 1) {
+                        compact[count] = values[v][i];
+                        fixed[count++] = C(values[v][i]);
+                        q[i] = C(values[v][i]);
+                    }
+                    else {
+                        poly_exp_t exps[3] = {0, 0, 0};
+                        exps[i - count] = 1;
+                        q[i] = TermPoly(exps, i - count + 1, 1);
+                    }
+                }
+                Poly expected = PolyCompose(&views[k], 3, q);
+                res &= TestEq(PolyEvalPartial(&views[k], mask, compact), PolyClone(&expected), true);
+                res &= TestEq(PolySubstituteVars(&views[k], mask, fixed), expected, true);
+                for (size_t i = 0; i < 3; ++i)
+                    PolyDestroy(&q[i]);
+            }
+        }
+    }
+    PolyDestroy(&p);
+
+    // bity maski powyżej liczby zmiennych wielomianu nie zmieniają wyniku
+    p = P(P(C(2), 1), 3);
+    poly_coeff_t two[2] = {5, 9};
+    res &= TestEq(PolyEvalPartial(&p, 2 | (1ull << 63), two), P(C(10), 3), true);
+    res &= TestEq(PolyEvalPartial(&p, 1ull << 40, two), PolyClone(&p), true);
+
+    // podstawienie wielomianu niebędącego stałą: x_1 = x_0 w x_0^3 * 2x_1
+    Poly x0 = P(C(1), 1);
+    res &= TestEq(PolySubstituteVars(&p, 2, &x0), P(C(2), 4), true);
+    PolyDestroy(&x0);
+    PolyDestroy(&p);
+
+    // x_0 * x_1 * ... * x_199 z ustalonymi zmiennymi x_1 = 3 i x_63 = -1
+    Poly chain = C(1);
+    for (size_t d = 0; d < 200; ++d)
+        chain = P(chain, 1);
+    poly_exp_t ones[198];
+    for (size_t d = 0; d < 198; ++d)
+        ones[d] = 1;
+    poly_coeff_t chain_values[2] = {3, -1};
+    res &= TestEq(PolyEvalPartial(&chain, 2 | (1ull << 63), chain_values), TermPoly(ones, 198, -3), true);
+    PolyDestroy(&chain);
+    return res;
+}
+
+static bool MemoryStatsTest(void) {
+    MemoryStats before = MemoryGetStats(MEMORY_MONOS);
+    Poly p = POLY_P;
+    Poly q = PolyMul(&p, &p);
+    Poly r = PolySub(&q, &p);
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+    PolyDestroy(&r);
+    MemoryStats after = MemoryGetStats(MEMORY_MONOS);
+#ifdef POLY_MEMORY_STATS
+    // wszystkie tablice jednomianów zostały zwolnione
+    return after.allocs > before.allocs &&
+           after.allocs - before.allocs == after.frees - before.frees &&
+           after.live_bytes == before.live_bytes &&
+           after.peak_bytes >= before.live_bytes &&
+           after.recycled > before.recycled;
+#else
+    return after.allocs == 0 && before.allocs == 0 && after.recycled == 0;
+#endif
+}
 
 int main() {
     assert(SimpleIsEqTest());
@@ -326,6 +1549,31 @@ int main() {
     assert(SimpleDegByTest());
     assert(SimpleAtTest());
     assert(SimpleMulTest());
+    assert(MulAddTest());
+    assert(SortMonosTest());
     assert(OverflowTest());
+    assert(InlineMonoTest());
+    assert(CompactTest());
+    assert(NegTagTest());
+    assert(ManyTest());
+    assert(GeobucketTest());
+    assert(ReclaimTest());
+    assert(ParallelTest());
+    assert(DataflowTest());
+    assert(PipelineTest());
+    assert(LongLineTest());
+    assert(BatchTest());
+    assert(StatsTest());
+    assert(DeepChainTest());
+    assert(ParseApiTest());
+    assert(AtParseTest());
+    assert(LibraryTest());
+    assert(TermsTest());
+    assert(BuilderTest());
+    assert(ModularTest());
+    assert(NttTest());
+    assert(ProgramTest());
+    assert(PartialTest());
+    assert(MemoryStatsTest());
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,111 @@
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include "poly.hpp"
+#include <cassert>
+#include <utility>
+
+using poly::Polynomial;
+
+static Polynomial Var(size_t idx, poly_exp_t exp) {
+    // x_idx^exp jako wielomian zagnieżdżony idx razy
+    Poly p = PolyFromCoeff(1);
+    for (size_t i = 0; i <= idx; ++i) {
+        Mono m = MonoFromPoly(&p, (i == 0) ? exp : 0);
+        p = PolyAddMonos(1, &m);
+    }
+    return Polynomial::Adopt(p);
+}
+
+static Polynomial Sample(poly_coeff_t c) {
+    // (x_0^2 + c) * x_1 + c x_0 - 1
+    Polynomial x0(Var(0, 1)), x0sq(Var(0, 2)), x1(Var(1, 1)), k(c), one(1);
+    return (x0sq + k) * x1 + k * x0 - one;
+}
+
+static Polynomial Add(const Polynomial &a, const Polynomial &b) {
+    return Polynomial::Adopt(PolyAdd(&a.Get(), &b.Get()));
+}
+
+static Polynomial Sub(const Polynomial &a, const Polynomial &b) {
+    return Polynomial::Adopt(PolySub(&a.Get(), &b.Get()));
+}
+
+static Polynomial Mul(const Polynomial &a, const Polynomial &b) {
+    return Polynomial::Adopt(PolyMul(&a.Get(), &b.Get()));
+}
+
+static Polynomial Neg(const Polynomial &a) {
+    return Polynomial::Adopt(PolyNeg(&a.Get()));
+}
+
+static bool ExpressionTest() {
+    Polynomial a(Sample(3)), b(Sample(-5)), c(Var(1, 4));
+    bool res = true;
+    res &= Polynomial(a * b + c) == Add(Mul(a, b), c);
+    res &= Polynomial(c - a * b) == Sub(c, Mul(a, b));
+    res &= Polynomial(-(a * b) - c) == Sub(Neg(Mul(a, b)), c);
+    res &= Polynomial(a + b + c) == Add(Add(a, b), c);
+    res &= Polynomial(a * b * c) == Mul(Mul(a, b), c);
+    res &= Polynomial(a * b + b * c - a) == Sub(Add(Mul(a, b), Mul(b, c)), a);
+    res &= Polynomial(-(a + b) * -c) == Mul(Add(a, b), c);
+    res &= Polynomial(a - a).IsZero();
+    return res;
+}
+
+static bool AliasingTest() {
+    Polynomial a(Sample(2)), b(Sample(7));
+    Polynomial expected = Sub(Mul(a, a), a);
+    // wyrażenie czyta a, zanim zostanie ono zastąpione wynikiem
+    a = a * a - a;
+    bool res = a == expected;
+
+    expected = Add(a, b);
+    a += b;
+    res &= a == expected;
+    expected = Sub(a, Mul(b, b));
+    a -= b * b;
+    res &= a == expected;
+    expected = Mul(a, Add(b, a));
+    a *= b + a;
+    res &= a == expected;
+    a -= a;
+    res &= a.IsZero();
+    return res;
+}
+
+static bool OwnershipTest() {
+    Polynomial a(Sample(4));
+    Polynomial copy(a);
+    bool res = copy == a;
+    a += Polynomial(1);
+    res &= copy != a && copy == Sample(4);
+
+    Polynomial moved(std::move(a));
+    res &= a.IsZero() && moved == Add(Sample(4), Polynomial(1));
+    a = moved;
+    res &= a == moved;
+    a = std::move(moved);
+    res &= moved.IsZero() && !a.IsZero();
+
+    Polynomial &self = a;
+    a = self;
+    res &= a == Add(Sample(4), Polynomial(1));
+    a = std::move(self);
+    res &= !a.IsZero();
+
+    Poly released = a.Release();
+    res &= a.IsZero() && PolyDeg(&released) == 3;
+    Polynomial adopted = Polynomial::Adopt(released);
+    res &= adopted.Deg() == 3 && adopted.DegBy(1) == 1;
+    res &= adopted.At(0) == Mul(Polynomial(4), Var(0, 1));
+    return res;
+}
+
+int main() {
+    assert(ExpressionTest());
+    assert(AliasingTest());
+    assert(OwnershipTest());
+    return 0;
+}
@@ -0,0 +1,397 @@
+/** @file
+  Implementacja kompilowania wielomianu do programu obliczającego jego wartość
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include <stdlib.h>
+#include "program.h"
+#include "work_stack.h"
+
+/** Początkowa liczba instrukcji, stałych i potęg w tablicach kompilatora. */
+#define PROGRAM_INITIAL_SIZE 16
+
+/** Stan kompilacji: tablice programu z ich pojemnościami. */
+typedef struct ProgramCompiler {
+    PolyProgram prog; ///< kompilowany program
+    size_t code_capacity; ///< liczba instrukcji mieszczących się w tablicy code
+    size_t constants_capacity; ///< liczba stałych mieszczących się w tablicy constants
+    size_t powers_capacity; ///< liczba potęg mieszczących się w tablicy powers
+    size_t stack; ///< liczba wartości na stosie po wykonaniu dotychczasowych instrukcji
+} ProgramCompiler;
+
+/**
+ * Ramka przejścia kompilującego wielomian. Jednomiany są kompilowane od
+ * najwyższego wykładnika do najniższego.
+ */
+typedef struct CompileFrame {
+    Poly p; ///< widok wielomianu z uwzględnionym znakiem
+    uint32_t var; ///< indeks zmiennej wielomianu
+    size_t i; ///< indeks jednomianu, którego współczynnik jest kompilowany; rozmiar przed rozpoczęciem
+    bool child; ///< czy współczynnik jednomianu i jest kompilowany w ramce wyżej
+} CompileFrame;
+
+/** Potęga zmiennej z jej indeksem sprzed usunięcia powtórzeń. */
+typedef struct PowerEntry {
+    ProgramPower power; ///< potęga
+    size_t index; ///< indeks potęgi przed usunięciem powtórzeń
+} PowerEntry;
+
+/**
+ * Dopisuje instrukcję do programu.
+ * @param[in,out] c : stan kompilacji
+ * @param[in] op : rodzaj instrukcji
+ * @param[in] arg : argument instrukcji
+ */
+static void ProgramEmit(ProgramCompiler *c, ProgramOp op, uint32_t arg) {
+    if (c->prog.code_size == c->code_capacity) {
+        size_t capacity = IncreaseSpace(c->code_capacity);
+        c->prog.code = (ProgramInstr*) MemoryRealloc(c->prog.code, c->code_capacity * sizeof(ProgramInstr),
+                                                     capacity * sizeof(ProgramInstr), MEMORY_WORK);
+        c->code_capacity = capacity;
+    }
+    c->prog.code[c->prog.code_size++] = (ProgramInstr) {.op = op, .arg = arg};
+}
+
+/**
+ * Dopisuje stałą do programu.
+ * @param[in,out] c : stan kompilacji
+ * @param[in] coeff : stała
+ */
+static void ProgramEmitConstant(ProgramCompiler *c, poly_coeff_t coeff) {
+    if (c->prog.constants_size == c->constants_capacity) {
+        size_t capacity = IncreaseSpace(c->constants_capacity);
+        c->prog.constants = (poly_coeff_t*) MemoryRealloc(c->prog.constants,
+                                                          c->constants_capacity * sizeof(poly_coeff_t),
+                                                          capacity * sizeof(poly_coeff_t), MEMORY_WORK);
+        c->constants_capacity = capacity;
+    }
+    c->prog.constants[c->prog.constants_size++] = coeff;
+}
+
+/**
+ * Dopisuje instrukcję kładącą stałą na stos.
+ * @param[in,out] c : stan kompilacji
+ * @param[in] coeff : stała
+ */
+static void ProgramEmitPush(ProgramCompiler *c, poly_coeff_t coeff) {
+    ProgramEmit(c, PROGRAM_PUSH_CONST, 0);
+    ProgramEmitConstant(c, coeff);
+    if (++c->stack > c->prog.max_stack)
+        c->prog.max_stack = c->stack;
+}
+
+/**
+ * Dopisuje mnożenie szczytu stosu przez potęgę zmiennej, a w wersji
+ * Hornera także dodanie stałej. Potęga @f$x^1@f$ jest czytana wprost
+ * z wartości zmiennej, a wyższe trafiają do tablicy potęg.
+ * @param[in,out] c : stan kompilacji
+ * @param[in] var : indeks zmiennej
+ * @param[in] exp : dodatni wykładnik
+ * @param[in] horner : czy dodać stałą @p coeff
+ * @param[in] coeff : stała
+ */
+static void ProgramEmitPower(ProgramCompiler *c, uint32_t var, poly_exp_t exp, bool horner, poly_coeff_t coeff) {
+    assert(exp > 0);
+    if (var >= c->prog.vars)
+        c->prog.vars = (size_t) var + 1;
+    if (exp == 1) {
+        ProgramEmit(c, horner ? PROGRAM_HORNER_VAR : PROGRAM_MUL_VAR, var);
+    }
+    else {
+        if (c->prog.powers_size == c->powers_capacity) {
+            size_t capacity = IncreaseSpace(c->powers_capacity);
+            c->prog.powers = (ProgramPower*) MemoryRealloc(c->prog.powers, c->powers_capacity * sizeof(ProgramPower),
+                                                           capacity * sizeof(ProgramPower), MEMORY_WORK);
+            c->powers_capacity = capacity;
+        }
+        // indeks potęgi zostanie zamieniony w ProgramSharePowers
+        ProgramEmit(c, horner ? PROGRAM_HORNER_POWER : PROGRAM_MUL_POWER, (uint32_t) c->prog.powers_size);
+        c->prog.powers[c->prog.powers_size++] = (ProgramPower) {.var = var, .exp = exp};
+    }
+    if (horner)
+        ProgramEmitConstant(c, coeff);
+}
+
+/**
+ * Porównuje potęgi według zmiennej, a potem wykładnika.
+ * @param[in] a : wskaźnik na pierwszą potęgę (PowerEntry)
+ * @param[in] b : wskaźnik na drugą potęgę (PowerEntry)
+ * @return wynik porównania
+ */
+static int ComparePowers(const void *a, const void *b) {
+    const ProgramPower *x = &((const PowerEntry*) a)->power, *y = &((const PowerEntry*) b)->power;
+    if (x->var != y->var)
+        return (x->var > y->var) - (x->var < y->var);
+    return (x->exp > y->exp) - (x->exp < y->exp);
+}
+
+/**
+ * Usuwa powtórzenia z tablicy potęg, tak że każda potęga jest liczona raz na
+ * punkt, i poprawia indeksy potęg w instrukcjach.
+ * @param[in,out] c : stan kompilacji
+ */
+static void ProgramSharePowers(ProgramCompiler *c) {
+    size_t count = c->prog.powers_size;
+    if (count == 0)
+        return;
+
+    PowerEntry *entries = (PowerEntry*) MemoryAlloc(count * sizeof(PowerEntry), MEMORY_WORK);
+    uint32_t *remap = (uint32_t*) MemoryAlloc(count * sizeof(uint32_t), MEMORY_WORK);
+    for (size_t k = 0; k < count; ++k)
+        entries[k] = (PowerEntry) {.power = c->prog.powers[k], .index = k};
+    qsort(entries, count, sizeof(PowerEntry), ComparePowers);
+
+    size_t unique = 0;
+    for (size_t k = 0; k < count; ++k) {
+        if (unique == 0 || ComparePowers(&entries[k], &entries[unique - 1]) != 0)
+            entries[unique++].power = entries[k].power;
+        remap[entries[k].index] = (uint32_t) (unique - 1);
+    }
+    for (size_t k = 0; k < unique; ++k)
+        c->prog.powers[k] = entries[k].power;
+    c->prog.powers_size = unique;
+
+    for (size_t k = 0; k < c->prog.code_size; ++k) {
+        ProgramInstr *instr = &c->prog.code[k];
+        if (instr->op == PROGRAM_HORNER_POWER || instr->op == PROGRAM_MUL_POWER)
+            instr->arg = remap[instr->arg];
+    }
+    MemoryFree(entries, count * sizeof(PowerEntry), MEMORY_WORK);
+    MemoryFree(remap, count * sizeof(uint32_t), MEMORY_WORK);
+}
+
+/**
+ * Zmniejsza tablicę do liczby użytych elementów.
+ * @param[in] ptr : tablica
+ * @param[in] capacity : liczba elementów mieszczących się w tablicy
+ * @param[in] size : liczba użytych elementów
+ * @param[in] elem_size : rozmiar elementu w bajtach
+ * @return tablica o @p size elementach albo NULL, jeżeli @p size jest zerem
+ */
+static void *ProgramShrink(void *ptr, size_t capacity, size_t size, size_t elem_size) {
+    if (size == 0) {
+        MemoryFree(ptr, capacity * elem_size, MEMORY_WORK);
+        return NULL;
+    }
+    return MemoryRealloc(ptr, capacity * elem_size, size * elem_size, MEMORY_WORK);
+}
+
+/**
+ * Kompiluje wielomian niebędący współczynnikiem bez rekurencji. Wartość
+ * wielomianu zmiennej @f$x_{var}@f$ powstaje schematem Hornera od jednomianu
+ * o najwyższym wykładniku. Stały współczynnik jest dodawany razem
+ * z mnożeniem przez potęgę, a wielomian będący współczynnikiem jest
+ * kompilowany w nowej ramce i dodawany do wyniku instrukcją PROGRAM_ADD.
+ * @param[in,out] c : stan kompilacji
+ * @param[in] p : wielomian
+ */
+static void ProgramCompilePoly(ProgramCompiler *c, const Poly *p) {
+    CompileFrame local[WORK_STACK_LOCAL_SIZE];
+    WorkStack ws = InitWorkStack(local, WORK_STACK_LOCAL_SIZE, sizeof(CompileFrame));
+    *(CompileFrame*) WorkStackPush(&ws) = (CompileFrame) {.p = *p, .var = 0, .i = PolyGetSize(p), .child = false};
+
+    while (!WorkStackIsEmpty(&ws)) {
+        CompileFrame *top = (CompileFrame*) WorkStackTop(&ws);
+        size_t size = PolyGetSize(&top->p);
+
+        if (top->i == size) {
+            // jednomian o najwyższym wykładniku zaczyna schemat Hornera
+            Mono m = PolyGetMono(&top->p, --top->i);
+            if (!PolyIsCoeff(&m.p)) {
+                top->child = true;
+                Poly child = m.p;
+                uint32_t var = top->var + 1;
+                *(CompileFrame*) WorkStackPush(&ws) = (CompileFrame) {.p = child, .var = var,
+                                                                      .i = PolyGetSize(&child), .child = false};
+                continue;
+            }
+            ProgramEmitPush(c, m.p.coeff);
+        }
+        else if (top->child) {
+            // wartość współczynnika jest na szczycie stosu, nad sumą wyższych jednomianów
+            top->child = false;
+            if (top->i != size - 1) {
+                ProgramEmit(c, PROGRAM_ADD, 0);
+                c->stack--;
+            }
+        }
+
+        bool pushed = false;
+        while (!pushed && top->i > 0) {
+            Mono high = PolyGetMono(&top->p, top->i), m = PolyGetMono(&top->p, top->i - 1);
+            poly_exp_t gap = MonoGetExp(&high) - MonoGetExp(&m);
+            top->i--;
+            if (PolyIsCoeff(&m.p)) {
+                ProgramEmitPower(c, top->var, gap, true, m.p.coeff);
+            }
+            else {
+                ProgramEmitPower(c, top->var, gap, false, 0);
+                top->child = true;
+                Poly child = m.p;
+                uint32_t var = top->var + 1;
+                *(CompileFrame*) WorkStackPush(&ws) = (CompileFrame) {.p = child, .var = var,
+                                                                      .i = PolyGetSize(&child), .child = false};
+                pushed = true;
+            }
+        }
+        if (pushed)
+            continue;
+
+        Mono lowest = PolyGetMono(&top->p, 0);
+        if (MonoGetExp(&lowest) > 0)
+            ProgramEmitPower(c, top->var, MonoGetExp(&lowest), false, 0);
+        WorkStackPop(&ws);
+    }
+    WorkStackClear(&ws);
+}
+
+PolyProgram PolyCompile(const Poly *p) {
+    assert(p != NULL);
+    ProgramCompiler c = {.code_capacity = PROGRAM_INITIAL_SIZE, .constants_capacity = PROGRAM_INITIAL_SIZE,
+                         .powers_capacity = PROGRAM_INITIAL_SIZE, .stack = 0};
+    c.prog = (PolyProgram) {.vars = 0, .code_size = 0, .constants_size = 0, .powers_size = 0, .max_stack = 0};
+    c.prog.code = (ProgramInstr*) MemoryAlloc(c.code_capacity * sizeof(ProgramInstr), MEMORY_WORK);
+    c.prog.constants = (poly_coeff_t*) MemoryAlloc(c.constants_capacity * sizeof(poly_coeff_t), MEMORY_WORK);
+    c.prog.powers = (ProgramPower*) MemoryAlloc(c.powers_capacity * sizeof(ProgramPower), MEMORY_WORK);
+
+    if (PolyIsCoeff(p))
+        ProgramEmitPush(&c, p->coeff);
+    else
+        ProgramCompilePoly(&c, p);
+    assert(c.stack == 1);
+
+    ProgramSharePowers(&c);
+    c.prog.code = (ProgramInstr*) ProgramShrink(c.prog.code, c.code_capacity, c.prog.code_size,
+                                                sizeof(ProgramInstr));
+    c.prog.constants = (poly_coeff_t*) ProgramShrink(c.prog.constants, c.constants_capacity,
+                                                     c.prog.constants_size, sizeof(poly_coeff_t));
+    c.prog.powers = (ProgramPower*) ProgramShrink(c.prog.powers, c.powers_capacity, c.prog.powers_size,
+                                                  sizeof(ProgramPower));
+    return c.prog;
+}
+
+void PolyProgramDestroy(PolyProgram *prog) {
+    if (prog->code != NULL)
+        MemoryFree(prog->code, prog->code_size * sizeof(ProgramInstr), MEMORY_WORK);
+    if (prog->constants != NULL)
+        MemoryFree(prog->constants, prog->constants_size * sizeof(poly_coeff_t), MEMORY_WORK);
+    if (prog->powers != NULL)
+        MemoryFree(prog->powers, prog->powers_size * sizeof(ProgramPower), MEMORY_WORK);
+    prog->code = NULL;
+    prog->constants = NULL;
+    prog->powers = NULL;
+}
+
+poly_coeff_t PolyProgramEval(const PolyProgram *prog, const poly_coeff_t x[]) {
+    assert(prog != NULL && (prog->vars == 0 || x != NULL));
+    // obliczenia na liczbach bez znaku przepełniają się modulo 2^64 bez niezdefiniowanego zachowania
+    uint64_t local[POLY_PROGRAM_LOCAL];
+    size_t work = prog->powers_size + prog->max_stack;
+    uint64_t *powers = (work <= POLY_PROGRAM_LOCAL) ? local : (uint64_t*) MemoryAlloc(work * sizeof(uint64_t),
+                                                                                       MEMORY_WORK);
+    uint64_t *stack = powers + prog->powers_size;
+    for (size_t k = 0; k < prog->powers_size; ++k)
+        powers[k] = PolyCoeffPow((uint64_t) x[prog->powers[k].var], prog->powers[k].exp);
+
+    uint64_t *top = stack - 1;
+    const poly_coeff_t *constant = prog->constants;
+    for (size_t k = 0; k < prog->code_size; ++k) {
+        ProgramInstr instr = prog->code[k];
+        switch (instr.op) {
+            case PROGRAM_PUSH_CONST:
+                *++top = (uint64_t) *constant++;
+                break;
+            case PROGRAM_HORNER_VAR:
+                *top = *top * (uint64_t) x[instr.arg] + (uint64_t) *constant++;
+                break;
+            case PROGRAM_HORNER_POWER:
+                *top = *top * powers[instr.arg] + (uint64_t) *constant++;
+                break;
+            case PROGRAM_MUL_VAR:
+                *top *= (uint64_t) x[instr.arg];
+                break;
+            case PROGRAM_MUL_POWER:
+                *top *= powers[instr.arg];
+                break;
+            default:
+                top--;
+                *top += top[1];
+                break;
+        }
+    }
+
+    uint64_t result = stack[0];
+    if (powers != local)
+        MemoryFree(powers, work * sizeof(uint64_t), MEMORY_WORK);
+    return (poly_coeff_t) result;
+}
+
+void PolyProgramEvalBlock(const PolyProgram *prog, size_t count, const poly_coeff_t xs[], poly_coeff_t out[]) {
+    assert(prog != NULL && (count == 0 || out != NULL));
+    if (count == 0)
+        return;
+
+    // wiersz tablicy to jedna wartość (potęga albo miejsce na stosie) dla POLY_PROGRAM_BLOCK punktów
+    const size_t block = POLY_PROGRAM_BLOCK, vars = prog->vars;
+    size_t work = (prog->powers_size + prog->max_stack) * block;
+    uint64_t *powers = (uint64_t*) MemoryAlloc(work * sizeof(uint64_t), MEMORY_WORK);
+    uint64_t *stack = powers + prog->powers_size * block;
+
+    for (size_t base = 0; base < count; base += block) {
+        size_t n = (count - base < block) ? count - base : block;
+        const poly_coeff_t *x = (vars > 0) ? xs + base * vars : xs;
+        for (size_t k = 0; k < prog->powers_size; ++k) {
+            uint64_t *row = powers + k * block;
+            for (size_t l = 0; l < n; ++l)
+                row[l] = PolyCoeffPow((uint64_t) x[l * vars + prog->powers[k].var], prog->powers[k].exp);
+        }
+
+        uint64_t *top = stack - block;
+        const poly_coeff_t *constant = prog->constants;
+        for (size_t k = 0; k < prog->code_size; ++k) {
+            ProgramInstr instr = prog->code[k];
+            // instrukcje bez zmiennej mają argument 0, a program bez zmiennych może mieć xs == NULL
+            const poly_coeff_t *var = (vars > 0) ? x + instr.arg : x;
+            const uint64_t *power = powers + (size_t) instr.arg * block;
+            uint64_t c;
+            switch (instr.op) {
+                case PROGRAM_PUSH_CONST:
+                    top += block;
+                    c = (uint64_t) *constant++;
+                    for (size_t l = 0; l < n; ++l)
+                        top[l] = c;
+                    break;
+                case PROGRAM_HORNER_VAR:
+                    c = (uint64_t) *constant++;
+                    for (size_t l = 0; l < n; ++l)
+                        top[l] = top[l] * (uint64_t) var[l * vars] + c;
+                    break;
+                case PROGRAM_HORNER_POWER:
+                    c = (uint64_t) *constant++;
+                    for (size_t l = 0; l < n; ++l)
+                        top[l] = top[l] * power[l] + c;
+                    break;
+                case PROGRAM_MUL_VAR:
+                    for (size_t l = 0; l < n; ++l)
+                        top[l] *= (uint64_t) var[l * vars];
+                    break;
+                case PROGRAM_MUL_POWER:
+                    for (size_t l = 0; l < n; ++l)
+                        top[l] *= power[l];
+                    break;
+                default:
+                    top -= block;
+                    for (size_t l = 0; l < n; ++l)
+                        top[l] += top[l + block];
+                    break;
+            }
+        }
+
+        for (size_t l = 0; l < n; ++l)
+            out[base + l] = (poly_coeff_t) stack[l];
+    }
+    MemoryFree(powers, work * sizeof(uint64_t), MEMORY_WORK);
+}
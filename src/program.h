@@ -0,0 +1,107 @@
+/** @file
+  Interfejs kompilowania wielomianu do programu obliczającego jego wartość
+
+  Obliczenie wartości wielomianu przez PolyAt przechodzi drzewo jednomianów
+  i tworzy wielomiany pośrednie. PolyCompile zamienia wielomian raz na płaski
+  program: ciąg instrukcji schematu Hornera zagnieżdżonego po zmiennych,
+  ze stałymi zapisanymi w jednej tablicy w kolejności ich użycia i tablicą
+  różnych potęg zmiennych, które program liczy raz na punkt. Wartość
+  @f$c_k x^{e_k} + \ldots + c_0 x^{e_0}@f$ jest liczona jako
+  @f$(\ldots(c_k x^{e_k - e_{k-1}} + c_{k-1}) \ldots) x^{e_0}@f$, gdzie
+  współczynniki @f$c_i@f$ są wartościami wielomianów kolejnych zmiennych.
+  Program nie zmienia się po kompilacji, więc może być wykonywany
+  równocześnie w wielu wątkach. Obliczenia są wykonywane modulo @f$2^{64}@f$,
+  tak jak działania na współczynnikach wielomianów.
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef POLYNOMIALS_PROGRAM_H
+#define POLYNOMIALS_PROGRAM_H
+
+#include <stdint.h>
+#include "poly.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Liczba punktów obliczanych razem przez PolyProgramEvalBlock. */
+#define POLY_PROGRAM_BLOCK 64
+
+/** Liczba wartości, które PolyProgramEval mieści bez alokacji pamięci. */
+#define POLY_PROGRAM_LOCAL 64
+
+/** Rodzaje instrukcji programu; `top` to wartość na szczycie stosu. */
+typedef enum ProgramOp {
+    PROGRAM_PUSH_CONST, ///< kładzie na stos kolejną stałą
+    PROGRAM_HORNER_VAR, ///< `top = top * x[arg] + ` kolejna stała
+    PROGRAM_HORNER_POWER, ///< `top = top * powers[arg] + ` kolejna stała
+    PROGRAM_MUL_VAR, ///< `top = top * x[arg]`
+    PROGRAM_MUL_POWER, ///< `top = top * powers[arg]`
+    PROGRAM_ADD ///< zdejmuje wartość ze stosu i dodaje ją do nowego szczytu
+} ProgramOp;
+
+/** Instrukcja programu. */
+typedef struct ProgramInstr {
+    uint32_t op; ///< rodzaj instrukcji (ProgramOp)
+    uint32_t arg; ///< indeks zmiennej albo potęgi w tablicy powers
+} ProgramInstr;
+
+/** Potęga zmiennej liczona raz na punkt przed wykonaniem instrukcji. */
+typedef struct ProgramPower {
+    uint32_t var; ///< indeks zmiennej
+    poly_exp_t exp; ///< wykładnik, co najmniej 2
+} ProgramPower;
+
+/** Skompilowany wielomian. */
+typedef struct PolyProgram {
+    size_t vars; ///< liczba zmiennych, których wartości czyta program
+    ProgramInstr *code; ///< instrukcje
+    size_t code_size; ///< liczba instrukcji
+    poly_coeff_t *constants; ///< stałe w kolejności użycia przez instrukcje
+    size_t constants_size; ///< liczba stałych
+    ProgramPower *powers; ///< różne potęgi zmiennych, posortowane według zmiennej i wykładnika
+    size_t powers_size; ///< liczba potęg
+    size_t max_stack; ///< największa liczba wartości na stosie
+} PolyProgram;
+
+/**
+ * Kompiluje wielomian do programu obliczającego jego wartość.
+ * @param[in] p : wielomian
+ * @return program, który trzeba zwolnić funkcją PolyProgramDestroy
+ */
+POLY_API PolyProgram PolyCompile(const Poly *p);
+
+/**
+ * Oblicza wartość skompilowanego wielomianu w punkcie.
+ * @param[in] prog : program
+ * @param[in] x : wartości zmiennych @f$x_0, \ldots, x_{vars-1}@f$
+ * @return wartość wielomianu
+ */
+POLY_API poly_coeff_t PolyProgramEval(const PolyProgram *prog, const poly_coeff_t x[]);
+
+/**
+ * Oblicza wartości skompilowanego wielomianu w wielu punktach. Każda
+ * instrukcja jest wykonywana od razu dla POLY_PROGRAM_BLOCK punktów,
+ * w pętli bez rozgałęzień.
+ * @param[in] prog : program
+ * @param[in] count : liczba punktów
+ * @param[in] xs : wartości zmiennych kolejnych punktów, po `prog->vars` na punkt
+ * @param[out] out : tablica na @p count wartości
+ */
+POLY_API void PolyProgramEvalBlock(const PolyProgram *prog, size_t count, const poly_coeff_t xs[], poly_coeff_t out[]);
+
+/**
+ * Zwalnia pamięć programu.
+ * @param[in,out] prog : program
+ */
+POLY_API void PolyProgramDestroy(PolyProgram *prog);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //POLYNOMIALS_PROGRAM_H
@@ -0,0 +1,73 @@
+/** @file
+  Implementacja buforowanego źródła znaków dla parsera
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+/** Udostępnia funkcje POSIX (read, fileno) przy kompilacji z -std=c11. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <unistd.h>
+#include "reader.h"
+#include "memory_helper.h"
+
+Reader CreateFdReader(int fd) {
+    char *buffer = (char*) MemoryAlloc(READER_BUFFER_SIZE * sizeof(char), MEMORY_PARSER);
+    return (Reader) {.fd = fd, .callback = NULL, .ctx = NULL, .buffer = buffer, .pos = 0, .len = 0};
+}
+
+Reader CreateReader(FILE *file) {
+    return CreateFdReader(fileno(file));
+}
+
+Reader CreateCallbackReader(ReaderCallback callback, void *ctx) {
+    Reader r = CreateFdReader(-1);
+    r.callback = callback;
+    r.ctx = ctx;
+    return r;
+}
+
+Reader CreateMemoryReader(const char *data, size_t len) {
+    return (Reader) {.fd = -1, .callback = NULL, .ctx = NULL, .buffer = (char*) data, .pos = 0, .len = len};
+}
+
+/**
+ * Sprawdza, czy bufor źródła jest pamięcią podaną przy jego tworzeniu.
+ * @param[in] r : źródło znaków
+ * @return Czy źródło czyta bezpośrednio z pamięci?
+ */
+static bool ReaderIsMemory(const Reader *r) {
+    return r->fd < 0 && r->callback == NULL;
+}
+
+void DestroyReader(Reader *r) {
+    if (!ReaderIsMemory(r))
+        MemoryFree(r->buffer, READER_BUFFER_SIZE * sizeof(char), MEMORY_PARSER);
+    r->buffer = NULL;
+}
+
+bool ReaderFill(Reader *r) {
+    // źródło z pamięci kończy się razem z buforem
+    if (ReaderIsMemory(r))
+        return false;
+
+    if (r->callback != NULL) {
+        r->pos = 0;
+        r->len = r->callback(r->ctx, r->buffer, READER_BUFFER_SIZE);
+        return r->len > 0;
+    }
+
+    // read zwraca tyle danych, ile jest dostępnych, więc w trybie interaktywnym
+    // nie czekamy na zapełnienie całego bufora
+    ssize_t count;
+    do {
+        count = read(r->fd, r->buffer, READER_BUFFER_SIZE);
+    } while (count < 0 && errno == EINTR);
+
+    r->pos = 0;
+    r->len = (count > 0) ? (size_t) count : 0;
+    return r->len > 0;
+}
@@ -0,0 +1,123 @@
+/** @file
+  Interfejs buforowanego źródła znaków dla parsera
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef POLYNOMIALS_READER_H
+#define POLYNOMIALS_READER_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/** Rozmiar bufora, do którego wczytywane są dane z pliku. */
+#define READER_BUFFER_SIZE 65536
+
+/**
+ * Funkcja dostarczająca kolejną porcję znaków źródłu utworzonemu przez
+ * CreateCallbackReader.
+ * @param[in,out] ctx : dane przekazane przy tworzeniu źródła
+ * @param[out] buffer : bufor na znaki
+ * @param[in] size : rozmiar bufora
+ * @return liczba zapisanych znaków, 0 oznacza koniec danych
+ */
+typedef size_t (*ReaderCallback)(void *ctx, char *buffer, size_t size);
+
+/**
+ * Struktura przechowująca źródło znaków dla parsera. Każdy parser ma własne
+ * źródło, dzięki czemu kilka sesji kalkulatora może działać jednocześnie,
+ * każda na innym pliku. Znaki pochodzą z deskryptora pliku, z funkcji
+ * zwrotnej albo bezpośrednio z pamięci podanej przy tworzeniu źródła.
+ */
+typedef struct Reader {
+    int fd; ///< deskryptor pliku, z którego wczytywane są dane, lub -1
+    ReaderCallback callback; ///< funkcja dostarczająca dane lub NULL
+    void *ctx; ///< dane przekazywane funkcji callback
+    char *buffer; ///< bufor z wczytanymi danymi
+    size_t pos; ///< pozycja kolejnego znaku do wczytania w buforze
+    size_t len; ///< liczba znaków w buforze
+} Reader;
+
+/**
+ * Tworzy źródło znaków czytające z deskryptora pliku @p fd.
+ * @param[in] fd : deskryptor pliku otwartego do odczytu
+ * @return źródło znaków
+ */
+Reader CreateFdReader(int fd);
+
+/**
+ * Tworzy źródło znaków czytające z pliku @p file.
+ * @param[in] file : plik otwarty do odczytu
+ * @return źródło znaków
+ */
+Reader CreateReader(FILE *file);
+
+/**
+ * Tworzy źródło znaków, któremu kolejne porcje znaków dostarcza funkcja
+ * @p callback wywoływana z argumentem @p ctx.
+ * @param[in] callback : funkcja dostarczająca znaki
+ * @param[in] ctx : dane przekazywane funkcji @p callback
+ * @return źródło znaków
+ */
+Reader CreateCallbackReader(ReaderCallback callback, void *ctx);
+
+/**
+ * Tworzy źródło znaków czytające @p len znaków z pamięci pod adresem
+ * @p data bez ich kopiowania. Pamięć musi pozostać niezmieniona, dopóki
+ * źródło jest używane; źródło jej nie przejmuje.
+ * @param[in] data : wczytywane znaki
+ * @param[in] len : liczba znaków
+ * @return źródło znaków
+ */
+Reader CreateMemoryReader(const char *data, size_t len);
+
+/**
+ * Usuwa źródło znaków z pamięci (nie zamyka pliku i nie zwalnia pamięci
+ * źródła utworzonego przez CreateMemoryReader).
+ * @param[in] r : źródło znaków
+ */
+void DestroyReader(Reader *r);
+
+/**
+ * Wczytuje kolejną porcję danych do bufora.
+ * @param[in,out] r : źródło znaków
+ * @return Czy udało się wczytać co najmniej jeden znak?
+ */
+bool ReaderFill(Reader *r);
+
+/**
+ * Wczytuje kolejny znak.
+ * @param[in,out] r : źródło znaków
+ * @return kolejny znak lub EOF
+ */
+static inline int ReaderGet(Reader *r) {
+    if (r->pos == r->len && !ReaderFill(r))
+        return EOF;
+    return (unsigned char) r->buffer[r->pos++];
+}
+
+/**
+ * Oddaje do źródła ostatnio wczytany znak @p c (odpowiednik ungetc).
+ * Oddanie EOF nie zmienia stanu źródła.
+ * @param[in,out] r : źródło znaków
+ * @param[in] c : ostatnio wczytany znak
+ */
+static inline void ReaderUnget(Reader *r, int c) {
+    if (c != EOF)
+        r->pos--;
+}
+
+/**
+ * Podgląda kolejny znak bez jego wczytywania.
+ * @param[in,out] r : źródło znaków
+ * @return kolejny znak lub EOF
+ */
+static inline int ReaderPeek(Reader *r) {
+    if (r->pos == r->len && !ReaderFill(r))
+        return EOF;
+    return (unsigned char) r->buffer[r->pos];
+}
+
+#endif //POLYNOMIALS_READER_H
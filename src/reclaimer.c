@@ -0,0 +1,121 @@
+/** @file
+  Implementacja wątku zwalniającego duże wielomiany w tle
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+/** Udostępnia funkcje POSIX (wątki) przy kompilacji z -std=c11. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "reclaimer.h"
+
+/** Struktura przechowująca stan wątku zwalniającego. */
+typedef struct Reclaimer {
+    Poly queue[RECLAIM_QUEUE_SIZE]; ///< cykliczna kolejka wielomianów do zwolnienia
+    size_t head; ///< indeks pierwszego wielomianu w kolejce
+    size_t size; ///< liczba wielomianów w kolejce
+    bool stopping; ///< czy wątek ma się zakończyć po opróżnieniu kolejki
+    atomic_bool running; ///< czy wątek działa
+    atomic_size_t threshold; ///< najmniejsza liczba jednomianów wielomianu zwalnianego w tle
+    pthread_t thread; ///< wątek zwalniający
+    pthread_mutex_t lock; ///< blokada chroniąca kolejkę
+    pthread_cond_t not_empty; ///< sygnalizuje pojawienie się wielomianu w kolejce
+    pthread_cond_t not_full; ///< sygnalizuje zwolnienie miejsca w kolejce
+} Reclaimer;
+
+/** Jedyny wątek zwalniający programu. */
+static Reclaimer reclaimer = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .not_empty = PTHREAD_COND_INITIALIZER,
+    .not_full = PTHREAD_COND_INITIALIZER
+};
+
+/**
+ * Pętla wątku zwalniającego: zwalnia wielomiany z kolejki, dopóki wątek nie
+ * zostanie zatrzymany, a kolejka opróżniona. Małe tablice jednomianów trafiają
+ * do puli wspólnej, z której wątek alokujący wielomiany pobiera je z powrotem.
+ * @param[in] arg : nieużywany
+ * @return NULL
+ */
+static void *ReclaimerLoop(void *arg) {
+    (void) arg;
+    // bloki zaalokował inny wątek, więc oddajemy je do puli wspólnej
+    MemoryPoolShareFrees(true);
+    pthread_mutex_lock(&reclaimer.lock);
+    while (true) {
+        while (reclaimer.size == 0 && !reclaimer.stopping)
+            pthread_cond_wait(&reclaimer.not_empty, &reclaimer.lock);
+        if (reclaimer.size == 0)
+            break;
+
+        Poly p = reclaimer.queue[reclaimer.head];
+        reclaimer.head = (reclaimer.head + 1) % RECLAIM_QUEUE_SIZE;
+        reclaimer.size--;
+        pthread_cond_signal(&reclaimer.not_full);
+
+        // zwalniamy bez blokady, żeby nie wstrzymywać dodających
+        pthread_mutex_unlock(&reclaimer.lock);
+        PolyDestroy(&p);
+        MemoryPoolFlush();
+        pthread_mutex_lock(&reclaimer.lock);
+    }
+    pthread_mutex_unlock(&reclaimer.lock);
+    return NULL;
+}
+
+void ReclaimerStart(size_t threshold) {
+    atomic_store(&reclaimer.threshold, (threshold == 0) ? RECLAIM_DEFAULT_THRESHOLD : threshold);
+    if (atomic_load(&reclaimer.running))
+        return;
+
+    reclaimer.head = 0;
+    reclaimer.size = 0;
+    reclaimer.stopping = false;
+    if (pthread_create(&reclaimer.thread, NULL, ReclaimerLoop, NULL) == 0)
+        atomic_store(&reclaimer.running, true);
+}
+
+void ReclaimerStop(void) {
+    if (!atomic_load(&reclaimer.running))
+        return;
+
+    pthread_mutex_lock(&reclaimer.lock);
+    reclaimer.stopping = true;
+    pthread_cond_signal(&reclaimer.not_empty);
+    pthread_cond_broadcast(&reclaimer.not_full);
+    pthread_mutex_unlock(&reclaimer.lock);
+    pthread_join(reclaimer.thread, NULL);
+    atomic_store(&reclaimer.running, false);
+}
+
+void PolyReclaim(Poly *p) {
+    if (!atomic_load_explicit(&reclaimer.running, memory_order_acquire) ||
+        !PolyHasMonos(p, atomic_load_explicit(&reclaimer.threshold, memory_order_relaxed))) {
+        PolyDestroy(p);
+        return;
+    }
+
+    pthread_mutex_lock(&reclaimer.lock);
+    while (reclaimer.size == RECLAIM_QUEUE_SIZE && !reclaimer.stopping)
+        pthread_cond_wait(&reclaimer.not_full, &reclaimer.lock);
+
+    bool queued = !reclaimer.stopping;
+    if (queued) {
+        reclaimer.queue[(reclaimer.head + reclaimer.size) % RECLAIM_QUEUE_SIZE] = *p;
+        reclaimer.size++;
+        pthread_cond_signal(&reclaimer.not_empty);
+    }
+    pthread_mutex_unlock(&reclaimer.lock);
+
+    if (queued) {
+        p->arr = NULL;
+        p->coeff = 0;
+    }
+    else {
+        PolyDestroy(p);
+    }
+}
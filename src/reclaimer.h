@@ -0,0 +1,53 @@
+/** @file
+  Interfejs wątku zwalniającego duże wielomiany w tle
+
+  Usunięcie wielomianu z milionami jednomianów trwa setki milisekund, o które
+  opóźnia się wtedy kolejne polecenie kalkulatora. Po uruchomieniu wątku
+  zwalniającego (ReclaimerStart) funkcja PolyReclaim przekazuje mu wielomiany
+  mające co najmniej zadaną liczbę jednomianów, a mniejsze usuwa od razu.
+  Kolejka wielomianów czekających na zwolnienie ma ograniczoną długość
+  RECLAIM_QUEUE_SIZE; gdy jest pełna, PolyReclaim czeka na zwolnienie miejsca,
+  więc pamięć nie rośnie bez ograniczeń, gdy wielomiany powstają szybciej, niż
+  są zwalniane.
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef POLYNOMIALS_RECLAIMER_H
+#define POLYNOMIALS_RECLAIMER_H
+
+#include "poly.h"
+
+/** Długość kolejki wielomianów czekających na zwolnienie. */
+#define RECLAIM_QUEUE_SIZE 16
+
+/** Domyślna liczba jednomianów, od której wielomian jest zwalniany w tle. */
+#define RECLAIM_DEFAULT_THRESHOLD 65536
+
+/**
+ * Uruchamia wątek zwalniający wielomiany mające co najmniej @p threshold
+ * jednomianów. Jeżeli wątek już działa, zmienia tylko próg.
+ * @param[in] threshold : najmniejsza liczba jednomianów wielomianu zwalnianego
+ * w tle, 0 oznacza RECLAIM_DEFAULT_THRESHOLD
+ */
+void ReclaimerStart(size_t threshold);
+
+/**
+ * Zwalnia wszystkie wielomiany czekające w kolejce i zatrzymuje wątek
+ * zwalniający. Po powrocie cała pamięć przekazanych wielomianów jest zwolniona.
+ * Jeżeli wątek nie działa, nic nie robi.
+ */
+void ReclaimerStop(void);
+
+/**
+ * Usuwa wielomian z pamięci jak PolyDestroy. Jeżeli działa wątek zwalniający,
+ * a wielomian ma co najmniej tyle jednomianów, ile wynosi próg, to przekazuje
+ * go do zwolnienia w tle i wraca od razu, chyba że kolejka jest pełna.
+ * Może być wywoływana z wielu wątków jednocześnie.
+ * @param[in] p : wielomian
+ */
+void PolyReclaim(Poly *p);
+
+#endif //POLYNOMIALS_RECLAIMER_H
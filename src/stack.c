@@ -6,6 +6,7 @@
   @date 2021
 */
 
+#include "reclaimer.h"
 #include "stack.h"
 
 /**
@@ -15,16 +16,19 @@
  */
 static void CheckFreeSpace(Stack *s) {
     if (s->size == s->allocated_size) {
+        size_t old_size = s->allocated_size;
         s->allocated_size = IncreaseSpace(s->allocated_size);
-        s->polys = (Poly*) realloc(s->polys, s->allocated_size * sizeof(Poly));
-        CheckPtr(s->polys);
+        s->polys = (Poly*) MemoryRealloc(s->polys, old_size * sizeof(Poly),
+                                         s->allocated_size * sizeof(Poly), MEMORY_STACK);
+        s->reads = (unsigned*) MemoryRealloc(s->reads, old_size * sizeof(unsigned),
+                                             s->allocated_size * sizeof(unsigned), MEMORY_STACK);
     }
 }
 
 Stack InitStack() {
     Stack s;
-    s.polys = (Poly*) malloc(INIT_SIZE * sizeof(Poly));
-    CheckPtr(s.polys);
+    s.polys = (Poly*) MemoryAlloc(INIT_SIZE * sizeof(Poly), MEMORY_STACK);
+    s.reads = (unsigned*) MemoryAlloc(INIT_SIZE * sizeof(unsigned), MEMORY_STACK);
     s.size = 0;
     s.allocated_size = INIT_SIZE;
     return s;
@@ -40,19 +44,48 @@ bool IsEmpty(const Stack *s) {
 
 void StackPush(Stack *s, const Poly *p) {
     CheckFreeSpace(s);
+    s->reads[s->size] = 0;
     s->polys[s->size++] = *p;
 }
 
 void StackPop(Stack *s) {
     if (!IsEmpty(s)) {
-        PolyDestroy(&(s->polys[s->size - 1]));
+        PolyReclaim(&(s->polys[s->size - 1]));
         s->size--;
     }
 }
 
+Poly StackTake(Stack *s) {
+    return s->polys[--s->size];
+}
+
+/**
+ * Zastępuje wielomian na stosie jego skompaktowaną kopią.
+ * @param[in,out] p : wielomian na stosie
+ */
+static void CompactInPlace(Poly *p) {
+    Poly compact = PolyCompact(p);
+    PolyReclaim(p);
+    *p = compact;
+}
+
+void StackCompactTop(Stack *s) {
+    CompactInPlace(&s->polys[s->size - 1]);
+}
+
+void StackTouch(Stack *s, size_t count) {
+    for (size_t i = s->size - count; i < s->size; ++i) {
+        // wielomian stały i jednomian zapisany w miejscu nie mają czego kompaktować
+        if (++s->reads[i] == STACK_COMPACT_READS && !PolyIsCoeff(&s->polys[i]) &&
+            !PolyIsInline(&s->polys[i]) && !PolyIsCompact(&s->polys[i]))
+            CompactInPlace(&s->polys[i]);
+    }
+}
+
 void StackClear(Stack *s) {
     while (!IsEmpty(s)) {
         StackPop(s);
     }
-    free(s->polys);
+    MemoryFree(s->polys, s->allocated_size * sizeof(Poly), MEMORY_STACK);
+    MemoryFree(s->reads, s->allocated_size * sizeof(unsigned), MEMORY_STACK);
 }
\ No newline at end of file
@@ -12,9 +12,16 @@
 #include "poly.h"
 #include "memory_helper.h"
 
+/**
+ * Liczba odczytów wielomianu ze stosu, po której jest on automatycznie
+ * kompaktowany (zobacz PolyCompact).
+ */
+#define STACK_COMPACT_READS 3
+
 /** Struktura przechowująca stos wielomianów. */
 typedef struct Stack {
     Poly *polys; ///< wielomiany przechowywane na stosie
+    unsigned *reads; ///< liczba odczytów każdego wielomianu ze stosu
     size_t size; ///< rozmiar stosu
     size_t allocated_size; ///< rozmiar zaalakowanej pamięci w tablicy polys
 } Stack;
@@ -50,6 +57,28 @@ void StackPush(Stack *s, const Poly *p);
  */
 void StackPop(Stack *s);
 
+/**
+ * Zdejmuje wielomian z góry stosu, nie usuwając go z pamięci.
+ * @param[in] s : niepusty stos
+ * @return wielomian z góry stosu, który przechodzi na własność wywołującego
+ */
+Poly StackTake(Stack *s);
+
+/**
+ * Zastępuje wielomian z góry stosu jego skompaktowaną kopią.
+ * @param[in] s : niepusty stos
+ */
+void StackCompactTop(Stack *s);
+
+/**
+ * Odnotowuje odczyt @p count wielomianów z góry stosu. Wielomian odczytany
+ * STACK_COMPACT_READS razy jest kompaktowany, żeby kolejne odczyty
+ * przechodziły po jednym ciągłym bloku pamięci.
+ * @param[in] s : stos
+ * @param[in] count : liczba odczytanych wielomianów, nie większa niż rozmiar stosu
+ */
+void StackTouch(Stack *s, size_t count);
+
 /**
  * Usuwa wszystkie elementy ze stosu.
  * @param[in] s : stos
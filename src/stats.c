@@ -0,0 +1,102 @@
+/** @file
+  Implementacja statystyk czasu wykonania poleceń kalkulatora
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+/** Udostępnia clock_gettime przy kompilacji z -std=c11. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+uint64_t StatsNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+void StatsReset(Stats *stats) {
+    memset(stats, 0, sizeof(Stats));
+}
+
+/**
+ * Wyznacza numer przedziału histogramu dla czasu @p ns.
+ * @param[in] ns : czas w nanosekundach
+ * @return numer przedziału, czyli @f$\lfloor \log_2 ns \rfloor@f$ (0 dla @p ns = 0)
+ */
+static int Bucket(uint64_t ns) {
+    int bucket = 0;
+    while (ns > 1) {
+        ns >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void StatsRecord(Stats *stats, CommandType type, uint64_t ns) {
+    CommandStats *cs = &stats->commands[type];
+    cs->count++;
+    cs->total_ns += ns;
+    if (ns > cs->max_ns)
+        cs->max_ns = ns;
+    cs->histogram[Bucket(ns)]++;
+}
+
+void StatsMerge(Stats *dst, const Stats *src) {
+    for (int i = 0; i < COMMAND_COUNT; ++i) {
+        CommandStats *d = &dst->commands[i];
+        const CommandStats *s = &src->commands[i];
+        d->count += s->count;
+        d->total_ns += s->total_ns;
+        if (s->max_ns > d->max_ns)
+            d->max_ns = s->max_ns;
+        for (int j = 0; j < STATS_BUCKETS; ++j)
+            d->histogram[j] += s->histogram[j];
+    }
+}
+
+/**
+ * Szacuje z góry percentyl czasu wykonania na podstawie histogramu.
+ * @param[in] cs : statystyki polecenia
+ * @param[in] percent : numer percentyla (od 1 do 100)
+ * @return górne ograniczenie percentyla w nanosekundach
+ */
+static uint64_t Percentile(const CommandStats *cs, unsigned percent) {
+    // szukamy najmniejszego przedziału, do którego należy co najmniej percent% pomiarów
+    uint64_t needed = (cs->count * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < STATS_BUCKETS; ++i) {
+        seen += cs->histogram[i];
+        if (seen >= needed) {
+            uint64_t upper = (i == STATS_BUCKETS - 1) ? UINT64_MAX : (UINT64_C(2) << i) - 1;
+            return (upper < cs->max_ns) ? upper : cs->max_ns;
+        }
+    }
+    return cs->max_ns;
+}
+
+void StatsPrint(const Stats *stats, FILE *out) {
+    fprintf(out, "COMMAND COUNT TOTAL_NS P50_NS P99_NS MAX_NS\n");
+    for (int i = 0; i < COMMAND_COUNT; ++i) {
+        const CommandStats *cs = &stats->commands[i];
+        if (cs->count == 0)
+            continue;
+        fprintf(out, "%s %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
+                CommandName((CommandType) i), cs->count, cs->total_ns,
+                Percentile(cs, 50), Percentile(cs, 99), cs->max_ns);
+    }
+}
+
+bool StatsDump(const Stats *stats, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+        return false;
+    StatsPrint(stats, file);
+    fclose(file);
+    return true;
+}
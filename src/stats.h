@@ -0,0 +1,97 @@
+/** @file
+  Interfejs statystyk czasu wykonania poleceń kalkulatora
+
+  Statystyki są zbierane tylko wtedy, gdy program został skompilowany
+  z makrem POLY_STATS (opcja POLY_STATS w CMake). W przeciwnym przypadku
+  makra STATS_START i STATS_STOP nie generują żadnego kodu.
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef POLYNOMIALS_STATS_H
+#define POLYNOMIALS_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "commands.h"
+
+/**
+ * Liczba przedziałów histogramu. Przedział @f$i@f$ zawiera czasy
+ * z zakresu @f$[2^i, 2^{i+1})@f$ nanosekund.
+ */
+#define STATS_BUCKETS 64
+
+/** Struktura przechowująca statystyki jednego rodzaju polecenia. */
+typedef struct CommandStats {
+    uint64_t count; ///< liczba wykonań
+    uint64_t total_ns; ///< łączny czas wykonania w nanosekundach
+    uint64_t max_ns; ///< najdłuższy czas wykonania w nanosekundach
+    uint64_t histogram[STATS_BUCKETS]; ///< histogram czasów w skali logarytmicznej
+} CommandStats;
+
+/** Struktura przechowująca statystyki wszystkich rodzajów poleceń sesji. */
+typedef struct Stats {
+    CommandStats commands[COMMAND_COUNT]; ///< statystyki poszczególnych poleceń
+} Stats;
+
+/**
+ * Daje aktualny czas zegara monotonicznego.
+ * @return czas w nanosekundach
+ */
+uint64_t StatsNow(void);
+
+/**
+ * Zeruje statystyki.
+ * @param[out] stats : statystyki
+ */
+void StatsReset(Stats *stats);
+
+/**
+ * Zapisuje jedno wykonanie polecenia.
+ * @param[in,out] stats : statystyki
+ * @param[in] type : rodzaj polecenia
+ * @param[in] ns : czas wykonania w nanosekundach
+ */
+void StatsRecord(Stats *stats, CommandType type, uint64_t ns);
+
+/**
+ * Dodaje statystyki @p src do statystyk @p dst.
+ * @param[in,out] dst : statystyki, do których dodajemy
+ * @param[in] src : dodawane statystyki
+ */
+void StatsMerge(Stats *dst, const Stats *src);
+
+/**
+ * Wypisuje statystyki poleceń, które zostały wykonane co najmniej raz.
+ * Dla każdego polecenia wypisywana jest liczba wykonań, łączny czas oraz
+ * mediana, 99. percentyl i maksimum czasu wykonania (w nanosekundach).
+ * Percentyle są szacowane z góry na podstawie histogramu.
+ * @param[in] stats : statystyki
+ * @param[in] out : strumień wyjścia
+ */
+void StatsPrint(const Stats *stats, FILE *out);
+
+/**
+ * Zapisuje statystyki do pliku @p path (zastępując jego zawartość).
+ * @param[in] stats : statystyki
+ * @param[in] path : ścieżka do pliku
+ * @return Czy udało się zapisać statystyki?
+ */
+bool StatsDump(const Stats *stats, const char *path);
+
+#ifdef POLY_STATS
+/** Zapamiętuje czas rozpoczęcia mierzonego fragmentu w zmiennej @p start. */
+#define STATS_START(start) uint64_t start = StatsNow()
+/** Zapisuje w @p stats czas, który upłynął od @p start, dla polecenia @p type. */
+#define STATS_STOP(stats, type, start) StatsRecord((stats), (type), StatsNow() - (start))
+#else
+/** Bez POLY_STATS nie mierzymy czasu. */
+#define STATS_START(start) ((void) 0)
+/** Bez POLY_STATS nie mierzymy czasu. */
+#define STATS_STOP(stats, type, start) ((void) 0)
+#endif
+
+#endif //POLYNOMIALS_STATS_H
@@ -0,0 +1,127 @@
+/** @file
+  Implementacja przeglądania wyrazów wielomianu i ich eksportu do tablic
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include <string.h>
+#include "terms.h"
+
+/** Poziom przejścia iteratora: wielomian i indeks kolejnego jednomianu. */
+struct TermFrame {
+    Poly p; ///< widok wielomianu z uwzględnionym znakiem
+    size_t i; ///< indeks kolejnego jednomianu do odwiedzenia
+};
+
+void InitPolyTerms(PolyTerms *t, const Poly *p) {
+    assert(t != NULL && p != NULL);
+    t->exps = NULL;
+    t->vars = 0;
+    t->coeff = 0;
+    t->depth = 0;
+    t->capacity = POLY_TERMS_DEPTH;
+    t->frames = (struct TermFrame*) MemoryAlloc(t->capacity * sizeof(struct TermFrame), MEMORY_WORK);
+    t->exp_stack = (poly_exp_t*) MemoryAlloc(t->capacity * sizeof(poly_exp_t), MEMORY_WORK);
+    t->constant = PolyIsCoeff(p) && !PolyIsZero(p);
+    if (t->constant)
+        t->coeff = p->coeff;
+    else if (!PolyIsCoeff(p))
+        t->frames[t->depth++] = (struct TermFrame) {.p = *p, .i = 0};
+}
+
+/**
+ * Kładzie na stos przejścia kolejny poziom, powiększając w razie potrzeby
+ * tablice stosu.
+ * @param[in,out] t : iterator
+ * @param[in] p : wielomian poziomu
+ */
+static void PolyTermsPush(PolyTerms *t, const Poly *p) {
+    if (t->depth == t->capacity) {
+        size_t capacity = IncreaseSpace(t->capacity);
+        t->frames = (struct TermFrame*) MemoryRealloc(t->frames, t->capacity * sizeof(struct TermFrame),
+                                                      capacity * sizeof(struct TermFrame), MEMORY_WORK);
+        t->exp_stack = (poly_exp_t*) MemoryRealloc(t->exp_stack, t->capacity * sizeof(poly_exp_t),
+                                                   capacity * sizeof(poly_exp_t), MEMORY_WORK);
+        t->capacity = capacity;
+    }
+    t->frames[t->depth++] = (struct TermFrame) {.p = *p, .i = 0};
+}
+
+bool PolyTermsNext(PolyTerms *t) {
+    if (t->constant) {
+        t->constant = false;
+        t->exps = t->exp_stack;
+        t->vars = 0;
+        return true;
+    }
+
+    while (t->depth > 0) {
+        struct TermFrame *top = &t->frames[t->depth - 1];
+        if (top->i == PolyGetSize(&top->p)) {
+            t->depth--;
+            continue;
+        }
+
+        // PolyGetMono uwzględnia znacznik POLY_NEG_TAG, więc współczynniki mają właściwy znak
+        Mono m = PolyGetMono(&top->p, top->i++);
+        t->exp_stack[t->depth - 1] = MonoGetExp(&m);
+        if (PolyIsCoeff(&m.p)) {
+            t->exps = t->exp_stack;
+            t->vars = t->depth;
+            t->coeff = m.p.coeff;
+            return true;
+        }
+        PolyTermsPush(t, &m.p);
+    }
+    return false;
+}
+
+void PolyTermsDestroy(PolyTerms *t) {
+    MemoryFree(t->frames, t->capacity * sizeof(struct TermFrame), MEMORY_WORK);
+    MemoryFree(t->exp_stack, t->capacity * sizeof(poly_exp_t), MEMORY_WORK);
+    t->frames = NULL;
+    t->exp_stack = NULL;
+    t->exps = NULL;
+}
+
+size_t PolyTermCount(const Poly *p) {
+    PolyTerms t;
+    InitPolyTerms(&t, p);
+    size_t count = 0;
+    while (PolyTermsNext(&t))
+        count++;
+    PolyTermsDestroy(&t);
+    return count;
+}
+
+size_t PolyVarCount(const Poly *p) {
+    PolyTerms t;
+    InitPolyTerms(&t, p);
+    size_t vars = 0;
+    while (PolyTermsNext(&t)) {
+        if (t.vars > vars)
+            vars = t.vars;
+    }
+    PolyTermsDestroy(&t);
+    return vars;
+}
+
+size_t PolyExportTerms(const Poly *p, size_t vars, poly_exp_t exps[], poly_coeff_t coeffs[]) {
+    PolyTerms t;
+    InitPolyTerms(&t, p);
+    size_t count = 0;
+    while (PolyTermsNext(&t)) {
+        assert(t.vars <= vars);
+        // wielomian stały można eksportować bez macierzy wykładników
+        if (vars > 0) {
+            poly_exp_t *row = exps + count * vars;
+            memcpy(row, t.exps, t.vars * sizeof(poly_exp_t));
+            memset(row + t.vars, 0, (vars - t.vars) * sizeof(poly_exp_t));
+        }
+        coeffs[count++] = t.coeff;
+    }
+    PolyTermsDestroy(&t);
+    return count;
+}
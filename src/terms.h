@@ -0,0 +1,99 @@
+/** @file
+  Interfejs przeglądania wyrazów wielomianu i ich eksportu do tablic
+
+  Wielomian jest drzewem jednomianów, a jego wyraz to iloczyn stałego
+  współczynnika i potęg kolejnych zmiennych zebranych po drodze od korzenia
+  do liścia. Iterator PolyTerms przechodzi po liściach w głąb, w kolejności
+  rosnących wektorów wykładników porównywanych leksykograficznie
+  (@f$x_0@f$ najpierw, brakujące wykładniki są zerami), i daje kolejne wyrazy
+  bez alokacji pamięci na wyraz: wektor wykładników jest widokiem stosu
+  przejścia. PolyExportTerms zapisuje wszystkie wyrazy do tablic
+  podanych przez wywołującego – macierzy wykładników i tablicy współczynników.
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef POLYNOMIALS_TERMS_H
+#define POLYNOMIALS_TERMS_H
+
+#include "poly.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Początkowa głębokość stosu przejścia iteratora. */
+#define POLY_TERMS_DEPTH 16
+
+/**
+ * Iterator po wyrazach wielomianu. Po udanym wywołaniu PolyTermsNext pola
+ * `exps`, `vars` i `coeff` opisują bieżący wyraz
+ * @f$coeff \cdot x_0^{exps[0]} \cdots x_{vars-1}^{exps[vars-1]}@f$.
+ * Iterator jest widokiem wielomianu, który nie może się zmieniać ani zostać
+ * usunięty przed końcem przeglądania.
+ */
+typedef struct PolyTerms {
+    const poly_exp_t *exps; ///< wykładniki bieżącego wyrazu, ważne do następnego wywołania PolyTermsNext
+    size_t vars; ///< liczba wykładników w exps; wykładniki dalszych zmiennych są zerami
+    poly_coeff_t coeff; ///< współczynnik bieżącego wyrazu
+    struct TermFrame *frames; ///< stos przejścia: jednomiany odwiedzane na kolejnych poziomach
+    poly_exp_t *exp_stack; ///< wykładniki bieżących jednomianów na kolejnych poziomach
+    size_t depth; ///< liczba poziomów na stosie przejścia
+    size_t capacity; ///< liczba poziomów mieszczących się w tablicach stosu
+    bool constant; ///< czy wyrazem do oddania jest niezerowy wielomian stały
+} PolyTerms;
+
+/**
+ * Rozpoczyna przeglądanie wyrazów wielomianu.
+ * @param[out] t : iterator
+ * @param[in] p : wielomian
+ */
+POLY_API void InitPolyTerms(PolyTerms *t, const Poly *p);
+
+/**
+ * Przechodzi do następnego wyrazu.
+ * @param[in,out] t : iterator
+ * @return Czy był jeszcze jakiś wyraz?
+ */
+POLY_API bool PolyTermsNext(PolyTerms *t);
+
+/**
+ * Zwalnia pamięć iteratora.
+ * @param[in,out] t : iterator
+ */
+POLY_API void PolyTermsDestroy(PolyTerms *t);
+
+/**
+ * Daje liczbę wyrazów wielomianu, czyli liczbę wierszy eksportu.
+ * @param[in] p : wielomian
+ * @return liczba wyrazów (0 dla wielomianu zerowego)
+ */
+POLY_API size_t PolyTermCount(const Poly *p);
+
+/**
+ * Daje liczbę zmiennych, od których zależy wielomian, czyli największą
+ * liczbę wykładników wyrazu.
+ * @param[in] p : wielomian
+ * @return liczba kolumn potrzebna w macierzy wykładników
+ */
+POLY_API size_t PolyVarCount(const Poly *p);
+
+/**
+ * Zapisuje wyrazy wielomianu w kolejności iteratora do tablic wywołującego.
+ * Wykładniki wyrazu @f$i@f$ trafiają do wiersza `exps[i * vars ... i * vars + vars - 1]`,
+ * uzupełnionego zerami, a jego współczynnik do `coeffs[i]`.
+ * @param[in] p : wielomian
+ * @param[in] vars : liczba kolumn macierzy, co najmniej PolyVarCount(p)
+ * @param[out] exps : macierz na PolyTermCount(p) * vars wykładników
+ * @param[out] coeffs : tablica na PolyTermCount(p) współczynników
+ * @return liczba zapisanych wyrazów
+ */
+POLY_API size_t PolyExportTerms(const Poly *p, size_t vars, poly_exp_t exps[], poly_coeff_t coeffs[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //POLYNOMIALS_TERMS_H
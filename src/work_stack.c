@@ -0,0 +1,33 @@
+/** @file
+  Implementacja stosu roboczego dla nierekurencyjnych przejść po wielomianach
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include <string.h>
+#include "work_stack.h"
+
+void WorkStackGrow(WorkStack *ws) {
+    size_t old_size = ws->allocated_size;
+    ws->allocated_size = IncreaseSpace(ws->allocated_size);
+    if (ws->arr == ws->local) {
+        // przenosimy ramki z tablicy wywołującego na stertę
+        char *arr = (char*) MemoryAlloc(ws->allocated_size * ws->elem_size, MEMORY_WORK);
+        memcpy(arr, ws->arr, ws->size * ws->elem_size);
+        ws->arr = arr;
+    }
+    else {
+        ws->arr = (char*) MemoryRealloc(ws->arr, old_size * ws->elem_size,
+                                        ws->allocated_size * ws->elem_size, MEMORY_WORK);
+    }
+}
+
+void WorkStackClear(WorkStack *ws) {
+    if (ws->arr != ws->local)
+        MemoryFree(ws->arr, ws->allocated_size * ws->elem_size, MEMORY_WORK);
+    ws->arr = NULL;
+    ws->size = 0;
+    ws->allocated_size = 0;
+}
@@ -0,0 +1,97 @@
+/** @file
+  Interfejs stosu roboczego dla nierekurencyjnych przejść po wielomianach
+
+  Funkcje przechodzące po zagnieżdżonych wielomianach zamiast rekurencji
+  odkładają swój stan na stos roboczy. Pierwsze WORK_STACK_LOCAL_SIZE ramek
+  mieści się w tablicy podanej przez wywołującego (zwykle na stosie wywołań),
+  głębsze przejścia przenoszą ramki na stertę. Głębokość zagnieżdżenia
+  wielomianu jest więc ograniczona tylko ilością pamięci.
+
+  Dariusz Doktorski <dd394248@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef POLYNOMIALS_WORK_STACK_H
+#define POLYNOMIALS_WORK_STACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "memory_helper.h"
+
+/** Liczba ramek w początkowej tablicy stosu roboczego. */
+#define WORK_STACK_LOCAL_SIZE 32
+
+/** Struktura przechowująca stos roboczy ramek o stałym rozmiarze. */
+typedef struct WorkStack {
+    char *arr; ///< tablica ramek
+    size_t size; ///< liczba ramek na stosie
+    size_t allocated_size; ///< liczba ramek, które mieszczą się w tablicy arr
+    size_t elem_size; ///< rozmiar ramki w bajtach
+    char *local; ///< początkowa tablica podana przez wywołującego
+} WorkStack;
+
+/**
+ * Tworzy pusty stos roboczy korzystający początkowo z tablicy @p local.
+ * @param[in] local : tablica na @p count ramek
+ * @param[in] count : liczba ramek mieszczących się w @p local
+ * @param[in] elem_size : rozmiar ramki w bajtach
+ * @return pusty stos roboczy
+ */
+static inline WorkStack InitWorkStack(void *local, size_t count, size_t elem_size) {
+    return (WorkStack) {.arr = (char*) local, .size = 0, .allocated_size = count,
+                        .elem_size = elem_size, .local = (char*) local};
+}
+
+/**
+ * Dwukrotnie powiększa tablicę ramek stosu roboczego.
+ * @param[in,out] ws : stos roboczy
+ */
+void WorkStackGrow(WorkStack *ws);
+
+/**
+ * Zwalnia pamięć zaalokowaną przez stos roboczy na stercie. Po wywołaniu
+ * stos nie może być dalej używany.
+ * @param[in,out] ws : stos roboczy
+ */
+void WorkStackClear(WorkStack *ws);
+
+/**
+ * Sprawdza czy stos roboczy jest pusty.
+ * @param[in] ws : stos roboczy
+ * @return Czy stos roboczy jest pusty?
+ */
+static inline bool WorkStackIsEmpty(const WorkStack *ws) {
+    return ws->size == 0;
+}
+
+/**
+ * Dodaje nową ramkę na szczyt stosu roboczego. Wskaźnik na ramkę jest ważny
+ * do następnego wywołania WorkStackPush.
+ * @param[in,out] ws : stos roboczy
+ * @return wskaźnik na nową, niezainicjowaną ramkę
+ */
+static inline void *WorkStackPush(WorkStack *ws) {
+    if (ws->size == ws->allocated_size)
+        WorkStackGrow(ws);
+    return ws->arr + (ws->size++) * ws->elem_size;
+}
+
+/**
+ * Daje ramkę ze szczytu stosu roboczego.
+ * @param[in] ws : niepusty stos roboczy
+ * @return wskaźnik na ramkę ze szczytu stosu
+ */
+static inline void *WorkStackTop(const WorkStack *ws) {
+    return ws->arr + (ws->size - 1) * ws->elem_size;
+}
+
+/**
+ * Usuwa ramkę ze szczytu stosu roboczego.
+ * @param[in,out] ws : niepusty stos roboczy
+ */
+static inline void WorkStackPop(WorkStack *ws) {
+    ws->size--;
+}
+
+#endif //POLYNOMIALS_WORK_STACK_H